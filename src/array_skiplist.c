@@ -0,0 +1,499 @@
+/**
+* Copyright (C) 2015 Happy Fish / YuQing
+*
+* libfastcommon may be copied only under the terms of the GNU General
+* Public License V3, which may be found in the FastDFS source kit.
+* Please visit the FastDFS Home Page http://www.csource.org/ for more detail.
+**/
+
+//array_skiplist.c
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include "logger.h"
+#include "array_skiplist.h"
+
+#define ARRAY_SKIPLIST_MAX_LEVEL_COUNT  20
+
+int array_skiplist_init_ex(ArraySkiplist *sl, const int level_count,
+        skiplist_compare_func compare_func, skiplist_free_func free_func,
+        const int min_alloc_elements_once)
+{
+    int bytes;
+    int element_size;
+    int i;
+    int alloc_elements_once;
+    int result;
+    struct fast_mblock_man *top_mblock;
+
+    if (level_count <= 0) {
+        logError("file: "__FILE__", line: %d, "
+                "invalid level count: %d",
+                __LINE__, level_count);
+        return EINVAL;
+    }
+
+    if (level_count > ARRAY_SKIPLIST_MAX_LEVEL_COUNT) {
+        logError("file: "__FILE__", line: %d, "
+                "level count: %d is too large",
+                __LINE__, level_count);
+        return E2BIG;
+    }
+
+    bytes = sizeof(struct fast_mblock_man) * level_count;
+    sl->mblocks = (struct fast_mblock_man *)malloc(bytes);
+    if (sl->mblocks == NULL) {
+        logError("file: "__FILE__", line: %d, "
+                "malloc %d bytes fail, errno: %d, error info: %s",
+                __LINE__, bytes, errno, STRERROR(errno));
+        return errno != 0 ? errno : ENOMEM;
+    }
+    memset(sl->mblocks, 0, bytes);
+
+    alloc_elements_once = min_alloc_elements_once;
+    if (alloc_elements_once <= 0) {
+        alloc_elements_once = SKIPLIST_DEFAULT_MIN_ALLOC_ELEMENTS_ONCE;
+    }
+    else if (alloc_elements_once > 1024) {
+        alloc_elements_once = 1024;
+    }
+
+    for (i=level_count-1; i>=0; i--) {
+        element_size = sizeof(ArraySkiplistNode) +
+            sizeof(ArraySkiplistNode *) * (i + 1);
+        if ((result=fast_mblock_init_ex(sl->mblocks + i,
+            element_size, alloc_elements_once, NULL, false)) != 0)
+        {
+            return result;
+        }
+        //one node contains multi elements, so less nodes than flat_skiplist
+        if (alloc_elements_once < 1024 * 1024 / ARRAY_SKIPLIST_NODE_ELEMENTS) {
+            alloc_elements_once *= 2;
+        }
+    }
+
+    sl->top_level_index = level_count - 1;
+    top_mblock = sl->mblocks + sl->top_level_index;
+    sl->top = (ArraySkiplistNode *)fast_mblock_alloc_object(top_mblock);
+    if (sl->top == NULL) {
+        return ENOMEM;
+    }
+    memset(sl->top, 0, top_mblock->info.element_size);
+    sl->top->level_index = sl->top_level_index;
+
+    sl->tail = NULL;
+    sl->element_count = 0;
+    sl->level_count = level_count;
+    sl->compare_func = compare_func;
+    sl->free_func = free_func;
+
+    srand(time(NULL));
+    return 0;
+}
+
+void array_skiplist_destroy(ArraySkiplist *sl)
+{
+    int i;
+    ArraySkiplistNode *node;
+
+    if (sl->mblocks == NULL) {
+        return;
+    }
+
+    if (sl->free_func != NULL) {
+        node = sl->top->links[0];
+        while (node != NULL) {
+            for (i=0; i<node->count; i++) {
+                sl->free_func(node->data[i]);
+            }
+            node = node->links[0];
+        }
+    }
+
+    for (i=0; i<sl->level_count; i++) {
+        fast_mblock_destroy(sl->mblocks + i);
+    }
+
+    free(sl->mblocks);
+    sl->mblocks = NULL;
+}
+
+static inline int array_skiplist_get_level_index(ArraySkiplist *sl)
+{
+    int i;
+
+    for (i=0; i<sl->top_level_index; i++) {
+        if (rand() < RAND_MAX / 2) {
+            break;
+        }
+    }
+
+    return i;
+}
+
+static ArraySkiplistNode *array_skiplist_alloc_node(ArraySkiplist *sl)
+{
+    int level_index;
+    ArraySkiplistNode *node;
+
+    level_index = array_skiplist_get_level_index(sl);
+    node = (ArraySkiplistNode *)fast_mblock_alloc_object(
+            sl->mblocks + level_index);
+    if (node == NULL) {
+        return NULL;
+    }
+
+    memset(node, 0, sl->mblocks[level_index].info.element_size);
+    node->level_index = level_index;
+    return node;
+}
+
+/**
+  find the previous nodes of every level,
+  upper: true for the last node whose first data <= the data,
+         false for the last node whose first data < the data
+  return the previous node of level 0, maybe the top node
+*/
+static ArraySkiplistNode *array_skiplist_get_previous(ArraySkiplist *sl,
+        void *data, ArraySkiplistNode **update, const bool upper)
+{
+    int i;
+    int min_cmp;
+    ArraySkiplistNode *previous;
+    ArraySkiplistNode *next;
+
+    min_cmp = upper ? 0 : 1;
+    previous = sl->top;
+    for (i=sl->top_level_index; i>=0; i--) {
+        while ((next=previous->links[i]) != NULL &&
+                sl->compare_func(data, next->data[0]) >= min_cmp)
+        {
+            previous = next;
+        }
+        update[i] = previous;
+    }
+
+    return previous;
+}
+
+//return the first index whose data > the data (upper) or >= the data
+static int array_skiplist_bsearch(ArraySkiplist *sl,
+        ArraySkiplistNode *node, void *data, const bool upper)
+{
+    int low;
+    int high;
+    int mid;
+    int min_cmp;
+
+    min_cmp = upper ? 0 : 1;
+    low = 0;
+    high = node->count;
+    while (low < high) {
+        mid = (low + high) / 2;
+        if (sl->compare_func(data, node->data[mid]) >= min_cmp) {
+            low = mid + 1;
+        }
+        else {
+            high = mid;
+        }
+    }
+
+    return low;
+}
+
+static void array_skiplist_link_after(ArraySkiplist *sl,
+        ArraySkiplistNode *previous, ArraySkiplistNode *node,
+        ArraySkiplistNode **update)
+{
+    int i;
+    ArraySkiplistNode *pred;
+
+    for (i=0; i<=node->level_index; i++) {
+        pred = (i <= previous->level_index) ? previous : update[i];
+        node->links[i] = pred->links[i];
+        pred->links[i] = node;
+    }
+
+    node->prev = (previous != sl->top) ? previous : NULL;
+    if (node->links[0] != NULL) {
+        node->links[0]->prev = node;
+    }
+    else {
+        sl->tail = node;
+    }
+}
+
+int array_skiplist_insert(ArraySkiplist *sl, void *data)
+{
+    int index;
+    int keep;
+    ArraySkiplistNode *update[ARRAY_SKIPLIST_MAX_LEVEL_COUNT];
+    ArraySkiplistNode *previous;
+    ArraySkiplistNode *node;
+    ArraySkiplistNode *new_node;
+
+    previous = array_skiplist_get_previous(sl, data, update, true);
+    node = (previous != sl->top) ? previous : sl->top->links[0];
+    if (node == NULL) {   //empty
+        if ((node=array_skiplist_alloc_node(sl)) == NULL) {
+            return ENOMEM;
+        }
+        array_skiplist_link_after(sl, sl->top, node, update);
+    }
+
+    index = array_skiplist_bsearch(sl, node, data, true);
+    if (node->count == ARRAY_SKIPLIST_NODE_ELEMENTS) {
+        if ((new_node=array_skiplist_alloc_node(sl)) == NULL) {
+            return ENOMEM;
+        }
+
+        //split the full node, move the upper half to the new node
+        keep = ARRAY_SKIPLIST_NODE_ELEMENTS - ARRAY_SKIPLIST_NODE_ELEMENTS / 2;
+        new_node->count = node->count - keep;
+        memcpy(new_node->data, node->data + keep,
+                sizeof(void *) * new_node->count);
+        node->count = keep;
+        array_skiplist_link_after(sl, node, new_node, update);
+
+        if (index > keep) {
+            node = new_node;
+            index -= keep;
+        }
+    }
+
+    if (index < node->count) {
+        memmove(node->data + index + 1, node->data + index,
+                sizeof(void *) * (node->count - index));
+    }
+    node->data[index] = data;
+    node->count++;
+    sl->element_count++;
+    return 0;
+}
+
+//find the position of the first data >= the data, the node is NULL for end
+static void array_skiplist_lower_bound(ArraySkiplist *sl, void *data,
+        ArraySkiplistNode **update, ArraySkiplistPosition *pos)
+{
+    ArraySkiplistNode *previous;
+
+    previous = array_skiplist_get_previous(sl, data, update, false);
+    pos->node = (previous != sl->top) ? previous : sl->top->links[0];
+    if (pos->node == NULL) {
+        pos->index = 0;
+        return;
+    }
+
+    pos->index = array_skiplist_bsearch(sl, pos->node, data, false);
+    array_skiplist_normalize(pos);
+}
+
+//find the position of the first data equal to the data
+static ArraySkiplistNode *array_skiplist_find_first(ArraySkiplist *sl,
+        void *data, ArraySkiplistNode **update, int *index)
+{
+    ArraySkiplistPosition pos;
+
+    array_skiplist_lower_bound(sl, data, update, &pos);
+    if (pos.node == NULL || sl->compare_func(data,
+                pos.node->data[pos.index]) != 0)
+    {
+        return NULL;
+    }
+
+    *index = pos.index;
+    return pos.node;
+}
+
+static void array_skiplist_remove_node(ArraySkiplist *sl,
+        ArraySkiplistNode *node, ArraySkiplistNode **update)
+{
+    int i;
+
+    for (i=0; i<=node->level_index; i++) {
+        assert(update[i]->links[i] == node);
+        update[i]->links[i] = node->links[i];
+    }
+
+    if (node->links[0] != NULL) {
+        node->links[0]->prev = node->prev;
+    }
+    else {
+        sl->tail = node->prev;
+    }
+
+    fast_mblock_free_object(sl->mblocks + node->level_index, node);
+}
+
+int array_skiplist_delete(ArraySkiplist *sl, void *data)
+{
+    int index;
+    ArraySkiplistNode *update[ARRAY_SKIPLIST_MAX_LEVEL_COUNT];
+    ArraySkiplistNode *node;
+    void *deleted;
+
+    node = array_skiplist_find_first(sl, data, update, &index);
+    if (node == NULL) {
+        return ENOENT;
+    }
+
+    deleted = node->data[index];
+    node->count--;
+    if (index < node->count) {
+        memmove(node->data + index, node->data + index + 1,
+                sizeof(void *) * (node->count - index));
+    }
+    sl->element_count--;
+
+    if (node->count == 0) {
+        array_skiplist_remove_node(sl, node, update);
+    }
+
+    if (sl->free_func != NULL) {
+        sl->free_func(deleted);
+    }
+    return 0;
+}
+
+int array_skiplist_delete_all(ArraySkiplist *sl, void *data, int *delete_count)
+{
+    *delete_count = 0;
+    while (array_skiplist_delete(sl, data) == 0) {
+        (*delete_count)++;
+    }
+
+    return *delete_count > 0 ? 0 : ENOENT;
+}
+
+void *array_skiplist_find(ArraySkiplist *sl, void *data)
+{
+    int index;
+    ArraySkiplistNode *update[ARRAY_SKIPLIST_MAX_LEVEL_COUNT];
+    ArraySkiplistNode *node;
+
+    node = array_skiplist_find_first(sl, data, update, &index);
+    return (node != NULL) ? node->data[index] : NULL;
+}
+
+int array_skiplist_find_all(ArraySkiplist *sl, void *data,
+        ArraySkiplistIterator *iterator)
+{
+    int index;
+    ArraySkiplistNode *update[ARRAY_SKIPLIST_MAX_LEVEL_COUNT];
+    ArraySkiplistNode *previous;
+    ArraySkiplistNode *node;
+
+    node = array_skiplist_find_first(sl, data, update, &index);
+    if (node == NULL) {
+        iterator->current.node = iterator->end.node = NULL;
+        iterator->current.index = iterator->end.index = 0;
+        return ENOENT;
+    }
+
+    iterator->current.node = node;
+    iterator->current.index = index;
+
+    previous = array_skiplist_get_previous(sl, data, update, true);
+    iterator->end.node = previous;
+    iterator->end.index = array_skiplist_bsearch(sl, previous, data, true);
+    array_skiplist_normalize(&iterator->end);
+    return 0;
+}
+
+void *array_skiplist_find_ge(ArraySkiplist *sl, void *data)
+{
+    ArraySkiplistNode *update[ARRAY_SKIPLIST_MAX_LEVEL_COUNT];
+    ArraySkiplistPosition pos;
+
+    array_skiplist_lower_bound(sl, data, update, &pos);
+    return (pos.node != NULL) ? pos.node->data[pos.index] : NULL;
+}
+
+void *array_skiplist_find_le(ArraySkiplist *sl, void *data)
+{
+    int index;
+    ArraySkiplistNode *update[ARRAY_SKIPLIST_MAX_LEVEL_COUNT];
+    ArraySkiplistNode *previous;
+
+    previous = array_skiplist_get_previous(sl, data, update, true);
+    if (previous == sl->top) {
+        return NULL;
+    }
+
+    //the first data of the previous node <= the data, so index > 0
+    index = array_skiplist_bsearch(sl, previous, data, true);
+    return previous->data[index - 1];
+}
+
+int array_skiplist_find_range(ArraySkiplist *sl, void *start, void *end,
+        ArraySkiplistIterator *iterator)
+{
+    ArraySkiplistNode *update[ARRAY_SKIPLIST_MAX_LEVEL_COUNT];
+
+    if (sl->compare_func(start, end) >= 0) {
+        iterator->current.node = iterator->end.node = NULL;
+        iterator->current.index = iterator->end.index = 0;
+        return ENOENT;
+    }
+
+    array_skiplist_lower_bound(sl, start, update, &iterator->current);
+    array_skiplist_lower_bound(sl, end, update, &iterator->end);
+    return (iterator->current.node != iterator->end.node ||
+            iterator->current.index != iterator->end.index) ? 0 : ENOENT;
+}
+
+int array_skiplist_delete_range(ArraySkiplist *sl, void *start, void *end,
+        int *delete_count)
+{
+    int i;
+    int end_index;
+    int count;
+    ArraySkiplistNode *update[ARRAY_SKIPLIST_MAX_LEVEL_COUNT];
+    ArraySkiplistPosition pos;
+    ArraySkiplistNode *next;
+
+    *delete_count = 0;
+    if (sl->compare_func(start, end) >= 0) {
+        return ENOENT;
+    }
+
+    /* the update nodes keep valid because the nodes between them and
+       the current node are removed in order */
+    array_skiplist_lower_bound(sl, start, update, &pos);
+    while (pos.node != NULL) {
+        end_index = array_skiplist_bsearch(sl, pos.node, end, false);
+        count = end_index - pos.index;
+        if (sl->free_func != NULL) {
+            for (i=pos.index; i<end_index; i++) {
+                sl->free_func(pos.node->data[i]);
+            }
+        }
+        *delete_count += count;
+        sl->element_count -= count;
+
+        next = pos.node->links[0];
+        if (end_index < pos.node->count) {
+            if (count > 0) {
+                memmove(pos.node->data + pos.index, pos.node->data + end_index,
+                        sizeof(void *) * (pos.node->count - end_index));
+                pos.node->count -= count;
+            }
+            break;
+        }
+
+        if (pos.index == 0) {
+            array_skiplist_remove_node(sl, pos.node, update);
+        }
+        else {
+            pos.node->count = pos.index;
+        }
+        pos.node = next;
+        pos.index = 0;
+    }
+
+    return *delete_count > 0 ? 0 : ENOENT;
+}
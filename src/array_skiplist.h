@@ -0,0 +1,157 @@
+/**
+* Copyright (C) 2015 Happy Fish / YuQing
+*
+* libfastcommon may be copied only under the terms of the GNU General
+* Public License V3, which may be found in the FastDFS source kit.
+* Please visit the FastDFS Home Page http://www.csource.org/ for more detail.
+**/
+
+//array_skiplist.h, cache conscious skiplist, support stable sort  :)
+/**
+  the skiplist links nodes of multi elements instead of single element,
+  each node stores the sorted data pointers in a contiguous array, so the
+  link hops are reduced to 1 / ARRAY_SKIPLIST_NODE_ELEMENTS and the scan
+  in the node is cache friendly. the level 0 node is two cache lines.
+*/
+#ifndef _ARRAY_SKIPLIST_H
+#define _ARRAY_SKIPLIST_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "common_define.h"
+#include "skiplist_common.h"
+#include "fast_mblock.h"
+
+#define ARRAY_SKIPLIST_NODE_ELEMENTS  13
+
+typedef struct array_skiplist_node
+{
+    short count;
+    short level_index;
+    struct array_skiplist_node *prev;   //for reverse iterator
+    void *data[ARRAY_SKIPLIST_NODE_ELEMENTS];
+    struct array_skiplist_node *links[0];
+} ArraySkiplistNode;
+
+typedef struct array_skiplist
+{
+    int level_count;
+    int top_level_index;
+    int element_count;
+    skiplist_compare_func compare_func;
+    skiplist_free_func free_func;
+    struct fast_mblock_man *mblocks;  //node allocators
+    ArraySkiplistNode *top;   //the top node
+    ArraySkiplistNode *tail;  //the last data node, NULL when empty
+} ArraySkiplist;
+
+typedef struct array_skiplist_position {
+    ArraySkiplistNode *node;
+    int index;
+} ArraySkiplistPosition;
+
+typedef struct array_skiplist_iterator {
+    ArraySkiplistPosition current;
+    ArraySkiplistPosition end;
+} ArraySkiplistIterator;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define array_skiplist_init(sl, level_count, compare_func, free_func) \
+    array_skiplist_init_ex(sl, level_count, compare_func, free_func,  \
+    SKIPLIST_DEFAULT_MIN_ALLOC_ELEMENTS_ONCE)
+
+int array_skiplist_init_ex(ArraySkiplist *sl, const int level_count,
+        skiplist_compare_func compare_func, skiplist_free_func free_func,
+        const int min_alloc_elements_once);
+
+void array_skiplist_destroy(ArraySkiplist *sl);
+
+int array_skiplist_insert(ArraySkiplist *sl, void *data);
+int array_skiplist_delete(ArraySkiplist *sl, void *data);
+int array_skiplist_delete_all(ArraySkiplist *sl, void *data, int *delete_count);
+void *array_skiplist_find(ArraySkiplist *sl, void *data);
+int array_skiplist_find_all(ArraySkiplist *sl, void *data,
+        ArraySkiplistIterator *iterator);
+
+//return the first data >= the data, NULL for not found
+void *array_skiplist_find_ge(ArraySkiplist *sl, void *data);
+
+//return the last data <= the data, NULL for not found
+void *array_skiplist_find_le(ArraySkiplist *sl, void *data);
+
+//iterate the data in [start, end), return ENOENT for empty
+int array_skiplist_find_range(ArraySkiplist *sl, void *start, void *end,
+        ArraySkiplistIterator *iterator);
+
+//delete the data in [start, end), return ENOENT when nothing deleted
+int array_skiplist_delete_range(ArraySkiplist *sl, void *start, void *end,
+        int *delete_count);
+
+static inline void array_skiplist_normalize(ArraySkiplistPosition *pos)
+{
+    while (pos->node != NULL && pos->index >= pos->node->count) {
+        pos->node = pos->node->links[0];
+        pos->index = 0;
+    }
+}
+
+static inline void array_skiplist_iterator(ArraySkiplist *sl,
+        ArraySkiplistIterator *iterator)
+{
+    iterator->current.node = sl->top->links[0];
+    iterator->current.index = 0;
+    iterator->end.node = NULL;
+    iterator->end.index = 0;
+}
+
+static inline void *array_skiplist_next(ArraySkiplistIterator *iterator)
+{
+    array_skiplist_normalize(&iterator->current);
+    if (iterator->current.node == iterator->end.node &&
+            iterator->current.index == iterator->end.index)
+    {
+        return NULL;
+    }
+
+    return iterator->current.node->data[iterator->current.index++];
+}
+
+//iterate from the last data to the first by array_skiplist_prev
+static inline void array_skiplist_reverse_iterator(ArraySkiplist *sl,
+        ArraySkiplistIterator *iterator)
+{
+    iterator->current.node = sl->tail;
+    iterator->current.index = (sl->tail != NULL) ? sl->tail->count : 0;
+    iterator->end.node = NULL;
+    iterator->end.index = 0;
+}
+
+static inline void *array_skiplist_prev(ArraySkiplistIterator *iterator)
+{
+    while (iterator->current.node != NULL && iterator->current.index == 0) {
+        iterator->current.node = iterator->current.node->prev;
+        if (iterator->current.node != NULL) {
+            iterator->current.index = iterator->current.node->count;
+        }
+    }
+
+    if (iterator->current.node == NULL) {
+        return NULL;
+    }
+    return iterator->current.node->data[--iterator->current.index];
+}
+
+static inline int array_skiplist_count(ArraySkiplist *sl)
+{
+    return sl->element_count;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,655 @@
+/**
+* Copyright (C) 2008 Happy Fish / YuQing
+*
+* FastDFS may be copied only under the terms of the GNU General
+* Public License V3, which may be found in the FastDFS source kit.
+* Please visit the FastDFS Home Page http://www.csource.org/ for more detail.
+**/
+
+#include <stddef.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include "logger.h"
+#include "sockopt.h"
+#include "shared_func.h"
+#include "sched_thread.h"
+#include "ioevent_loop.h"
+#include "async_conn_pool.h"
+
+#define ASYNC_CONN_NODE_BY_CONN(conn) \
+	((AsyncConnNode *)((char *)(conn) - offsetof(AsyncConnNode, conn)))
+
+#define ASYNC_CONN_POOL_BY_TIMER(event) \
+	((AsyncConnPool *)((char *)(event) - offsetof(AsyncConnPool, timer_event)))
+
+static void async_conn_pool_timer_callback(int sock, short event, void *arg);
+
+static int async_conn_add_timer(AsyncConnPool *pool)
+{
+	pool->timer_event.timer.expires = g_current_time + 1;
+	return fast_timer_add(&pool->thread_data->timer,
+			&pool->timer_event.timer);
+}
+
+int async_conn_pool_init(AsyncConnPool *pool, \
+		struct nio_thread_data *thread_data, const int connect_timeout, \
+		const int max_count_per_entry, const int max_idle_time, \
+		const int health_check_interval)
+{
+	int result;
+
+	memset(pool, 0, sizeof(AsyncConnPool));
+	pool->thread_data = thread_data;
+	pool->connect_timeout = connect_timeout > 0 ? connect_timeout : 1;
+	pool->max_count_per_entry = max_count_per_entry;
+	pool->max_idle_time = max_idle_time;
+	pool->health_check_interval = health_check_interval;
+
+	if ((result=fast_mblock_init_ex(&pool->node_allocator,
+			sizeof(AsyncConnNode), 0, NULL, false)) != 0)
+	{
+		return result;
+	}
+	if ((result=fast_mblock_init_ex(&pool->waiter_allocator,
+			sizeof(AsyncConnWaiter), 0, NULL, false)) != 0)
+	{
+		fast_mblock_destroy(&pool->node_allocator);
+		return result;
+	}
+
+	pool->timer_event.fd = -1;
+	pool->timer_event.callback = async_conn_pool_timer_callback;
+	pool->timer_event.timer.data = &pool->timer_event;
+	if ((result=async_conn_add_timer(pool)) != 0)
+	{
+		logError("file: "__FILE__", line: %d, " \
+			"fast_timer_add fail, " \
+			"errno: %d, error info: %s", \
+			__LINE__, result, STRERROR(result));
+		fast_mblock_destroy(&pool->waiter_allocator);
+		fast_mblock_destroy(&pool->node_allocator);
+		return result;
+	}
+
+	return 0;
+}
+
+static void async_conn_free_node(AsyncConnPool *pool, AsyncConnNode *node)
+{
+	AsyncConnEndpoint *endpoint;
+
+	endpoint = node->endpoint;
+	if (node->status == ASYNC_CONN_STATUS_CONNECTING)
+	{
+		fast_timer_remove(&pool->thread_data->timer, &node->event.timer);
+		ioevent_detach(&pool->thread_data->ev_puller, node->conn.sock);
+		ioevent_remove(&pool->thread_data->ev_puller, node);
+		endpoint->connecting_count--;
+	}
+
+	conn_pool_disconnect_server(&node->conn);
+	chain_link_remove(&node->link);
+	endpoint->total_count--;
+	fast_mblock_free_object(&pool->node_allocator, node);
+}
+
+static void async_conn_fail_waiters(AsyncConnEndpoint *endpoint,
+		const int err_no)
+{
+	AsyncConnWaiter *waiter;
+	AsyncConnCallback callback;
+	void *arg;
+
+	while (endpoint->waiters.head != NULL)
+	{
+		waiter = endpoint->waiters.head;
+		endpoint->waiters.head = waiter->next;
+		if (endpoint->waiters.head == NULL)
+		{
+			endpoint->waiters.tail = NULL;
+		}
+		endpoint->waiters.count--;
+
+		callback = waiter->callback;
+		arg = waiter->arg;
+		fast_mblock_free_object(&endpoint->pool->waiter_allocator, waiter);
+		callback(NULL, err_no, arg);
+	}
+}
+
+void async_conn_pool_destroy(AsyncConnPool *pool)
+{
+	AsyncConnEndpoint *endpoint;
+	AsyncConnNode *node;
+
+	fast_timer_remove(&pool->thread_data->timer, &pool->timer_event.timer);
+	while (pool->endpoints != NULL)
+	{
+		endpoint = pool->endpoints;
+		pool->endpoints = endpoint->next;
+
+		async_conn_fail_waiters(endpoint, ECANCELED);
+		while (!chain_link_empty(&endpoint->nodes))
+		{
+			node = CHAIN_LINK_ENTRY(chain_link_first(&endpoint->nodes),
+					AsyncConnNode, link);
+			if (node->status == ASYNC_CONN_STATUS_BUSY)
+			{
+				logWarning("file: "__FILE__", line: %d, " \
+					"the connection to %s:%d is in use " \
+					"when destroy", __LINE__, \
+					endpoint->server.ip_addr, endpoint->server.port);
+			}
+			async_conn_free_node(pool, node);
+		}
+		free(endpoint);
+	}
+
+	fast_mblock_destroy(&pool->waiter_allocator);
+	fast_mblock_destroy(&pool->node_allocator);
+}
+
+/* deliver the ready connection to the first waiter, or push it to the
+ * free list when no waiter */
+static void async_conn_release_node(AsyncConnEndpoint *endpoint,
+		AsyncConnNode *node)
+{
+	AsyncConnWaiter *waiter;
+	AsyncConnCallback callback;
+	void *arg;
+
+	node->atime = g_current_time;
+	if (endpoint->waiters.head == NULL)
+	{
+		node->status = ASYNC_CONN_STATUS_IDLE;
+		node->check_time = g_current_time;
+		node->next = endpoint->free_head;
+		endpoint->free_head = node;
+		endpoint->free_count++;
+		return;
+	}
+
+	waiter = endpoint->waiters.head;
+	endpoint->waiters.head = waiter->next;
+	if (endpoint->waiters.head == NULL)
+	{
+		endpoint->waiters.tail = NULL;
+	}
+	endpoint->waiters.count--;
+
+	node->status = ASYNC_CONN_STATUS_BUSY;
+	callback = waiter->callback;
+	arg = waiter->arg;
+	fast_mblock_free_object(&endpoint->pool->waiter_allocator, waiter);
+	callback(&node->conn, 0, arg);
+}
+
+static void async_conn_set_fail(AsyncConnEndpoint *endpoint,
+		const int err_no)
+{
+	int interval;
+
+	endpoint->fail_count++;
+	endpoint->last_errno = err_no;
+	if (endpoint->fail_count > 5)
+	{
+		interval = ASYNC_CONN_MAX_RETRY_INTERVAL;
+	}
+	else
+	{
+		interval = 1 << (endpoint->fail_count - 1);
+		if (interval > ASYNC_CONN_MAX_RETRY_INTERVAL)
+		{
+			interval = ASYNC_CONN_MAX_RETRY_INTERVAL;
+		}
+	}
+	endpoint->retry_time = g_current_time + interval;
+}
+
+static void async_conn_connect_callback(int sock, short event, void *arg)
+{
+	AsyncConnNode *node;
+	AsyncConnEndpoint *endpoint;
+	AsyncConnPool *pool;
+	socklen_t len;
+	int result;
+
+	node = (AsyncConnNode *)arg;
+	endpoint = node->endpoint;
+	pool = endpoint->pool;
+	if (event & IOEVENT_TIMEOUT)
+	{
+		result = ETIMEDOUT;
+	}
+	else
+	{
+		fast_timer_remove(&pool->thread_data->timer, &node->event.timer);
+		len = sizeof(result);
+		if (getsockopt(sock, SOL_SOCKET, SO_ERROR, &result, &len) < 0)
+		{
+			result = errno != 0 ? errno : EACCES;
+		}
+	}
+
+	if (result != 0)
+	{
+		logError("file: "__FILE__", line: %d, " \
+			"connect to %s:%d fail, errno: %d, " \
+			"error info: %s", __LINE__, endpoint->server.ip_addr, \
+			endpoint->server.port, result, STRERROR(result));
+
+		async_conn_free_node(pool, node);
+		async_conn_set_fail(endpoint, result);
+		if (endpoint->total_count == 0)  //no connection to wait
+		{
+			async_conn_fail_waiters(endpoint, result);
+		}
+		return;
+	}
+
+	ioevent_detach(&pool->thread_data->ev_puller, sock);
+	endpoint->connecting_count--;
+	endpoint->fail_count = 0;
+	endpoint->retry_time = 0;
+	async_conn_release_node(endpoint, node);
+}
+
+static int async_conn_connect(AsyncConnEndpoint *endpoint)
+{
+	AsyncConnPool *pool;
+	AsyncConnNode *node;
+	struct sockaddr_in addr;
+	struct sockaddr_in6 addr6;
+	void *dest;
+	int size;
+	int domain;
+	int result;
+
+	pool = endpoint->pool;
+	node = (AsyncConnNode *)fast_mblock_alloc_object(&pool->node_allocator);
+	if (node == NULL)
+	{
+		return ENOMEM;
+	}
+	memset(node, 0, sizeof(AsyncConnNode));
+	node->conn = endpoint->server;
+	node->endpoint = endpoint;
+
+	if (endpoint->server.socket_domain == AF_INET ||
+		endpoint->server.socket_domain == AF_INET6)
+	{
+		domain = endpoint->server.socket_domain;
+	}
+	else
+	{
+		domain = is_ipv6_addr(endpoint->server.ip_addr) ? AF_INET6 : AF_INET;
+	}
+
+	do
+	{
+		memset(&addr, 0, sizeof(addr));
+		memset(&addr6, 0, sizeof(addr6));
+		if ((result=setsockaddrbyip(endpoint->server.ip_addr,
+				endpoint->server.port, &addr, &addr6,
+				&dest, &size)) != 0)
+		{
+			break;
+		}
+
+		node->conn.sock = socket(domain, SOCK_STREAM, 0);
+		if (node->conn.sock < 0)
+		{
+			result = errno != 0 ? errno : EPERM;
+			logError("file: "__FILE__", line: %d, " \
+				"socket create failed, errno: %d, " \
+				"error info: %s", __LINE__, result, STRERROR(result));
+			break;
+		}
+		if ((result=tcpsetnonblockopt(node->conn.sock)) != 0)
+		{
+			break;
+		}
+
+		/* the immediate success is also notified by the write event */
+		if (connect(node->conn.sock, (const struct sockaddr *)dest,
+				size) < 0 && errno != EINPROGRESS)
+		{
+			result = errno != 0 ? errno : EINPROGRESS;
+			logError("file: "__FILE__", line: %d, " \
+				"connect to %s:%d fail, errno: %d, " \
+				"error info: %s", __LINE__, endpoint->server.ip_addr, \
+				endpoint->server.port, result, STRERROR(result));
+			break;
+		}
+
+		node->event.fd = node->conn.sock;
+		node->event.callback = async_conn_connect_callback;
+		node->event.timer.data = node;
+		if (ioevent_attach(&pool->thread_data->ev_puller,
+			node->conn.sock, IOEVENT_WRITE, node) < 0)
+		{
+			result = errno != 0 ? errno : ENOENT;
+			logError("file: "__FILE__", line: %d, " \
+				"ioevent_attach fail, " \
+				"errno: %d, error info: %s", \
+				__LINE__, result, STRERROR(result));
+			break;
+		}
+
+		node->event.timer.expires = g_current_time + pool->connect_timeout;
+		if ((result=fast_timer_add(&pool->thread_data->timer,
+				&node->event.timer)) != 0)
+		{
+			ioevent_detach(&pool->thread_data->ev_puller, node->conn.sock);
+			break;
+		}
+	} while (0);
+
+	if (result != 0)
+	{
+		conn_pool_disconnect_server(&node->conn);
+		fast_mblock_free_object(&pool->node_allocator, node);
+		async_conn_set_fail(endpoint, result);
+		return result;
+	}
+
+	node->status = ASYNC_CONN_STATUS_CONNECTING;
+	chain_link_add_tail(&endpoint->nodes, &node->link);
+	endpoint->total_count++;
+	endpoint->connecting_count++;
+	return 0;
+}
+
+static inline bool async_conn_can_connect(AsyncConnPool *pool,
+		AsyncConnEndpoint *endpoint)
+{
+	return (endpoint->retry_time <= g_current_time) &&
+		(pool->max_count_per_entry == 0 ||
+		 endpoint->total_count < pool->max_count_per_entry);
+}
+
+/* connect for the min count and the waiters in the background */
+static void async_conn_warm_up(AsyncConnPool *pool,
+		AsyncConnEndpoint *endpoint)
+{
+	while (async_conn_can_connect(pool, endpoint) &&
+		(endpoint->total_count < endpoint->min_count ||
+		 endpoint->connecting_count < endpoint->waiters.count))
+	{
+		if (async_conn_connect(endpoint) != 0)
+		{
+			break;
+		}
+	}
+}
+
+static AsyncConnEndpoint *async_conn_get_endpoint(AsyncConnPool *pool,
+		const ConnectionInfo *server)
+{
+	AsyncConnEndpoint *endpoint;
+
+	endpoint = pool->endpoints;
+	while (endpoint != NULL)
+	{
+		if (endpoint->server.port == server->port &&
+			strcmp(endpoint->server.ip_addr, server->ip_addr) == 0)
+		{
+			return endpoint;
+		}
+		endpoint = endpoint->next;
+	}
+
+	return NULL;
+}
+
+static AsyncConnEndpoint *async_conn_add_endpoint(AsyncConnPool *pool,
+		const ConnectionInfo *server, const int min_count)
+{
+	AsyncConnEndpoint *endpoint;
+
+	endpoint = (AsyncConnEndpoint *)malloc(sizeof(AsyncConnEndpoint));
+	if (endpoint == NULL)
+	{
+		logError("file: "__FILE__", line: %d, " \
+			"malloc %d bytes fail", __LINE__, \
+			(int)sizeof(AsyncConnEndpoint));
+		return NULL;
+	}
+
+	memset(endpoint, 0, sizeof(AsyncConnEndpoint));
+	endpoint->server = *server;
+	endpoint->server.sock = -1;
+	endpoint->min_count = min_count;
+	chain_link_init(&endpoint->nodes);
+	endpoint->pool = pool;
+	endpoint->next = pool->endpoints;
+	pool->endpoints = endpoint;
+	return endpoint;
+}
+
+int async_conn_pool_add_endpoint(AsyncConnPool *pool, \
+		const ConnectionInfo *server, const int min_count)
+{
+	AsyncConnEndpoint *endpoint;
+
+	endpoint = async_conn_get_endpoint(pool, server);
+	if (endpoint == NULL)
+	{
+		if ((endpoint=async_conn_add_endpoint(pool, server,
+				min_count)) == NULL)
+		{
+			return ENOMEM;
+		}
+	}
+	else
+	{
+		endpoint->min_count = min_count;
+	}
+
+	async_conn_warm_up(pool, endpoint);
+	return 0;
+}
+
+int async_conn_pool_get_connection(AsyncConnPool *pool, \
+		const ConnectionInfo *server, AsyncConnCallback callback, \
+		void *arg, ConnectionInfo **conn)
+{
+	AsyncConnEndpoint *endpoint;
+	AsyncConnNode *node;
+	AsyncConnWaiter *waiter;
+	int result;
+
+	*conn = NULL;
+	endpoint = async_conn_get_endpoint(pool, server);
+	if (endpoint == NULL)
+	{
+		if ((endpoint=async_conn_add_endpoint(pool, server, 0)) == NULL)
+		{
+			return ENOMEM;
+		}
+	}
+
+	if (endpoint->free_head != NULL)
+	{
+		node = endpoint->free_head;
+		endpoint->free_head = node->next;
+		endpoint->free_count--;
+		node->status = ASYNC_CONN_STATUS_BUSY;
+		node->atime = g_current_time;
+		*conn = &node->conn;
+		return 0;
+	}
+
+	//fail fast when the server is down
+	if (endpoint->connecting_count == 0 &&
+		endpoint->retry_time > g_current_time &&
+		endpoint->total_count == 0)
+	{
+		return endpoint->last_errno != 0 ?
+			endpoint->last_errno : ECONNREFUSED;
+	}
+
+	if (endpoint->connecting_count <= endpoint->waiters.count &&
+		async_conn_can_connect(pool, endpoint))
+	{
+		if ((result=async_conn_connect(endpoint)) != 0 &&
+			endpoint->connecting_count == 0 &&
+			endpoint->total_count == 0)
+		{
+			return result;
+		}
+	}
+
+	waiter = (AsyncConnWaiter *)fast_mblock_alloc_object(
+			&pool->waiter_allocator);
+	if (waiter == NULL)
+	{
+		return ENOMEM;
+	}
+	waiter->callback = callback;
+	waiter->arg = arg;
+	waiter->expires = g_current_time + pool->connect_timeout;
+	waiter->next = NULL;
+	if (endpoint->waiters.tail == NULL)
+	{
+		endpoint->waiters.head = waiter;
+	}
+	else
+	{
+		endpoint->waiters.tail->next = waiter;
+	}
+	endpoint->waiters.tail = waiter;
+	endpoint->waiters.count++;
+	return EINPROGRESS;
+}
+
+void async_conn_pool_close_connection_ex(AsyncConnPool *pool, \
+		ConnectionInfo *conn, const bool bForce)
+{
+	AsyncConnNode *node;
+	AsyncConnEndpoint *endpoint;
+
+	node = ASYNC_CONN_NODE_BY_CONN(conn);
+	endpoint = node->endpoint;
+	if (bForce)
+	{
+		async_conn_free_node(pool, node);
+		async_conn_warm_up(pool, endpoint);
+	}
+	else
+	{
+		async_conn_release_node(endpoint, node);
+	}
+}
+
+/* check the idle connection without the read event: the server should
+ * NOT send anything to the idle connection */
+static bool async_conn_is_alive(AsyncConnNode *node)
+{
+	char buff[1];
+	int bytes;
+
+	bytes = recv(node->conn.sock, buff, sizeof(buff),
+			MSG_PEEK | MSG_DONTWAIT);
+	if (bytes == 0)
+	{
+		return false;  //closed by the server
+	}
+	if (bytes > 0)
+	{
+		logWarning("file: "__FILE__", line: %d, " \
+			"the idle connection to %s:%d has unexpected data, " \
+			"close it", __LINE__, node->conn.ip_addr, node->conn.port);
+		return false;
+	}
+
+	return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR);
+}
+
+static void async_conn_check_endpoint(AsyncConnPool *pool,
+		AsyncConnEndpoint *endpoint)
+{
+	AsyncConnWaiter *waiter;
+	AsyncConnCallback callback;
+	AsyncConnNode *node;
+	AsyncConnNode *previous;
+	AsyncConnNode *current;
+	void *arg;
+	bool need_close;
+
+	//the waiters are in the expire order
+	while (endpoint->waiters.head != NULL &&
+		endpoint->waiters.head->expires <= g_current_time)
+	{
+		waiter = endpoint->waiters.head;
+		endpoint->waiters.head = waiter->next;
+		if (endpoint->waiters.head == NULL)
+		{
+			endpoint->waiters.tail = NULL;
+		}
+		endpoint->waiters.count--;
+
+		callback = waiter->callback;
+		arg = waiter->arg;
+		fast_mblock_free_object(&pool->waiter_allocator, waiter);
+		callback(NULL, ETIMEDOUT, arg);
+	}
+
+	previous = NULL;
+	node = endpoint->free_head;
+	while (node != NULL)
+	{
+		current = node;
+		node = node->next;
+
+		need_close = false;
+		if (pool->max_idle_time > 0 && endpoint->total_count >
+			endpoint->min_count && g_current_time - current->atime >
+			pool->max_idle_time)
+		{
+			need_close = true;
+		}
+		else if (pool->health_check_interval > 0 && g_current_time -
+			current->check_time >= pool->health_check_interval)
+		{
+			current->check_time = g_current_time;
+			need_close = !async_conn_is_alive(current);
+		}
+
+		if (!need_close)
+		{
+			previous = current;
+			continue;
+		}
+
+		if (previous == NULL)
+		{
+			endpoint->free_head = node;
+		}
+		else
+		{
+			previous->next = node;
+		}
+		endpoint->free_count--;
+		async_conn_free_node(pool, current);
+	}
+
+	async_conn_warm_up(pool, endpoint);
+}
+
+static void async_conn_pool_timer_callback(int sock, short event, void *arg)
+{
+	AsyncConnPool *pool;
+	AsyncConnEndpoint *endpoint;
+
+	pool = ASYNC_CONN_POOL_BY_TIMER(arg);
+	endpoint = pool->endpoints;
+	while (endpoint != NULL)
+	{
+		async_conn_check_endpoint(pool, endpoint);
+		endpoint = endpoint->next;
+	}
+
+	async_conn_add_timer(pool);
+}
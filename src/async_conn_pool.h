@@ -0,0 +1,177 @@
+/**
+* Copyright (C) 2008 Happy Fish / YuQing
+*
+* FastDFS may be copied only under the terms of the GNU General
+* Public License V3, which may be found in the FastDFS source kit.
+* Please visit the FastDFS Home Page http://www.csource.org/ for more detail.
+**/
+
+//async_conn_pool.h
+
+/**
+  the non-blocking connection pool of one nio thread: the connections are
+  connected asynchronously by the ioevent of the thread, the checkout never
+  waits for the connect, the caller is notified by the callback when no
+  free connection.
+  a timer of the thread pre-warms min_count connections per endpoint,
+  reconnects in the background, checks the idle connections and closes
+  the connections exceed the max idle time.
+  all the functions must be called in the nio thread, NOT thread safe.
+*/
+
+#ifndef _ASYNC_CONN_POOL_H
+#define _ASYNC_CONN_POOL_H
+
+#include "common_define.h"
+#include "chain.h"
+#include "fast_mblock.h"
+#include "fast_task_queue.h"
+#include "connection_pool.h"
+
+#define ASYNC_CONN_STATUS_CONNECTING  1
+#define ASYNC_CONN_STATUS_IDLE        2
+#define ASYNC_CONN_STATUS_BUSY        3
+
+//the max backoff seconds of the reconnect after fail
+#define ASYNC_CONN_MAX_RETRY_INTERVAL  30
+
+struct async_conn_endpoint;
+
+/**
+  the checkout callback
+  conn: the connection, NULL for fail
+  err_no: 0 for success, != 0 for fail such as ETIMEDOUT
+  arg: the argument of async_conn_pool_get_connection
+*/
+typedef void (*AsyncConnCallback)(ConnectionInfo *conn, const int err_no, \
+		void *arg);
+
+typedef struct async_conn_node
+{
+	IOEventEntry event;  //must first
+	ConnectionInfo conn;
+	struct async_conn_endpoint *endpoint;
+	int status;
+	time_t atime;       //last access time
+	time_t check_time;  //last health check time
+	ChainLink link;     //all the nodes of the endpoint
+	struct async_conn_node *next;  //for the free list
+} AsyncConnNode;
+
+typedef struct async_conn_waiter
+{
+	AsyncConnCallback callback;
+	void *arg;
+	time_t expires;
+	struct async_conn_waiter *next;
+} AsyncConnWaiter;
+
+typedef struct async_conn_endpoint
+{
+	ConnectionInfo server;
+	int min_count;   //the connections to keep
+	int total_count; //connected and connecting connections
+	int free_count;
+	int connecting_count;
+	int fail_count;  //the continuous connect fail count
+	int last_errno;  //the error no of the last connect fail
+	time_t retry_time;  //do NOT reconnect before this time after fail
+	AsyncConnNode *free_head;
+	ChainLink nodes;
+	struct {
+		AsyncConnWaiter *head;
+		AsyncConnWaiter *tail;
+		int count;
+	} waiters;
+	struct async_conn_pool *pool;
+	struct async_conn_endpoint *next;
+} AsyncConnEndpoint;
+
+typedef struct async_conn_pool
+{
+	struct nio_thread_data *thread_data;
+	int connect_timeout;  //in seconds
+	int max_count_per_entry;  //0 means no limit
+	int max_idle_time;    //in seconds
+	int health_check_interval;  //in seconds, 0 for no health check
+	AsyncConnEndpoint *endpoints;
+	IOEventEntry timer_event;  //the maintenance timer per second
+	struct fast_mblock_man node_allocator;
+	struct fast_mblock_man waiter_allocator;
+} AsyncConnPool;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+*   init function, the maintenance timer is added to the thread
+*   parameters:
+*      pool: the AsyncConnPool
+*      thread_data: the nio thread, the ioevent and the timer are used
+*      connect_timeout: the connect timeout in seconds
+*      max_count_per_entry: max connection count per host:port
+*      max_idle_time: close the idle connection after max idle time in seconds
+*      health_check_interval: check the idle connections interval in seconds
+*   the waiter of the checkout fails with ETIMEDOUT after connect_timeout
+*   return 0 for success, != 0 for error
+*/
+int async_conn_pool_init(AsyncConnPool *pool, \
+		struct nio_thread_data *thread_data, const int connect_timeout, \
+		const int max_count_per_entry, const int max_idle_time, \
+		const int health_check_interval);
+
+/**
+*   destroy function, all the connections should be closed or pushed back,
+*   the waiters are notified with ECANCELED
+*   parameters:
+*      pool: the AsyncConnPool
+*   return none
+**/
+void async_conn_pool_destroy(AsyncConnPool *pool);
+
+/**
+*   add the server endpoint and pre-warm the connections
+*   parameters:
+*      pool: the AsyncConnPool
+*      server: the server ip and port
+*      min_count: the connections to keep
+*   return 0 for success, != 0 for error
+*/
+int async_conn_pool_add_endpoint(AsyncConnPool *pool, \
+		const ConnectionInfo *server, const int min_count);
+
+/**
+*   get connection from the pool without wait
+*   parameters:
+*      pool: the AsyncConnPool
+*      server: the server ip and port, the endpoint is added when not exist
+*      callback: called when the connection is ready or fail later
+*      arg: the argument of the callback
+*      conn: store the free connection
+*   return 0 for the free connection got, EINPROGRESS for the callback will
+*          be called, other error no for fail
+*/
+int async_conn_pool_get_connection(AsyncConnPool *pool, \
+		const ConnectionInfo *server, AsyncConnCallback callback, \
+		void *arg, ConnectionInfo **conn);
+
+#define async_conn_pool_close_connection(pool, conn) \
+	async_conn_pool_close_connection_ex(pool, conn, false)
+
+/**
+*   push back the connection to pool
+*   parameters:
+*      pool: the AsyncConnPool
+*      conn: the connection
+*      bForce: set true to close the socket, else push back to the pool
+*   return none
+*/
+void async_conn_pool_close_connection_ex(AsyncConnPool *pool, \
+		ConnectionInfo *conn, const bool bForce);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
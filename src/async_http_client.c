@@ -0,0 +1,813 @@
+/**
+* Copyright (C) 2008 Happy Fish / YuQing
+*
+* FastDFS may be copied only under the terms of the GNU General
+* Public License V3, which may be found in the FastDFS source kit.
+* Please visit the FastDFS Home Page http://www.csource.org/ for more detail.
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include "logger.h"
+#include "sockopt.h"
+#include "shared_func.h"
+#include "sched_thread.h"
+#include "ioevent_loop.h"
+#include "async_http_client.h"
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+//the connection is released or closed by the parser
+#define ASYNC_HTTP_CONN_DONE  -1
+
+static int async_http_submit(AsyncHttpClient *client, AsyncHttpRequest *req);
+
+int async_http_client_init(AsyncHttpClient *client, AsyncConnPool *pool, \
+		const int network_timeout, const int max_pipeline_depth)
+{
+	memset(client, 0, sizeof(AsyncHttpClient));
+	client->thread_data = pool->thread_data;
+	client->pool = pool;
+	client->network_timeout = network_timeout > 0 ? network_timeout : 1;
+	client->max_pipeline_depth = max_pipeline_depth > 0 ?
+		max_pipeline_depth : 1;
+	return fast_mblock_init_ex(&client->conn_allocator,
+			sizeof(AsyncHttpConn), 16, NULL, false);
+}
+
+static void async_http_complete(AsyncHttpRequest *req, const int err_no)
+{
+	if (req->client != NULL)
+	{
+		req->callbacks->on_complete(req, err_no);
+	}
+	free(req);
+}
+
+static inline bool async_http_can_retry(const int err_no)
+{
+	return (err_no == ENOTCONN || err_no == ECONNRESET || err_no == EPIPE);
+}
+
+static void async_http_conn_free(AsyncHttpConn *conn, const bool keep_alive)
+{
+	AsyncHttpClient *client;
+
+	client = conn->client;
+	fast_timer_remove(&client->thread_data->timer, &conn->event.timer);
+	ioevent_detach(&client->thread_data->ev_puller, conn->conn->sock);
+	ioevent_remove(&client->thread_data->ev_puller, conn);
+
+	if (conn->prev == NULL)
+	{
+		client->conns = conn->next;
+	}
+	else
+	{
+		conn->prev->next = conn->next;
+	}
+	if (conn->next != NULL)
+	{
+		conn->next->prev = conn->prev;
+	}
+
+	async_conn_pool_close_connection_ex(client->pool, conn->conn,
+			!keep_alive);
+	fast_buffer_destroy(&conn->out);
+	fast_mblock_free_object(&client->conn_allocator, conn);
+}
+
+/* close the connection and complete the waiting requests, the requests
+ * which the response NOT started are retried once on the new connection
+ * when the keep-alive connection is closed by the server */
+static void async_http_conn_close(AsyncHttpConn *conn, const int err_no,
+		const bool retry)
+{
+	AsyncHttpClient *client;
+	AsyncHttpRequest *req;
+	AsyncHttpRequest *next;
+	bool started;
+
+	client = conn->client;
+	req = conn->head;
+	started = conn->parser.state != HTTP_PARSER_STATE_HEADER ||
+		conn->recv_end > conn->recv_start;
+	async_http_conn_free(conn, false);
+
+	while (req != NULL)
+	{
+		next = req->next;
+		req->next = NULL;
+		if (retry && req->idempotent && !req->retried && !started &&
+			async_http_can_retry(err_no))
+		{
+			req->retried = true;
+			if (async_http_submit(client, req) == 0)
+			{
+				req = next;
+				continue;
+			}
+		}
+
+		async_http_complete(req, err_no);
+		started = false;
+		req = next;
+	}
+}
+
+static int async_http_set_events(AsyncHttpConn *conn, const int events)
+{
+	if (conn->events == events)
+	{
+		return 0;
+	}
+
+	if (ioevent_modify(&conn->client->thread_data->ev_puller,
+		conn->conn->sock, events, conn) != 0)
+	{
+		return errno != 0 ? errno : EACCES;
+	}
+	conn->events = events;
+	return 0;
+}
+
+static int async_http_conn_send(AsyncHttpConn *conn)
+{
+	int bytes;
+
+	while (conn->out_offset < conn->out.length)
+	{
+		bytes = send(conn->conn->sock, conn->out.data + conn->out_offset,
+				conn->out.length - conn->out_offset, MSG_NOSIGNAL);
+		if (bytes > 0)
+		{
+			conn->out_offset += bytes;
+			continue;
+		}
+
+		if (bytes < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if (bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+		{
+			return async_http_set_events(conn,
+					IOEVENT_READ | IOEVENT_WRITE);
+		}
+		return bytes < 0 && errno != 0 ? errno : EPIPE;
+	}
+
+	conn->out.length = 0;
+	conn->out_offset = 0;
+	return async_http_set_events(conn, IOEVENT_READ);
+}
+
+static int async_http_enqueue(AsyncHttpConn *conn, AsyncHttpRequest *req)
+{
+	int result;
+
+	if ((result=fast_buffer_append_buff(&conn->out, req->data,
+		req->length)) != 0)
+	{
+		return result;
+	}
+
+	req->next = NULL;
+	if (conn->tail == NULL)
+	{
+		conn->head = req;
+	}
+	else
+	{
+		conn->tail->next = req;
+	}
+	conn->tail = req;
+	conn->request_count++;
+	return 0;
+}
+
+static void async_http_conn_callback(int sock, short event, void *arg);
+
+static AsyncHttpConn *async_http_conn_create(AsyncHttpClient *client,
+		ConnectionInfo *ci)
+{
+	AsyncHttpConn *conn;
+
+	conn = (AsyncHttpConn *)fast_mblock_alloc_object(
+			&client->conn_allocator);
+	if (conn == NULL)
+	{
+		return NULL;
+	}
+
+	memset(conn, 0, offsetof(AsyncHttpConn, recv_buff));
+	conn->client = client;
+	conn->conn = ci;
+	http_parser_init(&conn->parser, HTTP_PARSER_TYPE_RESPONSE,
+			ASYNC_HTTP_RECV_BUFF_SIZE);
+	if (fast_buffer_init(&conn->out) != 0)
+	{
+		fast_mblock_free_object(&client->conn_allocator, conn);
+		return NULL;
+	}
+
+	conn->event.fd = ci->sock;
+	conn->event.callback = async_http_conn_callback;
+	conn->event.timer.data = conn;
+	conn->events = IOEVENT_READ;
+	if (ioevent_attach(&client->thread_data->ev_puller,
+		ci->sock, conn->events, conn) < 0)
+	{
+		logError("file: "__FILE__", line: %d, " \
+			"ioevent_attach fail, errno: %d, error info: %s", \
+			__LINE__, errno, STRERROR(errno));
+		fast_buffer_destroy(&conn->out);
+		fast_mblock_free_object(&client->conn_allocator, conn);
+		return NULL;
+	}
+	conn->event.timer.expires = g_current_time + client->network_timeout;
+	fast_timer_add(&client->thread_data->timer, &conn->event.timer);
+
+	conn->prev = NULL;
+	conn->next = client->conns;
+	if (client->conns != NULL)
+	{
+		client->conns->prev = conn;
+	}
+	client->conns = conn;
+	return conn;
+}
+
+/* send the request on the new connection, the request is completed
+ * when fail */
+static void async_http_start(AsyncHttpClient *client, ConnectionInfo *ci,
+		AsyncHttpRequest *req)
+{
+	AsyncHttpConn *conn;
+	int result;
+
+	if ((conn=async_http_conn_create(client, ci)) == NULL)
+	{
+		async_conn_pool_close_connection_ex(client->pool, ci, true);
+		async_http_complete(req, ENOMEM);
+		return;
+	}
+
+	if ((result=async_http_enqueue(conn, req)) != 0)
+	{
+		async_http_conn_free(conn, true);
+		async_http_complete(req, result);
+		return;
+	}
+	if ((result=async_http_conn_send(conn)) != 0)
+	{
+		async_http_conn_close(conn, result, true);
+	}
+}
+
+static void async_http_checkout_callback(ConnectionInfo *ci,
+		const int err_no, void *arg)
+{
+	AsyncHttpRequest *req;
+	AsyncHttpClient *client;
+
+	req = (AsyncHttpRequest *)arg;
+	client = req->client;
+	if (client == NULL)  //cancelled by destroy
+	{
+		if (ci != NULL)
+		{
+			async_conn_pool_close_connection(req->pool, ci);
+		}
+		free(req);
+		return;
+	}
+
+	if (req->prev == NULL)
+	{
+		client->pending = req->next;
+	}
+	else
+	{
+		req->prev->next = req->next;
+	}
+	if (req->next != NULL)
+	{
+		req->next->prev = req->prev;
+	}
+	req->prev = req->next = NULL;
+
+	if (err_no != 0)
+	{
+		async_http_complete(req, err_no);
+		return;
+	}
+	async_http_start(client, ci, req);
+}
+
+static int async_http_submit(AsyncHttpClient *client, AsyncHttpRequest *req)
+{
+	AsyncHttpConn *conn;
+	ConnectionInfo *ci;
+	int result;
+
+	//pipeline on the connection in use
+	for (conn=client->conns; conn!=NULL; conn=conn->next)
+	{
+		if (conn->request_count < client->max_pipeline_depth &&
+			conn->conn->port == req->server.port &&
+			strcmp(conn->conn->ip_addr, req->server.ip_addr) == 0)
+		{
+			if ((result=async_http_enqueue(conn, req)) != 0)
+			{
+				return result;
+			}
+			if ((result=async_http_conn_send(conn)) != 0)
+			{
+				//the request is completed by the close
+				async_http_conn_close(conn, result, true);
+			}
+			return 0;
+		}
+	}
+
+	result = async_conn_pool_get_connection(client->pool, &req->server,
+			async_http_checkout_callback, req, &ci);
+	if (result == 0)
+	{
+		async_http_start(client, ci, req);
+		return 0;
+	}
+	if (result != EINPROGRESS)
+	{
+		return result;
+	}
+
+	req->prev = NULL;
+	req->next = client->pending;
+	if (client->pending != NULL)
+	{
+		client->pending->prev = req;
+	}
+	client->pending = req;
+	return 0;
+}
+
+static int async_http_parse_url(const char *url, ConnectionInfo *server,
+		const char **host, int *host_len, const char **uri)
+{
+	char domain_name[256];
+	char *port_str;
+	const char *domain;
+	const char *end;
+	int len;
+
+	if (strncasecmp(url, "http://", 7) != 0)
+	{
+		return EINVAL;
+	}
+
+	domain = url + 7;
+	end = strchr(domain, '/');
+	if (end == NULL)
+	{
+		*uri = "/";
+		end = domain + strlen(domain);
+	}
+	else
+	{
+		*uri = end;
+	}
+	*host = domain;
+	*host_len = end - domain;
+	if (*host_len == 0 || *host_len >= (int)sizeof(domain_name))
+	{
+		return EINVAL;
+	}
+
+	memset(server, 0, sizeof(ConnectionInfo));
+	server->sock = -1;
+	if (*domain == '[')  //IPv6 address as [::1]:80
+	{
+		port_str = (char *)memchr(domain, ']', *host_len);
+		if (port_str == NULL)
+		{
+			return EINVAL;
+		}
+		len = port_str - (domain + 1);
+		if (len >= (int)sizeof(server->ip_addr))
+		{
+			return EINVAL;
+		}
+		memcpy(server->ip_addr, domain + 1, len);
+		server->ip_addr[len] = '\0';
+		port_str++;
+		server->port = (port_str < end && *port_str == ':') ?
+			atoi(port_str + 1) : 80;
+		return 0;
+	}
+
+	memcpy(domain_name, domain, *host_len);
+	domain_name[*host_len] = '\0';
+	port_str = strchr(domain_name, ':');
+	if (port_str == NULL)
+	{
+		server->port = 80;
+	}
+	else
+	{
+		*port_str = '\0';
+		server->port = atoi(port_str + 1);
+	}
+
+	if (getIpaddrByName(domain_name, server->ip_addr,
+		sizeof(server->ip_addr)) == INADDR_NONE)
+	{
+		logError("file: "__FILE__", line: %d, " \
+			"resolve domain \"%s\" fail", __LINE__, domain_name);
+		return ENOENT;
+	}
+	return 0;
+}
+
+int async_http_client_request(AsyncHttpClient *client, const char *method, \
+		const char *url, const char *headers, const char *body, \
+		const int body_len, const AsyncHttpCallbacks *callbacks, \
+		void *arg)
+{
+	AsyncHttpRequest *req;
+	ConnectionInfo server;
+	const char *host;
+	const char *uri;
+	int host_len;
+	int alloc_size;
+	int result;
+
+	if ((result=async_http_parse_url(url, &server, &host,
+		&host_len, &uri)) != 0)
+	{
+		logError("file: "__FILE__", line: %d, " \
+			"invalid url: %s", __LINE__, url);
+		return result;
+	}
+
+	alloc_size = sizeof(AsyncHttpRequest) + strlen(method) + strlen(uri) +
+		host_len + (headers != NULL ? strlen(headers) : 0) +
+		body_len + 128;
+	req = (AsyncHttpRequest *)malloc(alloc_size);
+	if (req == NULL)
+	{
+		logError("file: "__FILE__", line: %d, " \
+			"malloc %d bytes fail", __LINE__, alloc_size);
+		return ENOMEM;
+	}
+	memset(req, 0, sizeof(AsyncHttpRequest));
+	req->client = client;
+	req->pool = client->pool;
+	req->server = server;
+	req->callbacks = callbacks;
+	req->arg = arg;
+	req->is_head = strcmp(method, "HEAD") == 0;
+	req->idempotent = req->is_head || strcmp(method, "GET") == 0 ||
+		strcmp(method, "OPTIONS") == 0;
+	req->data = (char *)(req + 1);
+
+	req->length = sprintf(req->data, "%s %s HTTP/1.1\r\n"
+			"Host: %.*s\r\n", method, uri, host_len, host);
+	if (body_len > 0 || strcmp(method, "POST") == 0 ||
+		strcmp(method, "PUT") == 0)
+	{
+		req->length += sprintf(req->data + req->length,
+				"Content-Length: %d\r\n", body_len);
+	}
+	if (headers != NULL)
+	{
+		req->length += sprintf(req->data + req->length, "%s", headers);
+	}
+	memcpy(req->data + req->length, "\r\n", 2);
+	req->length += 2;
+	if (body_len > 0)
+	{
+		memcpy(req->data + req->length, body, body_len);
+		req->length += body_len;
+	}
+
+	if ((result=async_http_submit(client, req)) != 0)
+	{
+		free(req);
+	}
+	return result;
+}
+
+/* parse the status line and the headers end with the empty line,
+ * return 0 for the headers complete, EAGAIN for more data, others for error */
+static int async_http_parse_headers(AsyncHttpConn *conn)
+{
+	AsyncHttpResponse *resp;
+	KeyValuePairEx *header;
+	HttpParser *parser;
+	int result;
+	int i;
+
+	parser = &conn->parser;
+	if ((result=http_parser_parse_headers(parser, conn->recv_buff,
+		conn->recv_end)) != 0)
+	{
+		return result;
+	}
+	if (parser->header_count > ASYNC_HTTP_MAX_HEADER_COUNT)
+	{
+		return EOVERFLOW;
+	}
+
+	resp = &conn->response;
+	resp->status = parser->status;
+	resp->minor_version = parser->minor_version;
+	resp->content_length = parser->content_length;
+	resp->chunked = parser->chunked;
+	resp->keep_alive = parser->keep_alive;
+	resp->header_count = parser->header_count;
+	for (i=0; i<parser->header_count; i++)
+	{
+		header = resp->headers + i;
+		header->key = HTTP_SLICE_PTR(conn->recv_buff,
+				parser->headers[i].name);
+		header->key_len = parser->headers[i].name.length;
+		header->value = HTTP_SLICE_PTR(conn->recv_buff,
+				parser->headers[i].value);
+		header->value_len = parser->headers[i].value.length;
+	}
+
+	conn->recv_start = parser->offset;
+	return 0;
+}
+
+static int async_http_on_body(AsyncHttpConn *conn, const HttpSlice *slice)
+{
+	AsyncHttpRequest *req;
+
+	req = conn->head;
+	if (req->callbacks->on_body != NULL && req->client != NULL)
+	{
+		if (req->callbacks->on_body(req, HTTP_SLICE_PTR(
+			conn->recv_buff, *slice), slice->length) != 0)
+		{
+			return ECANCELED;
+		}
+	}
+	return 0;
+}
+
+//the response is done, return ASYNC_HTTP_CONN_DONE when the conn released
+static int async_http_response_done(AsyncHttpConn *conn)
+{
+	AsyncHttpRequest *req;
+	bool keep_alive;
+
+	req = conn->head;
+	conn->head = req->next;
+	if (conn->head == NULL)
+	{
+		conn->tail = NULL;
+	}
+	conn->request_count--;
+	http_parser_reset(&conn->parser);
+	keep_alive = conn->response.keep_alive;
+	async_http_complete(req, 0);
+
+	if (!keep_alive)
+	{
+		async_http_conn_close(conn, ENOTCONN, true);
+		return ASYNC_HTTP_CONN_DONE;
+	}
+
+	if (conn->head == NULL)
+	{
+		if (conn->recv_end > conn->recv_start)
+		{
+			logWarning("file: "__FILE__", line: %d, " \
+				"server %s:%d, unexpected data length: %d", \
+				__LINE__, conn->conn->ip_addr, conn->conn->port, \
+				conn->recv_end - conn->recv_start);
+			async_http_conn_close(conn, EPROTO, false);
+		}
+		else
+		{
+			async_http_conn_free(conn, true);
+		}
+		return ASYNC_HTTP_CONN_DONE;
+	}
+	return 0;
+}
+
+/* parse the received data, return 0 for more data, ASYNC_HTTP_CONN_DONE
+ * for the connection released, others for error */
+static int async_http_parse(AsyncHttpConn *conn)
+{
+	AsyncHttpRequest *req;
+	HttpSlice slice;
+	int result;
+
+	while (conn->head != NULL)
+	{
+		req = conn->head;
+		if (conn->parser.state == HTTP_PARSER_STATE_HEADER)
+		{
+			if ((result=async_http_parse_headers(conn)) != 0)
+			{
+				return result == EAGAIN ? 0 : result;
+			}
+			if (conn->response.status / 100 == 1)
+			{
+				http_parser_reset(&conn->parser);  //skip 100 Continue
+				continue;
+			}
+
+			req->status = conn->response.status;
+			if (req->callbacks->on_headers != NULL && req->client != NULL)
+			{
+				if (req->callbacks->on_headers(req, &conn->response) != 0)
+				{
+					return ECANCELED;
+				}
+			}
+			if (req->is_head)
+			{
+				http_parser_skip_body(&conn->parser);
+			}
+			continue;
+		}
+
+		//the body is decoded by the parser, include the chunked
+		result = http_parser_parse_body(&conn->parser, conn->recv_buff,
+				conn->recv_end, &slice);
+		conn->recv_start = conn->parser.offset;
+		if (result == 0)
+		{
+			if ((result=async_http_on_body(conn, &slice)) != 0)
+			{
+				return result;
+			}
+		}
+		else if (result == ENOENT)  //the response complete
+		{
+			if ((result=async_http_response_done(conn)) != 0)
+			{
+				return result;
+			}
+		}
+		else
+		{
+			return result == EAGAIN ? 0 : result;
+		}
+	}
+
+	return 0;
+}
+
+static void async_http_conn_recv(AsyncHttpConn *conn)
+{
+	int bytes;
+	int result;
+
+	while (1)
+	{
+		if (conn->recv_start == conn->recv_end)
+		{
+			http_parser_shift(&conn->parser, conn->recv_start);
+			conn->recv_start = conn->recv_end = 0;
+		}
+		else if (conn->recv_end == ASYNC_HTTP_RECV_BUFF_SIZE)
+		{
+			if (conn->recv_start == 0)
+			{
+				logError("file: "__FILE__", line: %d, " \
+					"server %s:%d, the response header or the chunk " \
+					"size line exceeds %d bytes", __LINE__, \
+					conn->conn->ip_addr, conn->conn->port, \
+					ASYNC_HTTP_RECV_BUFF_SIZE);
+				async_http_conn_close(conn, EOVERFLOW, false);
+				return;
+			}
+
+			memmove(conn->recv_buff, conn->recv_buff + conn->recv_start,
+					conn->recv_end - conn->recv_start);
+			http_parser_shift(&conn->parser, conn->recv_start);
+			conn->recv_end -= conn->recv_start;
+			conn->recv_start = 0;
+		}
+
+		bytes = recv(conn->conn->sock, conn->recv_buff + conn->recv_end,
+				ASYNC_HTTP_RECV_BUFF_SIZE - conn->recv_end, 0);
+		if (bytes > 0)
+		{
+			conn->recv_end += bytes;
+			result = async_http_parse(conn);
+			if (result == ASYNC_HTTP_CONN_DONE)
+			{
+				return;
+			}
+			if (result != 0)
+			{
+				if (result == EPROTO || result == EOVERFLOW)
+				{
+					logError("file: "__FILE__", line: %d, " \
+						"server %s:%d, invalid http response, " \
+						"errno: %d, error info: %s", __LINE__, \
+						conn->conn->ip_addr, conn->conn->port, \
+						result, STRERROR(result));
+				}
+				async_http_conn_close(conn, result, false);
+				return;
+			}
+			continue;
+		}
+
+		if (bytes == 0)
+		{
+			if (conn->head != NULL && conn->parser.state ==
+				HTTP_PARSER_STATE_BODY_EOF)
+			{
+				conn->response.keep_alive = false;
+				async_http_response_done(conn);  //close the connection
+			}
+			else
+			{
+				async_http_conn_close(conn, ENOTCONN, true);
+			}
+			return;
+		}
+
+		if (errno == EINTR)
+		{
+			continue;
+		}
+		if (errno != EAGAIN && errno != EWOULDBLOCK)
+		{
+			async_http_conn_close(conn, errno != 0 ? errno : EIO, true);
+		}
+		return;
+	}
+}
+
+static void async_http_conn_callback(int sock, short event, void *arg)
+{
+	AsyncHttpConn *conn;
+	AsyncHttpClient *client;
+	int result;
+
+	conn = (AsyncHttpConn *)arg;
+	client = conn->client;
+	if (event & IOEVENT_TIMEOUT)
+	{
+		logError("file: "__FILE__", line: %d, " \
+			"server %s:%d, recv timeout", __LINE__, \
+			conn->conn->ip_addr, conn->conn->port);
+		async_http_conn_close(conn, ETIMEDOUT, false);
+		return;
+	}
+
+	fast_timer_modify(&client->thread_data->timer, &conn->event.timer,
+			g_current_time + client->network_timeout);
+	if (event & IOEVENT_WRITE)
+	{
+		if ((result=async_http_conn_send(conn)) != 0)
+		{
+			async_http_conn_close(conn, result, true);
+			return;
+		}
+	}
+
+	if (event & (IOEVENT_READ | IOEVENT_ERROR))
+	{
+		async_http_conn_recv(conn);
+	}
+}
+
+void async_http_client_destroy(AsyncHttpClient *client)
+{
+	AsyncHttpRequest *req;
+
+	while (client->conns != NULL)
+	{
+		async_http_conn_close(client->conns, ECANCELED, false);
+	}
+
+	//the pending requests are freed by the checkout callback
+	while (client->pending != NULL)
+	{
+		req = client->pending;
+		client->pending = req->next;
+		req->callbacks->on_complete(req, ECANCELED);
+		req->client = NULL;
+	}
+
+	fast_mblock_destroy(&client->conn_allocator);
+}
@@ -0,0 +1,178 @@
+/**
+* Copyright (C) 2008 Happy Fish / YuQing
+*
+* FastDFS may be copied only under the terms of the GNU General
+* Public License V3, which may be found in the FastDFS source kit.
+* Please visit the FastDFS Home Page http://www.csource.org/ for more detail.
+**/
+
+//async_http_client.h
+
+/**
+  the non-blocking HTTP/1.1 client of one nio thread based on ioevent and
+  fast_timer. the connections come from the AsyncConnPool of the thread and
+  are pushed back for keep-alive, the requests to the same server are
+  pipelined on the busy connection up to max_pipeline_depth, the body is
+  streamed to the callback, the chunked transfer encoding is decoded.
+  the domain name of the url is resolved by getIpaddrByName which blocks,
+  use the ip address for the non-blocking.
+  all the functions must be called in the nio thread, NOT thread safe.
+*/
+
+#ifndef _ASYNC_HTTP_CLIENT_H
+#define _ASYNC_HTTP_CLIENT_H
+
+#include "common_define.h"
+#include "fast_buffer.h"
+#include "fast_mblock.h"
+#include "async_conn_pool.h"
+#include "http_parser.h"
+
+#define ASYNC_HTTP_RECV_BUFF_SIZE  (16 * 1024)  //the max header size
+#define ASYNC_HTTP_MAX_HEADER_COUNT  64
+
+struct async_http_request;
+
+typedef struct async_http_response
+{
+	int status;        //the http status code such as 200
+	int minor_version; //1 for HTTP/1.1
+	int64_t content_length;  //-1 for unknown
+	bool chunked;
+	bool keep_alive;
+	int header_count;
+	KeyValuePairEx headers[ASYNC_HTTP_MAX_HEADER_COUNT];  //NOT '\0' ended
+} AsyncHttpResponse;
+
+/**
+  the headers are received, the headers are valid in the callback only
+  return 0 for continue, != 0 to cancel the request
+*/
+typedef int (*AsyncHttpHeaderCallback)(struct async_http_request *request,
+		const AsyncHttpResponse *response);
+
+/**
+  the piece of the body is received, the chunks are decoded
+  return 0 for continue, != 0 to cancel the request
+*/
+typedef int (*AsyncHttpBodyCallback)(struct async_http_request *request,
+		const char *data, const int length);
+
+/**
+  the request is done, err_no is 0 for success, the request is freed
+  after the callback
+*/
+typedef void (*AsyncHttpCompleteCallback)(struct async_http_request *request,
+		const int err_no);
+
+typedef struct async_http_callbacks
+{
+	AsyncHttpHeaderCallback on_headers;  //can be NULL
+	AsyncHttpBodyCallback on_body;       //can be NULL
+	AsyncHttpCompleteCallback on_complete;
+} AsyncHttpCallbacks;
+
+typedef struct async_http_request
+{
+	struct async_http_client *client;  //NULL for cancelled
+	AsyncConnPool *pool;
+	ConnectionInfo server;
+	const AsyncHttpCallbacks *callbacks;
+	void *arg;        //the argument of the callbacks
+	int status;       //the http status code of the response
+	bool is_head;     //the response of HEAD has no body
+	bool idempotent;  //can retry when the keep-alive connection closed
+	bool retried;
+	char *data;       //the request to send
+	int length;
+	struct async_http_request *prev;  //for the pending list
+	struct async_http_request *next;
+} AsyncHttpRequest;
+
+typedef struct async_http_conn
+{
+	IOEventEntry event;  //must first
+	struct async_http_client *client;
+	ConnectionInfo *conn;  //the connection of the pool
+	AsyncHttpRequest *head;  //the sent requests wait for the response
+	AsyncHttpRequest *tail;
+	int request_count;
+	FastBuffer out;        //the data to send
+	int out_offset;
+	int events;            //the attached events
+
+	HttpParser parser;     //offset is the parsed position of recv_buff
+	AsyncHttpResponse response;
+	int recv_start;
+	int recv_end;
+	char recv_buff[ASYNC_HTTP_RECV_BUFF_SIZE];
+
+	struct async_http_conn *prev;
+	struct async_http_conn *next;
+} AsyncHttpConn;
+
+typedef struct async_http_client
+{
+	struct nio_thread_data *thread_data;
+	AsyncConnPool *pool;
+	int network_timeout;  //in seconds
+	int max_pipeline_depth;  //1 for no pipelining
+	AsyncHttpConn *conns;    //the connections in use
+	AsyncHttpRequest *pending;  //the requests wait for the connection
+	struct fast_mblock_man conn_allocator;
+} AsyncHttpClient;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+*   init function
+*   parameters:
+*      client: the AsyncHttpClient
+*      pool: the AsyncConnPool of the same nio thread
+*      network_timeout: the network timeout in seconds
+*      max_pipeline_depth: the max pipelined requests per connection,
+*                          1 for no pipelining
+*   return 0 for success, != 0 for error
+*/
+int async_http_client_init(AsyncHttpClient *client, AsyncConnPool *pool, \
+		const int network_timeout, const int max_pipeline_depth);
+
+/**
+*   destroy function, the requests are completed with ECANCELED,
+*   the pool should be destroyed after the client
+*   parameters:
+*      client: the AsyncHttpClient
+*   return none
+**/
+void async_http_client_destroy(AsyncHttpClient *client);
+
+/**
+*   send the http request
+*   parameters:
+*      client: the AsyncHttpClient
+*      method: the http method such as GET, POST
+*      url: the url, must start as: "http://"
+*      headers: the extra headers end with "\r\n", can be NULL
+*      body: the request body, can be NULL
+*      body_len: the length of the body
+*      callbacks: the callbacks, must be valid until completed
+*      arg: the argument of the callbacks
+*   return 0 for success, the complete callback will be called,
+*          != 0 for error, the callback will NOT be called
+*/
+int async_http_client_request(AsyncHttpClient *client, const char *method, \
+		const char *url, const char *headers, const char *body, \
+		const int body_len, const AsyncHttpCallbacks *callbacks, \
+		void *arg);
+
+#define async_http_client_get(client, url, callbacks, arg) \
+	async_http_client_request(client, "GET", url, NULL, NULL, 0, \
+		callbacks, arg)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
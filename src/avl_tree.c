@@ -1,3 +1,5 @@
+#include <errno.h>
+#include "logger.h"
 #include "avl_tree.h"
 
 int avl_tree_init(AVLTreeInfo *tree, FreeDataFunc free_data_func, \
@@ -59,15 +61,27 @@ static AVLTreeNode *createTreeNode(AVLTreeNode *pParentNode, void *target_data)
 	pNewNode->left = pNewNode->right = NULL;
 	pNewNode->data = target_data;
 	pNewNode->balance = 0;
+	pNewNode->count = 1;
 
 	return pNewNode;
 }
 
+#define AVL_NODE_COUNT(pNode) ((pNode) != NULL ? (pNode)->count : 0)
+
+static inline void avlUpdateCount(AVLTreeNode *pNode)
+{
+	pNode->count = AVL_NODE_COUNT(pNode->left) + \
+		       AVL_NODE_COUNT(pNode->right) + 1;
+}
+
 static void avlRotateLeft(AVLTreeNode *pRotateNode, AVLTreeNode **ppRaiseNode)
 {
 	*ppRaiseNode = pRotateNode->right;
 	pRotateNode->right = (*ppRaiseNode)->left;
 	(*ppRaiseNode)->left = pRotateNode;
+
+	avlUpdateCount(pRotateNode);
+	avlUpdateCount(*ppRaiseNode);
 }
 
 static void avlRotateRight(AVLTreeNode *pRotateNode, AVLTreeNode **ppRaiseNode)
@@ -75,6 +89,9 @@ static void avlRotateRight(AVLTreeNode *pRotateNode, AVLTreeNode **ppRaiseNode)
 	*ppRaiseNode = pRotateNode->left;
 	pRotateNode->left = (*ppRaiseNode)->right;
 	(*ppRaiseNode)->right = pRotateNode;
+
+	avlUpdateCount(pRotateNode);
+	avlUpdateCount(*ppRaiseNode);
 }
 
 static void avlLeftBalanceWhenInsert(AVLTreeNode **pTreeNode, int *taller)
@@ -155,271 +172,248 @@ static void avlRightBalanceWhenInsert(AVLTreeNode **pTreeNode, int *taller)
 	}
 }
 
-static int avl_tree_insert_loop(CompareFunc compare_func, AVLTreeNode **pCurrentNode, \
-		void *target_data, int *taller)
+/* insert or replace without recursion, the links from the root to the
+   parent of the new node are kept in the path for rebalance */
+static int avl_tree_insert_ex(AVLTreeInfo *tree, void *target_data, \
+		const bool replace)
 {
+	AVLTreeNode **path[AVL_TREE_MAX_DEPTH];
+	AVLTreeNode **ppNode;
+	AVLTreeNode **ppCurrentNode;
+	int depth;
 	int nCompRes;
-	int success;
+	int taller;
 
-	if (*pCurrentNode == NULL)
+	depth = 0;
+	ppNode = &(tree->root);
+	while (*ppNode != NULL)
 	{
-		*pCurrentNode = createTreeNode(*pCurrentNode, target_data);
-		if (*pCurrentNode != NULL)
+		nCompRes = tree->compare_func((*ppNode)->data, target_data);
+		if (nCompRes == 0)
 		{
-			*taller = 1;
-			return 1;
-		}
-		else
-		{
-			return -ENOMEM;
+			if (replace)
+			{
+				if (tree->free_data_func != NULL)
+				{
+					tree->free_data_func((*ppNode)->data);
+				}
+				(*ppNode)->data = target_data;
+			}
+			return 0;
 		}
+
+		path[depth++] = ppNode;
+		ppNode = (nCompRes > 0) ? &((*ppNode)->left) : &((*ppNode)->right);
 	}
 
-	nCompRes = compare_func((*pCurrentNode)->data, target_data);
-	if (nCompRes > 0)
+	*ppNode = createTreeNode(NULL, target_data);
+	if (*ppNode == NULL)
 	{
-		success = avl_tree_insert_loop(compare_func, \
-				&((*pCurrentNode)->left), target_data, taller);
-		if (*taller != 0)
-		{
-			switch ((*pCurrentNode)->balance)
-			{
-				case -1:
-					avlLeftBalanceWhenInsert(pCurrentNode, taller);
-					break;
-				case 0:
-					(*pCurrentNode)->balance = -1;
-					break;
-				case 1:
-					(*pCurrentNode)->balance = 0;
-					*taller = 0;
-					break;
-			}
-		}
+		return -ENOMEM;
 	}
-	else if (nCompRes < 0)
+
+	taller = 1;
+	while (depth > 0)
 	{
-		success = avl_tree_insert_loop(compare_func, \
-				&((*pCurrentNode)->right), target_data, taller);
-		if (*taller != 0)
+		ppCurrentNode = path[--depth];
+		if (taller != 0)
 		{
-			switch ((*pCurrentNode)->balance)
+			if (ppNode == &((*ppCurrentNode)->left))
 			{
-				case -1: 
-					(*pCurrentNode)->balance = 0;
-					*taller = 0;
-					break;
-				case 0:
-					(*pCurrentNode)->balance = 1; 
-					break;
-				case 1:
-					avlRightBalanceWhenInsert(pCurrentNode, taller);
-					break;
+				switch ((*ppCurrentNode)->balance)
+				{
+					case -1:
+						avlLeftBalanceWhenInsert(ppCurrentNode, &taller);
+						break;
+					case 0:
+						(*ppCurrentNode)->balance = -1;
+						break;
+					case 1:
+						(*ppCurrentNode)->balance = 0;
+						taller = 0;
+						break;
+				}
+			}
+			else
+			{
+				switch ((*ppCurrentNode)->balance)
+				{
+					case -1:
+						(*ppCurrentNode)->balance = 0;
+						taller = 0;
+						break;
+					case 0:
+						(*ppCurrentNode)->balance = 1;
+						break;
+					case 1:
+						avlRightBalanceWhenInsert(ppCurrentNode, &taller);
+						break;
+				}
 			}
 		}
-	}
-	else
-	{
-		return 0;
+
+		avlUpdateCount(*ppCurrentNode);
+		ppNode = ppCurrentNode;
 	}
 
-	return success;
+	return 1;
 }
 
 int avl_tree_insert(AVLTreeInfo *tree, void *data)
 {
-	int taller;
+	return avl_tree_insert_ex(tree, data, false);
+}
 
-	taller = 0;
-	return avl_tree_insert_loop(tree->compare_func, &(tree->root), \
-				data, &taller);
+static int avl_tree_get_height(const int count)
+{
+	int height;
+
+	height = 0;
+	while ((1 << height) <= count)
+	{
+		height++;
+	}
+	return height;
 }
 
-static int avl_tree_replace_loop(CompareFunc compare_func, \
-		FreeDataFunc free_data_func, AVLTreeNode **pCurrentNode, \
-		void *target_data, int *taller)
+/* build the balanced tree of the sorted data [start, end), the middle one
+   is the root, the left sub tree is not lower than the right one */
+static AVLTreeNode *avl_tree_build_loop(void **data_array, \
+		const int start, const int end)
 {
-	int nCompRes;
-	int success;
+	AVLTreeNode *pNode;
+	int middle;
 
-	if (*pCurrentNode == NULL )
+	if (start >= end)
 	{
-		*pCurrentNode = createTreeNode(*pCurrentNode, target_data);
-		if (*pCurrentNode != NULL)
-		{
-			*taller = 1;
-			return 1;
-		}
-		else
-		{
-			return -ENOMEM;
-		}
+		return NULL;
 	}
 
-	nCompRes = compare_func((*pCurrentNode)->data, target_data);
-	if (nCompRes > 0)
+	middle = (start + end) / 2;
+	pNode = createTreeNode(NULL, data_array[middle]);
+	if (pNode == NULL)
 	{
-		success = avl_tree_replace_loop(compare_func, free_data_func, 
-				&((*pCurrentNode)->left), target_data, taller);
-		if (*taller != 0)
+		return NULL;
+	}
+
+	if (start < middle)
+	{
+		pNode->left = avl_tree_build_loop(data_array, \
+				start, middle);
+		if (pNode->left == NULL)
 		{
-			switch ((*pCurrentNode)->balance)
-			{
-				case -1:
-					avlLeftBalanceWhenInsert(pCurrentNode, taller);
-					break;
-				case 0:
-					(*pCurrentNode)->balance = -1;
-					break;
-				case 1:
-					(*pCurrentNode)->balance = 0;
-					*taller = 0;
-					break;
-			}
+			free(pNode);
+			return NULL;
 		}
 	}
-	else if (nCompRes < 0)
+	if (middle + 1 < end)
 	{
-		success = avl_tree_replace_loop(compare_func, free_data_func, 
-				&((*pCurrentNode)->right), target_data, taller);
-		if (*taller != 0) 
+		pNode->right = avl_tree_build_loop(data_array, \
+				middle + 1, end);
+		if (pNode->right == NULL)
 		{
-			switch ((*pCurrentNode)->balance)
+			if (pNode->left != NULL)
 			{
-				case -1 : 
-					(*pCurrentNode)->balance = 0;
-					*taller = 0;
-					break;
-				case 0 :
-					(*pCurrentNode)->balance = 1; 
-					break;
-				case 1 :
-					avlRightBalanceWhenInsert(pCurrentNode, taller);
-					break;
+				avl_tree_destroy_loop(NULL, pNode->left);
 			}
+			free(pNode);
+			return NULL;
 		}
 	}
-	else
+
+	pNode->balance = avl_tree_get_height(end - middle - 1) - \
+			 avl_tree_get_height(middle - start);
+	pNode->count = end - start;
+	return pNode;
+}
+
+int avl_tree_bulk_load(AVLTreeInfo *tree, void **data_array, const int count)
+{
+	int i;
+
+	if (tree->root != NULL)
 	{
-		if (free_data_func != NULL)
+		logError("file: "__FILE__", line: %d, " \
+			"the tree is not empty", __LINE__);
+		return EEXIST;
+	}
+
+	for (i=1; i<count; i++)
+	{
+		if (tree->compare_func(data_array[i - 1], data_array[i]) >= 0)
 		{
-			free_data_func((*pCurrentNode)->data);
+			logError("file: "__FILE__", line: %d, " \
+				"the data array is not strictly ascending, " \
+				"index: %d", __LINE__, i);
+			return EINVAL;
 		}
-		(*pCurrentNode)->data = target_data;
+	}
+
+	if (count <= 0)
+	{
 		return 0;
 	}
 
-	return success;
+	tree->root = avl_tree_build_loop(data_array, 0, count);
+	return tree->root != NULL ? 0 : ENOMEM;
 }
 
 int avl_tree_replace(AVLTreeInfo *tree, void *data)
 {
-	int taller;
-
-	taller = 0;
-	return avl_tree_replace_loop(tree->compare_func, \
-			tree->free_data_func, &(tree->root), data, &taller);
+	return avl_tree_insert_ex(tree, data, true);
 }
 
-static AVLTreeNode *avl_tree_find_loop(CompareFunc compare_func, \
-		AVLTreeNode *pCurrentNode, void *target_data)
+void *avl_tree_find(AVLTreeInfo *tree, void *target_data)
 {
+	AVLTreeNode *pNode;
 	int nCompRes;
-	nCompRes = compare_func(pCurrentNode->data, target_data);
-	if (nCompRes > 0)
+
+	pNode = tree->root;
+	while (pNode != NULL)
 	{
-		if (pCurrentNode->left == NULL)
-		{
-			return NULL;
-		}
-		else
+		nCompRes = tree->compare_func(pNode->data, target_data);
+		if (nCompRes > 0)
 		{
-			return avl_tree_find_loop(compare_func, \
-				pCurrentNode->left, target_data);
+			pNode = pNode->left;
 		}
-	}
-	else if (nCompRes < 0)
-	{
-		if (pCurrentNode->right == NULL)
+		else if (nCompRes < 0)
 		{
-			return NULL;
+			pNode = pNode->right;
 		}
 		else
 		{
-			return avl_tree_find_loop(compare_func, \
-				pCurrentNode->right, target_data);
+			return pNode->data;
 		}
 	}
-	else
-	{
-		return pCurrentNode;
-	}
+
+	return NULL;
 }
 
-static void *avl_tree_find_ge_loop(CompareFunc compare_func, \
-		AVLTreeNode *pCurrentNode, void *target_data)
+void *avl_tree_find_ge(AVLTreeInfo *tree, void *target_data)
 {
-	int nCompRes;
+	AVLTreeNode *pNode;
 	void *found;
+	int nCompRes;
 
-	nCompRes = compare_func(pCurrentNode->data, target_data);
-	if (nCompRes > 0)
+	found = NULL;
+	pNode = tree->root;
+	while (pNode != NULL)
 	{
-		if (pCurrentNode->left == NULL)
+		nCompRes = tree->compare_func(pNode->data, target_data);
+		if (nCompRes > 0)
 		{
-			return pCurrentNode->data;
+			found = pNode->data;
+			pNode = pNode->left;
 		}
-
-		found = avl_tree_find_ge_loop(compare_func, \
-				pCurrentNode->left, target_data);
-		return found != NULL ? found : pCurrentNode->data;
-	}
-	else if (nCompRes < 0)
-	{
-		if (pCurrentNode->right == NULL)
+		else if (nCompRes < 0)
 		{
-			return NULL;
+			pNode = pNode->right;
 		}
 		else
 		{
-			return avl_tree_find_ge_loop(compare_func, \
-				pCurrentNode->right, target_data);
+			return pNode->data;
 		}
 	}
-	else
-	{
-		return pCurrentNode->data;
-	}
-}
-
-void *avl_tree_find(AVLTreeInfo *tree, void *target_data)
-{
-	AVLTreeNode *found;
-
-	if (tree->root == NULL)
-	{
-		return NULL;
-	}
-
-	found = avl_tree_find_loop(tree->compare_func, \
-			tree->root, target_data);
-
-	return found != NULL ? found->data : NULL;
-}
-
-void *avl_tree_find_ge(AVLTreeInfo *tree, void *target_data)
-{
-	void *found;
-
-	if (tree->root == NULL)
-	{
-		found = NULL;
-	}
-	else
-	{
-		found = avl_tree_find_ge_loop(tree->compare_func, \
-			tree->root, target_data);
-	}
 
 	return found;
 }
@@ -506,227 +500,312 @@ static void avlRightBalanceWhenDelete(AVLTreeNode **pTreeNode, int *shorter)
 	}
 }
 
-static int avl_tree_delete_loop(AVLTreeInfo *tree, AVLTreeNode **pCurrentNode,\
-		 void *target_data, int *shorter, AVLTreeNode *pDeletedDataNode)
+int avl_tree_delete(AVLTreeInfo *tree, void *data)
 {
+	AVLTreeNode **path[AVL_TREE_MAX_DEPTH];
+	AVLTreeNode **ppNode;
+	AVLTreeNode **ppCurrentNode;
+	AVLTreeNode *pDeletedNode;
+	int depth;
 	int nCompRes;
-	bool result;
-	AVLTreeNode *leftsub;
-	AVLTreeNode *rightsub;
+	int shorter;
 
-	if (pDeletedDataNode != NULL)
+	depth = 0;
+	ppNode = &(tree->root);
+	while (*ppNode != NULL)
 	{
-		if ((*pCurrentNode)->right == NULL)
+		nCompRes = tree->compare_func((*ppNode)->data, data);
+		if (nCompRes == 0)
 		{
-			pDeletedDataNode->data = (*pCurrentNode)->data;
-			leftsub = (*pCurrentNode)->left;
-
-			free(*pCurrentNode);
-			*pCurrentNode = leftsub;
-			*shorter = 1;
-			return 1;
+			break;
 		}
 
-		nCompRes = -1;
+		path[depth++] = ppNode;
+		ppNode = (nCompRes > 0) ? &((*ppNode)->left) : &((*ppNode)->right);
 	}
-	else
+	if (*ppNode == NULL)
 	{
-		nCompRes = tree->compare_func((*pCurrentNode)->data, target_data);
+		return 0;
 	}
 
-	if (nCompRes > 0)
+	if (tree->free_data_func != NULL)
 	{
-		if ((*pCurrentNode)->left == NULL)
-		{
-			return 0;
-		}
-
-		result = avl_tree_delete_loop(tree, &((*pCurrentNode)->left), \
-				target_data, shorter, pDeletedDataNode);
-		if (*shorter != 0)
-		{
-			switch ((*pCurrentNode)->balance)
-			{
-			  case -1:
-				(*pCurrentNode)->balance = 0;
-				break;
-			  case 0:
-				(*pCurrentNode)->balance = 1;
-				*shorter = 0;
-				break;
-			  case 1:
-				avlRightBalanceWhenDelete(pCurrentNode, shorter);
-				break;
-			}
-		}
-		return result;
+		tree->free_data_func((*ppNode)->data);
 	}
-	else if (nCompRes < 0)
+
+	pDeletedNode = *ppNode;
+	if (pDeletedNode->left != NULL && pDeletedNode->right != NULL)
 	{
-		if ((*pCurrentNode)->right == NULL)
+		//move the data of the previous node here and delete that node
+		path[depth++] = ppNode;
+		ppNode = &(pDeletedNode->left);
+		while ((*ppNode)->right != NULL)
 		{
-			return 0;
+			path[depth++] = ppNode;
+			ppNode = &((*ppNode)->right);
 		}
 
-		result = avl_tree_delete_loop(tree, &((*pCurrentNode)->right), \
-				target_data, shorter, pDeletedDataNode);
-		if (*shorter != 0)
-		{
-			switch ((*pCurrentNode)->balance)
-			{
-				case -1:
-		          		avlLeftBalanceWhenDelete(pCurrentNode, shorter);
-		          		break;
-		        	case 0:
-		          		(*pCurrentNode)->balance = -1;
-				  	*shorter = 0;
-		          		break;
-		        	case 1:
-		  	        	(*pCurrentNode)->balance = 0;
-		        	  	break;
-		    	}
-		}
-		return result;
+		pDeletedNode->data = (*ppNode)->data;
+		pDeletedNode = *ppNode;
+		*ppNode = pDeletedNode->left;
 	}
 	else
 	{
-		if (tree->free_data_func != NULL)
-		{
-			tree->free_data_func((*pCurrentNode)->data);
-		}
+		*ppNode = (pDeletedNode->left != NULL) ? pDeletedNode->left : \
+			pDeletedNode->right;
+	}
+	free(pDeletedNode);
 
-		leftsub = (*pCurrentNode)->left;
-		rightsub = (*pCurrentNode)->right;
-		if (leftsub == NULL)
-		{
-			free(*pCurrentNode);
-			*pCurrentNode = rightsub;
-		}
-		else if (rightsub == NULL)
-		{
-			free(*pCurrentNode);
-			*pCurrentNode = leftsub;
-		}
-		else
+	shorter = 1;
+	while (depth > 0)
+	{
+		ppCurrentNode = path[--depth];
+		if (shorter != 0)
 		{
-			avl_tree_delete_loop(tree, &((*pCurrentNode)->left), \
-				target_data, shorter, *pCurrentNode);
-
-			if (*shorter != 0)
+			if (ppNode == &((*ppCurrentNode)->left))
 			{
-				switch ((*pCurrentNode)->balance)
+				switch ((*ppCurrentNode)->balance)
 				{
-				  case -1:
-					(*pCurrentNode)->balance = 0;
-					break;
-				  case 0:
-					(*pCurrentNode)->balance = 1;
-					*shorter = 0;
-					break;
-				  case 1:
-					avlRightBalanceWhenDelete(pCurrentNode, shorter);
-					break;
+					case -1:
+						(*ppCurrentNode)->balance = 0;
+						break;
+					case 0:
+						(*ppCurrentNode)->balance = 1;
+						shorter = 0;
+						break;
+					case 1:
+						avlRightBalanceWhenDelete(ppCurrentNode, &shorter);
+						break;
+				}
+			}
+			else
+			{
+				switch ((*ppCurrentNode)->balance)
+				{
+					case -1:
+						avlLeftBalanceWhenDelete(ppCurrentNode, &shorter);
+						break;
+					case 0:
+						(*ppCurrentNode)->balance = -1;
+						shorter = 0;
+						break;
+					case 1:
+						(*ppCurrentNode)->balance = 0;
+						break;
 				}
 			}
-			return 1;
 		}
 
-		*shorter = 1;
-		return 1;
+		avlUpdateCount(*ppCurrentNode);
+		ppNode = ppCurrentNode;
 	}
+
+	return 1;
 }
 
-int avl_tree_delete(AVLTreeInfo *tree, void *data)
+static inline void avl_tree_push_left(AVLTreeIterator *iterator, \
+		AVLTreeNode *pNode)
 {
-	int shorter;
+	while (pNode != NULL)
+	{
+		iterator->stack[iterator->depth++] = pNode;
+		pNode = pNode->left;
+	}
+}
 
-	if (tree->root == NULL)
+static inline void avl_tree_push_right(AVLTreeIterator *iterator, \
+		AVLTreeNode *pNode)
+{
+	while (pNode != NULL)
 	{
-		return 0;
+		iterator->stack[iterator->depth++] = pNode;
+		pNode = pNode->right;
 	}
+}
 
-	shorter = 0;
-	return avl_tree_delete_loop(tree, &(tree->root), data, &shorter, NULL);
+void avl_tree_iterator(AVLTreeInfo *tree, AVLTreeIterator *iterator)
+{
+	iterator->depth = 0;
+	avl_tree_push_left(iterator, tree->root);
 }
 
-static int avl_tree_walk_loop(DataOpFunc data_op_func, \
-		AVLTreeNode *pCurrentNode, void *args)
+void avl_tree_reverse_iterator(AVLTreeInfo *tree, AVLTreeIterator *iterator)
 {
-	int result;
+	iterator->depth = 0;
+	avl_tree_push_right(iterator, tree->root);
+}
 
-	if (pCurrentNode->left != NULL)
+int avl_tree_seek(AVLTreeInfo *tree, AVLTreeIterator *iterator, \
+		void *target_data)
+{
+	AVLTreeNode *pNode;
+	int nCompRes;
+	int found_depth;
+
+	found_depth = 0;
+	iterator->depth = 0;
+	pNode = tree->root;
+	while (pNode != NULL)
 	{
-		result = avl_tree_walk_loop(data_op_func, \
-				pCurrentNode->left, args);
-		if (result != 0)
+		iterator->stack[iterator->depth++] = pNode;
+		nCompRes = tree->compare_func(pNode->data, target_data);
+		if (nCompRes > 0)
 		{
-			return result;
+			found_depth = iterator->depth;
+			pNode = pNode->left;
+		}
+		else if (nCompRes < 0)
+		{
+			pNode = pNode->right;
+		}
+		else
+		{
+			return 0;
 		}
 	}
 
-	if ((result=data_op_func(pCurrentNode->data, args)) != 0)
+	//the path to the smallest data greater than the target
+	iterator->depth = found_depth;
+	return found_depth > 0 ? 0 : ENOENT;
+}
+
+void *avl_tree_next(AVLTreeIterator *iterator)
+{
+	AVLTreeNode *pNode;
+
+	if (iterator->depth == 0)
 	{
-		return result;
+		return NULL;
 	}
 
-	/*
-	if (pCurrentNode->balance >= -1 && pCurrentNode->balance <= 1)
+	pNode = iterator->stack[iterator->depth - 1];
+	if (pNode->right != NULL)
 	{
-		//printf("==%d\n", pCurrentNode->balance);
+		avl_tree_push_left(iterator, pNode->right);
 	}
 	else
 	{
-		printf("==bad %d!!!!!!!!!!!!\n", pCurrentNode->balance);
-	}
-	*/
-
-	if (pCurrentNode->right != NULL)
-	{
-		result = avl_tree_walk_loop(data_op_func, \
-				pCurrentNode->right, args);
+		//pop the right children, the top is the next when from left
+		while (--iterator->depth > 0 && iterator->stack[ \
+				iterator->depth - 1]->right == \
+				iterator->stack[iterator->depth])
+		{
+		}
 	}
 
-	return result;
+	return pNode->data;
 }
 
-int avl_tree_walk(AVLTreeInfo *tree, DataOpFunc data_op_func, void *args)
+void *avl_tree_prev(AVLTreeIterator *iterator)
 {
-	if (tree->root == NULL)
+	AVLTreeNode *pNode;
+
+	if (iterator->depth == 0)
 	{
-		return 0;
+		return NULL;
+	}
+
+	pNode = iterator->stack[iterator->depth - 1];
+	if (pNode->left != NULL)
+	{
+		avl_tree_push_right(iterator, pNode->left);
 	}
 	else
 	{
-		return avl_tree_walk_loop(data_op_func, tree->root, args);
+		while (--iterator->depth > 0 && iterator->stack[ \
+				iterator->depth - 1]->left == \
+				iterator->stack[iterator->depth])
+		{
+		}
 	}
+
+	return pNode->data;
 }
 
-static void avl_tree_count_loop(AVLTreeNode *pCurrentNode, int *count)
+int avl_tree_walk(AVLTreeInfo *tree, DataOpFunc data_op_func, void *args)
 {
-	if (pCurrentNode->left != NULL)
+	AVLTreeIterator iterator;
+	void *data;
+	int result;
+
+	avl_tree_iterator(tree, &iterator);
+	while ((data=avl_tree_next(&iterator)) != NULL)
 	{
-		avl_tree_count_loop(pCurrentNode->left, count);
+		if ((result=data_op_func(data, args)) != 0)
+		{
+			return result;
+		}
 	}
 
-	(*count)++;
+	return 0;
+}
 
-	if (pCurrentNode->right != NULL)
+int avl_tree_count(AVLTreeInfo *tree)
+{
+	return AVL_NODE_COUNT(tree->root);
+}
+
+void *avl_tree_select(AVLTreeInfo *tree, const int index)
+{
+	AVLTreeNode *pNode;
+	int left_count;
+	int k;
+
+	if (index < 0 || index >= AVL_NODE_COUNT(tree->root))
+	{
+		return NULL;
+	}
+
+	k = index;
+	pNode = tree->root;
+	while (pNode != NULL)
 	{
-		avl_tree_count_loop(pCurrentNode->right, count);
+		left_count = AVL_NODE_COUNT(pNode->left);
+		if (k < left_count)
+		{
+			pNode = pNode->left;
+		}
+		else if (k == left_count)
+		{
+			return pNode->data;
+		}
+		else
+		{
+			k -= left_count + 1;
+			pNode = pNode->right;
+		}
 	}
+
+	return NULL;
 }
 
-int avl_tree_count(AVLTreeInfo *tree)
+int avl_tree_rank(AVLTreeInfo *tree, void *target_data)
 {
-	int count;
-	if (tree->root == NULL)
+	AVLTreeNode *pNode;
+	int nCompRes;
+	int rank;
+
+	rank = 0;
+	pNode = tree->root;
+	while (pNode != NULL)
 	{
-		return 0;
+		nCompRes = tree->compare_func(pNode->data, target_data);
+		if (nCompRes >= 0)
+		{
+			if (nCompRes == 0)
+			{
+				return rank + AVL_NODE_COUNT(pNode->left);
+			}
+			pNode = pNode->left;
+		}
+		else
+		{
+			rank += AVL_NODE_COUNT(pNode->left) + 1;
+			pNode = pNode->right;
+		}
 	}
 
-	count = 0;
-	avl_tree_count_loop(tree->root, &count);
-	return count;
+	return rank;
 }
 
 int avl_tree_depth(AVLTreeInfo *tree)
@@ -7,11 +7,15 @@
 #include <pthread.h>
 #include "common_define.h"
 
+//the height of AVL tree is less than 1.44 * log2(n + 2)
+#define AVL_TREE_MAX_DEPTH  48
+
 typedef struct tagAVLTreeNode {
 	void *data;
 	struct tagAVLTreeNode *left;
 	struct tagAVLTreeNode *right;
 	byte balance;
+	int count;  //node count of the sub tree for order statistics
 } AVLTreeNode;
 
 typedef int (*DataOpFunc) (void *data, void *args);
@@ -22,6 +26,16 @@ typedef struct tagAVLTreeInfo {
 	CompareFunc compare_func;
 } AVLTreeInfo;
 
+/**
+  the iterator keeps the path from the root to the current node, so it
+  can move forward and backward without parent links. the iterator is
+  invalid after the tree changed, seek by the last data to resume.
+*/
+typedef struct tagAVLTreeIterator {
+	AVLTreeNode *stack[AVL_TREE_MAX_DEPTH];
+	int depth;  //0 for the end
+} AVLTreeIterator;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -31,12 +45,65 @@ int avl_tree_init(AVLTreeInfo *tree, FreeDataFunc free_data_func, \
 void avl_tree_destroy(AVLTreeInfo *tree);
 
 int avl_tree_insert(AVLTreeInfo *tree, void *data);
+
+/**
+ * build the balanced tree from the sorted data in O(n)
+ * parameters:
+ *         tree: the tree, must be empty
+ *         data_array: the data array in strictly ascending order
+ *         count: the count of the data array
+ * return 0 for success, != 0 fail (errno)
+*/
+int avl_tree_bulk_load(AVLTreeInfo *tree, void **data_array, const int count);
 int avl_tree_replace(AVLTreeInfo *tree, void *data);
 int avl_tree_delete(AVLTreeInfo *tree, void *data);
 void *avl_tree_find(AVLTreeInfo *tree, void *target_data);
 void *avl_tree_find_ge(AVLTreeInfo *tree, void *target_data);
 int avl_tree_walk(AVLTreeInfo *tree, DataOpFunc data_op_func, void *args);
+
+//seek to the first data
+void avl_tree_iterator(AVLTreeInfo *tree, AVLTreeIterator *iterator);
+
+//seek to the last data for avl_tree_prev
+void avl_tree_reverse_iterator(AVLTreeInfo *tree, AVLTreeIterator *iterator);
+
+/**
+ * seek to the first data >= the target data
+ * parameters:
+ *         tree: the tree
+ *         iterator: the iterator to seek
+ *         target_data: the data to seek
+ * return 0 for success, ENOENT for not found
+*/
+int avl_tree_seek(AVLTreeInfo *tree, AVLTreeIterator *iterator, \
+	void *target_data);
+
+//return the current data and move to the next, NULL for the end
+void *avl_tree_next(AVLTreeIterator *iterator);
+
+//return the current data and move to the previous, NULL for the end
+void *avl_tree_prev(AVLTreeIterator *iterator);
+
 int avl_tree_count(AVLTreeInfo *tree);
+
+/**
+ * get the data by the order (k-th smallest)
+ * parameters:
+ *         tree: the tree
+ *         index: the order index based 0
+ * return the data, NULL for out of range
+*/
+void *avl_tree_select(AVLTreeInfo *tree, const int index);
+
+/**
+ * get the rank of the data
+ * parameters:
+ *         tree: the tree
+ *         target_data: the data to find
+ * return the count of the data less than the target data, this is the order
+ *        index based 0 when the target data exists
+*/
+int avl_tree_rank(AVLTreeInfo *tree, void *target_data);
 int avl_tree_depth(AVLTreeInfo *tree);
 //void avl_tree_print(AVLTreeInfo *tree);
 
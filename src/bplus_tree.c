@@ -0,0 +1,759 @@
+#include <errno.h>
+#include "logger.h"
+#include "bplus_tree.h"
+
+#define BPLUS_TREE_MIN_COUNT  (BPLUS_TREE_NODE_SIZE / 2)
+
+typedef struct tagBPlusTreePathEntry {
+	BPlusTreeInternal *node;
+	int index;  //the child index
+} BPlusTreePathEntry;
+
+int bplus_tree_init(BPlusTreeInfo *tree, FreeDataFunc free_data_func, \
+	CompareFunc compare_func)
+{
+	int result;
+
+	tree->root = NULL;
+	tree->head = NULL;
+	tree->tail = NULL;
+	tree->count = 0;
+	tree->depth = 0;
+	tree->free_data_func = free_data_func;
+	tree->compare_func = compare_func;
+
+	if ((result=fast_mblock_init_ex(&tree->leaf_allocator, \
+			sizeof(BPlusTreeLeaf), 1024, NULL, false)) != 0)
+	{
+		return result;
+	}
+	if ((result=fast_mblock_init_ex(&tree->internal_allocator, \
+			sizeof(BPlusTreeInternal), 64, NULL, false)) != 0)
+	{
+		fast_mblock_destroy(&tree->leaf_allocator);
+		return result;
+	}
+
+	return 0;
+}
+
+void bplus_tree_destroy(BPlusTreeInfo *tree)
+{
+	BPlusTreeLeaf *leaf;
+	int i;
+
+	if (tree->free_data_func != NULL)
+	{
+		for (leaf=tree->head; leaf!=NULL; leaf=leaf->next)
+		{
+			for (i=0; i<leaf->header.count; i++)
+			{
+				tree->free_data_func(leaf->data[i]);
+			}
+		}
+	}
+
+	fast_mblock_destroy(&tree->leaf_allocator);
+	fast_mblock_destroy(&tree->internal_allocator);
+	tree->root = NULL;
+	tree->head = NULL;
+	tree->tail = NULL;
+	tree->count = 0;
+	tree->depth = 0;
+}
+
+//return the child index: the count of the keys <= the target data
+static inline int bplus_tree_child_index(BPlusTreeInfo *tree, \
+	BPlusTreeInternal *node, void *target_data)
+{
+	int low;
+	int high;
+	int mid;
+
+	low = 0;
+	high = node->header.count - 1;
+	while (low <= high)
+	{
+		mid = (low + high) / 2;
+		if (tree->compare_func(node->keys[mid], target_data) <= 0)
+		{
+			low = mid + 1;
+		}
+		else
+		{
+			high = mid - 1;
+		}
+	}
+
+	return low;
+}
+
+//return the index of the first data >= the target data
+static inline int bplus_tree_leaf_search(BPlusTreeInfo *tree, \
+	BPlusTreeLeaf *leaf, void *target_data, bool *found)
+{
+	int low;
+	int high;
+	int mid;
+	int compare;
+
+	low = 0;
+	high = leaf->header.count - 1;
+	while (low <= high)
+	{
+		mid = (low + high) / 2;
+		compare = tree->compare_func(leaf->data[mid], target_data);
+		if (compare < 0)
+		{
+			low = mid + 1;
+		}
+		else if (compare > 0)
+		{
+			high = mid - 1;
+		}
+		else
+		{
+			*found = true;
+			return mid;
+		}
+	}
+
+	*found = false;
+	return low;
+}
+
+static BPlusTreeLeaf *bplus_tree_find_leaf(BPlusTreeInfo *tree, \
+	void *target_data, BPlusTreePathEntry *path, int *path_count)
+{
+	BPlusTreeNode *node;
+	BPlusTreeInternal *internal;
+	int index;
+	int count;
+
+	count = 0;
+	node = tree->root;
+	while (!node->leaf)
+	{
+		internal = (BPlusTreeInternal *)node;
+		index = bplus_tree_child_index(tree, internal, target_data);
+		if (path != NULL)
+		{
+			path[count].node = internal;
+			path[count].index = index;
+			count++;
+		}
+		node = internal->children[index];
+	}
+
+	if (path_count != NULL)
+	{
+		*path_count = count;
+	}
+	return (BPlusTreeLeaf *)node;
+}
+
+static void *bplus_tree_leftmost_data(BPlusTreeNode *node)
+{
+	while (!node->leaf)
+	{
+		node = ((BPlusTreeInternal *)node)->children[0];
+	}
+	return ((BPlusTreeLeaf *)node)->data[0];
+}
+
+/**
+ * the key is the first data of a leaf, replace the key refer to the old data
+ * before the old data freed, new_data is NULL for the min of the right sub tree
+*/
+static void bplus_tree_replace_key(BPlusTreeInfo *tree, void *old_data, \
+	void *new_data)
+{
+	BPlusTreeNode *node;
+	BPlusTreeInternal *internal;
+	int index;
+
+	node = tree->root;
+	while (node != NULL && !node->leaf)
+	{
+		internal = (BPlusTreeInternal *)node;
+		index = bplus_tree_child_index(tree, internal, old_data);
+		if (index > 0 && internal->keys[index - 1] == old_data)
+		{
+			internal->keys[index - 1] = (new_data != NULL) ? new_data : \
+				bplus_tree_leftmost_data(internal->children[index]);
+			return;
+		}
+		node = internal->children[index];
+	}
+}
+
+static void bplus_tree_split_leaf(BPlusTreeInfo *tree, BPlusTreeLeaf *leaf, \
+	BPlusTreeLeaf *right, const int pos, void *data)
+{
+	void *all[BPLUS_TREE_NODE_SIZE + 1];
+	int left_count;
+
+	memcpy(all, leaf->data, sizeof(void *) * pos);
+	all[pos] = data;
+	memcpy(all + pos + 1, leaf->data + pos, sizeof(void *) * \
+		(BPLUS_TREE_NODE_SIZE - pos));
+
+	left_count = (BPLUS_TREE_NODE_SIZE + 1) / 2;
+	memcpy(leaf->data, all, sizeof(void *) * left_count);
+	leaf->header.count = left_count;
+	memcpy(right->data, all + left_count, sizeof(void *) * \
+		(BPLUS_TREE_NODE_SIZE + 1 - left_count));
+	right->header.count = BPLUS_TREE_NODE_SIZE + 1 - left_count;
+
+	right->prev = leaf;
+	right->next = leaf->next;
+	if (leaf->next != NULL)
+	{
+		leaf->next->prev = right;
+	}
+	else
+	{
+		tree->tail = right;
+	}
+	leaf->next = right;
+}
+
+//insert the key to keys[index] and the child to children[index + 1]
+static void bplus_tree_split_internal(BPlusTreeInternal *node, \
+	BPlusTreeInternal *right, const int index, void **key, \
+	BPlusTreeNode **child)
+{
+	void *keys[BPLUS_TREE_NODE_SIZE + 1];
+	BPlusTreeNode *children[BPLUS_TREE_NODE_SIZE + 2];
+	int mid;
+
+	memcpy(keys, node->keys, sizeof(void *) * index);
+	keys[index] = *key;
+	memcpy(keys + index + 1, node->keys + index, sizeof(void *) * \
+		(BPLUS_TREE_NODE_SIZE - index));
+	memcpy(children, node->children, sizeof(BPlusTreeNode *) * (index + 1));
+	children[index + 1] = *child;
+	memcpy(children + index + 2, node->children + index + 1, \
+		sizeof(BPlusTreeNode *) * (BPLUS_TREE_NODE_SIZE - index));
+
+	mid = (BPLUS_TREE_NODE_SIZE + 1) / 2;
+	memcpy(node->keys, keys, sizeof(void *) * mid);
+	memcpy(node->children, children, sizeof(BPlusTreeNode *) * (mid + 1));
+	node->header.count = mid;
+
+	right->header.count = BPLUS_TREE_NODE_SIZE - mid;
+	memcpy(right->keys, keys + mid + 1, sizeof(void *) * \
+		right->header.count);
+	memcpy(right->children, children + mid + 1, \
+		sizeof(BPlusTreeNode *) * (right->header.count + 1));
+
+	*key = keys[mid];
+	*child = &right->header;
+}
+
+static BPlusTreeNode *bplus_tree_alloc_node(BPlusTreeInfo *tree, \
+	const bool leaf)
+{
+	BPlusTreeNode *node;
+
+	if (leaf)
+	{
+		node = (BPlusTreeNode *)fast_mblock_alloc_object( \
+				&tree->leaf_allocator);
+	}
+	else
+	{
+		node = (BPlusTreeNode *)fast_mblock_alloc_object( \
+				&tree->internal_allocator);
+	}
+	if (node == NULL)
+	{
+		logError("file: "__FILE__", line: %d, " \
+			"malloc %d bytes fail", __LINE__, leaf ? \
+			(int)sizeof(BPlusTreeLeaf) : (int)sizeof(BPlusTreeInternal));
+		return NULL;
+	}
+
+	node->count = 0;
+	node->leaf = leaf;
+	return node;
+}
+
+static inline void bplus_tree_free_node(BPlusTreeInfo *tree, \
+	BPlusTreeNode *node)
+{
+	if (node->leaf)
+	{
+		fast_mblock_free_object(&tree->leaf_allocator, node);
+	}
+	else
+	{
+		fast_mblock_free_object(&tree->internal_allocator, node);
+	}
+}
+
+static int bplus_tree_insert_split(BPlusTreeInfo *tree, BPlusTreeLeaf *leaf, \
+	const int pos, void *data, BPlusTreePathEntry *path, int path_count)
+{
+	BPlusTreeNode *nodes[BPLUS_TREE_MAX_DEPTH + 2];
+	BPlusTreeInternal *internal;
+	BPlusTreeInternal *root;
+	BPlusTreeNode *child;
+	void *key;
+	int node_count;
+	int index;
+	int i;
+
+	//alloc all the nodes at first so the tree keeps unchanged when fail
+	node_count = 1;
+	for (i=path_count-1; i>=0 && path[i].node->header.count == \
+			BPLUS_TREE_NODE_SIZE; i--)
+	{
+		node_count++;
+	}
+	if (i < 0)
+	{
+		node_count++;  //new root
+	}
+	for (i=0; i<node_count; i++)
+	{
+		if ((nodes[i]=bplus_tree_alloc_node(tree, i == 0)) == NULL)
+		{
+			while (--i >= 0)
+			{
+				bplus_tree_free_node(tree, nodes[i]);
+			}
+			return ENOMEM;
+		}
+	}
+
+	bplus_tree_split_leaf(tree, leaf, (BPlusTreeLeaf *)nodes[0], pos, data);
+	key = ((BPlusTreeLeaf *)nodes[0])->data[0];
+	child = nodes[0];
+	i = 1;
+	while (path_count > 0)
+	{
+		path_count--;
+		internal = path[path_count].node;
+		index = path[path_count].index;
+		if (internal->header.count < BPLUS_TREE_NODE_SIZE)
+		{
+			memmove(internal->keys + index + 1, internal->keys + index, \
+				sizeof(void *) * (internal->header.count - index));
+			memmove(internal->children + index + 2, \
+				internal->children + index + 1, sizeof(BPlusTreeNode *) * \
+				(internal->header.count - index));
+			internal->keys[index] = key;
+			internal->children[index + 1] = child;
+			internal->header.count++;
+			return 0;
+		}
+
+		bplus_tree_split_internal(internal, \
+			(BPlusTreeInternal *)nodes[i++], index, &key, &child);
+	}
+
+	root = (BPlusTreeInternal *)nodes[i];
+	root->header.count = 1;
+	root->keys[0] = key;
+	root->children[0] = tree->root;
+	root->children[1] = child;
+	tree->root = &root->header;
+	tree->depth++;
+	return 0;
+}
+
+static int bplus_tree_do_insert(BPlusTreeInfo *tree, void *data, \
+	const bool replace)
+{
+	BPlusTreePathEntry path[BPLUS_TREE_MAX_DEPTH];
+	BPlusTreeLeaf *leaf;
+	void *old_data;
+	int path_count;
+	int pos;
+	int result;
+	bool found;
+
+	if (tree->root == NULL)
+	{
+		if ((leaf=(BPlusTreeLeaf *)bplus_tree_alloc_node(tree, \
+				true)) == NULL)
+		{
+			return -ENOMEM;
+		}
+		leaf->prev = leaf->next = NULL;
+		leaf->data[0] = data;
+		leaf->header.count = 1;
+		tree->root = &leaf->header;
+		tree->head = tree->tail = leaf;
+		tree->depth = 1;
+		tree->count = 1;
+		return 1;
+	}
+
+	leaf = bplus_tree_find_leaf(tree, data, path, &path_count);
+	pos = bplus_tree_leaf_search(tree, leaf, data, &found);
+	if (found)
+	{
+		if (!replace)
+		{
+			return 0;
+		}
+
+		old_data = leaf->data[pos];
+		leaf->data[pos] = data;
+		if (pos == 0)
+		{
+			bplus_tree_replace_key(tree, old_data, data);
+		}
+		if (tree->free_data_func != NULL)
+		{
+			tree->free_data_func(old_data);
+		}
+		return 0;
+	}
+
+	if (leaf->header.count < BPLUS_TREE_NODE_SIZE)
+	{
+		memmove(leaf->data + pos + 1, leaf->data + pos, \
+			sizeof(void *) * (leaf->header.count - pos));
+		leaf->data[pos] = data;
+		leaf->header.count++;
+	}
+	else if ((result=bplus_tree_insert_split(tree, leaf, pos, data, \
+			path, path_count)) != 0)
+	{
+		return -1 * result;
+	}
+
+	tree->count++;
+	return 1;
+}
+
+int bplus_tree_insert(BPlusTreeInfo *tree, void *data)
+{
+	return bplus_tree_do_insert(tree, data, false);
+}
+
+int bplus_tree_replace(BPlusTreeInfo *tree, void *data)
+{
+	return bplus_tree_do_insert(tree, data, true);
+}
+
+//remove keys[index] and children[index + 1]
+static inline void bplus_tree_remove_key(BPlusTreeInternal *node, \
+	const int index)
+{
+	memmove(node->keys + index, node->keys + index + 1, \
+		sizeof(void *) * (node->header.count - index - 1));
+	memmove(node->children + index + 1, node->children + index + 2, \
+		sizeof(BPlusTreeNode *) * (node->header.count - index - 1));
+	node->header.count--;
+}
+
+static void bplus_tree_unlink_leaf(BPlusTreeInfo *tree, BPlusTreeLeaf *leaf)
+{
+	if (leaf->prev != NULL)
+	{
+		leaf->prev->next = leaf->next;
+	}
+	else
+	{
+		tree->head = leaf->next;
+	}
+	if (leaf->next != NULL)
+	{
+		leaf->next->prev = leaf->prev;
+	}
+	else
+	{
+		tree->tail = leaf->prev;
+	}
+}
+
+//return true when merged (the parent lost a key)
+static bool bplus_tree_rebalance_leaf(BPlusTreeInfo *tree, \
+	BPlusTreeLeaf *leaf, BPlusTreeInternal *parent, const int index)
+{
+	BPlusTreeLeaf *left;
+	BPlusTreeLeaf *right;
+
+	left = (index > 0) ? (BPlusTreeLeaf *)parent->children[index - 1] : NULL;
+	right = (index < parent->header.count) ? \
+		(BPlusTreeLeaf *)parent->children[index + 1] : NULL;
+	if (left != NULL && left->header.count > BPLUS_TREE_MIN_COUNT)
+	{
+		memmove(leaf->data + 1, leaf->data, sizeof(void *) * \
+			leaf->header.count);
+		leaf->data[0] = left->data[--left->header.count];
+		leaf->header.count++;
+		parent->keys[index - 1] = leaf->data[0];
+		return false;
+	}
+	if (right != NULL && right->header.count > BPLUS_TREE_MIN_COUNT)
+	{
+		leaf->data[leaf->header.count++] = right->data[0];
+		right->header.count--;
+		memmove(right->data, right->data + 1, sizeof(void *) * \
+			right->header.count);
+		parent->keys[index] = right->data[0];
+		return false;
+	}
+
+	if (left != NULL)
+	{
+		memcpy(left->data + left->header.count, leaf->data, \
+			sizeof(void *) * leaf->header.count);
+		left->header.count += leaf->header.count;
+		bplus_tree_remove_key(parent, index - 1);
+		bplus_tree_unlink_leaf(tree, leaf);
+		bplus_tree_free_node(tree, &leaf->header);
+	}
+	else
+	{
+		memcpy(leaf->data + leaf->header.count, right->data, \
+			sizeof(void *) * right->header.count);
+		leaf->header.count += right->header.count;
+		bplus_tree_remove_key(parent, index);
+		bplus_tree_unlink_leaf(tree, right);
+		bplus_tree_free_node(tree, &right->header);
+	}
+	return true;
+}
+
+//return true when merged (the parent lost a key)
+static bool bplus_tree_rebalance_internal(BPlusTreeInfo *tree, \
+	BPlusTreeInternal *node, BPlusTreeInternal *parent, int index)
+{
+	BPlusTreeInternal *left;
+	BPlusTreeInternal *right;
+
+	left = (index > 0) ? (BPlusTreeInternal *)parent->children[index - 1] :
+		NULL;
+	right = (index < parent->header.count) ? \
+		(BPlusTreeInternal *)parent->children[index + 1] : NULL;
+	if (left != NULL && left->header.count > BPLUS_TREE_MIN_COUNT)
+	{
+		memmove(node->keys + 1, node->keys, sizeof(void *) * \
+			node->header.count);
+		memmove(node->children + 1, node->children, \
+			sizeof(BPlusTreeNode *) * (node->header.count + 1));
+		node->keys[0] = parent->keys[index - 1];
+		node->children[0] = left->children[left->header.count];
+		node->header.count++;
+		parent->keys[index - 1] = left->keys[left->header.count - 1];
+		left->header.count--;
+		return false;
+	}
+	if (right != NULL && right->header.count > BPLUS_TREE_MIN_COUNT)
+	{
+		node->keys[node->header.count] = parent->keys[index];
+		node->children[node->header.count + 1] = right->children[0];
+		node->header.count++;
+		parent->keys[index] = right->keys[0];
+		memmove(right->keys, right->keys + 1, sizeof(void *) * \
+			(right->header.count - 1));
+		memmove(right->children, right->children + 1, \
+			sizeof(BPlusTreeNode *) * right->header.count);
+		right->header.count--;
+		return false;
+	}
+
+	if (left == NULL)
+	{
+		left = node;
+		node = right;
+		index++;  //merge the right node into the node
+	}
+	left->keys[left->header.count] = parent->keys[index - 1];
+	memcpy(left->keys + left->header.count + 1, node->keys, \
+		sizeof(void *) * node->header.count);
+	memcpy(left->children + left->header.count + 1, node->children, \
+		sizeof(BPlusTreeNode *) * (node->header.count + 1));
+	left->header.count += node->header.count + 1;
+	bplus_tree_remove_key(parent, index - 1);
+	bplus_tree_free_node(tree, &node->header);
+	return true;
+}
+
+static void bplus_tree_rebalance(BPlusTreeInfo *tree, BPlusTreeNode *node, \
+	BPlusTreePathEntry *path, int path_count)
+{
+	BPlusTreeInternal *parent;
+	int index;
+	bool merged;
+
+	while (path_count > 0)
+	{
+		if (node->count >= BPLUS_TREE_MIN_COUNT)
+		{
+			return;
+		}
+
+		path_count--;
+		parent = path[path_count].node;
+		index = path[path_count].index;
+		if (node->leaf)
+		{
+			merged = bplus_tree_rebalance_leaf(tree, \
+					(BPlusTreeLeaf *)node, parent, index);
+		}
+		else
+		{
+			merged = bplus_tree_rebalance_internal(tree, \
+					(BPlusTreeInternal *)node, parent, index);
+		}
+		if (!merged)
+		{
+			return;
+		}
+		node = &parent->header;
+	}
+
+	//the node is the root
+	if (node->count > 0)
+	{
+		return;
+	}
+	if (node->leaf)
+	{
+		tree->root = NULL;
+		tree->head = tree->tail = NULL;
+	}
+	else
+	{
+		tree->root = ((BPlusTreeInternal *)node)->children[0];
+	}
+	tree->depth--;
+	bplus_tree_free_node(tree, node);
+}
+
+int bplus_tree_delete(BPlusTreeInfo *tree, void *data)
+{
+	BPlusTreePathEntry path[BPLUS_TREE_MAX_DEPTH];
+	BPlusTreeLeaf *leaf;
+	void *deleted_data;
+	int path_count;
+	int pos;
+	bool found;
+
+	if (tree->root == NULL)
+	{
+		return 0;
+	}
+
+	leaf = bplus_tree_find_leaf(tree, data, path, &path_count);
+	pos = bplus_tree_leaf_search(tree, leaf, data, &found);
+	if (!found)
+	{
+		return 0;
+	}
+
+	deleted_data = leaf->data[pos];
+	leaf->header.count--;
+	memmove(leaf->data + pos, leaf->data + pos + 1, \
+		sizeof(void *) * (leaf->header.count - pos));
+	tree->count--;
+	bplus_tree_rebalance(tree, &leaf->header, path, path_count);
+
+	if (pos == 0)
+	{
+		bplus_tree_replace_key(tree, deleted_data, NULL);
+	}
+	if (tree->free_data_func != NULL)
+	{
+		tree->free_data_func(deleted_data);
+	}
+	return 1;
+}
+
+void *bplus_tree_find(BPlusTreeInfo *tree, void *target_data)
+{
+	BPlusTreeLeaf *leaf;
+	int pos;
+	bool found;
+
+	if (tree->root == NULL)
+	{
+		return NULL;
+	}
+
+	leaf = bplus_tree_find_leaf(tree, target_data, NULL, NULL);
+	pos = bplus_tree_leaf_search(tree, leaf, target_data, &found);
+	return found ? leaf->data[pos] : NULL;
+}
+
+static BPlusTreeLeaf *bplus_tree_lower_bound(BPlusTreeInfo *tree, \
+	void *target_data, int *pos)
+{
+	BPlusTreeLeaf *leaf;
+	bool found;
+
+	leaf = bplus_tree_find_leaf(tree, target_data, NULL, NULL);
+	*pos = bplus_tree_leaf_search(tree, leaf, target_data, &found);
+	if (*pos == leaf->header.count)
+	{
+		leaf = leaf->next;
+		*pos = 0;
+	}
+	return leaf;
+}
+
+void *bplus_tree_find_ge(BPlusTreeInfo *tree, void *target_data)
+{
+	BPlusTreeLeaf *leaf;
+	int pos;
+
+	if (tree->root == NULL)
+	{
+		return NULL;
+	}
+
+	leaf = bplus_tree_lower_bound(tree, target_data, &pos);
+	return (leaf != NULL) ? leaf->data[pos] : NULL;
+}
+
+int bplus_tree_walk(BPlusTreeInfo *tree, DataOpFunc data_op_func, void *args)
+{
+	BPlusTreeLeaf *leaf;
+	int result;
+	int i;
+
+	for (leaf=tree->head; leaf!=NULL; leaf=leaf->next)
+	{
+		for (i=0; i<leaf->header.count; i++)
+		{
+			if ((result=data_op_func(leaf->data[i], args)) != 0)
+			{
+				return result;
+			}
+		}
+	}
+
+	return 0;
+}
+
+int bplus_tree_find_range(BPlusTreeInfo *tree, void *start, void *end, \
+	BPlusTreeIterator *iterator)
+{
+	bplus_tree_iterator(tree, iterator);
+	iterator->end = end;
+	if (tree->root == NULL)
+	{
+		return ENOENT;
+	}
+
+	if (start != NULL)
+	{
+		iterator->leaf = bplus_tree_lower_bound(tree, start, \
+				&iterator->index);
+	}
+	if (iterator->leaf == NULL || (end != NULL && tree->compare_func( \
+			iterator->leaf->data[iterator->index], end) >= 0))
+	{
+		iterator->leaf = NULL;
+		return ENOENT;
+	}
+
+	return 0;
+}
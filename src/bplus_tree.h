@@ -0,0 +1,166 @@
+/**
+* Copyright (C) 2008 Happy Fish / YuQing
+*
+* FastDFS may be copied only under the terms of the GNU General
+* Public License V3, which may be found in the FastDFS source kit.
+* Please visit the FastDFS Home Page http://www.csource.org/ for more detail.
+**/
+
+/**
+  B+tree as an ordered index with the same API as avl_tree. the nodes are
+  wide (BPLUS_TREE_NODE_SIZE entries) and allocated from fast_mblock, so one
+  node holds many data pointers and the search touches few cache lines.
+  all data are stored in the leaves, the leaves are linked for range scan.
+  the keys of the internal nodes are the data pointers of the leaves,
+  the data is freed after the keys refer to it are replaced.
+*/
+
+#ifndef _BPLUS_TREE_H_
+#define _BPLUS_TREE_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "common_define.h"
+#include "fast_mblock.h"
+#include "avl_tree.h"
+
+#define BPLUS_TREE_NODE_SIZE  32  //max entry count of one node
+#define BPLUS_TREE_MAX_DEPTH  16
+
+typedef struct tagBPlusTreeNode {
+	short count;  //data count of the leaf, key count of the internal node
+	bool leaf;
+} BPlusTreeNode;
+
+typedef struct tagBPlusTreeLeaf {
+	BPlusTreeNode header;
+	struct tagBPlusTreeLeaf *prev;
+	struct tagBPlusTreeLeaf *next;
+	void *data[BPLUS_TREE_NODE_SIZE];
+} BPlusTreeLeaf;
+
+typedef struct tagBPlusTreeInternal {
+	BPlusTreeNode header;
+	void *keys[BPLUS_TREE_NODE_SIZE];  //keys[i] is the min of children[i + 1]
+	BPlusTreeNode *children[BPLUS_TREE_NODE_SIZE + 1];
+} BPlusTreeInternal;
+
+typedef struct tagBPlusTreeInfo {
+	BPlusTreeNode *root;
+	BPlusTreeLeaf *head;  //the first leaf
+	BPlusTreeLeaf *tail;  //the last leaf
+	int count;  //data count
+	int depth;
+	FreeDataFunc free_data_func;
+	CompareFunc compare_func;
+	struct fast_mblock_man leaf_allocator;
+	struct fast_mblock_man internal_allocator;
+} BPlusTreeInfo;
+
+typedef struct tagBPlusTreeIterator {
+	BPlusTreeLeaf *leaf;  //NULL when the iteration ended
+	int index;
+	void *end;  //the end data (exclusive), NULL for all
+	CompareFunc compare_func;
+} BPlusTreeIterator;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * init the tree
+ * parameters:
+ *         tree: the tree
+ *         free_data_func: the function to free the data, can be NULL
+ *         compare_func: the function to compare the data
+ * return 0 for success, != 0 fail (errno)
+*/
+int bplus_tree_init(BPlusTreeInfo *tree, FreeDataFunc free_data_func, \
+	CompareFunc compare_func);
+void bplus_tree_destroy(BPlusTreeInfo *tree);
+
+/**
+ * insert the data
+ * return 1 for inserted, 0 for the data already exists, < 0 fail (-errno)
+*/
+int bplus_tree_insert(BPlusTreeInfo *tree, void *data);
+
+/**
+ * insert the data or replace the existing one
+ * return 1 for inserted, 0 for replaced, < 0 fail (-errno)
+*/
+int bplus_tree_replace(BPlusTreeInfo *tree, void *data);
+
+/**
+ * delete the data
+ * return 1 for deleted, 0 for not found
+*/
+int bplus_tree_delete(BPlusTreeInfo *tree, void *data);
+void *bplus_tree_find(BPlusTreeInfo *tree, void *target_data);
+void *bplus_tree_find_ge(BPlusTreeInfo *tree, void *target_data);
+int bplus_tree_walk(BPlusTreeInfo *tree, DataOpFunc data_op_func, void *args);
+
+/**
+ * iterate the data in [start, end) by the linked leaves
+ * parameters:
+ *         tree: the tree
+ *         start: the start data (inclusive), NULL for the first
+ *         end: the end data (exclusive), NULL for the last
+ *         iterator: the iterator to init
+ * return 0 for success, ENOENT for empty
+*/
+int bplus_tree_find_range(BPlusTreeInfo *tree, void *start, void *end, \
+	BPlusTreeIterator *iterator);
+
+static inline void bplus_tree_iterator(BPlusTreeInfo *tree, \
+	BPlusTreeIterator *iterator)
+{
+	iterator->leaf = tree->head;
+	iterator->index = 0;
+	iterator->end = NULL;
+	iterator->compare_func = tree->compare_func;
+}
+
+static inline void *bplus_tree_next(BPlusTreeIterator *iterator)
+{
+	void *data;
+
+	while (iterator->leaf != NULL && \
+		iterator->index >= iterator->leaf->header.count)
+	{
+		iterator->leaf = iterator->leaf->next;
+		iterator->index = 0;
+	}
+	if (iterator->leaf == NULL)
+	{
+		return NULL;
+	}
+
+	data = iterator->leaf->data[iterator->index];
+	if (iterator->end != NULL && \
+		iterator->compare_func(data, iterator->end) >= 0)
+	{
+		iterator->leaf = NULL;
+		return NULL;
+	}
+
+	iterator->index++;
+	return data;
+}
+
+static inline int bplus_tree_count(BPlusTreeInfo *tree)
+{
+	return tree->count;
+}
+
+static inline int bplus_tree_depth(BPlusTreeInfo *tree)
+{
+	return tree->depth;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -11,10 +11,18 @@
 #include <string.h>
 #include <errno.h>
 #include "chain.h"
+#include "fast_mblock.h"
 //#include "use_mmalloc.h"
 
 void chain_init(ChainList *pList, const int type, FreeDataFunc freeDataFunc, \
 		CompareFunc compareFunc)
+{
+	chain_init_ex(pList, type, freeDataFunc, compareFunc, NULL);
+}
+
+void chain_init_ex(ChainList *pList, const int type, \
+		FreeDataFunc freeDataFunc, CompareFunc compareFunc, \
+		struct fast_mblock_man *node_allocator)
 {
 	if (pList == NULL)
 	{
@@ -26,10 +34,43 @@ void chain_init(ChainList *pList, const int type, FreeDataFunc freeDataFunc, \
 	pList->type = type;
 	pList->freeDataFunc = freeDataFunc;
 	pList->compareFunc = compareFunc;
+	pList->node_allocator = node_allocator;
 
 	return;
 }
 
+int chain_node_allocator_init(struct fast_mblock_man *node_allocator, \
+		const int alloc_elements_once, const bool need_lock)
+{
+	return fast_mblock_init_ex(node_allocator, sizeof(ChainNode), \
+			alloc_elements_once, NULL, need_lock);
+}
+
+static inline ChainNode *chain_alloc_node(ChainList *pList)
+{
+	if (pList->node_allocator != NULL)
+	{
+		return (ChainNode *)fast_mblock_alloc_object( \
+				pList->node_allocator);
+	}
+	else
+	{
+		return (ChainNode *)malloc(sizeof(ChainNode));
+	}
+}
+
+static inline void chain_free_node(ChainList *pList, ChainNode *pChainNode)
+{
+	if (pList->node_allocator != NULL)
+	{
+		fast_mblock_free_object(pList->node_allocator, pChainNode);
+	}
+	else
+	{
+		free(pChainNode);
+	}
+}
+
 void chain_destroy(ChainList *pList)
 {
 	ChainNode *pNode;
@@ -58,7 +99,7 @@ void freeChainNode(ChainList *pList, ChainNode *pChainNode)
 		pList->freeDataFunc(pChainNode->data);
 	}
 
-	free(pChainNode);
+	chain_free_node(pList, pChainNode);
 }
 
 int insertNodePrior(ChainList *pList, void *data)
@@ -69,7 +110,7 @@ int insertNodePrior(ChainList *pList, void *data)
 		return EINVAL;
 	}
 
-	pNode = (ChainNode *)malloc(sizeof(ChainNode));
+	pNode = chain_alloc_node(pList);
 	if (pNode == NULL)
 	{
 		return ENOMEM;
@@ -95,7 +136,7 @@ int appendNode(ChainList *pList, void *data)
 		return EINVAL;
 	}
 
-	pNode = (ChainNode *)malloc(sizeof(ChainNode));
+	pNode = chain_alloc_node(pList);
 	if (pNode == NULL)
 	{
 		return ENOMEM;
@@ -128,7 +169,7 @@ int insertNodeAsc(ChainList *pList, void *data)
 		return EINVAL;
 	}
 
-	pNew = (ChainNode *)malloc(sizeof(ChainNode));
+	pNew = chain_alloc_node(pList);
 	if (pNew == NULL)
 	{
 		return ENOMEM;
@@ -246,7 +287,7 @@ void *chain_pop_head(ChainList *pList)
 	}
 
 	data = pDeletedNode->data;
-	free(pDeletedNode);
+	chain_free_node(pList, pDeletedNode);
 
 	return data;
 }
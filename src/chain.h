@@ -9,6 +9,7 @@
 #ifndef CHAIN_H
 #define CHAIN_H
 
+#include <stddef.h>
 #include "common_define.h"
 
 #define CHAIN_TYPE_INSERT	0  //insert new node before head
@@ -21,6 +22,8 @@ typedef struct tagChainNode
 	struct tagChainNode *next;
 } ChainNode;
 
+struct fast_mblock_man;
+
 typedef struct
 {
 	int type;
@@ -28,8 +31,32 @@ typedef struct
 	ChainNode *tail;
 	FreeDataFunc freeDataFunc;
 	CompareFunc compareFunc;
+	struct fast_mblock_man *node_allocator;  //NULL for malloc
 } ChainList;
 
+/**
+  intrusive doubly linked list: the link is embedded in the user struct,
+  no memory allocated for add and the link is removed in O(1).
+  the list is circular, the head is a link without entry.
+*/
+typedef struct tagChainLink
+{
+	struct tagChainLink *prev;
+	struct tagChainLink *next;
+} ChainLink;
+
+//get the user struct from the link
+#define CHAIN_LINK_ENTRY(link, type, member) \
+	((type *)((char *)(link) - offsetof(type, member)))
+
+#define CHAIN_LINK_FOR_EACH(link, head) \
+	for (link=(head)->next; link!=(head); link=link->next)
+
+//the next link is fetched first, so the link can be removed in the loop
+#define CHAIN_LINK_FOR_EACH_SAFE(link, tmp, head) \
+	for (link=(head)->next, tmp=link->next; link!=(head); \
+		link=tmp, tmp=link->next)
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -49,6 +76,30 @@ extern "C" {
 void chain_init(ChainList *pList, const int type, FreeDataFunc freeDataFunc, \
 		CompareFunc compareFunc);
 
+/** chain init function with the node allocator
+ *  parameters:
+ *           pList: the chain list
+ *           type: chain type, same as chain_init
+ *           freeDataFunc: free data function pointer, can be NULL
+ *           compareFunc: compare data function pointer, can be NULL
+ *           node_allocator: the chain node pool, NULL for malloc,
+ *                           can be shared by the chains of one thread
+ *  return: none
+ */
+void chain_init_ex(ChainList *pList, const int type, \
+		FreeDataFunc freeDataFunc, CompareFunc compareFunc, \
+		struct fast_mblock_man *node_allocator);
+
+/** init the chain node pool for chain_init_ex
+ *  parameters:
+ *           node_allocator: the chain node pool
+ *           alloc_elements_once: malloc nodes once, 0 for 1MB memory once
+ *           need_lock: if need lock, true when shared by multi threads
+ *  return: error no, 0 for success, != 0 fail
+ */
+int chain_node_allocator_init(struct fast_mblock_man *node_allocator, \
+		const int alloc_elements_once, const bool need_lock);
+
 /** destroy chain
  * parameters:
  *         pList: the chain list
@@ -140,6 +191,69 @@ int insertNodePrior(ChainList *pList, void *data);
  */
 int appendNode(ChainList *pList, void *data);
 
+static inline void chain_link_init(ChainLink *head)
+{
+	head->prev = head->next = head;
+}
+
+static inline bool chain_link_empty(ChainLink *head)
+{
+	return head->next == head;
+}
+
+static inline void chain_link_insert(ChainLink *link, ChainLink *prev, \
+		ChainLink *next)
+{
+	link->prev = prev;
+	link->next = next;
+	prev->next = link;
+	next->prev = link;
+}
+
+//add the link after the head
+static inline void chain_link_add_head(ChainLink *head, ChainLink *link)
+{
+	chain_link_insert(link, head, head->next);
+}
+
+//add the link before the head, as the tail
+static inline void chain_link_add_tail(ChainLink *head, ChainLink *link)
+{
+	chain_link_insert(link, head->prev, head);
+}
+
+//remove the link from its list, the link is reset to an empty list
+static inline void chain_link_remove(ChainLink *link)
+{
+	link->prev->next = link->next;
+	link->next->prev = link->prev;
+	link->prev = link->next = link;
+}
+
+//return the first link, NULL when the list is empty
+static inline ChainLink *chain_link_first(ChainLink *head)
+{
+	return head->next != head ? head->next : NULL;
+}
+
+//return the last link, NULL when the list is empty
+static inline ChainLink *chain_link_last(ChainLink *head)
+{
+	return head->prev != head ? head->prev : NULL;
+}
+
+//remove and return the first link, NULL when the list is empty
+static inline ChainLink *chain_link_pop_head(ChainLink *head)
+{
+	ChainLink *link;
+
+	if ((link=chain_link_first(head)) != NULL)
+	{
+		chain_link_remove(link);
+	}
+	return link;
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,818 @@
+/**
+* Copyright (C) 2015 Happy Fish / YuQing
+*
+* libfastcommon may be copied only under the terms of the GNU General
+* Public License V3, which may be found in the FastDFS source kit.
+* Please visit the FastDFS Home Page http://www.csource.org/ for more detail.
+**/
+
+//concurrent_skiplist.c
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include "logger.h"
+#include "pthread_func.h"
+#include "concurrent_skiplist.h"
+
+#define CONCURRENT_SKIPLIST_MAX_LEVEL_COUNT  20
+
+#define CSL_EPOCH_IDLE   INT64_MAX
+
+//the node is being linked by the inserter
+#define CSL_FLAG_LINKING   1
+//the node is logically deleted by the deleter
+#define CSL_FLAG_DELETED   2
+
+#define CSL_IS_MARKED(p)  (((unsigned long)(p)) & 1)
+#define CSL_MARKED(p)   ((ConcurrentSkiplistNode *)(((unsigned long)(p)) | 1))
+#define CSL_UNMARKED(p) ((ConcurrentSkiplistNode *)(((unsigned long)(p)) & ~1UL))
+
+#define CSL_CAS(ptr, oldval, newval) \
+    __sync_bool_compare_and_swap(ptr, oldval, newval)
+
+static void concurrent_skiplist_thread_exit(void *arg)
+{
+    ConcurrentSkiplistThread *thread;
+
+    thread = (ConcurrentSkiplistThread *)arg;
+    thread->nesting = 0;
+    thread->epoch = CSL_EPOCH_IDLE;
+    __sync_synchronize();
+    thread->in_use = 0;
+}
+
+int concurrent_skiplist_init_ex(ConcurrentSkiplist *sl, const int level_count,
+        skiplist_compare_func compare_func, skiplist_free_func free_func,
+        const int min_alloc_elements_once)
+{
+    int bytes;
+    int element_size;
+    int i;
+    int alloc_elements_once;
+    int result;
+    struct fast_mblock_man *top_mblock;
+
+    if (level_count <= 0) {
+        logError("file: "__FILE__", line: %d, "
+                "invalid level count: %d",
+                __LINE__, level_count);
+        return EINVAL;
+    }
+
+    if (level_count > CONCURRENT_SKIPLIST_MAX_LEVEL_COUNT) {
+        logError("file: "__FILE__", line: %d, "
+                "level count: %d is too large",
+                __LINE__, level_count);
+        return E2BIG;
+    }
+
+    bytes = sizeof(struct fast_mblock_man) * level_count;
+    sl->mblocks = (struct fast_mblock_man *)malloc(bytes);
+    if (sl->mblocks == NULL) {
+        logError("file: "__FILE__", line: %d, "
+                "malloc %d bytes fail, errno: %d, error info: %s",
+                __LINE__, bytes, errno, STRERROR(errno));
+        return errno != 0 ? errno : ENOMEM;
+    }
+    memset(sl->mblocks, 0, bytes);
+
+    alloc_elements_once = min_alloc_elements_once;
+    if (alloc_elements_once <= 0) {
+        alloc_elements_once = SKIPLIST_DEFAULT_MIN_ALLOC_ELEMENTS_ONCE;
+    }
+    else if (alloc_elements_once > 1024) {
+        alloc_elements_once = 1024;
+    }
+
+    for (i=level_count-1; i>=0; i--) {
+        element_size = sizeof(ConcurrentSkiplistNode) +
+            sizeof(ConcurrentSkiplistNode *) * (i + 1);
+        if ((result=fast_mblock_init_ex(sl->mblocks + i,
+            element_size, alloc_elements_once, NULL, true)) != 0)
+        {
+            return result;
+        }
+        if (alloc_elements_once < 1024 * 1024) {
+            alloc_elements_once *= 2;
+        }
+    }
+
+    sl->top_level_index = level_count - 1;
+    top_mblock = sl->mblocks + sl->top_level_index;
+    sl->top = (ConcurrentSkiplistNode *)fast_mblock_alloc_object(top_mblock);
+    if (sl->top == NULL) {
+        return ENOMEM;
+    }
+    memset(sl->top, 0, top_mblock->info.element_size);
+    sl->top->level_index = sl->top_level_index;
+
+    if ((result=pthread_key_create(&sl->thread_key,
+                    concurrent_skiplist_thread_exit)) != 0)
+    {
+        logError("file: "__FILE__", line: %d, "
+                "pthread_key_create fail, errno: %d, error info: %s",
+                __LINE__, result, STRERROR(result));
+        return result;
+    }
+    if ((result=init_pthread_lock(&sl->reclaim_lock)) != 0) {
+        return result;
+    }
+
+    sl->epoch = 1;
+    sl->retired = NULL;
+    sl->threads = NULL;
+    sl->element_count = 0;
+    sl->level_count = level_count;
+    sl->compare_func = compare_func;
+    sl->free_func = free_func;
+    return 0;
+}
+
+static void concurrent_skiplist_free_node(ConcurrentSkiplist *sl,
+        ConcurrentSkiplistNode *node)
+{
+    if (sl->free_func != NULL) {
+        sl->free_func(node->data);
+    }
+    fast_mblock_free_object(sl->mblocks + node->level_index, node);
+}
+
+void concurrent_skiplist_destroy(ConcurrentSkiplist *sl)
+{
+    int i;
+    ConcurrentSkiplistNode *node;
+    ConcurrentSkiplistThread *thread;
+    ConcurrentSkiplistThread *thread_next;
+
+    if (sl->mblocks == NULL) {
+        return;
+    }
+
+    if (sl->free_func != NULL) {
+        node = CSL_UNMARKED(sl->top->links[0]);
+        while (node != NULL) {
+            if (!CSL_IS_MARKED(node->links[0])) {
+                sl->free_func(node->data);
+            }
+            node = CSL_UNMARKED(node->links[0]);
+        }
+
+        //the marked nodes are in the retired list or still linked
+        node = sl->retired;
+        while (node != NULL) {
+            sl->free_func(node->data);
+            node = node->retire_next;
+        }
+        sl->retired = NULL;
+    }
+
+    pthread_key_delete(sl->thread_key);
+    thread = sl->threads;
+    while (thread != NULL) {
+        thread_next = thread->next;
+        free(thread);
+        thread = thread_next;
+    }
+    sl->threads = NULL;
+    pthread_mutex_destroy(&sl->reclaim_lock);
+
+    for (i=0; i<sl->level_count; i++) {
+        fast_mblock_destroy(sl->mblocks + i);
+    }
+
+    free(sl->mblocks);
+    sl->mblocks = NULL;
+}
+
+static ConcurrentSkiplistThread *concurrent_skiplist_get_thread(
+        ConcurrentSkiplist *sl)
+{
+    ConcurrentSkiplistThread *thread;
+
+    thread = (ConcurrentSkiplistThread *)pthread_getspecific(sl->thread_key);
+    if (thread != NULL) {
+        return thread;
+    }
+
+    //reuse the record of the exited thread
+    for (thread=sl->threads; thread!=NULL; thread=thread->next) {
+        if (thread->in_use == 0 && CSL_CAS(&thread->in_use, 0, 1)) {
+            break;
+        }
+    }
+
+    if (thread == NULL) {
+        thread = (ConcurrentSkiplistThread *)malloc(
+                sizeof(ConcurrentSkiplistThread));
+        if (thread == NULL) {
+            logError("file: "__FILE__", line: %d, "
+                    "malloc %d bytes fail, errno: %d, error info: %s",
+                    __LINE__, (int)sizeof(ConcurrentSkiplistThread),
+                    errno, STRERROR(errno));
+            return NULL;
+        }
+        memset(thread, 0, sizeof(ConcurrentSkiplistThread));
+        thread->in_use = 1;
+        thread->epoch = CSL_EPOCH_IDLE;
+        do {
+            thread->next = sl->threads;
+        } while (!CSL_CAS(&sl->threads, thread->next, thread));
+    }
+
+    thread->nesting = 0;
+    thread->seed = (unsigned int)time(NULL) ^ (unsigned int)pthread_self();
+    pthread_setspecific(sl->thread_key, thread);
+    return thread;
+}
+
+static inline void concurrent_skiplist_enter(ConcurrentSkiplist *sl,
+        ConcurrentSkiplistThread *thread)
+{
+    if (thread->nesting++ == 0) {
+        thread->epoch = sl->epoch;
+        __sync_synchronize();
+    }
+}
+
+static inline void concurrent_skiplist_leave(ConcurrentSkiplistThread *thread)
+{
+    if (--thread->nesting == 0) {
+        __sync_synchronize();
+        thread->epoch = CSL_EPOCH_IDLE;
+    }
+}
+
+static void concurrent_skiplist_retire(ConcurrentSkiplist *sl,
+        ConcurrentSkiplistNode *node)
+{
+    node->retire_epoch = __sync_fetch_and_add(&sl->epoch, 1);
+    do {
+        node->retire_next = sl->retired;
+    } while (!CSL_CAS(&sl->retired, node->retire_next, node));
+}
+
+/**
+  free the retired nodes which no thread can hold: a thread which entered
+  before the node unlinked has an epoch <= the retire epoch of the node
+*/
+static void concurrent_skiplist_reclaim(ConcurrentSkiplist *sl)
+{
+    int64_t min_epoch;
+    ConcurrentSkiplistThread *thread;
+    ConcurrentSkiplistNode *node;
+    ConcurrentSkiplistNode *next;
+    ConcurrentSkiplistNode *keep_head;
+    ConcurrentSkiplistNode *keep_tail;
+
+    if (sl->retired == NULL) {
+        return;
+    }
+    if (pthread_mutex_trylock(&sl->reclaim_lock) != 0) {
+        return;  //other thread is reclaiming
+    }
+
+    node = __sync_lock_test_and_set(&sl->retired, NULL);
+    __sync_synchronize();
+    min_epoch = sl->epoch;
+    for (thread=sl->threads; thread!=NULL; thread=thread->next) {
+        if (thread->epoch < min_epoch) {
+            min_epoch = thread->epoch;
+        }
+    }
+
+    keep_head = keep_tail = NULL;
+    while (node != NULL) {
+        next = node->retire_next;
+        if (node->retire_epoch < min_epoch) {
+            concurrent_skiplist_free_node(sl, node);
+        }
+        else {
+            if (keep_head == NULL) {
+                keep_head = node;
+            }
+            else {
+                keep_tail->retire_next = node;
+            }
+            keep_tail = node;
+        }
+        node = next;
+    }
+
+    if (keep_head != NULL) {
+        do {
+            keep_tail->retire_next = sl->retired;
+        } while (!CSL_CAS(&sl->retired, keep_tail->retire_next, keep_head));
+    }
+    pthread_mutex_unlock(&sl->reclaim_lock);
+}
+
+static inline int concurrent_skiplist_get_level_index(ConcurrentSkiplist *sl,
+        ConcurrentSkiplistThread *thread)
+{
+    int i;
+
+    for (i=0; i<sl->top_level_index; i++) {
+        if (rand_r(&thread->seed) < RAND_MAX / 2) {
+            break;
+        }
+    }
+
+    return i;
+}
+
+/**
+  find the previous and next nodes of every level and unlink the marked nodes
+  on the way. upper: true for the next node > the data, false for >= the data
+*/
+static void concurrent_skiplist_search(ConcurrentSkiplist *sl, void *data,
+        ConcurrentSkiplistNode **preds, ConcurrentSkiplistNode **succs,
+        const bool upper)
+{
+    int i;
+    int cmp;
+    ConcurrentSkiplistNode *pred;
+    ConcurrentSkiplistNode *curr;
+    ConcurrentSkiplistNode *succ;
+
+retry:
+    pred = sl->top;
+    for (i=sl->top_level_index; i>=0; i--) {
+        curr = CSL_UNMARKED(pred->links[i]);
+        while (curr != NULL) {
+            succ = curr->links[i];
+            while (CSL_IS_MARKED(succ)) {
+                if (!CSL_CAS(&pred->links[i], curr, CSL_UNMARKED(succ))) {
+                    goto retry;
+                }
+                curr = CSL_UNMARKED(succ);
+                if (curr == NULL) {
+                    break;
+                }
+                succ = curr->links[i];
+            }
+            if (curr == NULL) {
+                break;
+            }
+
+            cmp = sl->compare_func(data, curr->data);
+            if (cmp > 0 || (upper && cmp == 0)) {
+                pred = curr;
+                curr = succ;
+            }
+            else {
+                break;
+            }
+        }
+
+        preds[i] = pred;
+        succs[i] = curr;
+    }
+}
+
+//return the first live node >= the data without any write
+static ConcurrentSkiplistNode *concurrent_skiplist_lower_bound(
+        ConcurrentSkiplist *sl, void *data)
+{
+    int i;
+    ConcurrentSkiplistNode *pred;
+    ConcurrentSkiplistNode *curr;
+    ConcurrentSkiplistNode *succ;
+
+    pred = sl->top;
+    curr = NULL;
+    for (i=sl->top_level_index; i>=0; i--) {
+        curr = CSL_UNMARKED(pred->links[i]);
+        while (curr != NULL) {
+            succ = curr->links[i];
+            if (CSL_IS_MARKED(succ)) {  //skip the deleted node
+                curr = CSL_UNMARKED(succ);
+                continue;
+            }
+
+            if (sl->compare_func(data, curr->data) > 0) {
+                pred = curr;
+                curr = succ;
+            }
+            else {
+                break;
+            }
+        }
+    }
+
+    return curr;
+}
+
+/**
+  unlink the marked node from every level by the node identity, the search
+  by the data can't tell the node from the other nodes of the equal data.
+  the node can be retired after this function returns
+*/
+static void concurrent_skiplist_unlink(ConcurrentSkiplist *sl,
+        ConcurrentSkiplistNode *node)
+{
+    int i;
+    ConcurrentSkiplistNode *preds[CONCURRENT_SKIPLIST_MAX_LEVEL_COUNT];
+    ConcurrentSkiplistNode *succs[CONCURRENT_SKIPLIST_MAX_LEVEL_COUNT];
+    ConcurrentSkiplistNode *pred;
+    ConcurrentSkiplistNode *curr;
+    ConcurrentSkiplistNode *succ;
+
+retry:
+    //preds[i] is the last node < the data, the equal nodes follow it
+    concurrent_skiplist_search(sl, node->data, preds, succs, false);
+    for (i=node->level_index; i>=0; i--) {
+        pred = preds[i];
+        curr = CSL_UNMARKED(pred->links[i]);
+        while (curr != NULL) {
+            succ = curr->links[i];
+            if (curr == node) {
+                if (!CSL_CAS(&pred->links[i], node, CSL_UNMARKED(succ))) {
+                    goto retry;
+                }
+                break;
+            }
+
+            if (CSL_IS_MARKED(succ)) {  //other deleted node
+                if (!CSL_CAS(&pred->links[i], curr, CSL_UNMARKED(succ))) {
+                    goto retry;
+                }
+                curr = CSL_UNMARKED(succ);
+                continue;
+            }
+
+            if (sl->compare_func(node->data, curr->data) < 0) {
+                break;  //not linked at this level
+            }
+            pred = curr;
+            curr = succ;
+        }
+    }
+}
+
+int concurrent_skiplist_insert(ConcurrentSkiplist *sl, void *data)
+{
+    int i;
+    int level_index;
+    int old_flags;
+    ConcurrentSkiplistThread *thread;
+    ConcurrentSkiplistNode *preds[CONCURRENT_SKIPLIST_MAX_LEVEL_COUNT];
+    ConcurrentSkiplistNode *succs[CONCURRENT_SKIPLIST_MAX_LEVEL_COUNT];
+    ConcurrentSkiplistNode *node;
+    ConcurrentSkiplistNode *succ;
+
+    if ((thread=concurrent_skiplist_get_thread(sl)) == NULL) {
+        return ENOMEM;
+    }
+
+    level_index = concurrent_skiplist_get_level_index(sl, thread);
+    node = (ConcurrentSkiplistNode *)fast_mblock_alloc_object(
+            sl->mblocks + level_index);
+    if (node == NULL) {
+        return ENOMEM;
+    }
+    memset(node, 0, sl->mblocks[level_index].info.element_size);
+    node->data = data;
+    node->level_index = level_index;
+    node->flags = CSL_FLAG_LINKING;
+
+    concurrent_skiplist_enter(sl, thread);
+    while (1) {
+        concurrent_skiplist_search(sl, data, preds, succs, true);
+        for (i=0; i<=level_index; i++) {
+            node->links[i] = succs[i];
+        }
+        if (CSL_CAS(&preds[0]->links[0], succs[0], node)) {
+            break;
+        }
+    }
+    __sync_add_and_fetch(&sl->element_count, 1);
+
+    for (i=1; i<=level_index; i++) {
+        while (1) {
+            succ = node->links[i];
+            if (CSL_IS_MARKED(succ)) {
+                break;   //deleted by other thread
+            }
+            if (succ != succs[i] && !CSL_CAS(&node->links[i],
+                        succ, succs[i]))
+            {
+                break;
+            }
+            if (CSL_CAS(&preds[i]->links[i], succs[i], node)) {
+                break;
+            }
+            concurrent_skiplist_search(sl, data, preds, succs, true);
+        }
+
+        if (CSL_IS_MARKED(node->links[i])) {
+            break;
+        }
+    }
+
+    /* the deleter can't retire the node during linking, because the node
+       maybe linked to a level after the deleter unlinked it */
+    old_flags = __sync_fetch_and_and(&node->flags, ~CSL_FLAG_LINKING);
+    if ((old_flags & CSL_FLAG_DELETED) != 0) {
+        concurrent_skiplist_unlink(sl, node);
+        concurrent_skiplist_retire(sl, node);
+    }
+    concurrent_skiplist_leave(thread);
+
+    return 0;
+}
+
+static int concurrent_skiplist_do_delete(ConcurrentSkiplist *sl,
+        ConcurrentSkiplistThread *thread, void *data)
+{
+    int i;
+    int old_flags;
+    ConcurrentSkiplistNode *node;
+    ConcurrentSkiplistNode *succ;
+
+    while (1) {
+        node = concurrent_skiplist_lower_bound(sl, data);
+        if (node == NULL || sl->compare_func(data, node->data) != 0) {
+            return ENOENT;
+        }
+
+        for (i=node->level_index; i>=1; i--) {
+            do {
+                succ = node->links[i];
+                if (CSL_IS_MARKED(succ)) {
+                    break;
+                }
+            } while (!CSL_CAS(&node->links[i], succ, CSL_MARKED(succ)));
+        }
+
+        //the thread which marks the level 0 wins
+        do {
+            succ = node->links[0];
+            if (CSL_IS_MARKED(succ)) {
+                break;
+            }
+        } while (!CSL_CAS(&node->links[0], succ, CSL_MARKED(succ)));
+        if (!CSL_IS_MARKED(succ)) {
+            break;
+        }
+    }
+
+    __sync_sub_and_fetch(&sl->element_count, 1);
+    old_flags = __sync_fetch_and_or(&node->flags, CSL_FLAG_DELETED);
+    if ((old_flags & CSL_FLAG_LINKING) == 0) {
+        concurrent_skiplist_unlink(sl, node);
+        concurrent_skiplist_retire(sl, node);
+    }
+    return 0;
+}
+
+int concurrent_skiplist_delete(ConcurrentSkiplist *sl, void *data)
+{
+    int result;
+    ConcurrentSkiplistThread *thread;
+
+    if ((thread=concurrent_skiplist_get_thread(sl)) == NULL) {
+        return ENOMEM;
+    }
+
+    concurrent_skiplist_enter(sl, thread);
+    result = concurrent_skiplist_do_delete(sl, thread, data);
+    concurrent_skiplist_leave(thread);
+
+    if (result == 0 && thread->nesting == 0) {
+        concurrent_skiplist_reclaim(sl);
+    }
+    return result;
+}
+
+int concurrent_skiplist_delete_all(ConcurrentSkiplist *sl, void *data,
+        int *delete_count)
+{
+    ConcurrentSkiplistThread *thread;
+
+    *delete_count = 0;
+    if ((thread=concurrent_skiplist_get_thread(sl)) == NULL) {
+        return ENOMEM;
+    }
+
+    concurrent_skiplist_enter(sl, thread);
+    while (concurrent_skiplist_do_delete(sl, thread, data) == 0) {
+        (*delete_count)++;
+    }
+    concurrent_skiplist_leave(thread);
+
+    if (*delete_count > 0 && thread->nesting == 0) {
+        concurrent_skiplist_reclaim(sl);
+    }
+    return *delete_count > 0 ? 0 : ENOENT;
+}
+
+void *concurrent_skiplist_find(ConcurrentSkiplist *sl, void *data)
+{
+    ConcurrentSkiplistThread *thread;
+    ConcurrentSkiplistNode *node;
+    void *found;
+
+    if ((thread=concurrent_skiplist_get_thread(sl)) == NULL) {
+        return NULL;
+    }
+
+    concurrent_skiplist_enter(sl, thread);
+    node = concurrent_skiplist_lower_bound(sl, data);
+    if (node != NULL && sl->compare_func(data, node->data) == 0) {
+        found = node->data;
+    }
+    else {
+        found = NULL;
+    }
+    concurrent_skiplist_leave(thread);
+
+    return found;
+}
+
+int concurrent_skiplist_find_all(ConcurrentSkiplist *sl, void *data,
+        ConcurrentSkiplistIterator *iterator)
+{
+    ConcurrentSkiplistNode *node;
+
+    iterator->sl = sl;
+    iterator->data = data;
+    iterator->end = NULL;
+    if ((iterator->thread=concurrent_skiplist_get_thread(sl)) == NULL) {
+        iterator->current = NULL;
+        return ENOMEM;
+    }
+
+    concurrent_skiplist_enter(sl, iterator->thread);
+    node = concurrent_skiplist_lower_bound(sl, data);
+    if (node == NULL || sl->compare_func(data, node->data) != 0) {
+        concurrent_skiplist_iterator_end(iterator);
+        return ENOENT;
+    }
+
+    iterator->current = node;
+    return 0;
+}
+
+void *concurrent_skiplist_find_ge(ConcurrentSkiplist *sl, void *data)
+{
+    ConcurrentSkiplistThread *thread;
+    ConcurrentSkiplistNode *node;
+    void *found;
+
+    if ((thread=concurrent_skiplist_get_thread(sl)) == NULL) {
+        return NULL;
+    }
+
+    concurrent_skiplist_enter(sl, thread);
+    node = concurrent_skiplist_lower_bound(sl, data);
+    found = (node != NULL) ? node->data : NULL;
+    concurrent_skiplist_leave(thread);
+
+    return found;
+}
+
+void *concurrent_skiplist_find_le(ConcurrentSkiplist *sl, void *data)
+{
+    int i;
+    ConcurrentSkiplistThread *thread;
+    ConcurrentSkiplistNode *pred;
+    ConcurrentSkiplistNode *curr;
+    ConcurrentSkiplistNode *succ;
+    void *found;
+
+    if ((thread=concurrent_skiplist_get_thread(sl)) == NULL) {
+        return NULL;
+    }
+
+    concurrent_skiplist_enter(sl, thread);
+    pred = sl->top;
+    for (i=sl->top_level_index; i>=0; i--) {
+        curr = CSL_UNMARKED(pred->links[i]);
+        while (curr != NULL) {
+            succ = curr->links[i];
+            if (CSL_IS_MARKED(succ)) {  //skip the deleted node
+                curr = CSL_UNMARKED(succ);
+                continue;
+            }
+
+            if (sl->compare_func(data, curr->data) >= 0) {
+                pred = curr;
+                curr = succ;
+            }
+            else {
+                break;
+            }
+        }
+    }
+    found = (pred != sl->top) ? pred->data : NULL;
+    concurrent_skiplist_leave(thread);
+
+    return found;
+}
+
+int concurrent_skiplist_find_range(ConcurrentSkiplist *sl, void *start,
+        void *end, ConcurrentSkiplistIterator *iterator)
+{
+    ConcurrentSkiplistNode *node;
+
+    iterator->sl = sl;
+    iterator->data = NULL;
+    iterator->end = end;
+    if ((iterator->thread=concurrent_skiplist_get_thread(sl)) == NULL) {
+        iterator->current = NULL;
+        return ENOMEM;
+    }
+
+    concurrent_skiplist_enter(sl, iterator->thread);
+    node = concurrent_skiplist_lower_bound(sl, start);
+    if (node == NULL || sl->compare_func(node->data, end) >= 0) {
+        concurrent_skiplist_iterator_end(iterator);
+        return ENOENT;
+    }
+
+    iterator->current = node;
+    return 0;
+}
+
+int concurrent_skiplist_delete_range(ConcurrentSkiplist *sl, void *start,
+        void *end, int *delete_count)
+{
+    ConcurrentSkiplistThread *thread;
+    ConcurrentSkiplistNode *node;
+
+    *delete_count = 0;
+    if ((thread=concurrent_skiplist_get_thread(sl)) == NULL) {
+        return ENOMEM;
+    }
+
+    concurrent_skiplist_enter(sl, thread);
+    while (1) {
+        node = concurrent_skiplist_lower_bound(sl, start);
+        if (node == NULL || sl->compare_func(node->data, end) >= 0) {
+            break;
+        }
+
+        //the node maybe deleted by other thread, delete by the data
+        if (concurrent_skiplist_do_delete(sl, thread, node->data) == 0) {
+            (*delete_count)++;
+        }
+    }
+    concurrent_skiplist_leave(thread);
+
+    if (*delete_count > 0 && thread->nesting == 0) {
+        concurrent_skiplist_reclaim(sl);
+    }
+    return *delete_count > 0 ? 0 : ENOENT;
+}
+
+int concurrent_skiplist_iterator(ConcurrentSkiplist *sl,
+        ConcurrentSkiplistIterator *iterator)
+{
+    iterator->sl = sl;
+    iterator->data = NULL;
+    iterator->end = NULL;
+    if ((iterator->thread=concurrent_skiplist_get_thread(sl)) == NULL) {
+        iterator->current = NULL;
+        return ENOMEM;
+    }
+
+    concurrent_skiplist_enter(sl, iterator->thread);
+    iterator->current = CSL_UNMARKED(sl->top->links[0]);
+    return 0;
+}
+
+void *concurrent_skiplist_next(ConcurrentSkiplistIterator *iterator)
+{
+    ConcurrentSkiplistNode *node;
+    ConcurrentSkiplistNode *succ;
+
+    node = iterator->current;
+    while (node != NULL && CSL_IS_MARKED(succ=node->links[0])) {
+        node = CSL_UNMARKED(succ);
+    }
+
+    if (node == NULL || (iterator->data != NULL && iterator->sl->
+                compare_func(iterator->data, node->data) != 0) ||
+            (iterator->end != NULL && iterator->sl->compare_func(
+                node->data, iterator->end) >= 0))
+    {
+        concurrent_skiplist_iterator_end(iterator);
+        return NULL;
+    }
+
+    iterator->current = CSL_UNMARKED(node->links[0]);
+    return node->data;
+}
+
+void concurrent_skiplist_iterator_end(ConcurrentSkiplistIterator *iterator)
+{
+    iterator->current = NULL;
+    if (iterator->thread != NULL) {
+        concurrent_skiplist_leave(iterator->thread);
+        iterator->thread = NULL;
+    }
+}
@@ -0,0 +1,135 @@
+/**
+* Copyright (C) 2015 Happy Fish / YuQing
+*
+* libfastcommon may be copied only under the terms of the GNU General
+* Public License V3, which may be found in the FastDFS source kit.
+* Please visit the FastDFS Home Page http://www.csource.org/ for more detail.
+**/
+
+//concurrent_skiplist.h, lock-free skiplist, support stable sort  :)
+/**
+  the links of every level are updated by CAS, a deleted node is marked by
+  the lowest bit of its links (Fraser / Herlihy style). find and iterator
+  never block and never write the shared links. the deleted nodes are
+  reclaimed by epoch: a node is freed only after all the threads which
+  may hold it left their operations, so the free_func is called delayed.
+  notes:
+    1. the iterator must be used in the thread which created it, the
+       iterator pins the epoch of the thread until the end of iteration,
+       call concurrent_skiplist_iterator_end when break the iteration
+    2. every skiplist uses one pthread key for the thread records
+*/
+#ifndef _CONCURRENT_SKIPLIST_H
+#define _CONCURRENT_SKIPLIST_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "common_define.h"
+#include "skiplist_common.h"
+#include "fast_mblock.h"
+
+typedef struct concurrent_skiplist_node
+{
+    void *data;
+    int level_index;
+    volatile int flags;
+    int64_t retire_epoch;
+    struct concurrent_skiplist_node *retire_next;
+    struct concurrent_skiplist_node * volatile links[0];
+} ConcurrentSkiplistNode;
+
+typedef struct concurrent_skiplist_thread
+{
+    volatile int64_t epoch;  //the epoch when enter, INT64_MAX for idle
+    volatile int in_use;
+    int nesting;
+    unsigned int seed;       //for rand_r
+    struct concurrent_skiplist_thread *next;
+} ConcurrentSkiplistThread;
+
+typedef struct concurrent_skiplist
+{
+    int level_count;
+    int top_level_index;
+    volatile int element_count;
+    skiplist_compare_func compare_func;
+    skiplist_free_func free_func;
+    struct fast_mblock_man *mblocks;  //node allocators
+    ConcurrentSkiplistNode *top;      //the top node
+
+    volatile int64_t epoch;
+    ConcurrentSkiplistNode * volatile retired;  //the retired nodes to free
+    ConcurrentSkiplistThread * volatile threads;
+    pthread_key_t thread_key;
+    pthread_mutex_t reclaim_lock;
+} ConcurrentSkiplist;
+
+typedef struct concurrent_skiplist_iterator {
+    ConcurrentSkiplist *sl;
+    ConcurrentSkiplistThread *thread;  //NULL when the iteration ended
+    ConcurrentSkiplistNode *current;
+    void *data;   //the data to match for find_all, NULL for all
+    void *end;    //the end data (exclusive) for find_range, NULL for all
+} ConcurrentSkiplistIterator;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define concurrent_skiplist_init(sl, level_count, compare_func, free_func) \
+    concurrent_skiplist_init_ex(sl, level_count, compare_func, free_func,  \
+    SKIPLIST_DEFAULT_MIN_ALLOC_ELEMENTS_ONCE)
+
+int concurrent_skiplist_init_ex(ConcurrentSkiplist *sl, const int level_count,
+        skiplist_compare_func compare_func, skiplist_free_func free_func,
+        const int min_alloc_elements_once);
+
+/**
+ * destroy the skiplist, the caller must make sure that no other thread
+ * accesses the skiplist
+*/
+void concurrent_skiplist_destroy(ConcurrentSkiplist *sl);
+
+int concurrent_skiplist_insert(ConcurrentSkiplist *sl, void *data);
+int concurrent_skiplist_delete(ConcurrentSkiplist *sl, void *data);
+int concurrent_skiplist_delete_all(ConcurrentSkiplist *sl, void *data,
+        int *delete_count);
+void *concurrent_skiplist_find(ConcurrentSkiplist *sl, void *data);
+int concurrent_skiplist_find_all(ConcurrentSkiplist *sl, void *data,
+        ConcurrentSkiplistIterator *iterator);
+
+//return the first data >= the data, NULL for not found
+void *concurrent_skiplist_find_ge(ConcurrentSkiplist *sl, void *data);
+
+//return the last data <= the data, NULL for not found
+void *concurrent_skiplist_find_le(ConcurrentSkiplist *sl, void *data);
+
+//iterate the data in [start, end), return ENOENT for empty
+int concurrent_skiplist_find_range(ConcurrentSkiplist *sl, void *start,
+        void *end, ConcurrentSkiplistIterator *iterator);
+
+//delete the data in [start, end), return ENOENT when nothing deleted
+int concurrent_skiplist_delete_range(ConcurrentSkiplist *sl, void *start,
+        void *end, int *delete_count);
+
+int concurrent_skiplist_iterator(ConcurrentSkiplist *sl,
+        ConcurrentSkiplistIterator *iterator);
+void *concurrent_skiplist_next(ConcurrentSkiplistIterator *iterator);
+
+/**
+ * end the iteration before concurrent_skiplist_next returns NULL
+*/
+void concurrent_skiplist_iterator_end(ConcurrentSkiplistIterator *iterator);
+
+static inline int concurrent_skiplist_count(ConcurrentSkiplist *sl)
+{
+    return sl->element_count;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -15,11 +15,16 @@
 #include "sched_thread.h"
 #include "connection_pool.h"
 
+//the upper bounds of the connect latency buckets in microseconds
+static const int64_t conn_pool_latency_bounds[CONN_POOL_LATENCY_BUCKET_COUNT
+	- 1] = {100, 500, 1000, 5000, 10000, 50000, 100000, 1000000};
+
 int conn_pool_init_ex(ConnectionPool *cp, int connect_timeout, \
 	const int max_count_per_entry, const int max_idle_time,
     const int socket_domain)
 {
 	int result;
+	int bytes;
 
 	if ((result=init_pthread_lock(&cp->lock)) != 0)
 	{
@@ -29,8 +34,34 @@ int conn_pool_init_ex(ConnectionPool *cp, int connect_timeout, \
 	cp->max_count_per_entry = max_count_per_entry;
 	cp->max_idle_time = max_idle_time;
 	cp->socket_domain = socket_domain;
+	cp->thread_cache_size = 0;
+	cp->thread_caches = NULL;
+
+	bytes = sizeof(ConnectionManager *) * CONN_POOL_BUCKET_COUNT;
+	cp->buckets = (ConnectionManager **)malloc(bytes);
+	if (cp->buckets == NULL)
+	{
+		result = errno != 0 ? errno : ENOMEM;
+		logError("file: "__FILE__", line: %d, " \
+			"malloc %d bytes fail, errno: %d, " \
+			"error info: %s", __LINE__, bytes, \
+			result, STRERROR(result));
+		pthread_mutex_destroy(&cp->lock);
+		return result;
+	}
+	memset(cp->buckets, 0, bytes);
+
+	if ((result=fast_mblock_init_ex(&cp->node_allocator,
+		sizeof(ConnectionNode) + sizeof(ConnectionInfo),
+		0, NULL, true)) != 0)
+	{
+		free(cp->buckets);
+		cp->buckets = NULL;
+		pthread_mutex_destroy(&cp->lock);
+		return result;
+	}
 
-	return hash_init(&(cp->hash_array), simple_hash, 1024, 0.75);
+	return 0;
 }
 
 int conn_pool_init(ConnectionPool *cp, int connect_timeout,
@@ -41,36 +72,193 @@ int conn_pool_init(ConnectionPool *cp, int connect_timeout,
             max_idle_time, socket_domain);
 }
 
-int coon_pool_close_connections(const int index, const HashData *data, void *args)
+static void conn_pool_close_connections(ConnectionPool *cp,
+	ConnectionManager *cm)
 {
-    ConnectionManager *cm;
+	ConnectionNode *node;
+	ConnectionNode *deleted;
 
-    cm = (ConnectionManager *)data->value;
-    if (cm != NULL)
-    {
-        ConnectionNode *node;
-        ConnectionNode *deleted;
-
-        node = cm->head;
-        while (node != NULL)
-        {
-            deleted = node;
-            node = node->next;
-
-            conn_pool_disconnect_server(deleted->conn);
-            free(deleted);
-        }
-        free(cm);
-    }
+	node = cm->head;
+	while (node != NULL)
+	{
+		deleted = node;
+		node = node->next;
+
+		conn_pool_disconnect_server(deleted->conn);
+		fast_mblock_free_object(&cp->node_allocator, deleted);
+	}
+	pthread_mutex_destroy(&cm->lock);
+	free(cm);
+}
+
+/* push back the nodes after the first keep_count nodes to the manager */
+static void conn_pool_cache_flush_entry(ConnectionCacheEntry *entry,
+	const int keep_count)
+{
+	ConnectionManager *cm;
+	ConnectionNode *last;
+	ConnectionNode *first;
+	ConnectionNode *tail;
+	int count;
+
+	if (entry->free_count <= keep_count)
+	{
+		return;
+	}
+
+	if (keep_count == 0)
+	{
+		first = entry->head;
+		entry->head = NULL;
+	}
+	else
+	{
+		last = entry->head;
+		for (count=1; count<keep_count; count++)
+		{
+			last = last->next;
+		}
+		first = last->next;
+		last->next = NULL;
+	}
+
+	tail = first;
+	while (tail->next != NULL)
+	{
+		tail = tail->next;
+	}
+	count = entry->free_count - keep_count;
+	entry->free_count = keep_count;
+
+	cm = entry->manager;
+	pthread_mutex_lock(&cm->lock);
+	tail->next = cm->head;
+	cm->head = first;
+	cm->free_count += count;
+	pthread_mutex_unlock(&cm->lock);
+}
 
-    return 0;
+/* push back the cached connections to the managers when the thread exits,
+ * close the connections when the pool destroy */
+static void conn_pool_free_thread_cache(ConnectionPool *cp,
+	ConnectionThreadCache *cache, const bool push_back)
+{
+	ConnectionCacheEntry **bucket;
+	ConnectionCacheEntry **end;
+	ConnectionCacheEntry *entry;
+	ConnectionNode *node;
+
+	end = cache->buckets + CONN_POOL_CACHE_BUCKET_COUNT;
+	for (bucket=cache->buckets; bucket<end; bucket++)
+	{
+		while (*bucket != NULL)
+		{
+			entry = *bucket;
+			*bucket = entry->next;
+			if (push_back)
+			{
+				conn_pool_cache_flush_entry(entry, 0);
+				pthread_mutex_lock(&entry->manager->lock);
+				entry->manager->stats.checkout_count += entry->reuse_count;
+				entry->manager->stats.reuse_count += entry->reuse_count;
+				pthread_mutex_unlock(&entry->manager->lock);
+			}
+			else
+			{
+				while (entry->head != NULL)
+				{
+					node = entry->head;
+					entry->head = node->next;
+					conn_pool_disconnect_server(node->conn);
+					fast_mblock_free_object(&cp->node_allocator, node);
+				}
+			}
+			free(entry);
+		}
+	}
+	free(cache);
+}
+
+static void conn_pool_thread_cache_destructor(void *arg)
+{
+	ConnectionThreadCache *cache;
+	ConnectionThreadCache **pp;
+	ConnectionPool *cp;
+
+	cache = (ConnectionThreadCache *)arg;
+	cp = cache->cp;
+	pthread_mutex_lock(&cp->lock);
+	pp = &cp->thread_caches;
+	while (*pp != NULL && *pp != cache)
+	{
+		pp = &(*pp)->next;
+	}
+	if (*pp != NULL)
+	{
+		*pp = cache->next;
+	}
+	pthread_mutex_unlock(&cp->lock);
+
+	conn_pool_free_thread_cache(cp, cache, true);
+}
+
+int conn_pool_enable_thread_cache(ConnectionPool *cp, const int cache_size)
+{
+	int result;
+
+	if (cache_size <= 0)
+	{
+		return EINVAL;
+	}
+
+	if ((result=pthread_key_create(&cp->cache_key,
+		conn_pool_thread_cache_destructor)) != 0)
+	{
+		logError("file: "__FILE__", line: %d, " \
+			"pthread_key_create fail, errno: %d, " \
+			"error info: %s", __LINE__, result, STRERROR(result));
+		return result;
+	}
+	cp->thread_cache_size = cache_size;
+	return 0;
 }
 
 void conn_pool_destroy(ConnectionPool *cp)
 {
+	ConnectionManager **bucket;
+	ConnectionManager **end;
+	ConnectionManager *cm;
+	ConnectionThreadCache *cache;
+
 	pthread_mutex_lock(&cp->lock);
-    hash_walk(&(cp->hash_array), coon_pool_close_connections, NULL);
-	hash_destroy(&(cp->hash_array));
+	if (cp->thread_cache_size > 0)
+	{
+		pthread_key_delete(cp->cache_key);
+		while (cp->thread_caches != NULL)
+		{
+			cache = cp->thread_caches;
+			cp->thread_caches = cache->next;
+			conn_pool_free_thread_cache(cp, cache, false);
+		}
+		cp->thread_cache_size = 0;
+	}
+
+	if (cp->buckets != NULL)
+	{
+		end = cp->buckets + CONN_POOL_BUCKET_COUNT;
+		for (bucket=cp->buckets; bucket<end; bucket++)
+		{
+			while (*bucket != NULL)
+			{
+				cm = *bucket;
+				*bucket = cm->next;
+				conn_pool_close_connections(cp, cm);
+			}
+		}
+		free(cp->buckets);
+		cp->buckets = NULL;
+	}
+	fast_mblock_destroy(&cp->node_allocator);
 	pthread_mutex_unlock(&cp->lock);
 
 	pthread_mutex_destroy(&cp->lock);
@@ -138,55 +326,309 @@ int conn_pool_connect_server(ConnectionInfo *pConnection, \
 	return 0;
 }
 
-static inline void  conn_pool_get_key(const ConnectionInfo *conn, char *key, int *key_len)
+int conn_pool_make_key(const ConnectionInfo *conn, ConnectionPoolKey *key)
 {
-    *key_len = sprintf(key, "%s_%d", conn->ip_addr, conn->port);
+	memset(key, 0, sizeof(ConnectionPoolKey));
+	if (is_ipv6_addr(conn->ip_addr))
+	{
+		key->family = AF_INET6;
+	}
+	else
+	{
+		key->family = AF_INET;
+	}
+	if (inet_pton(key->family, conn->ip_addr, key->addr) != 1)
+	{
+		logError("file: "__FILE__", line: %d, " \
+			"invalid ip address: %s", __LINE__, conn->ip_addr);
+		return EINVAL;
+	}
+
+	key->port = conn->port;
+	key->hash_code = simple_hash(key, CONN_POOL_KEY_BYTES);
+	return 0;
 }
 
-ConnectionInfo *conn_pool_get_connection(ConnectionPool *cp, 
-	const ConnectionInfo *conn, int *err_no)
+static inline ConnectionManager **conn_pool_get_bucket(ConnectionPool *cp,
+	const ConnectionPoolKey *key)
 {
-	char key[INET6_ADDRSTRLEN + 8];
-	int key_len;
-	int bytes;
-	char *p;
+	return cp->buckets + (key->hash_code & (CONN_POOL_BUCKET_COUNT - 1));
+}
+
+static inline ConnectionManager *conn_pool_find_manager(
+	ConnectionManager *cm, const ConnectionPoolKey *key)
+{
+	while (cm != NULL)
+	{
+		if (cm->key.hash_code == key->hash_code &&
+			memcmp(&cm->key, key, CONN_POOL_KEY_BYTES) == 0)
+		{
+			return cm;
+		}
+		cm = cm->next;
+	}
+
+	return NULL;
+}
+
+static ConnectionManager *conn_pool_get_manager(ConnectionPool *cp,
+	const ConnectionPoolKey *key, int *err_no)
+{
+	ConnectionManager **bucket;
 	ConnectionManager *cm;
-	ConnectionNode *node;
-	ConnectionInfo *ci;
-	time_t current_time;
 
-	conn_pool_get_key(conn, key, &key_len);
+	bucket = conn_pool_get_bucket(cp, key);
+	if ((cm=conn_pool_find_manager(*bucket, key)) != NULL)
+	{
+		return cm;
+	}
 
 	pthread_mutex_lock(&cp->lock);
-	cm = (ConnectionManager *)hash_find(&cp->hash_array, key, key_len);
+	if ((cm=conn_pool_find_manager(*bucket, key)) != NULL)
+	{
+		pthread_mutex_unlock(&cp->lock);
+		return cm;
+	}
+
+	cm = (ConnectionManager *)malloc(sizeof(ConnectionManager));
 	if (cm == NULL)
 	{
-		cm = (ConnectionManager *)malloc(sizeof(ConnectionManager));
-		if (cm == NULL)
+		*err_no = errno != 0 ? errno : ENOMEM;
+		logError("file: "__FILE__", line: %d, " \
+			"malloc %d bytes fail, errno: %d, " \
+			"error info: %s", __LINE__, \
+			(int)sizeof(ConnectionManager), \
+			*err_no, STRERROR(*err_no));
+		pthread_mutex_unlock(&cp->lock);
+		return NULL;
+	}
+
+	cm->key = *key;
+	cm->head = NULL;
+	cm->total_count = 0;
+	cm->free_count = 0;
+	memset(&cm->stats, 0, sizeof(ConnectionStats));
+	if ((*err_no=init_pthread_lock(&cm->lock)) != 0)
+	{
+		free(cm);
+		pthread_mutex_unlock(&cp->lock);
+		return NULL;
+	}
+	cm->next = *bucket;
+
+	//publish the initialized manager to the lock free readers
+	__sync_synchronize();
+	*bucket = cm;
+	pthread_mutex_unlock(&cp->lock);
+	return cm;
+}
+
+static ConnectionCacheEntry *conn_pool_get_cache_entry(ConnectionPool *cp,
+	ConnectionManager *cm)
+{
+	ConnectionThreadCache *cache;
+	ConnectionCacheEntry **bucket;
+	ConnectionCacheEntry *entry;
+
+	cache = (ConnectionThreadCache *)pthread_getspecific(cp->cache_key);
+	if (cache == NULL)
+	{
+		cache = (ConnectionThreadCache *)malloc(
+				sizeof(ConnectionThreadCache));
+		if (cache == NULL)
 		{
-			*err_no = errno != 0 ? errno : ENOMEM;
-			logError("file: "__FILE__", line: %d, " \
-				"malloc %d bytes fail, errno: %d, " \
-				"error info: %s", __LINE__, \
-				(int)sizeof(ConnectionManager), \
-				*err_no, STRERROR(*err_no));
-			pthread_mutex_unlock(&cp->lock);
 			return NULL;
 		}
-
-		cm->head = NULL;
-		cm->total_count = 0;
-		cm->free_count = 0;
-		if ((*err_no=init_pthread_lock(&cm->lock)) != 0)
+		memset(cache, 0, sizeof(ConnectionThreadCache));
+		cache->cp = cp;
+		if (pthread_setspecific(cp->cache_key, cache) != 0)
 		{
-			pthread_mutex_unlock(&cp->lock);
+			free(cache);
 			return NULL;
 		}
-		hash_insert(&cp->hash_array, key, key_len, cm);
+
+		pthread_mutex_lock(&cp->lock);
+		cache->next = cp->thread_caches;
+		cp->thread_caches = cache;
+		pthread_mutex_unlock(&cp->lock);
+	}
+
+	bucket = cache->buckets + (cm->key.hash_code &
+			(CONN_POOL_CACHE_BUCKET_COUNT - 1));
+	for (entry=*bucket; entry!=NULL; entry=entry->next)
+	{
+		if (entry->manager == cm)
+		{
+			return entry;
+		}
+	}
+
+	entry = (ConnectionCacheEntry *)malloc(sizeof(ConnectionCacheEntry));
+	if (entry == NULL)
+	{
+		return NULL;
+	}
+	entry->manager = cm;
+	entry->head = NULL;
+	entry->free_count = 0;
+	entry->reuse_count = 0;
+	entry->next = *bucket;
+	*bucket = entry;
+	return entry;
+}
+
+/* get the connection from the thread cache, refill the cache from the
+ * manager in batch when empty. return NULL when no free connection */
+static ConnectionInfo *conn_pool_cache_get(ConnectionPool *cp,
+	ConnectionManager *cm, const time_t current_time)
+{
+	ConnectionCacheEntry *entry;
+	ConnectionNode *node;
+	ConnectionNode *last;
+	int count;
+
+	if ((entry=conn_pool_get_cache_entry(cp, cm)) == NULL)
+	{
+		return NULL;
+	}
+
+	if (entry->head == NULL)
+	{
+		pthread_mutex_lock(&cm->lock);
+		if (cm->head != NULL)
+		{
+			last = cm->head;
+			count = 1;
+			while (count < (cp->thread_cache_size + 1) / 2 &&
+				last->next != NULL)
+			{
+				last = last->next;
+				count++;
+			}
+			entry->head = cm->head;
+			cm->head = last->next;
+			last->next = NULL;
+			cm->free_count -= count;
+			entry->free_count = count;
+		}
+		pthread_mutex_unlock(&cm->lock);
+	}
+
+	while (entry->head != NULL)
+	{
+		node = entry->head;
+		entry->head = node->next;
+		entry->free_count--;
+		if (current_time - node->atime <= cp->max_idle_time)
+		{
+			entry->reuse_count++;
+			return node->conn;
+		}
+
+		pthread_mutex_lock(&cm->lock);
+		cm->total_count--;
+		cm->stats.idle_evict_count++;
+		pthread_mutex_unlock(&cm->lock);
+
+		logDebug("file: "__FILE__", line: %d, " \
+			"server %s:%d, cached connection: %d idle " \
+			"time: %d exceeds max idle time: %d", __LINE__, \
+			node->conn->ip_addr, node->conn->port, node->conn->sock, \
+			(int)(current_time - node->atime), cp->max_idle_time);
+		conn_pool_disconnect_server(node->conn);
+		fast_mblock_free_object(&cp->node_allocator, node);
+	}
+
+	return NULL;
+}
+
+/* push back the connection to the thread cache, flush the older half
+ * to the manager when the cache is full. return false when no cache */
+static bool conn_pool_cache_put(ConnectionPool *cp, ConnectionNode *node)
+{
+	ConnectionCacheEntry *entry;
+
+	if ((entry=conn_pool_get_cache_entry(cp, node->manager)) == NULL)
+	{
+		return false;
+	}
+
+	node->atime = get_current_time();
+	node->next = entry->head;
+	entry->head = node;
+	entry->free_count++;
+	if (entry->free_count > cp->thread_cache_size)
+	{
+		conn_pool_cache_flush_entry(entry, cp->thread_cache_size / 2);
+	}
+	return true;
+}
+
+static inline void conn_pool_add_connect_time(ConnectionStats *stats,
+	const int64_t time_used)
+{
+	int index;
+
+	for (index=0; index<CONN_POOL_LATENCY_BUCKET_COUNT - 1; index++)
+	{
+		if (time_used < conn_pool_latency_bounds[index])
+		{
+			break;
+		}
+	}
+	stats->connect_latency[index]++;
+	stats->connect_count++;
+	stats->connect_time_us += time_used;
+}
+
+static inline void conn_pool_add_checkout_wait(ConnectionStats *stats,
+	const int64_t time_used)
+{
+	stats->checkout_count++;
+	stats->checkout_wait_us += time_used;
+	if (time_used > stats->max_checkout_wait_us)
+	{
+		stats->max_checkout_wait_us = time_used;
+	}
+}
+
+ConnectionInfo *conn_pool_get_connection(ConnectionPool *cp, 
+	const ConnectionInfo *conn, int *err_no)
+{
+	ConnectionPoolKey key;
+
+	if ((*err_no=conn_pool_make_key(conn, &key)) != 0)
+	{
+		return NULL;
+	}
+	return conn_pool_get_connection_by_key(cp, conn, &key, err_no);
+}
+
+ConnectionInfo *conn_pool_get_connection_by_key(ConnectionPool *cp,
+	const ConnectionInfo *conn, const ConnectionPoolKey *key, int *err_no)
+{
+	ConnectionManager *cm;
+	ConnectionNode *node;
+	ConnectionInfo *ci;
+	time_t current_time;
+	int64_t start_time;
+	int64_t time_used;
+
+	if ((cm=conn_pool_get_manager(cp, key, err_no)) == NULL)
+	{
+		return NULL;
 	}
-	pthread_mutex_unlock(&cp->lock);
 
 	current_time = get_current_time();
+	if (cp->thread_cache_size > 0)
+	{
+		if ((ci=conn_pool_cache_get(cp, cm, current_time)) != NULL)
+		{
+			*err_no = 0;
+			return ci;
+		}
+	}
+
 	pthread_mutex_lock(&cm->lock);
 	while (1)
 	{
@@ -205,21 +647,18 @@ ConnectionInfo *conn_pool_get_connection(ConnectionPool *cp,
 				return NULL;
 			}
 
-			bytes = sizeof(ConnectionNode) + sizeof(ConnectionInfo);
-			p = (char *)malloc(bytes);
-			if (p == NULL)
+			node = (ConnectionNode *)fast_mblock_alloc_object(
+					&cp->node_allocator);
+			if (node == NULL)
 			{
-				*err_no = errno != 0 ? errno : ENOMEM;
+				*err_no = ENOMEM;
 				logError("file: "__FILE__", line: %d, " \
-					"malloc %d bytes fail, errno: %d, " \
-					"error info: %s", __LINE__, \
-					bytes, *err_no, STRERROR(*err_no));
+					"alloc connection node fail", __LINE__);
 				pthread_mutex_unlock(&cm->lock);
 				return NULL;
 			}
 
-			node = (ConnectionNode *)p;
-			node->conn = (ConnectionInfo *)(p + sizeof(ConnectionNode));
+			node->conn = (ConnectionInfo *)(node + 1);
 			node->manager = cm;
 			node->next = NULL;
 			node->atime = 0;
@@ -230,18 +669,27 @@ ConnectionInfo *conn_pool_get_connection(ConnectionPool *cp,
 			memcpy(node->conn, conn, sizeof(ConnectionInfo));
             node->conn->socket_domain = cp->socket_domain;
 			node->conn->sock = -1;
+			start_time = get_current_time_us();
 			*err_no = conn_pool_connect_server(node->conn, \
 					cp->connect_timeout);
+			time_used = get_current_time_us() - start_time;
 			if (*err_no != 0)
 			{
                 pthread_mutex_lock(&cm->lock);
                 cm->total_count--;  //rollback
+                cm->stats.connect_fail_count++;
+                conn_pool_add_checkout_wait(&cm->stats, time_used);
                 pthread_mutex_unlock(&cm->lock);
 
-				free(p);
+				fast_mblock_free_object(&cp->node_allocator, node);
 				return NULL;
 			}
 
+			pthread_mutex_lock(&cm->lock);
+			conn_pool_add_connect_time(&cm->stats, time_used);
+			conn_pool_add_checkout_wait(&cm->stats, time_used);
+			pthread_mutex_unlock(&cm->lock);
+
 			logDebug("file: "__FILE__", line: %d, " \
 				"server %s:%d, new connection: %d, " \
 				"total_count: %d, free_count: %d",   \
@@ -260,6 +708,7 @@ ConnectionInfo *conn_pool_get_connection(ConnectionPool *cp,
 			if (current_time - node->atime > cp->max_idle_time)
 			{
 				cm->total_count--;
+				cm->stats.idle_evict_count++;
 
 				logDebug("file: "__FILE__", line: %d, " \
 					"server %s:%d, connection: %d idle " \
@@ -272,11 +721,14 @@ ConnectionInfo *conn_pool_get_connection(ConnectionPool *cp,
 					cm->free_count);
 
 				conn_pool_disconnect_server(ci);
-				free(node);
+				fast_mblock_free_object(&cp->node_allocator, node);
 				continue;
 			}
 
+			cm->stats.checkout_count++;
+			cm->stats.reuse_count++;
 			pthread_mutex_unlock(&cm->lock);
+			*err_no = 0;
 			logDebug("file: "__FILE__", line: %d, " \
 				"server %s:%d, reuse connection: %d, " \
 				"total_count: %d, free_count: %d", 
@@ -290,26 +742,13 @@ ConnectionInfo *conn_pool_get_connection(ConnectionPool *cp,
 int conn_pool_close_connection_ex(ConnectionPool *cp, ConnectionInfo *conn, 
 	const bool bForce)
 {
-	char key[INET6_ADDRSTRLEN + 8];
-	int key_len;
 	ConnectionManager *cm;
 	ConnectionNode *node;
 
-	conn_pool_get_key(conn, key, &key_len);
-
-	pthread_mutex_lock(&cp->lock);
-	cm = (ConnectionManager *)hash_find(&cp->hash_array, key, key_len);
-	pthread_mutex_unlock(&cp->lock);
-	if (cm == NULL)
-	{
-		logError("file: "__FILE__", line: %d, " \
-			"hash entry of server %s:%d not exist", __LINE__, \
-			conn->ip_addr, conn->port);
-		return ENOENT;
-	}
-
+	//the node is before the connection, so NO lookup
 	node = (ConnectionNode *)(((char *)conn) - sizeof(ConnectionNode));
-	if (node->manager != cm)
+	cm = node->manager;
+	if (cm == NULL || node->conn != conn || cm->key.port != conn->port)
 	{
 		logError("file: "__FILE__", line: %d, " \
 			"manager of server entry %s:%d is invalid!", \
@@ -317,6 +756,14 @@ int conn_pool_close_connection_ex(ConnectionPool *cp, ConnectionInfo *conn,
 		return EINVAL;
 	}
 
+	if (!bForce && cp->thread_cache_size > 0)
+	{
+		if (conn_pool_cache_put(cp, node))
+		{
+			return 0;
+		}
+	}
+
 	pthread_mutex_lock(&cm->lock);
 	if (bForce)
 	{
@@ -329,7 +776,7 @@ int conn_pool_close_connection_ex(ConnectionPool *cp, ConnectionInfo *conn,
 			conn->sock, cm->total_count, cm->free_count);
 
 		conn_pool_disconnect_server(conn);
-		free(node);
+		fast_mblock_free_object(&cp->node_allocator, node);
 	}
 	else
 	{
@@ -349,29 +796,194 @@ int conn_pool_close_connection_ex(ConnectionPool *cp, ConnectionInfo *conn,
 	return 0;
 }
 
-static int _conn_count_walk(const int index, const HashData *data, void *args)
+int conn_pool_get_connection_count(ConnectionPool *cp)
 {
-	int *count;
+	ConnectionManager **bucket;
+	ConnectionManager **end;
 	ConnectionManager *cm;
-	ConnectionNode *node;
+	ConnectionThreadCache *cache;
+	ConnectionCacheEntry **cbucket;
+	ConnectionCacheEntry **cend;
+	ConnectionCacheEntry *entry;
+	int count;
 
-	count = (int *)args;
-	cm = (ConnectionManager *)data->value;
-	node = cm->head;
-	while (node != NULL)
+	count = 0;
+	end = cp->buckets + CONN_POOL_BUCKET_COUNT;
+	for (bucket=cp->buckets; bucket<end; bucket++)
 	{
-		(*count)++;
-		node = node->next;
+		for (cm=*bucket; cm!=NULL; cm=cm->next)
+		{
+			count += cm->free_count;
+		}
 	}
 
-	return 0;
+	//the free connections in the thread caches, NOT accurate
+	pthread_mutex_lock(&cp->lock);
+	for (cache=cp->thread_caches; cache!=NULL; cache=cache->next)
+	{
+		cend = cache->buckets + CONN_POOL_CACHE_BUCKET_COUNT;
+		for (cbucket=cache->buckets; cbucket<cend; cbucket++)
+		{
+			for (entry=*cbucket; entry!=NULL; entry=entry->next)
+			{
+				count += entry->free_count;
+			}
+		}
+	}
+	pthread_mutex_unlock(&cp->lock);
+	return count;
 }
 
-int conn_pool_get_connection_count(ConnectionPool *cp)
+static void conn_pool_stat_one(ConnectionPool *cp, ConnectionManager *cm,
+	ConnectionPoolStat *stat)
 {
+	ConnectionThreadCache *cache;
+	ConnectionCacheEntry *entry;
+
+	inet_ntop(cm->key.family, cm->key.addr, stat->ip_addr,
+		sizeof(stat->ip_addr));
+	stat->port = cm->key.port;
+
+	pthread_mutex_lock(&cm->lock);
+	stat->total_count = cm->total_count;
+	stat->free_count = cm->free_count;
+	stat->stats = cm->stats;
+	pthread_mutex_unlock(&cm->lock);
+
+	//the counters of the thread caches, read without lock
+	for (cache=cp->thread_caches; cache!=NULL; cache=cache->next)
+	{
+		entry = cache->buckets[cm->key.hash_code &
+			(CONN_POOL_CACHE_BUCKET_COUNT - 1)];
+		for (; entry!=NULL; entry=entry->next)
+		{
+			if (entry->manager == cm)
+			{
+				stat->free_count += entry->free_count;
+				stat->stats.checkout_count += entry->reuse_count;
+				stat->stats.reuse_count += entry->reuse_count;
+				break;
+			}
+		}
+	}
+}
+
+int conn_pool_stat(ConnectionPool *cp, ConnectionPoolStat *stats,
+	const int size, int *count)
+{
+	ConnectionManager **bucket;
+	ConnectionManager **end;
+	ConnectionManager *cm;
+	int result;
+
+	*count = 0;
+	result = 0;
+	pthread_mutex_lock(&cp->lock);
+	end = cp->buckets + CONN_POOL_BUCKET_COUNT;
+	for (bucket=cp->buckets; bucket<end && result == 0; bucket++)
+	{
+		for (cm=*bucket; cm!=NULL; cm=cm->next)
+		{
+			if (*count >= size)
+			{
+				result = EOVERFLOW;
+				break;
+			}
+			conn_pool_stat_one(cp, cm, stats + (*count)++);
+		}
+	}
+	pthread_mutex_unlock(&cp->lock);
+
+	return result;
+}
+
+//the upper bound of the bucket which the percentage of the connects reach
+static const char *conn_pool_latency_percentile(const ConnectionStats *stats,
+	const double percent)
+{
+	static const char *bound_labels[CONN_POOL_LATENCY_BUCKET_COUNT] = {
+		"<100us", "<500us", "<1ms", "<5ms", "<10ms", "<50ms",
+		"<100ms", "<1s", ">=1s"};
+	int64_t target;
+	int64_t sum;
+	int index;
+
+	if (stats->connect_count == 0)
+	{
+		return "-";
+	}
+
+	target = (int64_t)(stats->connect_count * percent / 100.00);
+	sum = 0;
+	for (index=0; index<CONN_POOL_LATENCY_BUCKET_COUNT - 1; index++)
+	{
+		sum += stats->connect_latency[index];
+		if (sum > target)
+		{
+			break;
+		}
+	}
+	return bound_labels[index];
+}
+
+int conn_pool_stat_print(ConnectionPool *cp)
+{
+	ConnectionPoolStat *stats;
+	ConnectionPoolStat *stat;
+	ConnectionPoolStat *stat_end;
+	char server[INET6_ADDRSTRLEN + 8];
+	int alloc_size;
 	int count;
+	int result;
+
+	stats = NULL;
 	count = 0;
-	hash_walk(&cp->hash_array, _conn_count_walk, &count);
-	return count;
+	alloc_size = 32;
+	result = EOVERFLOW;
+	while (result == EOVERFLOW)
+	{
+		alloc_size *= 2;
+		stat = (ConnectionPoolStat *)realloc(stats,
+			sizeof(ConnectionPoolStat) * alloc_size);
+		if (stat == NULL)
+		{
+			free(stats);
+			return ENOMEM;
+		}
+		stats = stat;
+		result = conn_pool_stat(cp, stats, alloc_size, &count);
+	}
+
+	logInfo("%24s %6s %6s %10s %8s %10s %8s %8s %12s %8s %10s %10s %10s",
+		"server", "total", "free", "connects", "fails", "avg_conn",
+		"p50", "p99", "checkouts", "reuse", "avg_wait", "max_wait",
+		"idle_evict");
+	stat_end = stats + count;
+	for (stat=stats; stat<stat_end; stat++)
+	{
+		sprintf(server, "%s:%d", stat->ip_addr, stat->port);
+		logInfo("%24s %6d %6d %10"PRId64" %8"PRId64" %8.3fms %8s %8s "
+			"%12"PRId64" %7.2f%% %8.3fms %8.3fms %10"PRId64, server,
+			stat->total_count, stat->free_count,
+			stat->stats.connect_count, stat->stats.connect_fail_count,
+			stat->stats.connect_count > 0 ? (double)stat->stats.
+			connect_time_us / stat->stats.connect_count / 1000 : 0.00,
+			conn_pool_latency_percentile(&stat->stats, 50.00),
+			conn_pool_latency_percentile(&stat->stats, 99.00),
+			stat->stats.checkout_count,
+			stat->stats.checkout_count > 0 ? 100.00 * (double)stat->
+			stats.reuse_count / stat->stats.checkout_count : 0.00,
+			stat->stats.checkout_count > 0 ? (double)stat->stats.
+			checkout_wait_us / stat->stats.checkout_count / 1000 : 0.00,
+			(double)stat->stats.max_checkout_wait_us / 1000,
+			stat->stats.idle_evict_count);
+	}
+
+	free(stats);
+	return 0;
 }
 
+int conn_pool_stat_print_func(void *args)
+{
+	return conn_pool_stat_print((ConnectionPool *)args);
+}
@@ -13,11 +13,24 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <string.h>
 #include <time.h>
 #include "common_define.h"
 #include "pthread_func.h"
 #include "hash.h"
+#include "fast_mblock.h"
+
+//the bucket count of the endpoint table, must be power of 2
+#define CONN_POOL_BUCKET_COUNT  1024
+
+//the bucket count of the thread cache, must be power of 2
+#define CONN_POOL_CACHE_BUCKET_COUNT  64
+
+/* the connect latency histogram, the upper bounds of the buckets are
+ * 100us, 500us, 1ms, 5ms, 10ms, 50ms, 100ms, 1s and the last is >= 1s */
+#define CONN_POOL_LATENCY_BUCKET_COUNT  9
 
 #ifdef __cplusplus
 extern "C" {
@@ -31,6 +44,41 @@ typedef struct
     int socket_domain;  //socket domain, AF_INET, AF_INET6 or PF_UNSPEC for auto dedect
 } ConnectionInfo;
 
+/* the binary key of the server endpoint, build by conn_pool_make_key
+ * once then the hash code is reused by the lookup */
+typedef struct
+{
+	unsigned char addr[16];  //the IPv4 address in the first 4 bytes
+	uint16_t port;
+	uint16_t family;
+	uint32_t hash_code;
+} ConnectionPoolKey;
+
+//the compared bytes of the key, exclude the hash code
+#define CONN_POOL_KEY_BYTES  offsetof(ConnectionPoolKey, hash_code)
+
+typedef struct
+{
+	int64_t connect_count;       //the successful connects
+	int64_t connect_fail_count;
+	int64_t connect_time_us;     //the total time of the successful connects
+	int64_t connect_latency[CONN_POOL_LATENCY_BUCKET_COUNT];
+	int64_t checkout_count;
+	int64_t reuse_count;         //the checkouts of the free connections
+	int64_t checkout_wait_us;    //the total wait time of the checkouts
+	int64_t max_checkout_wait_us;
+	int64_t idle_evict_count;    //closed for the max idle time
+} ConnectionStats;
+
+typedef struct
+{
+	char ip_addr[INET6_ADDRSTRLEN];
+	int port;
+	int total_count;
+	int free_count;
+	ConnectionStats stats;
+} ConnectionPoolStat;
+
 struct tagConnectionManager;
 
 typedef struct tagConnectionNode {
@@ -41,15 +89,36 @@ typedef struct tagConnectionNode {
 } ConnectionNode;
 
 typedef struct tagConnectionManager {
+	ConnectionPoolKey key;
 	ConnectionNode *head;
 	int total_count;  //total connections
 	int free_count;   //free connections
 	pthread_mutex_t lock;
+	ConnectionStats stats;  //protected by the lock
+	struct tagConnectionManager *next;  //for the bucket chain
 } ConnectionManager;
 
+//the free connections of one server in the thread cache
+typedef struct tagConnectionCacheEntry {
+	ConnectionManager *manager;
+	ConnectionNode *head;
+	int free_count;
+	int64_t reuse_count;  //the checkouts from the cache, NO lock
+	struct tagConnectionCacheEntry *next;  //for the bucket chain
+} ConnectionCacheEntry;
+
+typedef struct tagConnectionThreadCache {
+	struct tagConnectionPool *cp;
+	ConnectionCacheEntry *buckets[CONN_POOL_CACHE_BUCKET_COUNT];
+	struct tagConnectionThreadCache *next;  //the thread caches of the pool
+} ConnectionThreadCache;
+
 typedef struct tagConnectionPool {
-	HashArray hash_array;  //key is ip:port, value is ConnectionManager
-	pthread_mutex_t lock;
+	/* the endpoint table, the lookup is lock free because the managers
+	 * are only inserted at the bucket head and freed when destroy */
+	ConnectionManager **buckets;
+	pthread_mutex_t lock;  //for the manager insert
+	struct fast_mblock_man node_allocator;  //ConnectionNode + ConnectionInfo
 	int connect_timeout;
 	int max_count_per_entry;  //0 means no limit
 
@@ -59,6 +128,12 @@ typedef struct tagConnectionPool {
 	*/
 	int max_idle_time;
     int socket_domain;  //socket domain
+
+	/* the max free connections per server in the thread cache,
+	 * 0 for the thread cache disabled */
+	int thread_cache_size;
+	pthread_key_t cache_key;
+	ConnectionThreadCache *thread_caches;  //for destroy
 } ConnectionPool;
 
 /**
@@ -87,8 +162,25 @@ int conn_pool_init_ex(ConnectionPool *cp, int connect_timeout,
 int conn_pool_init(ConnectionPool *cp, int connect_timeout,
 	const int max_count_per_entry, const int max_idle_time);
 
+/**
+*   enable the per thread cache of the free connections, the checkout and
+*   the push back of the cached connections take no shared lock, the
+*   cache exchanges the connections with the pool in batch.
+*   max_count_per_entry is enforced for all the threads, the idle
+*   connections in the cache of a thread can NOT be used by the others
+*   until the thread exits, so cache_size should be much less than
+*   max_count_per_entry / thread count.
+*   should be called after init and before use
+*   parameters:
+*      cp: the ConnectionPool
+*      cache_size: the max free connections per server of each thread
+*   return 0 for success, != 0 for error
+*/
+int conn_pool_enable_thread_cache(ConnectionPool *cp, const int cache_size);
+
 /**
 *   destroy function
+*   NOTE: the threads should NOT use the pool when destroy
 *   parameters:
 *      cp: the ConnectionPool
 *   return none
@@ -106,6 +198,27 @@ void conn_pool_destroy(ConnectionPool *cp);
 ConnectionInfo *conn_pool_get_connection(ConnectionPool *cp, 
 	const ConnectionInfo *conn, int *err_no);
 
+/**
+*   build the binary key of the server
+*   parameters:
+*      conn: the connection, ip_addr and port are used
+*      key: store the key
+*   return 0 for success, EINVAL for invalid ip address
+*/
+int conn_pool_make_key(const ConnectionInfo *conn, ConnectionPoolKey *key);
+
+/**
+*   get connection from the pool by the key of conn_pool_make_key
+*   parameters:
+*      cp: the ConnectionPool
+*      conn: the connection
+*      key: the key of the connection
+*      err_no: return the the errno, 0 for success
+*   return != NULL for success, NULL for error
+*/
+ConnectionInfo *conn_pool_get_connection_by_key(ConnectionPool *cp,
+	const ConnectionInfo *conn, const ConnectionPoolKey *key, int *err_no);
+
 #define conn_pool_close_connection(cp, conn) \
 	conn_pool_close_connection_ex(cp, conn, false)
 
@@ -147,6 +260,34 @@ int conn_pool_connect_server(ConnectionInfo *pConnection, \
 */
 int conn_pool_get_connection_count(ConnectionPool *cp);
 
+/**
+*   get the stats of the servers
+*   parameters:
+*      cp: the ConnectionPool
+*      stats: store the stats
+*      size: the max count of the stats
+*      count: store the count of the servers
+*   return 0 for success, EOVERFLOW for the stats array is too small
+*/
+int conn_pool_stat(ConnectionPool *cp, ConnectionPoolStat *stats,
+	const int size, int *count);
+
+/**
+*   print the stats of the servers by the logger
+*   parameters:
+*      cp: the ConnectionPool
+*   return 0 for success, != 0 for error
+*/
+int conn_pool_stat_print(ConnectionPool *cp);
+
+/**
+*   the task func of the ScheduleEntry to print the stats periodically
+*   parameters:
+*      args: the ConnectionPool
+*   return 0 for success, != 0 for error
+*/
+int conn_pool_stat_print_func(void *args);
+
 #ifdef __cplusplus
 }
 #endif
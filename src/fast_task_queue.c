@@ -8,6 +8,7 @@
 #include "logger.h"
 #include "shared_func.h"
 #include "pthread_func.h"
+#include "sockopt.h"
 
 static struct fast_task_queue g_free_queue;
 
@@ -485,6 +486,8 @@ int free_queue_push(struct fast_task_info *pTask)
 	*(pTask->client_ip) = '\0';
 	pTask->length = 0;
 	pTask->offset = 0;
+	pTask->iovs = NULL;
+	pTask->iov_count = 0;
 	pTask->req_count = 0;
 
 	if (pTask->size > g_free_queue.min_buff_size) //need thrink
@@ -719,3 +722,32 @@ int task_queue_realloc_buffer(struct fast_task_queue *pQueue,
     return _realloc_buffer(pTask, new_size, true);
 }
 
+
+int task_send_iovs(struct fast_task_info *pTask)
+{
+    ssize_t bytes;
+
+    tcpadvanceiov(&pTask->iovs, &pTask->iov_count, 0);
+    while (pTask->iov_count > 0)
+    {
+        bytes = writev(pTask->event.fd, pTask->iovs,
+                pTask->iov_count < IOV_MAX ? pTask->iov_count : IOV_MAX);
+        if (bytes < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                return EAGAIN;
+            }
+            return errno != 0 ? errno : EIO;
+        }
+
+        tcpadvanceiov(&pTask->iovs, &pTask->iov_count, bytes);
+    }
+
+    pTask->iovs = NULL;
+    return 0;
+}
@@ -15,6 +15,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <pthread.h>
+#include <sys/uio.h>
 #include "common_define.h"
 #include "ioevent.h"
 #include "fast_timer.h"
@@ -54,6 +55,8 @@ struct fast_task_info
 	int size;   //alloc size
 	int length; //data length
 	int offset; //current offset
+	struct iovec *iovs;  //the io vectors to send by task_send_iovs
+	int iov_count;       //the unsent io vector count
 	int64_t req_count; //request count
 	TaskFinishCallback finish_callback;
 	struct nio_thread_data *thread_data;
@@ -109,6 +112,24 @@ int task_queue_realloc_buffer(struct fast_task_queue *pQueue,
 int task_queue_get_new_buffer_size(const int min_buff_size,
         const int max_buff_size, const int expect_size, int *new_size);
 
+/** set the io vectors to send by task_send_iovs, such as the header in
+ *  the task buffer, the body and the trailer, the array must be valid
+ *  until sent and will be modified
+*/
+static inline void task_set_iovs(struct fast_task_info *pTask,
+        struct iovec *iovs, const int iov_count)
+{
+    pTask->iovs = iovs;
+    pTask->iov_count = iov_count;
+}
+
+/** send the io vectors of the task by one writev for the ioevent write
+ *  callback, the sent bytes are skipped for the next call
+ *  return: 0 for all sent, EAGAIN for the remain (wait the next write
+ *          event), other error no for fail
+*/
+int task_send_iovs(struct fast_task_info *pTask);
+
 #ifdef __cplusplus
 }
 #endif
@@ -232,8 +232,12 @@ int flat_skiplist_delete(FlatSkiplist *sl, void *data)
             previous = previous->links[i];
         }
 
-        assert(sl->compare_func(data, previous->links[i]->data) == 0);
-        previous->links[i] = previous->links[i]->links[i];
+        //skip the other nodes with the same data, unlink the deleted one
+        while (previous->links[i] != deleted) {
+            assert(sl->compare_func(data, previous->links[i]->data) == 0);
+            previous = previous->links[i];
+        }
+        previous->links[i] = deleted->links[i];
     }
 
     deleted->links[0]->prev = previous;
@@ -287,3 +291,184 @@ int flat_skiplist_find_all(FlatSkiplist *sl, void *data, FlatSkiplistIterator *i
     return 0;
 }
 
+
+//return the last node whose data >= the data in the link order, maybe the top
+static FlatSkiplistNode *flat_skiplist_get_last_ge(FlatSkiplist *sl, void *data)
+{
+    int i;
+    FlatSkiplistNode *previous;
+
+    previous = sl->top;
+    for (i=sl->top_level_index; i>=0; i--) {
+        while (previous->links[i] != sl->tail && sl->compare_func(data,
+                    previous->links[i]->data) <= 0)
+        {
+            previous = previous->links[i];
+        }
+    }
+
+    return previous;
+}
+
+void *flat_skiplist_find_ge(FlatSkiplist *sl, void *data)
+{
+    FlatSkiplistNode *node;
+
+    node = flat_skiplist_get_last_ge(sl, data);
+    return (node != sl->top) ? node->data : NULL;
+}
+
+void *flat_skiplist_find_le(FlatSkiplist *sl, void *data)
+{
+    int i;
+    FlatSkiplistNode *previous;
+
+    previous = sl->top;
+    for (i=sl->top_level_index; i>=0; i--) {
+        while (previous->links[i] != sl->tail && sl->compare_func(data,
+                    previous->links[i]->data) < 0)
+        {
+            previous = previous->links[i];
+        }
+    }
+
+    return (previous->links[0] != sl->tail) ? previous->links[0]->data : NULL;
+}
+
+int flat_skiplist_find_range(FlatSkiplist *sl, void *start, void *end,
+        FlatSkiplistIterator *iterator)
+{
+    if (sl->compare_func(start, end) >= 0) {
+        iterator->top = sl->top;
+        iterator->current = sl->top;
+        return ENOENT;
+    }
+
+    iterator->current = flat_skiplist_get_last_ge(sl, start);
+    iterator->top = flat_skiplist_get_last_ge(sl, end);
+    return (iterator->current != iterator->top) ? 0 : ENOENT;
+}
+
+int flat_skiplist_delete_range(FlatSkiplist *sl, void *start, void *end,
+        int *delete_count)
+{
+    int i;
+    FlatSkiplistNode *firsts[SKIPLIST_MAX_LEVEL_COUNT];
+    FlatSkiplistNode *lasts[SKIPLIST_MAX_LEVEL_COUNT];
+    FlatSkiplistNode *previous;
+    FlatSkiplistNode *current;
+    FlatSkiplistNode *deleted;
+    FlatSkiplistNode *upper;
+
+    *delete_count = 0;
+    if (sl->compare_func(start, end) >= 0) {
+        return ENOENT;
+    }
+
+    //the range of every level is (firsts[i], lasts[i]) in the link order
+    previous = sl->top;
+    for (i=sl->top_level_index; i>=0; i--) {
+        while (previous->links[i] != sl->tail && sl->compare_func(end,
+                    previous->links[i]->data) <= 0)
+        {
+            previous = previous->links[i];
+        }
+
+        current = previous->links[i];
+        firsts[i] = current;
+        while (current != sl->tail && sl->compare_func(start,
+                    current->data) <= 0)
+        {
+            current = current->links[i];
+        }
+        lasts[i] = current;
+        previous->links[i] = current;
+    }
+
+    if (firsts[0] == lasts[0]) {
+        return ENOENT;
+    }
+    lasts[0]->prev = previous;
+
+    /* free the node by the level from bottom to top, a node belongs to
+       level i when it is not in the level i + 1 */
+    for (i=0; i<=sl->top_level_index; i++) {
+        upper = (i < sl->top_level_index) ? firsts[i + 1] : NULL;
+        current = firsts[i];
+        while (current != lasts[i]) {
+            deleted = current;
+            current = current->links[i];
+
+            if (i == 0) {
+                (*delete_count)++;
+                if (sl->free_func != NULL) {
+                    sl->free_func(deleted->data);
+                }
+            }
+
+            if (deleted == upper) {
+                upper = upper->links[i + 1];
+            }
+            else {
+                fast_mblock_free_object(sl->mblocks + i, deleted);
+            }
+        }
+    }
+
+    return 0;
+}
+
+int flat_skiplist_bulk_load(FlatSkiplist *sl, void **data_array,
+        const int count)
+{
+    int i;
+    int k;
+    int level_index;
+    int result;
+    FlatSkiplistNode *lasts[SKIPLIST_MAX_LEVEL_COUNT];
+    FlatSkiplistNode *node;
+
+    if (sl->top->links[0] != sl->tail) {
+        logError("file: "__FILE__", line: %d, "
+                "the skiplist is not empty", __LINE__);
+        return EEXIST;
+    }
+
+    for (i=1; i<count; i++) {
+        if (sl->compare_func(data_array[i - 1], data_array[i]) > 0) {
+            logError("file: "__FILE__", line: %d, "
+                    "the data array is not sorted, index: %d",
+                    __LINE__, i);
+            return EINVAL;
+        }
+    }
+
+    for (k=0; k<=sl->top_level_index; k++) {
+        lasts[k] = sl->top;
+    }
+
+    //the links are in descending order, append from the last data
+    result = 0;
+    for (i=count-1; i>=0; i--) {
+        level_index = flat_skiplist_get_level_index(sl);
+        node = (FlatSkiplistNode *)fast_mblock_alloc_object(
+                sl->mblocks + level_index);
+        if (node == NULL) {
+            result = ENOMEM;
+            break;
+        }
+
+        node->data = data_array[i];
+        node->prev = lasts[0];
+        for (k=0; k<=level_index; k++) {
+            lasts[k]->links[k] = node;
+            lasts[k] = node;
+        }
+    }
+
+    for (k=0; k<=sl->top_level_index; k++) {
+        lasts[k]->links[k] = sl->tail;
+    }
+    sl->tail->prev = lasts[0];
+    return result;
+}
@@ -60,6 +60,31 @@ int flat_skiplist_delete_all(FlatSkiplist *sl, void *data, int *delete_count);
 void *flat_skiplist_find(FlatSkiplist *sl, void *data);
 int flat_skiplist_find_all(FlatSkiplist *sl, void *data, FlatSkiplistIterator *iterator);
 
+/**
+ * build the skiplist from the sorted data in O(n) without searching
+ * parameters:
+ *         sl: the skiplist, must be empty
+ *         data_array: the data array in ascending order
+ *         count: the count of the data array
+ * return 0 for success, != 0 fail (errno)
+*/
+int flat_skiplist_bulk_load(FlatSkiplist *sl, void **data_array,
+        const int count);
+
+//return the first data >= the data, NULL for not found
+void *flat_skiplist_find_ge(FlatSkiplist *sl, void *data);
+
+//return the last data <= the data, NULL for not found
+void *flat_skiplist_find_le(FlatSkiplist *sl, void *data);
+
+//iterate the data in [start, end), return ENOENT for empty
+int flat_skiplist_find_range(FlatSkiplist *sl, void *start, void *end,
+        FlatSkiplistIterator *iterator);
+
+//delete the data in [start, end), return ENOENT when nothing deleted
+int flat_skiplist_delete_range(FlatSkiplist *sl, void *start, void *end,
+        int *delete_count);
+
 static inline void flat_skiplist_iterator(FlatSkiplist *sl, FlatSkiplistIterator *iterator)
 {
     iterator->top = sl->top;
@@ -79,6 +104,27 @@ static inline void *flat_skiplist_next(FlatSkiplistIterator *iterator)
     return data;
 }
 
+//iterate from the last data to the first by flat_skiplist_prev
+static inline void flat_skiplist_reverse_iterator(FlatSkiplist *sl,
+        FlatSkiplistIterator *iterator)
+{
+    iterator->top = sl->tail;
+    iterator->current = sl->top->links[0];
+}
+
+static inline void *flat_skiplist_prev(FlatSkiplistIterator *iterator)
+{
+    void *data;
+
+    if (iterator->current == iterator->top) {
+        return NULL;
+    }
+
+    data = iterator->current->data;
+    iterator->current = iterator->current->links[0];
+    return data;
+}
+
 #ifdef __cplusplus
 }
 #endif
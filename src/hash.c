@@ -49,6 +49,14 @@ static unsigned int prime_array[] = {
 
 #define PRIME_ARRAY_SIZE  30
 
+#define HASH_FIND_BATCH_SIZE  16
+
+#if defined(__GNUC__)
+#define HASH_PREFETCH(addr)  __builtin_prefetch(addr)
+#else
+#define HASH_PREFETCH(addr)
+#endif
+
 static int _hash_alloc_buckets(HashArray *pHash, const unsigned int old_capacity)
 {
 	size_t bytes;
@@ -575,6 +583,73 @@ void *hash_find(HashArray *pHash, const void *key, const int key_len)
 	}
 }
 
+static int _hash_find_batch(HashArray *pHash, const void **keys,
+		const int *key_lens, const int count, void **values)
+{
+	unsigned int hash_codes[HASH_FIND_BATCH_SIZE];
+	HashData **ppBuckets[HASH_FIND_BATCH_SIZE];
+	HashData *hash_data;
+	int found;
+	int i;
+
+	for (i=0; i<count; i++)
+	{
+		hash_codes[i] = pHash->hash_func(keys[i], key_lens[i]);
+		ppBuckets[i] = pHash->buckets + (hash_codes[i] %
+				(*pHash->capacity));
+		HASH_PREFETCH(ppBuckets[i]);
+	}
+
+	/* the chain head read without lock is used as a prefetch hint only,
+	   it is read again under lock when compare */
+	for (i=0; i<count; i++)
+	{
+		HASH_PREFETCH(*ppBuckets[i]);
+	}
+
+	found = 0;
+	for (i=0; i<count; i++)
+	{
+		HASH_LOCK(pHash, ppBuckets[i] - pHash->buckets)
+		hash_data = _chain_find_entry(ppBuckets[i], keys[i],
+				key_lens[i], hash_codes[i]);
+		if (hash_data != NULL)
+		{
+			values[i] = hash_data->value;
+			found++;
+		}
+		else
+		{
+			values[i] = NULL;
+		}
+		HASH_UNLOCK(pHash, ppBuckets[i] - pHash->buckets)
+	}
+
+	return found;
+}
+
+int hash_find_batch(HashArray *pHash, const void **keys, const int *key_lens,
+		const int count, void **values)
+{
+	int found;
+	int start;
+	int n;
+
+	found = 0;
+	for (start=0; start<count; start+=HASH_FIND_BATCH_SIZE)
+	{
+		n = count - start;
+		if (n > HASH_FIND_BATCH_SIZE)
+		{
+			n = HASH_FIND_BATCH_SIZE;
+		}
+		found += _hash_find_batch(pHash, keys + start, key_lens + start,
+				n, values + start);
+	}
+
+	return found;
+}
+
 int hash_get(HashArray *pHash, const void *key, const int key_len,
 	void *value, int *value_len)
 {
@@ -199,6 +199,20 @@ void *hash_find(HashArray *pHash, const void *key, const int key_len);
 HashData *hash_find_ex(HashArray *pHash, const void *key, const int key_len);
 
 
+/**
+ * hash find keys in batch, all keys are hashed first, then the buckets and
+ * the chain heads are prefetched before compare to hide the memory latency
+ * parameters:
+ *         pHash: the hash table
+ *         keys: the keys to find
+ *         key_lens: the lengths of the keys
+ *         count: the key count
+ *         values: return the user data, NULL when the key not exist
+ * return the found key count
+*/
+int hash_find_batch(HashArray *pHash, const void **keys, const int *key_lens,
+		const int count, void **values);
+
 /**
  * hash get the value of the key
  * parameters:
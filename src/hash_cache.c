@@ -0,0 +1,452 @@
+/**
+* Copyright (C) 2008 Happy Fish / YuQing
+*
+* FastDFS may be copied only under the terms of the GNU General
+* Public License V3, which may be found in the FastDFS source kit.
+* Please visit the FastDFS Home Page http://www.csource.org/ for more detail.
+**/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include "logger.h"
+#include "pthread_func.h"
+#include "sched_thread.h"
+#include "hash_cache.h"
+
+/* the value stored in the HashArray is the entry pointer followed by the
+   user value, the entry pointer is accessed by memcpy because the value
+   address is not aligned */
+#define ENTRY_PTR_SIZE  ((int)sizeof(HashCacheEntry *))
+
+#define HASH_CACHE_STACK_BUFF_SIZE  1024
+
+#define HASH_CACHE_GET_SHARD(cache, key, key_len) \
+	((cache)->shards + ((unsigned int)(cache)->hash_func(key, key_len) % \
+		(cache)->shard_count))
+
+#define CALC_CACHE_ENTRY_BYTES(key_len, value_len) \
+	(CALC_NODE_MALLOC_BYTES(key_len, MEM_ALIGN(ENTRY_PTR_SIZE + value_len)) \
+	 + sizeof(HashCacheEntry))
+
+static inline HashCacheEntry *hash_cache_get_entry(const HashData *hash_data)
+{
+	HashCacheEntry *entry;
+	memcpy(&entry, hash_data->value, ENTRY_PTR_SIZE);
+	return entry;
+}
+
+static inline void hash_cache_link_head(HashCacheShard *shard,
+		HashCacheEntry *entry)
+{
+	entry->prev = NULL;
+	entry->next = shard->head;
+	if (shard->head != NULL)
+	{
+		shard->head->prev = entry;
+	}
+	else
+	{
+		shard->tail = entry;
+	}
+	shard->head = entry;
+}
+
+static inline void hash_cache_unlink(HashCacheShard *shard,
+		HashCacheEntry *entry)
+{
+	if (shard->hand == entry)
+	{
+		shard->hand = entry->prev;
+	}
+
+	if (entry->prev != NULL)
+	{
+		entry->prev->next = entry->next;
+	}
+	else
+	{
+		shard->head = entry->next;
+	}
+
+	if (entry->next != NULL)
+	{
+		entry->next->prev = entry->prev;
+	}
+	else
+	{
+		shard->tail = entry->prev;
+	}
+}
+
+static void hash_cache_remove_entry(HashCacheShard *shard,
+		HashCacheEntry *entry)
+{
+	HashData *hash_data;
+
+	hash_cache_unlink(shard, entry);
+	hash_data = entry->hash_data;
+	hash_delete(&shard->hash_array, hash_data->key, hash_data->key_len);
+	shard->hash_array.bytes_used -= sizeof(HashCacheEntry);
+	fast_mblock_free_object(&shard->entry_allocator, entry);
+}
+
+static HashCacheEntry *hash_cache_clock_victim(HashCacheShard *shard)
+{
+	HashCacheEntry *entry;
+
+	while (1)
+	{
+		if (shard->hand == NULL)
+		{
+			if ((shard->hand=shard->tail) == NULL)
+			{
+				return NULL;
+			}
+		}
+
+		entry = shard->hand;
+		shard->hand = entry->prev;
+		if (!entry->referenced)
+		{
+			return entry;
+		}
+		entry->referenced = false;  //give the second chance
+	}
+}
+
+static int hash_cache_evict(HashCache *cache, HashCacheShard *shard)
+{
+	HashCacheEntry *entry;
+
+	if (cache->policy == HASH_CACHE_POLICY_CLOCK)
+	{
+		entry = hash_cache_clock_victim(shard);
+	}
+	else
+	{
+		entry = shard->tail;
+	}
+
+	if (entry == NULL)
+	{
+		return ENOENT;
+	}
+
+	hash_cache_remove_entry(shard, entry);
+	shard->evictions++;
+	return 0;
+}
+
+static int hash_cache_init_shard(HashCacheShard *shard, HashFunc hash_func,
+		const unsigned int capacity, const int64_t max_bytes)
+{
+	int result;
+
+	if ((result=hash_init_ex(&shard->hash_array, hash_func,
+			capacity, 0.75, max_bytes, true)) != 0)
+	{
+		return result;
+	}
+	if ((result=fast_mblock_init_ex(&shard->entry_allocator,
+			sizeof(HashCacheEntry), 0, NULL, false)) != 0)
+	{
+		hash_destroy(&shard->hash_array);
+		return result;
+	}
+	if ((result=init_pthread_lock(&shard->lock)) != 0)
+	{
+		fast_mblock_destroy(&shard->entry_allocator);
+		hash_destroy(&shard->hash_array);
+		return result;
+	}
+
+	return 0;
+}
+
+static void hash_cache_destroy_shards(HashCacheShard *start,
+		HashCacheShard *end)
+{
+	HashCacheShard *shard;
+
+	for (shard=start; shard<end; shard++)
+	{
+		hash_destroy(&shard->hash_array);
+		fast_mblock_destroy(&shard->entry_allocator);
+		pthread_mutex_destroy(&shard->lock);
+	}
+}
+
+int hash_cache_init_ex(HashCache *cache, HashFunc hash_func,
+		const unsigned int capacity, const int64_t max_bytes,
+		const int shard_count, const int policy)
+{
+	int result;
+	int bytes;
+	int64_t shard_max_bytes;
+	unsigned int shard_capacity;
+	HashCacheShard *shard;
+	HashCacheShard *shard_end;
+
+	memset(cache, 0, sizeof(HashCache));
+	if (shard_count <= 0 || max_bytes <= 0)
+	{
+		logError("file: "__FILE__", line: %d, "
+			"invalid shard count: %d or max bytes: %"PRId64,
+			__LINE__, shard_count, max_bytes);
+		return EINVAL;
+	}
+	if (policy != HASH_CACHE_POLICY_LRU &&
+		policy != HASH_CACHE_POLICY_CLOCK)
+	{
+		logError("file: "__FILE__", line: %d, "
+			"invalid cache policy: %d", __LINE__, policy);
+		return EINVAL;
+	}
+
+	bytes = sizeof(HashCacheShard) * shard_count;
+	cache->shards = (HashCacheShard *)malloc(bytes);
+	if (cache->shards == NULL)
+	{
+		logError("file: "__FILE__", line: %d, "
+			"malloc %d bytes fail, errno: %d, error info: %s",
+			__LINE__, bytes, errno, STRERROR(errno));
+		return errno != 0 ? errno : ENOMEM;
+	}
+	memset(cache->shards, 0, bytes);
+
+	cache->policy = policy;
+	cache->shard_count = shard_count;
+	cache->hash_func = hash_func;
+	shard_capacity = capacity / shard_count;
+	shard_max_bytes = max_bytes / shard_count;
+	shard_end = cache->shards + shard_count;
+	for (shard=cache->shards; shard<shard_end; shard++)
+	{
+		if ((result=hash_cache_init_shard(shard, hash_func,
+				shard_capacity, shard_max_bytes)) != 0)
+		{
+			//destroy the shards already inited
+			hash_cache_destroy_shards(cache->shards, shard);
+			free(cache->shards);
+			cache->shards = NULL;
+			return result;
+		}
+	}
+
+	return 0;
+}
+
+void hash_cache_destroy(HashCache *cache)
+{
+	if (cache->shards == NULL)
+	{
+		return;
+	}
+
+	hash_cache_destroy_shards(cache->shards,
+			cache->shards + cache->shard_count);
+	free(cache->shards);
+	cache->shards = NULL;
+}
+
+static int hash_cache_do_set(HashCache *cache, HashCacheShard *shard,
+		const void *key, const int key_len, char *buff, const int buff_len,
+		const int ttl)
+{
+	HashData *hash_data;
+	HashCacheEntry *entry;
+	int64_t need_bytes;
+	int result;
+
+	hash_data = hash_find_ex(&shard->hash_array, key, key_len);
+	if (hash_data != NULL)
+	{
+		hash_cache_remove_entry(shard, hash_cache_get_entry(hash_data));
+	}
+
+	need_bytes = CALC_CACHE_ENTRY_BYTES(key_len, buff_len - ENTRY_PTR_SIZE);
+	if (need_bytes > shard->hash_array.max_bytes)
+	{
+		return ENOSPC;
+	}
+	while (shard->hash_array.bytes_used + need_bytes >
+			shard->hash_array.max_bytes)
+	{
+		if (hash_cache_evict(cache, shard) != 0)
+		{
+			return ENOSPC;
+		}
+	}
+
+	entry = (HashCacheEntry *)fast_mblock_alloc_object(
+			&shard->entry_allocator);
+	if (entry == NULL)
+	{
+		return ENOMEM;
+	}
+	memcpy(buff, &entry, ENTRY_PTR_SIZE);
+
+	while ((result=hash_insert_ex(&shard->hash_array, key, key_len,
+				buff, buff_len, false)) == -ENOSPC)
+	{
+		if (hash_cache_evict(cache, shard) != 0)
+		{
+			break;
+		}
+	}
+	if (result < 0)
+	{
+		fast_mblock_free_object(&shard->entry_allocator, entry);
+		return -1 * result;
+	}
+
+	entry->hash_data = hash_find_ex(&shard->hash_array, key, key_len);
+	entry->expires = ttl > 0 ? get_current_time() + ttl : 0;
+	entry->referenced = false;
+	hash_cache_link_head(shard, entry);
+	shard->hash_array.bytes_used += sizeof(HashCacheEntry);
+	return 0;
+}
+
+int hash_cache_set(HashCache *cache, const void *key, const int key_len,
+		const void *value, const int value_len, const int ttl)
+{
+	HashCacheShard *shard;
+	char stack_buff[HASH_CACHE_STACK_BUFF_SIZE];
+	char *buff;
+	int buff_len;
+	int result;
+
+	buff_len = ENTRY_PTR_SIZE + value_len;
+	if (buff_len <= HASH_CACHE_STACK_BUFF_SIZE)
+	{
+		buff = stack_buff;
+	}
+	else
+	{
+		buff = (char *)malloc(buff_len);
+		if (buff == NULL)
+		{
+			logError("file: "__FILE__", line: %d, "
+				"malloc %d bytes fail, errno: %d, error info: %s",
+				__LINE__, buff_len, errno, STRERROR(errno));
+			return errno != 0 ? errno : ENOMEM;
+		}
+	}
+	memcpy(buff + ENTRY_PTR_SIZE, value, value_len);
+
+	shard = HASH_CACHE_GET_SHARD(cache, key, key_len);
+	pthread_mutex_lock(&shard->lock);
+	result = hash_cache_do_set(cache, shard, key, key_len,
+			buff, buff_len, ttl);
+	pthread_mutex_unlock(&shard->lock);
+
+	if (buff != stack_buff)
+	{
+		free(buff);
+	}
+	return result;
+}
+
+int hash_cache_get(HashCache *cache, const void *key, const int key_len,
+		void *value, int *value_len)
+{
+	HashCacheShard *shard;
+	HashData *hash_data;
+	HashCacheEntry *entry;
+	int result;
+	int len;
+
+	shard = HASH_CACHE_GET_SHARD(cache, key, key_len);
+	pthread_mutex_lock(&shard->lock);
+	do
+	{
+		hash_data = hash_find_ex(&shard->hash_array, key, key_len);
+		if (hash_data == NULL)
+		{
+			shard->misses++;
+			result = ENOENT;
+			break;
+		}
+
+		entry = hash_cache_get_entry(hash_data);
+		if (entry->expires > 0 && entry->expires < get_current_time())
+		{
+			hash_cache_remove_entry(shard, entry);
+			shard->expirations++;
+			shard->misses++;
+			result = ENOENT;
+			break;
+		}
+
+		shard->hits++;
+		if (cache->policy == HASH_CACHE_POLICY_CLOCK)
+		{
+			entry->referenced = true;
+		}
+		else if (entry != shard->head)
+		{
+			hash_cache_unlink(shard, entry);
+			hash_cache_link_head(shard, entry);
+		}
+
+		len = hash_data->value_len - ENTRY_PTR_SIZE;
+		if (len > *value_len)
+		{
+			result = ENOSPC;
+			break;
+		}
+
+		*value_len = len;
+		memcpy(value, hash_data->value + ENTRY_PTR_SIZE, len);
+		result = 0;
+	} while (0);
+	pthread_mutex_unlock(&shard->lock);
+
+	return result;
+}
+
+int hash_cache_delete(HashCache *cache, const void *key, const int key_len)
+{
+	HashCacheShard *shard;
+	HashData *hash_data;
+	int result;
+
+	shard = HASH_CACHE_GET_SHARD(cache, key, key_len);
+	pthread_mutex_lock(&shard->lock);
+	hash_data = hash_find_ex(&shard->hash_array, key, key_len);
+	if (hash_data != NULL)
+	{
+		hash_cache_remove_entry(shard, hash_cache_get_entry(hash_data));
+		result = 0;
+	}
+	else
+	{
+		result = ENOENT;
+	}
+	pthread_mutex_unlock(&shard->lock);
+
+	return result;
+}
+
+void hash_cache_stat(HashCache *cache, HashCacheStat *stat)
+{
+	HashCacheShard *shard;
+	HashCacheShard *shard_end;
+
+	memset(stat, 0, sizeof(HashCacheStat));
+	shard_end = cache->shards + cache->shard_count;
+	for (shard=cache->shards; shard<shard_end; shard++)
+	{
+		pthread_mutex_lock(&shard->lock);
+		stat->item_count += shard->hash_array.item_count;
+		stat->bytes_used += shard->hash_array.bytes_used;
+		stat->hits += shard->hits;
+		stat->misses += shard->misses;
+		stat->evictions += shard->evictions;
+		stat->expirations += shard->expirations;
+		pthread_mutex_unlock(&shard->lock);
+	}
+}
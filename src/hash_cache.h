@@ -0,0 +1,150 @@
+/**
+* Copyright (C) 2008 Happy Fish / YuQing
+*
+* FastDFS may be copied only under the terms of the GNU General
+* Public License V3, which may be found in the FastDFS source kit.
+* Please visit the FastDFS Home Page http://www.csource.org/ for more detail.
+**/
+
+/**
+  memory bounded cache based on HashArray, evict the entries by LRU or CLOCK
+  when the max bytes of the HashArray reached. the cache can be divided
+  into shards for concurrency, each shard has its own lock and HashArray.
+*/
+
+#ifndef _HASH_CACHE_H_
+#define _HASH_CACHE_H_
+
+#include <time.h>
+#include <pthread.h>
+#include "common_define.h"
+#include "fast_mblock.h"
+#include "hash.h"
+
+#define HASH_CACHE_POLICY_LRU    0  //least recently used
+#define HASH_CACHE_POLICY_CLOCK  1  //second chance, get without list moving
+
+typedef struct tagHashCacheEntry
+{
+	HashData *hash_data;
+	time_t expires;  //0 for never expired
+	bool referenced; //for CLOCK
+	struct tagHashCacheEntry *prev;
+	struct tagHashCacheEntry *next;
+} HashCacheEntry;
+
+typedef struct tagHashCacheShard
+{
+	HashArray hash_array;
+	HashCacheEntry *head;  //the most recently used (LRU) or inserted
+	HashCacheEntry *tail;
+	HashCacheEntry *hand;  //the clock hand, from tail to head
+	struct fast_mblock_man entry_allocator;
+	int64_t hits;
+	int64_t misses;
+	int64_t evictions;
+	int64_t expirations;
+	pthread_mutex_t lock;
+} HashCacheShard;
+
+typedef struct tagHashCache
+{
+	int policy;
+	int shard_count;
+	HashFunc hash_func;
+	HashCacheShard *shards;
+} HashCache;
+
+typedef struct tagHashCacheStat
+{
+	int item_count;
+	int64_t bytes_used;
+	int64_t hits;
+	int64_t misses;
+	int64_t evictions;
+	int64_t expirations;
+} HashCacheStat;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define hash_cache_init(cache, hash_func, capacity, max_bytes) \
+	hash_cache_init_ex(cache, hash_func, capacity, max_bytes, 1, \
+		HASH_CACHE_POLICY_LRU)
+
+/**
+ * hash cache init function
+ * parameters:
+ *         cache: the cache
+ *         hash_func: hash function
+ *         capacity: init capacity of all shards
+ *         max_bytes: max memory of all shards, must > 0
+ *         shard_count: the shard count for concurrency
+ *         policy: HASH_CACHE_POLICY_LRU or HASH_CACHE_POLICY_CLOCK
+ * return 0 for success, != 0 for error
+*/
+int hash_cache_init_ex(HashCache *cache, HashFunc hash_func,
+		const unsigned int capacity, const int64_t max_bytes,
+		const int shard_count, const int policy);
+
+/**
+ * hash cache destroy function
+ * parameters:
+ *         cache: the cache
+ * return none
+*/
+void hash_cache_destroy(HashCache *cache);
+
+/**
+ * set the value of the key, evict other entries when the memory is not enough
+ * parameters:
+ *         cache: the cache
+ *         key: the key to set
+ *         key_len: length of th key
+ *         value: the value
+ *         value_len: length of the value
+ *         ttl: time to live in seconds, <= 0 for never expired
+ * return 0 for success, != 0 fail (errno)
+*/
+int hash_cache_set(HashCache *cache, const void *key, const int key_len,
+		const void *value, const int value_len, const int ttl);
+
+/**
+ * get the value of the key
+ * parameters:
+ *         cache: the cache
+ *         key: the key to find
+ *         key_len: length of th key
+ *         value: store the value
+ *         value_len: input for the max size of the value
+ *                    output for the length fo the value
+ * return 0 for success, != 0 fail (errno), ENOENT for miss
+*/
+int hash_cache_get(HashCache *cache, const void *key, const int key_len,
+		void *value, int *value_len);
+
+/**
+ * delete the key
+ * parameters:
+ *         cache: the cache
+ *         key: the key to delete
+ *         key_len: length of th key
+ * return 0 for success, != 0 fail (errno)
+*/
+int hash_cache_delete(HashCache *cache, const void *key, const int key_len);
+
+/**
+ * get the stat of all shards
+ * parameters:
+ *         cache: the cache
+ *         stat: return the stat info
+ * return none
+*/
+void hash_cache_stat(HashCache *cache, HashCacheStat *stat);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
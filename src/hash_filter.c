@@ -0,0 +1,588 @@
+/**
+* Copyright (C) 2008 Happy Fish / YuQing
+*
+* FastDFS may be copied only under the terms of the GNU General
+* Public License V3, which may be found in the FastDFS source kit.
+* Please visit the FastDFS Home Page http://www.csource.org/ for more detail.
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
+#include "logger.h"
+#include "shared_func.h"
+#include "hash_filter.h"
+
+#define BLOOM_FILTER_BLOCK_BITS  (BLOOM_FILTER_BLOCK_WORDS * 64)
+#define BLOOM_FILTER_BLOCK_BYTES (BLOOM_FILTER_BLOCK_WORDS * 8)
+
+#define CUCKOO_FILTER_MAX_LOAD_FACTOR  0.95
+
+uint64_t hash_filter_hash64(const void *key, const int key_len, \
+		const uint64_t seed)
+{
+	const uint64_t m = 0xc6a4a7935bd1e995ULL;
+	const int r = 47;
+	const unsigned char *p;
+	const unsigned char *end;
+	uint64_t h;
+	uint64_t k;
+
+	h = seed ^ ((uint64_t)key_len * m);
+	p = (const unsigned char *)key;
+	end = p + (key_len & ~7);
+	while (p != end)
+	{
+		memcpy(&k, p, 8);
+		k *= m;
+		k ^= k >> r;
+		k *= m;
+
+		h ^= k;
+		h *= m;
+		p += 8;
+	}
+
+	switch (key_len & 7)
+	{
+		case 7: h ^= (uint64_t)p[6] << 48;
+		case 6: h ^= (uint64_t)p[5] << 40;
+		case 5: h ^= (uint64_t)p[4] << 32;
+		case 4: h ^= (uint64_t)p[3] << 24;
+		case 3: h ^= (uint64_t)p[2] << 16;
+		case 2: h ^= (uint64_t)p[1] << 8;
+		case 1: h ^= (uint64_t)p[0];
+			h *= m;
+	}
+
+	h ^= h >> r;
+	h *= m;
+	h ^= h >> r;
+	return h;
+}
+
+static int bloom_filter_alloc(BloomFilter *filter, const int64_t block_count)
+{
+	int64_t bytes;
+	int result;
+
+	bytes = block_count * BLOOM_FILTER_BLOCK_BYTES;
+	if ((result=posix_memalign((void **)&filter->bits, \
+			BLOOM_FILTER_BLOCK_BYTES, bytes)) != 0)
+	{
+		logError("file: "__FILE__", line: %d, " \
+			"malloc %"PRId64" bytes fail, errno: %d, error info: %s", \
+			__LINE__, bytes, result, STRERROR(result));
+		filter->bits = NULL;
+		return result;
+	}
+
+	memset(filter->bits, 0, bytes);
+	filter->block_count = block_count;
+	return 0;
+}
+
+int bloom_filter_init(BloomFilter *filter, const int64_t capacity, \
+		const double false_positive_rate, const bool atomic_insert)
+{
+	double bits;
+	int64_t block_count;
+
+	if (capacity <= 0 || false_positive_rate <= 0.00 || \
+		false_positive_rate >= 1.00)
+	{
+		logError("file: "__FILE__", line: %d, " \
+			"invalid capacity: %"PRId64" or false positive " \
+			"rate: %.6f", __LINE__, capacity, false_positive_rate);
+		return EINVAL;
+	}
+
+	bits = -1.00 * capacity * log(false_positive_rate) / (M_LN2 * M_LN2);
+	block_count = (int64_t)((bits + BLOOM_FILTER_BLOCK_BITS - 1) / \
+			BLOOM_FILTER_BLOCK_BITS);
+	if (block_count <= 0)
+	{
+		block_count = 1;
+	}
+
+	filter->hash_count = (int)(-1.00 * log(false_positive_rate) / M_LN2 + 0.5);
+	if (filter->hash_count <= 0)
+	{
+		filter->hash_count = 1;
+	}
+	else if (filter->hash_count > BLOOM_FILTER_MAX_HASH_COUNT)
+	{
+		filter->hash_count = BLOOM_FILTER_MAX_HASH_COUNT;
+	}
+	filter->seed = 0;
+	filter->atomic_insert = atomic_insert;
+	return bloom_filter_alloc(filter, block_count);
+}
+
+void bloom_filter_destroy(BloomFilter *filter)
+{
+	if (filter->bits != NULL)
+	{
+		free(filter->bits);
+		filter->bits = NULL;
+	}
+	filter->block_count = 0;
+}
+
+void bloom_filter_clear(BloomFilter *filter)
+{
+	memset(filter->bits, 0, filter->block_count * BLOOM_FILTER_BLOCK_BYTES);
+}
+
+/* all the bits of the key are in one block, the bit positions are
+   generated by double hashing */
+static inline uint64_t *bloom_filter_get_masks(BloomFilter *filter, \
+		const void *key, const int key_len, uint64_t *masks)
+{
+	uint64_t h;
+	uint32_t h1;
+	uint32_t h2;
+	uint32_t pos;
+	int i;
+
+	h = hash_filter_hash64(key, key_len, filter->seed);
+	h1 = (uint32_t)h;
+	h2 = (uint32_t)((h * 0x9E3779B97F4A7C15ULL) >> 32) | 1;
+	memset(masks, 0, sizeof(uint64_t) * BLOOM_FILTER_BLOCK_WORDS);
+	for (i=0; i<filter->hash_count; i++)
+	{
+		pos = (h1 + i * h2) % BLOOM_FILTER_BLOCK_BITS;
+		masks[pos / 64] |= (uint64_t)1 << (pos % 64);
+	}
+
+	return filter->bits + ((h >> 32) % filter->block_count) * \
+		BLOOM_FILTER_BLOCK_WORDS;
+}
+
+void bloom_filter_add(BloomFilter *filter, const void *key, \
+		const int key_len)
+{
+	uint64_t masks[BLOOM_FILTER_BLOCK_WORDS];
+	uint64_t *block;
+	int i;
+
+	block = bloom_filter_get_masks(filter, key, key_len, masks);
+	for (i=0; i<BLOOM_FILTER_BLOCK_WORDS; i++)
+	{
+		if (masks[i] == 0 || (block[i] & masks[i]) == masks[i])
+		{
+			continue;
+		}
+
+		if (filter->atomic_insert)
+		{
+			__sync_fetch_and_or(block + i, masks[i]);
+		}
+		else
+		{
+			block[i] |= masks[i];
+		}
+	}
+}
+
+bool bloom_filter_contains(BloomFilter *filter, const void *key, \
+		const int key_len)
+{
+	uint64_t masks[BLOOM_FILTER_BLOCK_WORDS];
+	uint64_t *block;
+	int i;
+
+	block = bloom_filter_get_masks(filter, key, key_len, masks);
+	for (i=0; i<BLOOM_FILTER_BLOCK_WORDS; i++)
+	{
+		if ((block[i] & masks[i]) != masks[i])
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+int bloom_filter_serialize(BloomFilter *filter, char *buff, \
+		const int64_t size)
+{
+	char *p;
+	int64_t word_count;
+	int64_t i;
+
+	if (size < bloom_filter_serialize_size(filter))
+	{
+		return ENOSPC;
+	}
+
+	p = buff;
+	memcpy(p, BLOOM_FILTER_MAGIC, 4);
+	p += 4;
+	int2buff(BLOOM_FILTER_VERSION, p);
+	p += 4;
+	int2buff(filter->hash_count, p);
+	p += 4;
+	int2buff(filter->seed, p);
+	p += 4;
+	long2buff(filter->block_count, p);
+	p += 8;
+
+	word_count = filter->block_count * BLOOM_FILTER_BLOCK_WORDS;
+	for (i=0; i<word_count; i++)
+	{
+		long2buff(filter->bits[i], p);
+		p += 8;
+	}
+
+	return 0;
+}
+
+int bloom_filter_deserialize(BloomFilter *filter, const char *buff, \
+		const int64_t size, const bool atomic_insert)
+{
+	const char *p;
+	int64_t block_count;
+	int64_t word_count;
+	int64_t i;
+	int result;
+
+	if (size < BLOOM_FILTER_HEADER_SIZE || memcmp(buff, \
+		BLOOM_FILTER_MAGIC, 4) != 0 || buff2int(buff + 4) != \
+		BLOOM_FILTER_VERSION)
+	{
+		logError("file: "__FILE__", line: %d, " \
+			"invalid bloom filter header", __LINE__);
+		return EINVAL;
+	}
+
+	block_count = buff2long(buff + 16);
+	if (block_count <= 0 || size != BLOOM_FILTER_HEADER_SIZE + \
+		block_count * BLOOM_FILTER_BLOCK_BYTES)
+	{
+		logError("file: "__FILE__", line: %d, " \
+			"invalid bloom filter size: %"PRId64", block count: " \
+			"%"PRId64, __LINE__, size, block_count);
+		return EINVAL;
+	}
+
+	filter->hash_count = buff2int(buff + 8);
+	if (filter->hash_count <= 0 || filter->hash_count > \
+		BLOOM_FILTER_MAX_HASH_COUNT)
+	{
+		logError("file: "__FILE__", line: %d, " \
+			"invalid bloom filter hash count: %d", \
+			__LINE__, filter->hash_count);
+		return EINVAL;
+	}
+	filter->seed = buff2int(buff + 12);
+	filter->atomic_insert = atomic_insert;
+	if ((result=bloom_filter_alloc(filter, block_count)) != 0)
+	{
+		return result;
+	}
+
+	p = buff + BLOOM_FILTER_HEADER_SIZE;
+	word_count = block_count * BLOOM_FILTER_BLOCK_WORDS;
+	for (i=0; i<word_count; i++)
+	{
+		filter->bits[i] = buff2long(p);
+		p += 8;
+	}
+
+	return 0;
+}
+
+int bloom_filter_save(BloomFilter *filter, const char *filename)
+{
+	char *buff;
+	int64_t size;
+	int result;
+
+	size = bloom_filter_serialize_size(filter);
+	if (size > INT_MAX)
+	{
+		logError("file: "__FILE__", line: %d, " \
+			"bloom filter size: %"PRId64" is too large", \
+			__LINE__, size);
+		return EOVERFLOW;
+	}
+
+	buff = (char *)malloc(size);
+	if (buff == NULL)
+	{
+		logError("file: "__FILE__", line: %d, " \
+			"malloc %"PRId64" bytes fail", __LINE__, size);
+		return ENOMEM;
+	}
+
+	if ((result=bloom_filter_serialize(filter, buff, size)) == 0)
+	{
+		result = writeToFile(filename, buff, size);
+	}
+	free(buff);
+	return result;
+}
+
+int bloom_filter_load(BloomFilter *filter, const char *filename, \
+		const bool atomic_insert)
+{
+	char *buff;
+	int64_t size;
+	int result;
+
+	if ((result=getFileContent(filename, &buff, &size)) != 0)
+	{
+		return result;
+	}
+
+	result = bloom_filter_deserialize(filter, buff, size, atomic_insert);
+	free(buff);
+	return result;
+}
+
+int cuckoo_filter_init(CuckooFilter *filter, const int64_t capacity)
+{
+	int64_t bucket_count;
+	int64_t min_count;
+	int64_t bytes;
+
+	if (capacity <= 0)
+	{
+		logError("file: "__FILE__", line: %d, " \
+			"invalid capacity: %"PRId64, __LINE__, capacity);
+		return EINVAL;
+	}
+
+	min_count = (int64_t)(capacity / (CUCKOO_FILTER_BUCKET_SLOTS * \
+			CUCKOO_FILTER_MAX_LOAD_FACTOR)) + 1;
+	bucket_count = 1;
+	while (bucket_count < min_count)
+	{
+		bucket_count *= 2;
+	}
+
+	bytes = sizeof(uint16_t) * CUCKOO_FILTER_BUCKET_SLOTS * bucket_count;
+	filter->slots = (uint16_t *)malloc(bytes);
+	if (filter->slots == NULL)
+	{
+		logError("file: "__FILE__", line: %d, " \
+			"malloc %"PRId64" bytes fail", __LINE__, bytes);
+		return ENOMEM;
+	}
+	memset(filter->slots, 0, bytes);
+
+	filter->bucket_mask = bucket_count - 1;
+	filter->count = 0;
+	filter->random = 0x9E3779B97F4A7C15ULL;
+	filter->victim.index = 0;
+	filter->victim.fingerprint = 0;
+	return 0;
+}
+
+void cuckoo_filter_destroy(CuckooFilter *filter)
+{
+	if (filter->slots != NULL)
+	{
+		free(filter->slots);
+		filter->slots = NULL;
+	}
+	filter->count = 0;
+}
+
+static inline void cuckoo_filter_hash(CuckooFilter *filter, \
+		const void *key, const int key_len, int64_t *index, \
+		uint16_t *fingerprint)
+{
+	uint64_t h;
+
+	h = hash_filter_hash64(key, key_len, 0);
+	*fingerprint = (uint16_t)(h >> 48);
+	if (*fingerprint == 0)
+	{
+		*fingerprint = 1;
+	}
+	*index = h & filter->bucket_mask;
+}
+
+//the alternate bucket of the alternate bucket is the bucket itself
+static inline int64_t cuckoo_filter_alt_index(CuckooFilter *filter, \
+		const int64_t index, const uint16_t fingerprint)
+{
+	return (index ^ (fingerprint * 0x5bd1e995ULL)) & filter->bucket_mask;
+}
+
+static inline bool cuckoo_filter_bucket_add(CuckooFilter *filter, \
+		const int64_t index, const uint16_t fingerprint)
+{
+	uint16_t *slot;
+	uint16_t *end;
+
+	slot = filter->slots + index * CUCKOO_FILTER_BUCKET_SLOTS;
+	end = slot + CUCKOO_FILTER_BUCKET_SLOTS;
+	for (; slot<end; slot++)
+	{
+		if (*slot == 0)
+		{
+			*slot = fingerprint;
+			return true;
+		}
+	}
+	return false;
+}
+
+static inline bool cuckoo_filter_bucket_delete(CuckooFilter *filter, \
+		const int64_t index, const uint16_t fingerprint)
+{
+	uint16_t *slot;
+	uint16_t *end;
+
+	slot = filter->slots + index * CUCKOO_FILTER_BUCKET_SLOTS;
+	end = slot + CUCKOO_FILTER_BUCKET_SLOTS;
+	for (; slot<end; slot++)
+	{
+		if (*slot == fingerprint)
+		{
+			*slot = 0;
+			return true;
+		}
+	}
+	return false;
+}
+
+static inline bool cuckoo_filter_bucket_contains(CuckooFilter *filter, \
+		const int64_t index, const uint16_t fingerprint)
+{
+	uint16_t *slot;
+
+	slot = filter->slots + index * CUCKOO_FILTER_BUCKET_SLOTS;
+	return slot[0] == fingerprint || slot[1] == fingerprint || \
+		slot[2] == fingerprint || slot[3] == fingerprint;
+}
+
+static inline uint64_t cuckoo_filter_random(CuckooFilter *filter)
+{
+	//xorshift64
+	filter->random ^= filter->random << 13;
+	filter->random ^= filter->random >> 7;
+	filter->random ^= filter->random << 17;
+	return filter->random;
+}
+
+int cuckoo_filter_add(CuckooFilter *filter, const void *key, \
+		const int key_len)
+{
+	int64_t index;
+	uint16_t fingerprint;
+	uint16_t *slot;
+	uint16_t old_fingerprint;
+	int i;
+
+	if (filter->victim.fingerprint != 0)
+	{
+		return ENOSPC;
+	}
+
+	cuckoo_filter_hash(filter, key, key_len, &index, &fingerprint);
+	if (cuckoo_filter_bucket_add(filter, index, fingerprint))
+	{
+		filter->count++;
+		return 0;
+	}
+	index = cuckoo_filter_alt_index(filter, index, fingerprint);
+	if (cuckoo_filter_bucket_add(filter, index, fingerprint))
+	{
+		filter->count++;
+		return 0;
+	}
+
+	//kick out a random fingerprint to its alternate bucket
+	for (i=0; i<CUCKOO_FILTER_MAX_KICKS; i++)
+	{
+		slot = filter->slots + index * CUCKOO_FILTER_BUCKET_SLOTS + \
+			cuckoo_filter_random(filter) % CUCKOO_FILTER_BUCKET_SLOTS;
+		old_fingerprint = *slot;
+		*slot = fingerprint;
+		fingerprint = old_fingerprint;
+
+		index = cuckoo_filter_alt_index(filter, index, fingerprint);
+		if (cuckoo_filter_bucket_add(filter, index, fingerprint))
+		{
+			filter->count++;
+			return 0;
+		}
+	}
+
+	//keep the last one as the victim, the filter is full
+	filter->victim.index = index;
+	filter->victim.fingerprint = fingerprint;
+	filter->count++;
+	return 0;
+}
+
+int cuckoo_filter_delete(CuckooFilter *filter, const void *key, \
+		const int key_len)
+{
+	int64_t index;
+	int64_t alt_index;
+	uint16_t fingerprint;
+
+	cuckoo_filter_hash(filter, key, key_len, &index, &fingerprint);
+	alt_index = cuckoo_filter_alt_index(filter, index, fingerprint);
+	if (filter->victim.fingerprint == fingerprint && \
+		(filter->victim.index == index || \
+		 filter->victim.index == alt_index))
+	{
+		filter->victim.fingerprint = 0;
+		filter->count--;
+		return 0;
+	}
+
+	if (!(cuckoo_filter_bucket_delete(filter, index, fingerprint) || \
+		cuckoo_filter_bucket_delete(filter, alt_index, fingerprint)))
+	{
+		return ENOENT;
+	}
+	filter->count--;
+
+	//a slot is free now, add the victim back
+	if (filter->victim.fingerprint != 0)
+	{
+		fingerprint = filter->victim.fingerprint;
+		index = filter->victim.index;
+		if (cuckoo_filter_bucket_add(filter, index, fingerprint) || \
+			cuckoo_filter_bucket_add(filter, cuckoo_filter_alt_index( \
+					filter, index, fingerprint), fingerprint))
+		{
+			filter->victim.fingerprint = 0;
+		}
+	}
+	return 0;
+}
+
+bool cuckoo_filter_contains(CuckooFilter *filter, const void *key, \
+		const int key_len)
+{
+	int64_t index;
+	int64_t alt_index;
+	uint16_t fingerprint;
+
+	cuckoo_filter_hash(filter, key, key_len, &index, &fingerprint);
+	if (cuckoo_filter_bucket_contains(filter, index, fingerprint))
+	{
+		return true;
+	}
+
+	alt_index = cuckoo_filter_alt_index(filter, index, fingerprint);
+	if (cuckoo_filter_bucket_contains(filter, alt_index, fingerprint))
+	{
+		return true;
+	}
+
+	return filter->victim.fingerprint == fingerprint && \
+		(filter->victim.index == index || \
+		 filter->victim.index == alt_index);
+}
@@ -0,0 +1,171 @@
+/**
+* Copyright (C) 2008 Happy Fish / YuQing
+*
+* FastDFS may be copied only under the terms of the GNU General
+* Public License V3, which may be found in the FastDFS source kit.
+* Please visit the FastDFS Home Page http://www.csource.org/ for more detail.
+**/
+
+/**
+  filters to answer the negative lookup before the HashArray or the disk.
+  BloomFilter is blocked: all the bits of one key are in one 64 bytes
+  block (one cache line), the insert can be thread safe by atomic OR.
+  CuckooFilter stores the 16 bits fingerprints in the buckets of 4 slots
+  and supports delete, it is NOT thread safe.
+  the false positive is possible, the false negative is impossible.
+*/
+
+#ifndef _HASH_FILTER_H_
+#define _HASH_FILTER_H_
+
+#include "common_define.h"
+
+#define BLOOM_FILTER_BLOCK_WORDS  8   //64 bytes per block
+#define BLOOM_FILTER_MAX_HASH_COUNT  16
+
+#define CUCKOO_FILTER_BUCKET_SLOTS  4
+#define CUCKOO_FILTER_MAX_KICKS   500
+
+/**
+  the serialized bloom filter: the header then the words of the bits,
+  the header: magic (4 bytes), version (4 bytes), hash_count (4 bytes),
+  seed (4 bytes) and block_count (8 bytes), the integers are big endian
+*/
+#define BLOOM_FILTER_MAGIC  "BLMF"
+#define BLOOM_FILTER_VERSION  1
+#define BLOOM_FILTER_HEADER_SIZE  24
+
+typedef struct tagBloomFilter
+{
+	uint64_t *bits;
+	int64_t block_count;
+	int hash_count;
+	int seed;
+	bool atomic_insert;  //insert by atomic OR for the multi threads
+} BloomFilter;
+
+typedef struct tagCuckooFilter
+{
+	uint16_t *slots;  //fingerprints, 0 for empty
+	int64_t bucket_mask;  //the bucket count is power of 2
+	int64_t count;
+	uint64_t random;  //the state for kick out
+	struct {
+		int64_t index;
+		uint16_t fingerprint;  //0 for none
+	} victim;  //the fingerprint failed to insert when full
+} CuckooFilter;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * 64 bits hash function (MurmurHash64A)
+ * parameters:
+ *         key: the key
+ *         key_len: the length of the key
+ *         seed: the hash seed
+ * return the hash code
+*/
+uint64_t hash_filter_hash64(const void *key, const int key_len, \
+		const uint64_t seed);
+
+/**
+ * init the bloom filter
+ * parameters:
+ *         filter: the bloom filter
+ *         capacity: the expected key count
+ *         false_positive_rate: the expected false positive rate, such as 0.01
+ *         atomic_insert: if insert by atomic OR for the multi threads
+ * return 0 for success, != 0 fail (errno)
+*/
+int bloom_filter_init(BloomFilter *filter, const int64_t capacity, \
+		const double false_positive_rate, const bool atomic_insert);
+
+void bloom_filter_destroy(BloomFilter *filter);
+
+void bloom_filter_add(BloomFilter *filter, const void *key, \
+		const int key_len);
+
+/**
+ * check the key
+ * return true for the key may exist, false for the key NOT exist
+*/
+bool bloom_filter_contains(BloomFilter *filter, const void *key, \
+		const int key_len);
+
+//clear all the bits
+void bloom_filter_clear(BloomFilter *filter);
+
+//return the bytes of the serialized filter
+static inline int64_t bloom_filter_serialize_size(BloomFilter *filter)
+{
+	return BLOOM_FILTER_HEADER_SIZE + filter->block_count * \
+		BLOOM_FILTER_BLOCK_WORDS * 8;
+}
+
+/**
+ * serialize the bloom filter to the buffer
+ * parameters:
+ *         filter: the bloom filter
+ *         buff: the buffer
+ *         size: the buffer size, must >= bloom_filter_serialize_size
+ * return 0 for success, != 0 fail (errno)
+*/
+int bloom_filter_serialize(BloomFilter *filter, char *buff, \
+		const int64_t size);
+
+/**
+ * init the bloom filter from the serialized buffer
+ * parameters:
+ *         filter: the bloom filter to init
+ *         buff: the buffer
+ *         size: the buffer size
+ *         atomic_insert: if insert by atomic OR for the multi threads
+ * return 0 for success, != 0 fail (errno)
+*/
+int bloom_filter_deserialize(BloomFilter *filter, const char *buff, \
+		const int64_t size, const bool atomic_insert);
+
+int bloom_filter_save(BloomFilter *filter, const char *filename);
+int bloom_filter_load(BloomFilter *filter, const char *filename, \
+		const bool atomic_insert);
+
+/**
+ * init the cuckoo filter
+ * parameters:
+ *         filter: the cuckoo filter
+ *         capacity: the max key count, the load factor is 0.95 at most
+ * return 0 for success, != 0 fail (errno)
+*/
+int cuckoo_filter_init(CuckooFilter *filter, const int64_t capacity);
+void cuckoo_filter_destroy(CuckooFilter *filter);
+
+/**
+ * add the key, the same key can be added multi times
+ * return 0 for success, ENOSPC for the filter is full
+*/
+int cuckoo_filter_add(CuckooFilter *filter, const void *key, \
+		const int key_len);
+
+/**
+ * delete the key, the key must be added before
+ * return 0 for success, ENOENT for not found
+*/
+int cuckoo_filter_delete(CuckooFilter *filter, const void *key, \
+		const int key_len);
+
+bool cuckoo_filter_contains(CuckooFilter *filter, const void *key, \
+		const int key_len);
+
+static inline int64_t cuckoo_filter_count(CuckooFilter *filter)
+{
+	return filter->count;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
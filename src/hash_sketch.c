@@ -0,0 +1,628 @@
+/**
+* Copyright (C) 2008 Happy Fish / YuQing
+*
+* FastDFS may be copied only under the terms of the GNU General
+* Public License V3, which may be found in the FastDFS source kit.
+* Please visit the FastDFS Home Page http://www.csource.org/ for more detail.
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include "logger.h"
+#include "shared_func.h"
+#include "hash_filter.h"
+#include "hash_sketch.h"
+
+int hll_init(HyperLogLog *hll, const int precision)
+{
+	if (precision < HLL_MIN_PRECISION || precision > HLL_MAX_PRECISION)
+	{
+		logError("file: "__FILE__", line: %d, " \
+			"invalid precision: %d, should be in [%d, %d]", \
+			__LINE__, precision, HLL_MIN_PRECISION, HLL_MAX_PRECISION);
+		return EINVAL;
+	}
+
+	hll->precision = precision;
+	hll->register_count = 1 << precision;
+	hll->registers = (unsigned char *)malloc(hll->register_count);
+	if (hll->registers == NULL)
+	{
+		logError("file: "__FILE__", line: %d, " \
+			"malloc %d bytes fail", __LINE__, hll->register_count);
+		return ENOMEM;
+	}
+
+	memset(hll->registers, 0, hll->register_count);
+	return 0;
+}
+
+void hll_destroy(HyperLogLog *hll)
+{
+	if (hll->registers != NULL)
+	{
+		free(hll->registers);
+		hll->registers = NULL;
+	}
+}
+
+void hll_clear(HyperLogLog *hll)
+{
+	memset(hll->registers, 0, hll->register_count);
+}
+
+void hll_add(HyperLogLog *hll, const void *key, const int key_len)
+{
+	uint64_t hash_code;
+	uint64_t bits;
+	int index;
+	unsigned char rank;
+
+	hash_code = hash_filter_hash64(key, key_len, 0);
+	index = hash_code >> (64 - hll->precision);
+	bits = hash_code << hll->precision;
+	if (bits == 0)
+	{
+		rank = 64 - hll->precision + 1;
+	}
+	else
+	{
+		rank = __builtin_clzll(bits) + 1;
+	}
+
+	if (hll->registers[index] < rank)
+	{
+		hll->registers[index] = rank;
+	}
+}
+
+int64_t hll_count(HyperLogLog *hll)
+{
+	double alpha;
+	double sum;
+	double estimate;
+	int zero_count;
+	int i;
+
+	switch (hll->register_count)
+	{
+		case 16:
+			alpha = 0.673;
+			break;
+		case 32:
+			alpha = 0.697;
+			break;
+		case 64:
+			alpha = 0.709;
+			break;
+		default:
+			alpha = 0.7213 / (1.00 + 1.079 / hll->register_count);
+			break;
+	}
+
+	sum = 0.00;
+	zero_count = 0;
+	for (i=0; i<hll->register_count; i++)
+	{
+		sum += ldexp(1.00, -1 * hll->registers[i]);
+		if (hll->registers[i] == 0)
+		{
+			zero_count++;
+		}
+	}
+
+	estimate = alpha * hll->register_count * hll->register_count / sum;
+	if (estimate <= 2.5 * hll->register_count && zero_count > 0)
+	{
+		//linear counting for the small range
+		estimate = hll->register_count * log((double)hll->register_count /
+				zero_count);
+	}
+
+	return (int64_t)(estimate + 0.5);
+}
+
+int hll_merge(HyperLogLog *dest, const HyperLogLog *src)
+{
+	int i;
+
+	if (dest->precision != src->precision)
+	{
+		logError("file: "__FILE__", line: %d, " \
+			"the precisions: %d != %d", __LINE__, \
+			dest->precision, src->precision);
+		return EINVAL;
+	}
+
+	for (i=0; i<dest->register_count; i++)
+	{
+		if (dest->registers[i] < src->registers[i])
+		{
+			dest->registers[i] = src->registers[i];
+		}
+	}
+	return 0;
+}
+
+int hll_serialize(HyperLogLog *hll, char *buff, const int size)
+{
+	if (size < hll_serialize_size(hll))
+	{
+		return ENOSPC;
+	}
+
+	int2buff(hll->precision, buff);
+	memcpy(buff + HLL_HEADER_SIZE, hll->registers, hll->register_count);
+	return 0;
+}
+
+int hll_deserialize(HyperLogLog *hll, const char *buff, const int size)
+{
+	int result;
+
+	if (size < HLL_HEADER_SIZE)
+	{
+		logError("file: "__FILE__", line: %d, " \
+			"invalid buffer size: %d", __LINE__, size);
+		return EINVAL;
+	}
+
+	if ((result=hll_init(hll, buff2int(buff))) != 0)
+	{
+		return result;
+	}
+	if (size != hll_serialize_size(hll))
+	{
+		logError("file: "__FILE__", line: %d, " \
+			"invalid buffer size: %d != %d", __LINE__, \
+			size, hll_serialize_size(hll));
+		hll_destroy(hll);
+		return EINVAL;
+	}
+
+	memcpy(hll->registers, buff + HLL_HEADER_SIZE, hll->register_count);
+	return 0;
+}
+
+int count_min_init(CountMinSketch *sketch, const int width, \
+		const int depth, const int top_k)
+{
+	int64_t bytes;
+
+	if (width <= 0 || depth <= 0 || top_k < 0)
+	{
+		logError("file: "__FILE__", line: %d, " \
+			"invalid width: %d, depth: %d or top k: %d", \
+			__LINE__, width, depth, top_k);
+		return EINVAL;
+	}
+
+	sketch->width = width;
+	sketch->depth = depth;
+	sketch->total = 0;
+	sketch->top_k.capacity = top_k;
+	sketch->top_k.count = 0;
+	sketch->top_k.entries = NULL;
+
+	bytes = sizeof(int64_t) * width * depth;
+	sketch->counters = (int64_t *)malloc(bytes);
+	if (sketch->counters == NULL)
+	{
+		logError("file: "__FILE__", line: %d, " \
+			"malloc %"PRId64" bytes fail", __LINE__, bytes);
+		return ENOMEM;
+	}
+	memset(sketch->counters, 0, bytes);
+
+	if (top_k > 0)
+	{
+		bytes = sizeof(CountMinEntry) * top_k;
+		sketch->top_k.entries = (CountMinEntry *)malloc(bytes);
+		if (sketch->top_k.entries == NULL)
+		{
+			logError("file: "__FILE__", line: %d, " \
+				"malloc %"PRId64" bytes fail", __LINE__, bytes);
+			count_min_destroy(sketch);
+			return ENOMEM;
+		}
+	}
+
+	return 0;
+}
+
+void count_min_destroy(CountMinSketch *sketch)
+{
+	if (sketch->counters != NULL)
+	{
+		free(sketch->counters);
+		sketch->counters = NULL;
+	}
+	if (sketch->top_k.entries != NULL)
+	{
+		free(sketch->top_k.entries);
+		sketch->top_k.entries = NULL;
+	}
+	sketch->top_k.count = 0;
+}
+
+void count_min_clear(CountMinSketch *sketch)
+{
+	memset(sketch->counters, 0, sizeof(int64_t) * \
+		sketch->width * sketch->depth);
+	sketch->total = 0;
+	sketch->top_k.count = 0;
+}
+
+//the counter index of the row by double hashing
+#define COUNT_MIN_INDEX(sketch, hash_code, row) \
+	((row) * (sketch)->width + (int)(((uint32_t)(hash_code) + (row) * \
+	  (uint32_t)((hash_code) >> 32)) % (uint32_t)(sketch)->width))
+
+static int64_t count_min_estimate_by_hash(const CountMinSketch *sketch, \
+		const uint64_t hash_code)
+{
+	int64_t min_count;
+	int64_t count;
+	int row;
+
+	min_count = sketch->counters[COUNT_MIN_INDEX(sketch, hash_code, 0)];
+	for (row=1; row<sketch->depth; row++)
+	{
+		count = sketch->counters[COUNT_MIN_INDEX(sketch, hash_code, row)];
+		if (count < min_count)
+		{
+			min_count = count;
+		}
+	}
+	return min_count;
+}
+
+static void count_min_heap_sift_down(CountMinEntry *entries, \
+		const int count, int index)
+{
+	CountMinEntry entry;
+	int child;
+
+	entry = entries[index];
+	while ((child=2 * index + 1) < count)
+	{
+		if (child + 1 < count && entries[child + 1].count < \
+			entries[child].count)
+		{
+			child++;
+		}
+		if (entry.count <= entries[child].count)
+		{
+			break;
+		}
+
+		entries[index] = entries[child];
+		index = child;
+	}
+	entries[index] = entry;
+}
+
+static void count_min_heap_sift_up(CountMinEntry *entries, int index)
+{
+	CountMinEntry entry;
+	int parent;
+
+	entry = entries[index];
+	while (index > 0)
+	{
+		parent = (index - 1) / 2;
+		if (entries[parent].count <= entry.count)
+		{
+			break;
+		}
+
+		entries[index] = entries[parent];
+		index = parent;
+	}
+	entries[index] = entry;
+}
+
+static void count_min_offer(CountMinSketch *sketch, const uint64_t hash_code, \
+		const char *key, const int key_len, const int64_t count)
+{
+	CountMinEntry *entry;
+	int stored_len;
+	int i;
+
+	stored_len = key_len < COUNT_MIN_KEY_SIZE ? key_len : COUNT_MIN_KEY_SIZE;
+	for (i=0; i<sketch->top_k.count; i++)
+	{
+		entry = sketch->top_k.entries + i;
+		if (entry->hash_code == hash_code && entry->key_len == \
+			stored_len && memcmp(entry->key, key, stored_len) == 0)
+		{
+			if (count > entry->count)
+			{
+				entry->count = count;
+				count_min_heap_sift_down(sketch->top_k.entries, \
+						sketch->top_k.count, i);
+			}
+			return;
+		}
+	}
+
+	if (sketch->top_k.count < sketch->top_k.capacity)
+	{
+		i = sketch->top_k.count++;
+	}
+	else if (count > sketch->top_k.entries[0].count)
+	{
+		i = 0;
+	}
+	else
+	{
+		return;
+	}
+
+	entry = sketch->top_k.entries + i;
+	entry->hash_code = hash_code;
+	entry->count = count;
+	entry->key_len = stored_len;
+	memcpy(entry->key, key, stored_len);
+	if (i == 0)
+	{
+		count_min_heap_sift_down(sketch->top_k.entries, \
+				sketch->top_k.count, 0);
+	}
+	else
+	{
+		count_min_heap_sift_up(sketch->top_k.entries, i);
+	}
+}
+
+int64_t count_min_add(CountMinSketch *sketch, const void *key, \
+		const int key_len, const int64_t inc)
+{
+	uint64_t hash_code;
+	int64_t min_count;
+	int64_t *counter;
+	int row;
+
+	hash_code = hash_filter_hash64(key, key_len, 0);
+	min_count = 0;
+	for (row=0; row<sketch->depth; row++)
+	{
+		counter = sketch->counters + COUNT_MIN_INDEX(sketch, \
+				hash_code, row);
+		*counter += inc;
+		if (row == 0 || *counter < min_count)
+		{
+			min_count = *counter;
+		}
+	}
+	sketch->total += inc;
+
+	if (sketch->top_k.capacity > 0)
+	{
+		count_min_offer(sketch, hash_code, (const char *)key, \
+				key_len, min_count);
+	}
+	return min_count;
+}
+
+int64_t count_min_estimate(CountMinSketch *sketch, const void *key, \
+		const int key_len)
+{
+	return count_min_estimate_by_hash(sketch, \
+			hash_filter_hash64(key, key_len, 0));
+}
+
+int count_min_merge(CountMinSketch *dest, const CountMinSketch *src)
+{
+	CountMinEntry *candidates;
+	CountMinEntry *entry;
+	CountMinEntry *end;
+	int64_t bytes;
+	int64_t i;
+	int count;
+
+	if (dest->width != src->width || dest->depth != src->depth)
+	{
+		logError("file: "__FILE__", line: %d, " \
+			"the width: %d and depth: %d != the width: %d and " \
+			"depth: %d", __LINE__, dest->width, dest->depth, \
+			src->width, src->depth);
+		return EINVAL;
+	}
+
+	for (i=0; i<(int64_t)dest->width * dest->depth; i++)
+	{
+		dest->counters[i] += src->counters[i];
+	}
+	dest->total += src->total;
+
+	if (dest->top_k.capacity == 0)
+	{
+		return 0;
+	}
+
+	//rebuild the top k by the merged counters
+	count = dest->top_k.count + src->top_k.count;
+	if (count == 0)
+	{
+		return 0;
+	}
+	bytes = sizeof(CountMinEntry) * count;
+	candidates = (CountMinEntry *)malloc(bytes);
+	if (candidates == NULL)
+	{
+		logError("file: "__FILE__", line: %d, " \
+			"malloc %"PRId64" bytes fail", __LINE__, bytes);
+		return ENOMEM;
+	}
+	memcpy(candidates, dest->top_k.entries, sizeof(CountMinEntry) * \
+		dest->top_k.count);
+	memcpy(candidates + dest->top_k.count, src->top_k.entries, \
+		sizeof(CountMinEntry) * src->top_k.count);
+
+	dest->top_k.count = 0;
+	end = candidates + count;
+	for (entry=candidates; entry<end; entry++)
+	{
+		count_min_offer(dest, entry->hash_code, entry->key, \
+			entry->key_len, count_min_estimate_by_hash(dest, \
+				entry->hash_code));
+	}
+
+	free(candidates);
+	return 0;
+}
+
+int count_min_serialize(CountMinSketch *sketch, char *buff, const int size)
+{
+	CountMinEntry *entry;
+	CountMinEntry *end;
+	char *p;
+	int64_t i;
+
+	if (size < count_min_serialize_size(sketch))
+	{
+		return ENOSPC;
+	}
+
+	p = buff;
+	int2buff(sketch->width, p);
+	int2buff(sketch->depth, p + 4);
+	long2buff(sketch->total, p + 8);
+	int2buff(sketch->top_k.capacity, p + 16);
+	int2buff(sketch->top_k.count, p + 20);
+	p += COUNT_MIN_HEADER_SIZE;
+
+	for (i=0; i<(int64_t)sketch->width * sketch->depth; i++)
+	{
+		long2buff(sketch->counters[i], p);
+		p += 8;
+	}
+
+	//in the heap order, so the heap is kept by deserialize
+	end = sketch->top_k.entries + sketch->top_k.count;
+	for (entry=sketch->top_k.entries; entry<end; entry++)
+	{
+		long2buff((int64_t)entry->hash_code, p);
+		long2buff(entry->count, p + 8);
+		int2buff(entry->key_len, p + 16);
+		memcpy(p + 20, entry->key, entry->key_len);
+		memset(p + 20 + entry->key_len, 0, \
+			COUNT_MIN_KEY_SIZE - entry->key_len);
+		p += COUNT_MIN_ENTRY_SIZE;
+	}
+	return 0;
+}
+
+int count_min_deserialize(CountMinSketch *sketch, const char *buff, \
+		const int size)
+{
+	CountMinEntry *entry;
+	CountMinEntry *end;
+	const char *p;
+	int64_t expect_size;
+	int64_t i;
+	int width;
+	int depth;
+	int capacity;
+	int count;
+	int result;
+
+	if (size < COUNT_MIN_HEADER_SIZE)
+	{
+		logError("file: "__FILE__", line: %d, " \
+			"invalid buffer size: %d", __LINE__, size);
+		return EINVAL;
+	}
+
+	width = buff2int(buff);
+	depth = buff2int(buff + 4);
+	capacity = buff2int(buff + 16);
+	count = buff2int(buff + 20);
+	expect_size = COUNT_MIN_HEADER_SIZE + 8 * (int64_t)width * depth + \
+		(int64_t)COUNT_MIN_ENTRY_SIZE * count;
+	if (count < 0 || count > capacity || size != expect_size)
+	{
+		logError("file: "__FILE__", line: %d, " \
+			"invalid buffer size: %d != %"PRId64" or top k count: " \
+			"%d, capacity: %d", __LINE__, size, expect_size, \
+			count, capacity);
+		return EINVAL;
+	}
+
+	if ((result=count_min_init(sketch, width, depth, capacity)) != 0)
+	{
+		return result;
+	}
+
+	sketch->total = buff2long(buff + 8);
+	p = buff + COUNT_MIN_HEADER_SIZE;
+	for (i=0; i<(int64_t)sketch->width * sketch->depth; i++)
+	{
+		sketch->counters[i] = buff2long(p);
+		p += 8;
+	}
+
+	end = sketch->top_k.entries + count;
+	for (entry=sketch->top_k.entries; entry<end; entry++)
+	{
+		entry->hash_code = (uint64_t)buff2long(p);
+		entry->count = buff2long(p + 8);
+		entry->key_len = buff2int(p + 16);
+		if (entry->key_len < 0 || entry->key_len > COUNT_MIN_KEY_SIZE)
+		{
+			logError("file: "__FILE__", line: %d, " \
+				"invalid key length: %d", __LINE__, entry->key_len);
+			count_min_destroy(sketch);
+			return EINVAL;
+		}
+		memcpy(entry->key, p + 20, entry->key_len);
+		p += COUNT_MIN_ENTRY_SIZE;
+	}
+	sketch->top_k.count = count;
+	return 0;
+}
+
+static int count_min_compare_entry(const void *p1, const void *p2)
+{
+	int64_t count1;
+	int64_t count2;
+
+	count1 = ((const CountMinEntry *)p1)->count;
+	count2 = ((const CountMinEntry *)p2)->count;
+	return count1 > count2 ? -1 : (count1 < count2 ? 1 : 0);
+}
+
+int count_min_top_k(CountMinSketch *sketch, CountMinEntry *entries, \
+		const int size)
+{
+	CountMinEntry *sorted;
+	int count;
+
+	if (sketch->top_k.count == 0)
+	{
+		return 0;
+	}
+
+	sorted = (CountMinEntry *)malloc(sizeof(CountMinEntry) * \
+			sketch->top_k.count);
+	if (sorted == NULL)
+	{
+		logError("file: "__FILE__", line: %d, " \
+			"malloc %d bytes fail", __LINE__, \
+			(int)sizeof(CountMinEntry) * sketch->top_k.count);
+		return 0;
+	}
+
+	memcpy(sorted, sketch->top_k.entries, sizeof(CountMinEntry) * \
+		sketch->top_k.count);
+	qsort(sorted, sketch->top_k.count, sizeof(CountMinEntry), \
+		count_min_compare_entry);
+	count = size < sketch->top_k.count ? size : sketch->top_k.count;
+	memcpy(entries, sorted, sizeof(CountMinEntry) * count);
+	free(sorted);
+	return count;
+}
@@ -0,0 +1,161 @@
+/**
+* Copyright (C) 2008 Happy Fish / YuQing
+*
+* FastDFS may be copied only under the terms of the GNU General
+* Public License V3, which may be found in the FastDFS source kit.
+* Please visit the FastDFS Home Page http://www.csource.org/ for more detail.
+**/
+
+/**
+  fixed size probabilistic counters for the stats of high cardinality keys:
+  HyperLogLog estimates the distinct key count, CountMinSketch estimates
+  the count of every key and tracks the top k keys.
+  the sketches are NOT thread safe, use one sketch per thread and merge
+  them, the sketches can be serialized to merge across nodes.
+*/
+
+#ifndef _HASH_SKETCH_H_
+#define _HASH_SKETCH_H_
+
+#include "common_define.h"
+
+#define HLL_MIN_PRECISION  4
+#define HLL_MAX_PRECISION  18
+#define HLL_DEFAULT_PRECISION  14  //16K registers, standard error 0.81%
+
+#define HLL_HEADER_SIZE  4  //the precision, big endian
+
+//the key longer than this is truncated in the top k entry
+#define COUNT_MIN_KEY_SIZE  64
+
+/* the serialized count-min sketch: the header of width (4), depth (4),
+   total (8), top k capacity (4) and count (4), then the counters and
+   the top k entries, all integers are big endian */
+#define COUNT_MIN_HEADER_SIZE  24
+
+//hash code (8), count (8), key length (4) and the key
+#define COUNT_MIN_ENTRY_SIZE  (20 + COUNT_MIN_KEY_SIZE)
+
+typedef struct tagHyperLogLog
+{
+	int precision;
+	int register_count;  //2 ^ precision
+	unsigned char *registers;
+} HyperLogLog;
+
+typedef struct tagCountMinEntry
+{
+	uint64_t hash_code;
+	int64_t count;  //the estimated count
+	int key_len;    //the stored key length
+	char key[COUNT_MIN_KEY_SIZE];
+} CountMinEntry;
+
+typedef struct tagCountMinSketch
+{
+	int width;
+	int depth;
+	int64_t total;  //the sum of all increments
+	int64_t *counters;  //depth rows of width counters
+	struct {
+		int capacity;  //the k
+		int count;
+		CountMinEntry *entries;  //min heap by the count
+	} top_k;
+} CountMinSketch;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * init the HyperLogLog
+ * parameters:
+ *         hll: the HyperLogLog
+ *         precision: the register count is 2 ^ precision, from
+ *                    HLL_MIN_PRECISION to HLL_MAX_PRECISION
+ * return 0 for success, != 0 fail (errno)
+*/
+int hll_init(HyperLogLog *hll, const int precision);
+void hll_destroy(HyperLogLog *hll);
+void hll_clear(HyperLogLog *hll);
+
+void hll_add(HyperLogLog *hll, const void *key, const int key_len);
+
+//return the estimated distinct count
+int64_t hll_count(HyperLogLog *hll);
+
+/**
+ * merge the source into the dest, the precisions must be same
+ * return 0 for success, != 0 fail (errno)
+*/
+int hll_merge(HyperLogLog *dest, const HyperLogLog *src);
+
+static inline int hll_serialize_size(HyperLogLog *hll)
+{
+	return HLL_HEADER_SIZE + hll->register_count;
+}
+
+//serialize to the buffer, return 0 for success, ENOSPC for buffer too small
+int hll_serialize(HyperLogLog *hll, char *buff, const int size);
+
+//init the HyperLogLog from the serialized buffer, return 0 for success
+int hll_deserialize(HyperLogLog *hll, const char *buff, const int size);
+
+/**
+ * init the count-min sketch, the error is total * e / width with the
+ * probability 1 - exp(-depth)
+ * parameters:
+ *         sketch: the sketch
+ *         width: the counter count of a row
+ *         depth: the row count
+ *         top_k: the top k keys to track, 0 for none
+ * return 0 for success, != 0 fail (errno)
+*/
+int count_min_init(CountMinSketch *sketch, const int width, \
+		const int depth, const int top_k);
+void count_min_destroy(CountMinSketch *sketch);
+void count_min_clear(CountMinSketch *sketch);
+
+//add the increment, return the estimated count of the key
+int64_t count_min_add(CountMinSketch *sketch, const void *key, \
+		const int key_len, const int64_t inc);
+
+int64_t count_min_estimate(CountMinSketch *sketch, const void *key, \
+		const int key_len);
+
+/**
+ * merge the source into the dest, the width and depth must be same
+ * return 0 for success, != 0 fail (errno)
+*/
+int count_min_merge(CountMinSketch *dest, const CountMinSketch *src);
+
+static inline int count_min_serialize_size(CountMinSketch *sketch)
+{
+	return COUNT_MIN_HEADER_SIZE + 8 * sketch->width * sketch->depth +
+		COUNT_MIN_ENTRY_SIZE * sketch->top_k.count;
+}
+
+//serialize to the buffer, return 0 for success, ENOSPC for buffer too small
+int count_min_serialize(CountMinSketch *sketch, char *buff, const int size);
+
+//init the sketch from the serialized buffer, return 0 for success
+int count_min_deserialize(CountMinSketch *sketch, const char *buff, \
+		const int size);
+
+/**
+ * get the top k entries order by the count desc
+ * parameters:
+ *         sketch: the sketch
+ *         entries: the entries array to store
+ *         size: the array size
+ * return the entry count
+*/
+int count_min_top_k(CountMinSketch *sketch, CountMinEntry *entries, \
+		const int size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
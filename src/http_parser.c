@@ -0,0 +1,737 @@
+/**
+* Copyright (C) 2008 Happy Fish / YuQing
+*
+* FastDFS may be copied only under the terms of the GNU General
+* Public License V3, which may be found in the FastDFS source kit.
+* Please visit the FastDFS Home Page http://www.csource.org/ for more detail.
+**/
+
+//http_parser.c
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#endif
+#include "http_parser.h"
+
+//the max length of the chunk size line include the chunk extension
+#define HTTP_PARSER_MAX_CHUNK_LINE  1024
+
+#define HTTP_CHAR_TOKEN  1  //the char of the method and the header name
+#define HTTP_CHAR_PATH   2  //the char of the request target
+#define HTTP_CHAR_VALUE  4  //the char of the header value and the reason
+
+/* the char types, TOKEN is the tchar of RFC 7230, PATH excludes the
+ * control chars and the space, VALUE adds the space and the tab */
+static const unsigned char http_char_types[256] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 4, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	4, 7, 6, 7, 7, 7, 7, 7, 6, 6, 7, 7, 6, 7, 7, 6,
+	7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 6, 6, 6, 6, 6, 6,
+	6, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+	7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 6, 6, 6, 7, 7,
+	7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+	7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 6, 7, 6, 7, 0,
+	6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+	6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+	6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+	6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+	6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+	6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+	6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+	6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+};
+
+#if defined(__SSE4_2__)
+/* the ranges of the chars NOT allowed, the scan stops at the first one,
+ * then check by the char table because the token ranges exclude more
+ * chars than RFC 7230 for the 16 bytes limit */
+static const char http_token_ranges[16] __attribute__((aligned(16))) =
+	"\x00 \"\"(),,//:@[]{\xff";
+static const char http_path_ranges[16] __attribute__((aligned(16))) =
+	"\x00 \x7f\x7f";
+static const char http_value_ranges[16] __attribute__((aligned(16))) =
+	"\x00\x08\x0a\x1f\x7f\x7f";
+
+static inline const char *http_scan_ranges(const char *p, const char *end,
+		const char *ranges, const int ranges_size)
+{
+	__m128i ranges16;
+	__m128i b16;
+	int index;
+
+	ranges16 = _mm_load_si128((const __m128i *)ranges);
+	while (end - p >= 16)
+	{
+		b16 = _mm_loadu_si128((const __m128i *)p);
+		index = _mm_cmpestri(ranges16, ranges_size, b16, 16,
+				_SIDD_LEAST_SIGNIFICANT | _SIDD_CMP_RANGES |
+				_SIDD_UBYTE_OPS);
+		if (index != 16)
+		{
+			return p + index;
+		}
+		p += 16;
+	}
+	return p;
+}
+
+#define HTTP_SCAN_RANGES(p, end, ranges, size) \
+	p = http_scan_ranges(p, end, ranges, size)
+#else
+#define HTTP_SCAN_RANGES(p, end, ranges, size)
+#endif
+
+/* scan the chars of the type, stop at the first char of other types,
+ * the data must end with '\n' which stops the scan */
+#define HTTP_SCAN_CHARS(p, end, ranges, size, type) \
+	do { \
+		while (1) \
+		{ \
+			HTTP_SCAN_RANGES(p, end, ranges, size); \
+			if ((http_char_types[(unsigned char)*p] & type) == 0) \
+			{ \
+				break; \
+			} \
+			p++; \
+		} \
+	} while (0)
+
+static inline const char *http_scan_token(const char *p, const char *end)
+{
+	HTTP_SCAN_CHARS(p, end, http_token_ranges, 16, HTTP_CHAR_TOKEN);
+	return p;
+}
+
+static inline const char *http_scan_path(const char *p, const char *end)
+{
+	HTTP_SCAN_CHARS(p, end, http_path_ranges, 4, HTTP_CHAR_PATH);
+	return p;
+}
+
+static inline const char *http_scan_value(const char *p, const char *end)
+{
+	HTTP_SCAN_CHARS(p, end, http_value_ranges, 6, HTTP_CHAR_VALUE);
+	return p;
+}
+
+void http_parser_init(HttpParser *parser, const int type,
+		const int max_header_size)
+{
+	parser->type = type;
+	parser->offset = 0;
+	parser->max_header_size = max_header_size > 0 ? max_header_size :
+		HTTP_PARSER_DEFAULT_MAX_HEADER_SIZE;
+	http_parser_reset(parser);
+}
+
+void http_parser_reset(HttpParser *parser)
+{
+	parser->state = HTTP_PARSER_STATE_HEADER;
+	parser->scan_offset = parser->offset;
+	parser->minor_version = 0;
+	parser->status = 0;
+	parser->method.offset = parser->method.length = 0;
+	parser->path.offset = parser->path.length = 0;
+	parser->reason.offset = parser->reason.length = 0;
+	parser->header_count = 0;
+	parser->content_length = -1;
+	parser->remain_bytes = 0;
+	parser->chunked = false;
+	parser->keep_alive = false;
+}
+
+static inline void http_set_slice(HttpSlice *slice, const char *buff,
+		const char *start, const char *end)
+{
+	slice->offset = start - buff;
+	slice->length = end - start;
+}
+
+//skip CRLF or LF, return NULL for invalid
+static inline const char *http_skip_eol(const char *p)
+{
+	if (*p == '\r')
+	{
+		p++;
+	}
+	return *p == '\n' ? p + 1 : NULL;
+}
+
+static inline const char *http_parse_version(const char *p,
+		const char *end, int *minor_version)
+{
+	if (end - p < 9 || memcmp(p, "HTTP/1.", 7) != 0 ||
+		p[7] < '0' || p[7] > '9')
+	{
+		return NULL;
+	}
+	*minor_version = p[7] - '0';
+	return p + 8;
+}
+
+static const char *http_parse_request_line(HttpParser *parser,
+		const char *buff, const char *p, const char *end)
+{
+	const char *start;
+
+	start = p;
+	p = http_scan_token(p, end);
+	if (p == start || *p != ' ')
+	{
+		return NULL;
+	}
+	http_set_slice(&parser->method, buff, start, p);
+
+	start = ++p;
+	p = http_scan_path(p, end);
+	if (p == start || *p != ' ')
+	{
+		return NULL;
+	}
+	http_set_slice(&parser->path, buff, start, p);
+
+	if ((p=http_parse_version(p + 1, end, &parser->minor_version)) == NULL)
+	{
+		return NULL;
+	}
+	return http_skip_eol(p);
+}
+
+static const char *http_parse_status_line(HttpParser *parser,
+		const char *buff, const char *p, const char *end)
+{
+	const char *start;
+
+	if ((p=http_parse_version(p, end, &parser->minor_version)) == NULL)
+	{
+		return NULL;
+	}
+
+	//HTTP/1.1 200 OK
+	if (end - p < 5 || *p != ' ' || p[1] < '0' || p[1] > '9' ||
+		p[2] < '0' || p[2] > '9' || p[3] < '0' || p[3] > '9')
+	{
+		return NULL;
+	}
+	parser->status = (p[1] - '0') * 100 + (p[2] - '0') * 10 + (p[3] - '0');
+	p += 4;
+
+	if (*p == ' ')
+	{
+		start = ++p;
+		p = http_scan_value(p, end);
+		http_set_slice(&parser->reason, buff, start, p);
+	}
+	else
+	{
+		parser->reason.offset = p - buff;
+	}
+	return http_skip_eol(p);
+}
+
+static inline bool http_slice_equals(const char *buff, const HttpSlice *slice,
+		const char *str, const int len)
+{
+	return slice->length == len && strncasecmp(buff + slice->offset,
+			str, len) == 0;
+}
+
+//if the comma separated value contains the token, case insensitive
+static bool http_value_contains(const char *value, const int value_len,
+		const char *token, const int token_len)
+{
+	const char *p;
+	const char *end;
+	const char *item;
+	const char *item_end;
+
+	p = value;
+	end = value + value_len;
+	while (p < end)
+	{
+		while (p < end && (*p == ' ' || *p == '\t' || *p == ','))
+		{
+			p++;
+		}
+		item = p;
+		while (p < end && *p != ',')
+		{
+			p++;
+		}
+		item_end = p;
+		while (item_end > item && (*(item_end - 1) == ' ' ||
+			*(item_end - 1) == '\t'))
+		{
+			item_end--;
+		}
+		if (item_end - item == token_len &&
+			strncasecmp(item, token, token_len) == 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+static int http_parse_content_length(HttpParser *parser, const char *value,
+		const int value_len)
+{
+	const char *p;
+	const char *end;
+	int64_t content_length;
+
+	if (value_len == 0 || value_len > 18)
+	{
+		return EPROTO;
+	}
+
+	content_length = 0;
+	end = value + value_len;
+	for (p=value; p<end; p++)
+	{
+		if (*p < '0' || *p > '9')
+		{
+			return EPROTO;
+		}
+		content_length = content_length * 10 + (*p - '0');
+	}
+
+	//the different duplicate values is the request smuggling
+	if (parser->content_length >= 0 &&
+		parser->content_length != content_length)
+	{
+		return EPROTO;
+	}
+	parser->content_length = content_length;
+	return 0;
+}
+
+static int http_check_header(HttpParser *parser, const char *buff,
+		const HttpHeaderSlice *header)
+{
+	const char *value;
+
+	value = buff + header->value.offset;
+	switch (header->name.length)
+	{
+		case 14:
+			if (http_slice_equals(buff, &header->name,
+						"Content-Length", 14))
+			{
+				return http_parse_content_length(parser, value,
+						header->value.length);
+			}
+			break;
+		case 17:
+			if (http_slice_equals(buff, &header->name,
+						"Transfer-Encoding", 17))
+			{
+				parser->chunked = http_value_contains(value,
+						header->value.length, "chunked", 7);
+			}
+			break;
+		case 10:
+			if (http_slice_equals(buff, &header->name, "Connection", 10))
+			{
+				if (http_value_contains(value, header->value.length,
+							"close", 5))
+				{
+					parser->keep_alive = false;
+				}
+				else if (http_value_contains(value, header->value.length,
+							"keep-alive", 10))
+				{
+					parser->keep_alive = true;
+				}
+			}
+			break;
+		default:
+			break;
+	}
+	return 0;
+}
+
+//parse the header lines until the empty line
+static int http_parse_header_lines(HttpParser *parser, const char *buff,
+		const char *p, const char *end)
+{
+	HttpHeaderSlice *header;
+	const char *start;
+	const char *value_end;
+	int result;
+
+	while (1)
+	{
+		if (*p == '\r' || *p == '\n')  //the empty line
+		{
+			return http_skip_eol(p) == end ? 0 : EPROTO;
+		}
+
+		if (parser->header_count >= HTTP_PARSER_MAX_HEADER_COUNT)
+		{
+			return EOVERFLOW;
+		}
+		header = parser->headers + parser->header_count;
+
+		//the obs-fold of the line starts with space is rejected
+		start = p;
+		p = http_scan_token(p, end);
+		if (p == start || *p != ':')
+		{
+			return EPROTO;
+		}
+		http_set_slice(&header->name, buff, start, p);
+
+		p++;
+		while (*p == ' ' || *p == '\t')
+		{
+			p++;
+		}
+		start = p;
+		p = http_scan_value(p, end);
+		value_end = p;
+		while (value_end > start && (*(value_end - 1) == ' ' ||
+			*(value_end - 1) == '\t'))
+		{
+			value_end--;
+		}
+		http_set_slice(&header->value, buff, start, value_end);
+		if ((p=http_skip_eol(p)) == NULL)
+		{
+			return EPROTO;
+		}
+
+		parser->header_count++;
+		if ((result=http_check_header(parser, buff, header)) != 0)
+		{
+			return result;
+		}
+	}
+}
+
+/* find the end of the headers from the scan offset,
+ * return the header end, NULL for more data */
+static const char *http_find_header_end(HttpParser *parser,
+		const char *buff, const int length)
+{
+	const char *p;
+	const char *end;
+	const char *lf;
+
+	p = buff + parser->scan_offset;
+	end = buff + length;
+	while ((lf=(const char *)memchr(p, '\n', end - p)) != NULL)
+	{
+		p = lf + 1;
+		if (p < end && *p == '\r')
+		{
+			p++;
+		}
+		if (p == end)
+		{
+			break;
+		}
+		if (*p == '\n')
+		{
+			return p + 1;
+		}
+	}
+
+	//scan from the last LF for the next time
+	parser->scan_offset = (lf != NULL ? lf : end) - buff;
+	return NULL;
+}
+
+static void http_set_body_state(HttpParser *parser)
+{
+	if (parser->type == HTTP_PARSER_TYPE_RESPONSE && (parser->status < 200 ||
+		parser->status == 204 || parser->status == 304))
+	{
+		parser->state = HTTP_PARSER_STATE_DONE;
+	}
+	else if (parser->chunked)
+	{
+		parser->state = HTTP_PARSER_STATE_CHUNK_SIZE;
+	}
+	else if (parser->content_length > 0)
+	{
+		parser->remain_bytes = parser->content_length;
+		parser->state = HTTP_PARSER_STATE_BODY;
+	}
+	else if (parser->content_length == 0 ||
+		parser->type == HTTP_PARSER_TYPE_REQUEST)
+	{
+		parser->state = HTTP_PARSER_STATE_DONE;
+	}
+	else
+	{
+		parser->keep_alive = false;
+		parser->state = HTTP_PARSER_STATE_BODY_EOF;
+	}
+}
+
+int http_parser_parse_headers(HttpParser *parser, const char *buff,
+		const int length)
+{
+	const char *start;
+	const char *end;
+	const char *p;
+	int result;
+
+	if (parser->state != HTTP_PARSER_STATE_HEADER)
+	{
+		return 0;
+	}
+
+	//skip the empty lines before the request line
+	if (parser->type == HTTP_PARSER_TYPE_REQUEST)
+	{
+		while (parser->offset < length && (buff[parser->offset] == '\r'
+			|| buff[parser->offset] == '\n'))
+		{
+			parser->offset++;
+		}
+		if (parser->scan_offset < parser->offset)
+		{
+			parser->scan_offset = parser->offset;
+		}
+	}
+
+	start = buff + parser->offset;
+	if ((end=http_find_header_end(parser, buff, length)) == NULL)
+	{
+		return (length - parser->offset > parser->max_header_size) ?
+			EOVERFLOW : EAGAIN;
+	}
+	if (end - start > parser->max_header_size)
+	{
+		return EOVERFLOW;
+	}
+
+	if (parser->type == HTTP_PARSER_TYPE_REQUEST)
+	{
+		p = http_parse_request_line(parser, buff, start, end);
+	}
+	else
+	{
+		p = http_parse_status_line(parser, buff, start, end);
+	}
+	if (p == NULL)
+	{
+		return EPROTO;
+	}
+
+	parser->keep_alive = parser->minor_version >= 1;
+	if ((result=http_parse_header_lines(parser, buff, p, end)) != 0)
+	{
+		return result;
+	}
+
+	parser->offset = end - buff;
+	parser->scan_offset = parser->offset;
+	http_set_body_state(parser);
+	return 0;
+}
+
+//find the LF from the offset, return the line length include the LF
+static inline int http_get_line(HttpParser *parser, const char *buff,
+		const int length)
+{
+	const char *lf;
+
+	lf = (const char *)memchr(buff + parser->offset, '\n',
+			length - parser->offset);
+	return lf != NULL ? (lf + 1) - (buff + parser->offset) : 0;
+}
+
+static int http_parse_chunk_size(HttpParser *parser, const char *buff,
+		const int line_len)
+{
+	const char *p;
+	const char *end;
+	int64_t size;
+	int digit;
+
+	size = 0;
+	p = buff + parser->offset;
+	end = p + line_len - 1;  //the LF
+	for (; p<end; p++)
+	{
+		if (*p >= '0' && *p <= '9')
+		{
+			digit = *p - '0';
+		}
+		else if (*p >= 'a' && *p <= 'f')
+		{
+			digit = *p - 'a' + 10;
+		}
+		else if (*p >= 'A' && *p <= 'F')
+		{
+			digit = *p - 'A' + 10;
+		}
+		else
+		{
+			break;
+		}
+
+		if (size >= ((int64_t)1 << 59))
+		{
+			return EPROTO;
+		}
+		size = (size << 4) | digit;
+	}
+
+	if (p == buff + parser->offset)
+	{
+		return EPROTO;
+	}
+	//the chunk extension after ';' is ignored
+	if (p < end && *p != ';' && *p != ' ' && *p != '\t' && *p != '\r')
+	{
+		return EPROTO;
+	}
+
+	parser->offset += line_len;
+	if (size == 0)
+	{
+		parser->state = HTTP_PARSER_STATE_TRAILER;
+	}
+	else
+	{
+		parser->remain_bytes = size;
+		parser->state = HTTP_PARSER_STATE_CHUNK_DATA;
+	}
+	return 0;
+}
+
+int http_parser_parse_body(HttpParser *parser, const char *buff,
+		const int length, HttpSlice *slice)
+{
+	int avail;
+	int line_len;
+	int result;
+
+	while (1)
+	{
+		avail = length - parser->offset;
+		switch (parser->state)
+		{
+			case HTTP_PARSER_STATE_BODY:
+			case HTTP_PARSER_STATE_CHUNK_DATA:
+				if (avail <= 0)
+				{
+					return EAGAIN;
+				}
+				slice->offset = parser->offset;
+				slice->length = (avail < parser->remain_bytes) ?
+					avail : parser->remain_bytes;
+				parser->offset += slice->length;
+				parser->remain_bytes -= slice->length;
+				if (parser->remain_bytes == 0)
+				{
+					parser->state = (parser->state ==
+							HTTP_PARSER_STATE_BODY) ?
+						HTTP_PARSER_STATE_DONE :
+						HTTP_PARSER_STATE_CHUNK_END;
+				}
+				return 0;
+			case HTTP_PARSER_STATE_BODY_EOF:
+				if (avail <= 0)
+				{
+					return EAGAIN;
+				}
+				slice->offset = parser->offset;
+				slice->length = avail;
+				parser->offset = length;
+				return 0;
+			case HTTP_PARSER_STATE_CHUNK_SIZE:
+				if ((line_len=http_get_line(parser, buff, length)) == 0)
+				{
+					return avail > HTTP_PARSER_MAX_CHUNK_LINE ?
+						EPROTO : EAGAIN;
+				}
+				if ((result=http_parse_chunk_size(parser,
+								buff, line_len)) != 0)
+				{
+					return result;
+				}
+				break;
+			case HTTP_PARSER_STATE_CHUNK_END:
+				if (avail < 1 || (buff[parser->offset] == '\r' &&
+					avail < 2))
+				{
+					return EAGAIN;
+				}
+				if (buff[parser->offset] == '\r')
+				{
+					parser->offset++;
+				}
+				if (buff[parser->offset] != '\n')
+				{
+					return EPROTO;
+				}
+				parser->offset++;
+				parser->state = HTTP_PARSER_STATE_CHUNK_SIZE;
+				break;
+			case HTTP_PARSER_STATE_TRAILER:
+				//the trailer fields are skipped
+				if ((line_len=http_get_line(parser, buff, length)) == 0)
+				{
+					return avail > parser->max_header_size ?
+						EOVERFLOW : EAGAIN;
+				}
+				if (line_len == 1 || (line_len == 2 &&
+					buff[parser->offset] == '\r'))
+				{
+					parser->state = HTTP_PARSER_STATE_DONE;
+				}
+				parser->offset += line_len;
+				break;
+			case HTTP_PARSER_STATE_DONE:
+				return ENOENT;
+			default:
+				return EINVAL;
+		}
+	}
+}
+
+int http_parser_find_header(const HttpParser *parser, const char *buff,
+		const char *name, HttpSlice *value)
+{
+	const HttpHeaderSlice *header;
+	const HttpHeaderSlice *end;
+	int name_len;
+
+	name_len = strlen(name);
+	end = parser->headers + parser->header_count;
+	for (header=parser->headers; header<end; header++)
+	{
+		if (http_slice_equals(buff, &header->name, name, name_len))
+		{
+			*value = header->value;
+			return 0;
+		}
+	}
+	return ENOENT;
+}
+
+void http_parser_shift(HttpParser *parser, const int bytes)
+{
+	int i;
+
+	parser->offset -= bytes;
+	parser->scan_offset -= bytes;
+	parser->method.offset -= bytes;
+	parser->path.offset -= bytes;
+	parser->reason.offset -= bytes;
+	for (i=0; i<parser->header_count; i++)
+	{
+		parser->headers[i].name.offset -= bytes;
+		parser->headers[i].value.offset -= bytes;
+	}
+}
@@ -0,0 +1,186 @@
+/**
+* Copyright (C) 2008 Happy Fish / YuQing
+*
+* FastDFS may be copied only under the terms of the GNU General
+* Public License V3, which may be found in the FastDFS source kit.
+* Please visit the FastDFS Home Page http://www.csource.org/ for more detail.
+**/
+
+//http_parser.h
+
+/**
+  the incremental and zero copy HTTP/1.x request / response parser.
+  the parser does NOT copy nor modify the data, the method, path, headers
+  and body are emitted as the slices (offset and length) of the receive
+  buffer such as fast_task_info.data, so the slices are still valid after
+  the buffer is realloced for the larger message.
+  the data is appended to the buffer by the caller and parsed again
+  after each read, the scanned data is NOT scanned again for the header
+  end. the tokens are scanned by SSE4.2 when the compiler enables it.
+*/
+
+#ifndef _HTTP_PARSER_H
+#define _HTTP_PARSER_H
+
+#include "common_define.h"
+#include "fast_task_queue.h"
+
+#define HTTP_PARSER_TYPE_REQUEST   0
+#define HTTP_PARSER_TYPE_RESPONSE  1
+
+#define HTTP_PARSER_STATE_HEADER      0
+#define HTTP_PARSER_STATE_BODY        1  //by the content length
+#define HTTP_PARSER_STATE_BODY_EOF    2  //until the connection closed
+#define HTTP_PARSER_STATE_CHUNK_SIZE  3
+#define HTTP_PARSER_STATE_CHUNK_DATA  4
+#define HTTP_PARSER_STATE_CHUNK_END   5  //the CRLF after the chunk data
+#define HTTP_PARSER_STATE_TRAILER     6
+#define HTTP_PARSER_STATE_DONE        7  //the message is complete
+
+#define HTTP_PARSER_MAX_HEADER_COUNT  64
+#define HTTP_PARSER_DEFAULT_MAX_HEADER_SIZE  (16 * 1024)
+
+typedef struct http_slice
+{
+	int offset;  //the offset of the buffer
+	int length;
+} HttpSlice;
+
+typedef struct http_header_slice
+{
+	HttpSlice name;
+	HttpSlice value;  //the spaces around are trimmed
+} HttpHeaderSlice;
+
+typedef struct http_parser
+{
+	int type;    //HTTP_PARSER_TYPE_REQUEST or HTTP_PARSER_TYPE_RESPONSE
+	int state;   //HTTP_PARSER_STATE_xxx
+	int offset;  //the parsed offset of the buffer
+	int scan_offset;  //the offset to continue the header end scan
+	int max_header_size;
+
+	int minor_version;  //1 for HTTP/1.1
+	int status;         //the status code of the response
+	HttpSlice method;   //for the request
+	HttpSlice path;     //for the request, include the query string
+	HttpSlice reason;   //for the response
+	int header_count;
+	HttpHeaderSlice headers[HTTP_PARSER_MAX_HEADER_COUNT];
+
+	int64_t content_length;  //-1 for unknown
+	int64_t remain_bytes;    //of the body or the chunk
+	bool chunked;
+	bool keep_alive;
+} HttpParser;
+
+#define HTTP_SLICE_PTR(buff, slice)  ((buff) + (slice).offset)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+*   init function
+*   parameters:
+*      parser: the HttpParser
+*      type: HTTP_PARSER_TYPE_REQUEST or HTTP_PARSER_TYPE_RESPONSE
+*      max_header_size: the max size of the start line and the headers,
+*                       <= 0 for HTTP_PARSER_DEFAULT_MAX_HEADER_SIZE
+*   return none
+*/
+void http_parser_init(HttpParser *parser, const int type,
+		const int max_header_size);
+
+/**
+*   reset the parser for the next message of the keep-alive connection,
+*   the parsed offset is kept for the pipelined messages
+*   parameters:
+*      parser: the HttpParser
+*   return none
+*/
+void http_parser_reset(HttpParser *parser);
+
+/**
+*   parse the start line and the headers
+*   parameters:
+*      parser: the HttpParser
+*      buff: the receive buffer
+*      length: the data length of the buffer
+*   return 0 for the headers complete, parser->offset is the body start,
+*          EAGAIN for more data,
+*          EOVERFLOW for the headers too large or too many,
+*          EPROTO for the invalid message
+*/
+int http_parser_parse_headers(HttpParser *parser, const char *buff,
+		const int length);
+
+/**
+*   get the next piece of the body, the chunked body is decoded,
+*   should be called after the headers complete
+*   parameters:
+*      parser: the HttpParser
+*      buff: the receive buffer
+*      length: the data length of the buffer
+*      slice: return the body slice
+*   return 0 for the body slice,
+*          ENOENT for the message complete,
+*          EAGAIN for more data,
+*          EOVERFLOW for the trailer too large,
+*          EPROTO for the invalid chunk
+*/
+int http_parser_parse_body(HttpParser *parser, const char *buff,
+		const int length, HttpSlice *slice);
+
+/**
+*   find the header by the name, case insensitive
+*   parameters:
+*      parser: the HttpParser
+*      buff: the receive buffer
+*      name: the header name
+*      value: return the header value
+*   return 0 for found, ENOENT for not found
+*/
+int http_parser_find_header(const HttpParser *parser, const char *buff,
+		const char *name, HttpSlice *value);
+
+/**
+*   the bytes before parser->offset are dropped from the buffer front
+*   by the caller, adjust the slices
+*   parameters:
+*      parser: the HttpParser
+*      bytes: the dropped bytes, must <= parser->offset
+*   return none
+*/
+void http_parser_shift(HttpParser *parser, const int bytes);
+
+//the response of HEAD has no body
+static inline void http_parser_skip_body(HttpParser *parser)
+{
+	parser->state = HTTP_PARSER_STATE_DONE;
+}
+
+static inline bool http_parser_is_done(const HttpParser *parser)
+{
+	return parser->state == HTTP_PARSER_STATE_DONE;
+}
+
+//the received data of the task is [data, data + offset)
+static inline int http_parser_parse_task_headers(HttpParser *parser,
+		struct fast_task_info *pTask)
+{
+	return http_parser_parse_headers(parser, pTask->data, pTask->offset);
+}
+
+static inline int http_parser_parse_task_body(HttpParser *parser,
+		struct fast_task_info *pTask, HttpSlice *slice)
+{
+	return http_parser_parse_body(parser, pTask->data,
+			pTask->offset, slice);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -185,3 +185,26 @@ int ioevent_set(struct fast_task_info *pTask, struct nio_thread_data *pThread,
 	return 0;
 }
 
+
+int ioevent_reap_zerocopy(TCPZeroCopyContext *ctx, const int event)
+{
+	if ((event & IOEVENT_ERROR) == 0)
+	{
+		return event;
+	}
+
+	/* the pending socket error (SO_ERROR) keeps the error event, so it
+	 * will be reported again by the next poll when cleared here */
+	if (tcpzerocopy_reap(ctx) <= 0)
+	{
+		return event;
+	}
+
+#if IOEVENT_USE_EPOLL
+	if ((event & EPOLLHUP) != 0)
+	{
+		return event;
+	}
+#endif
+	return event & (~IOEVENT_ERROR);
+}
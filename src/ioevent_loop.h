@@ -2,6 +2,7 @@
 #define _IOEVENT_LOOP_H
 
 #include "fast_task_queue.h"
+#include "sockopt.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -17,6 +18,12 @@ int ioevent_remove(IOEventPoller *ioevent, void *data);
 int ioevent_set(struct fast_task_info *pTask, struct nio_thread_data *pThread,
 	int sock, short event, IOEventCallback callback, const int timeout);
 
+/* reap the MSG_ZEROCOPY completions in the IOEventCallback, the kernel
+ * notifies the completions by the socket error queue as IOEVENT_ERROR.
+ * return the event without IOEVENT_ERROR when the error event is the
+ * zero copy completion only, the done callback of ctx is called */
+int ioevent_reap_zerocopy(TCPZeroCopyContext *ctx, const int event);
+
 #ifdef __cplusplus
 }
 #endif
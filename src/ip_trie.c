@@ -0,0 +1,323 @@
+/**
+* Copyright (C) 2008 Happy Fish / YuQing
+*
+* FastDFS may be copied only under the terms of the GNU General
+* Public License V3, which may be found in the FastDFS source kit.
+* Please visit the FastDFS Home Page http://www.csource.org/ for more detail.
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <arpa/inet.h>
+#include "logger.h"
+#include "ip_trie.h"
+
+#define IP_TRIE_BIT(key, index) \
+	(((key)[(index) / 8] >> (7 - (index) % 8)) & 1)
+
+void ip_trie_init(IPTrie *trie)
+{
+	trie->ipv4_root = NULL;
+	trie->ipv6_root = NULL;
+	trie->count = 0;
+}
+
+static void ip_trie_free_node(IPTrieNode *node)
+{
+	if (node == NULL)
+	{
+		return;
+	}
+
+	ip_trie_free_node(node->children[0]);
+	ip_trie_free_node(node->children[1]);
+	free(node);
+}
+
+void ip_trie_destroy(IPTrie *trie)
+{
+	ip_trie_free_node(trie->ipv4_root);
+	ip_trie_free_node(trie->ipv6_root);
+	ip_trie_init(trie);
+}
+
+static inline int ip_trie_get_root(IPTrie *trie, const int family, \
+		IPTrieNode ***root, int *addr_bits)
+{
+	if (family == AF_INET)
+	{
+		*root = &trie->ipv4_root;
+		*addr_bits = 32;
+	}
+	else if (family == AF_INET6)
+	{
+		*root = &trie->ipv6_root;
+		*addr_bits = 128;
+	}
+	else
+	{
+		return EAFNOSUPPORT;
+	}
+
+	return 0;
+}
+
+//the bit count of the common prefix, max_bits at most
+static int ip_trie_common_bits(const unsigned char *key1, \
+		const unsigned char *key2, const int max_bits)
+{
+	int bytes;
+	int bits;
+	unsigned char diff;
+
+	bytes = 0;
+	while (bytes * 8 < max_bits && key1[bytes] == key2[bytes])
+	{
+		bytes++;
+	}
+	if (bytes * 8 >= max_bits)
+	{
+		return max_bits;
+	}
+
+	diff = key1[bytes] ^ key2[bytes];
+	bits = bytes * 8 + __builtin_clz((unsigned int)diff) - \
+		(int)(sizeof(unsigned int) - 1) * 8;
+	return bits < max_bits ? bits : max_bits;
+}
+
+static IPTrieNode *ip_trie_alloc_node(const unsigned char *key, \
+		const int prefix_len)
+{
+	IPTrieNode *node;
+	int bytes;
+
+	node = (IPTrieNode *)malloc(sizeof(IPTrieNode));
+	if (node == NULL)
+	{
+		logError("file: "__FILE__", line: %d, " \
+			"malloc %d bytes fail", __LINE__, \
+			(int)sizeof(IPTrieNode));
+		return NULL;
+	}
+
+	memset(node, 0, sizeof(IPTrieNode));
+	bytes = prefix_len / 8;
+	memcpy(node->prefix, key, bytes);
+	if (prefix_len % 8 != 0)
+	{
+		node->prefix[bytes] = key[bytes] & \
+			(unsigned char)(0xFF << (8 - prefix_len % 8));
+	}
+	node->prefix_len = prefix_len;
+	return node;
+}
+
+static void ip_trie_set_value(IPTrie *trie, IPTrieNode *node, void *data)
+{
+	if (!node->has_value)
+	{
+		node->has_value = true;
+		trie->count++;
+	}
+	node->data = data;
+}
+
+int ip_trie_insert(IPTrie *trie, const int family, const void *addr, \
+		const int prefix_len, void *data)
+{
+	IPTrieNode **link;
+	IPTrieNode *node;
+	IPTrieNode *split;
+	IPTrieNode *leaf;
+	const unsigned char *key;
+	int addr_bits;
+	int common;
+	int result;
+
+	if ((result=ip_trie_get_root(trie, family, &link, &addr_bits)) != 0)
+	{
+		logError("file: "__FILE__", line: %d, " \
+			"unsupported address family: %d", __LINE__, family);
+		return result;
+	}
+	if (prefix_len < 0 || prefix_len > addr_bits)
+	{
+		logError("file: "__FILE__", line: %d, " \
+			"invalid prefix length: %d, should be in [0, %d]", \
+			__LINE__, prefix_len, addr_bits);
+		return EINVAL;
+	}
+
+	key = (const unsigned char *)addr;
+	while ((node=*link) != NULL)
+	{
+		common = ip_trie_common_bits(node->prefix, key, \
+			node->prefix_len < prefix_len ? \
+			node->prefix_len : prefix_len);
+		if (common < node->prefix_len)
+		{
+			//split the node at the common bits
+			if ((split=ip_trie_alloc_node(key, common)) == NULL)
+			{
+				return ENOMEM;
+			}
+			if (common < prefix_len)
+			{
+				if ((leaf=ip_trie_alloc_node(key, prefix_len)) == NULL)
+				{
+					free(split);
+					return ENOMEM;
+				}
+				split->children[IP_TRIE_BIT(key, common)] = leaf;
+				ip_trie_set_value(trie, leaf, data);
+			}
+			else
+			{
+				ip_trie_set_value(trie, split, data);
+			}
+
+			split->children[IP_TRIE_BIT(node->prefix, common)] = node;
+			*link = split;
+			return 0;
+		}
+
+		if (node->prefix_len == prefix_len)
+		{
+			ip_trie_set_value(trie, node, data);
+			return 0;
+		}
+		link = &node->children[IP_TRIE_BIT(key, node->prefix_len)];
+	}
+
+	if ((leaf=ip_trie_alloc_node(key, prefix_len)) == NULL)
+	{
+		return ENOMEM;
+	}
+	ip_trie_set_value(trie, leaf, data);
+	*link = leaf;
+	return 0;
+}
+
+int ip_trie_insert_cidr(IPTrie *trie, const char *cidr, void *data)
+{
+	char ip_part[INET6_ADDRSTRLEN];
+	unsigned char addr[IP_TRIE_MAX_ADDR_BYTES];
+	const char *pSlash;
+	char *pEnd;
+	int ip_len;
+	int family;
+	int prefix_len;
+
+	pSlash = strchr(cidr, '/');
+	ip_len = (pSlash != NULL) ? pSlash - cidr : (int)strlen(cidr);
+	if (ip_len == 0 || ip_len >= (int)sizeof(ip_part))
+	{
+		logError("file: "__FILE__", line: %d, " \
+			"invalid ip address: %s", __LINE__, cidr);
+		return EINVAL;
+	}
+	memcpy(ip_part, cidr, ip_len);
+	*(ip_part + ip_len) = '\0';
+
+	family = (strchr(ip_part, ':') != NULL) ? AF_INET6 : AF_INET;
+	if (inet_pton(family, ip_part, addr) != 1)
+	{
+		logError("file: "__FILE__", line: %d, " \
+			"ip address: %s, invalid ip part: %s", \
+			__LINE__, cidr, ip_part);
+		return EINVAL;
+	}
+
+	if (pSlash == NULL)
+	{
+		prefix_len = (family == AF_INET) ? 32 : 128;
+	}
+	else
+	{
+		prefix_len = strtol(pSlash + 1, &pEnd, 10);
+		if (pEnd == pSlash + 1 || *pEnd != '\0')
+		{
+			logError("file: "__FILE__", line: %d, " \
+				"ip address: %s, invalid network bits: %s", \
+				__LINE__, cidr, pSlash + 1);
+			return EINVAL;
+		}
+	}
+
+	return ip_trie_insert(trie, family, addr, prefix_len, data);
+}
+
+//if the key matches the prefix of the node
+static inline bool ip_trie_match_prefix(const IPTrieNode *node, \
+		const unsigned char *key)
+{
+	int bytes;
+	int bits;
+
+	bytes = node->prefix_len / 8;
+	if (memcmp(node->prefix, key, bytes) != 0)
+	{
+		return false;
+	}
+
+	bits = node->prefix_len % 8;
+	return bits == 0 || node->prefix[bytes] == (key[bytes] & \
+			(unsigned char)(0xFF << (8 - bits)));
+}
+
+IPTrieNode *ip_trie_lookup(IPTrie *trie, const int family, const void *addr)
+{
+	IPTrieNode **root;
+	IPTrieNode *node;
+	IPTrieNode *found;
+	const unsigned char *key;
+	int addr_bits;
+
+	if (ip_trie_get_root(trie, family, &root, &addr_bits) != 0)
+	{
+		return NULL;
+	}
+
+	key = (const unsigned char *)addr;
+	found = NULL;
+	node = *root;
+	while (node != NULL && ip_trie_match_prefix(node, key))
+	{
+		if (node->has_value)
+		{
+			found = node;
+		}
+		if (node->prefix_len == addr_bits)
+		{
+			break;
+		}
+		node = node->children[IP_TRIE_BIT(key, node->prefix_len)];
+	}
+
+	return found;
+}
+
+IPTrieNode *ip_trie_lookup_sockaddr(IPTrie *trie, const struct sockaddr *addr)
+{
+	const struct in6_addr *addr6;
+
+	if (addr->sa_family == AF_INET)
+	{
+		return ip_trie_lookup(trie, AF_INET,
+				&((const struct sockaddr_in *)addr)->sin_addr);
+	}
+	else if (addr->sa_family == AF_INET6)
+	{
+		addr6 = &((const struct sockaddr_in6 *)addr)->sin6_addr;
+		if (IN6_IS_ADDR_V4MAPPED(addr6))
+		{
+			return ip_trie_lookup(trie, AF_INET, addr6->s6_addr + 12);
+		}
+		return ip_trie_lookup(trie, AF_INET6, addr6);
+	}
+
+	return NULL;
+}
@@ -0,0 +1,102 @@
+/**
+* Copyright (C) 2008 Happy Fish / YuQing
+*
+* FastDFS may be copied only under the terms of the GNU General
+* Public License V3, which may be found in the FastDFS source kit.
+* Please visit the FastDFS Home Page http://www.csource.org/ for more detail.
+**/
+
+/**
+  path compressed binary radix (Patricia) trie of the IPv4 and IPv6
+  prefixes for the longest prefix match, such as the allow hosts.
+  the lookup is O(address bits) regardless of the prefix count, and
+  a CIDR block is one node without expanding to the addresses.
+  the trie is NOT thread safe for insert, the lookup is read only.
+*/
+
+#ifndef _IP_TRIE_H_
+#define _IP_TRIE_H_
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include "common_define.h"
+
+#define IP_TRIE_MAX_ADDR_BYTES  16  //IPv6 address
+
+typedef struct ip_trie_node
+{
+	unsigned char prefix[IP_TRIE_MAX_ADDR_BYTES];  //the bits after prefix_len are 0
+	short prefix_len;  //in bits
+	bool has_value;    //false for the branch node created by split
+	void *data;
+	struct ip_trie_node *children[2];
+} IPTrieNode;
+
+typedef struct ip_trie
+{
+	IPTrieNode *ipv4_root;
+	IPTrieNode *ipv6_root;
+	int count;  //the prefix count
+} IPTrie;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void ip_trie_init(IPTrie *trie);
+void ip_trie_destroy(IPTrie *trie);
+
+/**
+ * insert the prefix, replace the data when the prefix exists
+ * parameters:
+ *         trie: the trie
+ *         family: AF_INET or AF_INET6
+ *         addr: the address in network order, struct in_addr or in6_addr
+ *         prefix_len: the prefix bits, 0 to 32 for IPv4, 0 to 128 for IPv6
+ *         data: the data of the prefix
+ * return 0 for success, != 0 fail (errno)
+*/
+int ip_trie_insert(IPTrie *trie, const int family, const void *addr, \
+		const int prefix_len, void *data);
+
+/**
+ * insert the prefix by the string, such as 192.168.0.0/16, 10.0.0.1,
+ * fe80::/10 or ::1, the prefix length is the full bits without "/"
+ * return 0 for success, != 0 fail (errno)
+*/
+int ip_trie_insert_cidr(IPTrie *trie, const char *cidr, void *data);
+
+/**
+ * longest prefix match
+ * parameters:
+ *         trie: the trie
+ *         family: AF_INET or AF_INET6
+ *         addr: the address in network order, struct in_addr or in6_addr
+ * return the node of the longest matched prefix, NULL for not found
+*/
+IPTrieNode *ip_trie_lookup(IPTrie *trie, const int family, const void *addr);
+
+/**
+ * longest prefix match of the socket address, the IPv4 mapped IPv6
+ * address (::ffff:a.b.c.d) matches the IPv4 prefixes
+ * return the node of the longest matched prefix, NULL for not found
+*/
+IPTrieNode *ip_trie_lookup_sockaddr(IPTrie *trie, const struct sockaddr *addr);
+
+static inline bool ip_trie_contains(IPTrie *trie, const int family, \
+		const void *addr)
+{
+	return ip_trie_lookup(trie, family, addr) != NULL;
+}
+
+static inline int ip_trie_count(IPTrie *trie)
+{
+	return trie->count;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
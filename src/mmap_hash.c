@@ -0,0 +1,600 @@
+/**
+* Copyright (C) 2008 Happy Fish / YuQing
+*
+* FastDFS may be copied only under the terms of the GNU General
+* Public License V3, which may be found in the FastDFS source kit.
+* Please visit the FastDFS Home Page http://www.csource.org/ for more detail.
+**/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "logger.h"
+#include "shared_func.h"
+#include "mmap_hash.h"
+
+#define MMAP_HASH_HEADER_SIZE  MEM_ALIGN(sizeof(MmapHashHeader))
+
+#define CALC_MMAP_NODE_BYTES(key_len, value_size) \
+	MEM_ALIGN(sizeof(MmapHashData) + (key_len) + (value_size))
+
+#define MMAP_HASH_FREE_INDEX(block_size) \
+	((block_size) / 8 < MMAP_HASH_FREE_CHAIN_COUNT ? (block_size) / 8 : \
+	 MMAP_HASH_FREE_CHAIN_COUNT - 1)
+
+#define MMAP_HASH_OFFSET(pHash, hash_data) \
+	((char *)(hash_data) - (pHash)->base)
+
+//return fail_return when lock fail, the errno is stored in result
+#define MMAP_HASH_LOCK(pHash, result, fail_return) \
+	if (pHash->need_lock && (result=mmap_hash_lock(pHash)) != 0) \
+	{ \
+		return fail_return; \
+	}
+
+#define MMAP_HASH_UNLOCK(pHash) \
+	if (pHash->need_lock) \
+	{ \
+		pthread_mutex_unlock(&pHash->header->lock); \
+	}
+
+static int mmap_hash_lock(MmapHashArray *pHash)
+{
+	int result;
+
+	if ((result=pthread_mutex_lock(&pHash->header->lock)) == 0)
+	{
+		return 0;
+	}
+
+#ifdef EOWNERDEAD
+	if (result == EOWNERDEAD)
+	{
+		/* the owner process died with the lock held, the chains are
+		   linked by single offset stores, only the entry being changed
+		   by the dead owner may be lost or partially written */
+		logWarning("file: "__FILE__", line: %d, "
+			"the owner of the mmap hash lock died, recover it",
+			__LINE__);
+		if ((result=pthread_mutex_consistent(
+				&pHash->header->lock)) == 0)
+		{
+			return 0;
+		}
+		pthread_mutex_unlock(&pHash->header->lock);
+	}
+#endif
+
+	logError("file: "__FILE__", line: %d, "
+		"lock the mmap hash fail, "
+		"errno: %d, error info: %s", __LINE__,
+		result, STRERROR(result));
+	return result;
+}
+
+static int mmap_hash_do_mmap(MmapHashArray *pHash, const int64_t file_size)
+{
+	int result;
+
+	pHash->base = (char *)mmap(NULL, file_size, PROT_READ | PROT_WRITE,
+			MAP_SHARED, pHash->fd, 0);
+	if (pHash->base == MAP_FAILED)
+	{
+		result = errno != 0 ? errno : ENOMEM;
+		logError("file: "__FILE__", line: %d, "
+			"mmap %"PRId64" bytes fail, errno: %d, error info: %s",
+			__LINE__, file_size, result, STRERROR(result));
+		pHash->base = NULL;
+		return result;
+	}
+
+	pHash->header = (MmapHashHeader *)pHash->base;
+	pHash->buckets = (int64_t *)(pHash->base + MMAP_HASH_HEADER_SIZE);
+	return 0;
+}
+
+static int mmap_hash_create(MmapHashArray *pHash, const unsigned int capacity,
+		const int64_t max_bytes)
+{
+	int64_t min_bytes;
+	int result;
+	pthread_mutexattr_t attr;
+
+	min_bytes = MMAP_HASH_HEADER_SIZE + sizeof(int64_t) * (int64_t)capacity;
+	if (capacity == 0 || max_bytes <= min_bytes)
+	{
+		logError("file: "__FILE__", line: %d, "
+			"invalid capacity: %u or max bytes: %"PRId64
+			", max bytes must > %"PRId64, __LINE__,
+			capacity, max_bytes, min_bytes);
+		return EINVAL;
+	}
+
+	if (ftruncate(pHash->fd, max_bytes) != 0)
+	{
+		result = errno != 0 ? errno : EIO;
+		logError("file: "__FILE__", line: %d, "
+			"ftruncate to %"PRId64" bytes fail, "
+			"errno: %d, error info: %s", __LINE__,
+			max_bytes, result, STRERROR(result));
+		return result;
+	}
+
+	if ((result=mmap_hash_do_mmap(pHash, max_bytes)) != 0)
+	{
+		return result;
+	}
+
+	memset(pHash->base, 0, min_bytes);
+	pHash->header->version = MMAP_HASH_VERSION;
+	pHash->header->header_size = MMAP_HASH_HEADER_SIZE;
+	pHash->header->capacity = capacity;
+	pHash->header->hash_check = pHash->hash_func(MMAP_HASH_MAGIC,
+			sizeof(MMAP_HASH_MAGIC) - 1);
+	pHash->header->file_size = max_bytes;
+	pHash->header->alloc_offset = min_bytes;
+
+	if ((result=pthread_mutexattr_init(&attr)) != 0)
+	{
+		return result;
+	}
+	result = pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+#if defined(OS_LINUX) || defined(OS_FREEBSD)
+	if (result == 0)
+	{
+		//recoverable when the owner process crashed with the lock held
+		result = pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+	}
+#endif
+	if (result == 0)
+	{
+		result = pthread_mutex_init(&pHash->header->lock, &attr);
+	}
+	pthread_mutexattr_destroy(&attr);
+	if (result != 0)
+	{
+		logError("file: "__FILE__", line: %d, "
+			"init process shared mutex fail, "
+			"errno: %d, error info: %s", __LINE__,
+			result, STRERROR(result));
+		return result;
+	}
+
+	//set magic at last, the table is valid since now
+	memcpy(pHash->header->magic, MMAP_HASH_MAGIC, MMAP_HASH_MAGIC_SIZE);
+	return msync(pHash->base, min_bytes, MS_SYNC) == 0 ? 0 :
+		(errno != 0 ? errno : EIO);
+}
+
+static int mmap_hash_attach(MmapHashArray *pHash, const char *filename,
+		const int64_t file_size)
+{
+	MmapHashHeader header;
+	int hash_check;
+
+	if (pread(pHash->fd, &header, sizeof(header), 0) != sizeof(header))
+	{
+		logError("file: "__FILE__", line: %d, "
+			"read header of file %s fail, "
+			"errno: %d, error info: %s", __LINE__,
+			filename, errno, STRERROR(errno));
+		return errno != 0 ? errno : EIO;
+	}
+
+	if (memcmp(header.magic, MMAP_HASH_MAGIC, MMAP_HASH_MAGIC_SIZE) != 0)
+	{
+		logError("file: "__FILE__", line: %d, "
+			"file %s is not a mmap hash file", __LINE__, filename);
+		return EINVAL;
+	}
+
+	if (header.version != MMAP_HASH_VERSION ||
+		header.header_size != MMAP_HASH_HEADER_SIZE)
+	{
+		logError("file: "__FILE__", line: %d, "
+			"file %s, version: %d or header size: %d "
+			"not match, expect version: %d, header size: %d",
+			__LINE__, filename, header.version,
+			header.header_size, MMAP_HASH_VERSION,
+			(int)MMAP_HASH_HEADER_SIZE);
+		return EINVAL;
+	}
+
+	hash_check = pHash->hash_func(MMAP_HASH_MAGIC,
+			sizeof(MMAP_HASH_MAGIC) - 1);
+	if (header.hash_check != hash_check)
+	{
+		logError("file: "__FILE__", line: %d, "
+			"file %s, the hash function not match",
+			__LINE__, filename);
+		return EINVAL;
+	}
+
+	if (header.file_size != file_size)
+	{
+		logError("file: "__FILE__", line: %d, "
+			"file %s, file size: %"PRId64" != %"PRId64
+			" in the header", __LINE__, filename,
+			file_size, header.file_size);
+		return EINVAL;
+	}
+
+	return mmap_hash_do_mmap(pHash, file_size);
+}
+
+int mmap_hash_init(MmapHashArray *pHash, const char *filename,
+		HashFunc hash_func, const unsigned int capacity,
+		const int64_t max_bytes, const bool need_lock)
+{
+	struct stat st;
+	int result;
+
+	memset(pHash, 0, sizeof(MmapHashArray));
+	pHash->hash_func = hash_func;
+	pHash->need_lock = need_lock;
+	if ((pHash->fd=open(filename, O_RDWR | O_CREAT, 0644)) < 0)
+	{
+		result = errno != 0 ? errno : EACCES;
+		logError("file: "__FILE__", line: %d, "
+			"open file \"%s\" fail, "
+			"errno: %d, error info: %s", __LINE__,
+			filename, result, STRERROR(result));
+		return result;
+	}
+
+	//serialize the creating and attaching among processes
+	if ((result=file_write_lock(pHash->fd)) != 0)
+	{
+		close(pHash->fd);
+		pHash->fd = -1;
+		return result;
+	}
+
+	do
+	{
+		if (fstat(pHash->fd, &st) != 0)
+		{
+			result = errno != 0 ? errno : EIO;
+			logError("file: "__FILE__", line: %d, "
+				"stat file \"%s\" fail, "
+				"errno: %d, error info: %s", __LINE__,
+				filename, result, STRERROR(result));
+			break;
+		}
+
+		if (st.st_size == 0)
+		{
+			result = mmap_hash_create(pHash, capacity, max_bytes);
+		}
+		else
+		{
+			result = mmap_hash_attach(pHash, filename, st.st_size);
+		}
+	} while (0);
+
+	file_unlock(pHash->fd);
+	if (result != 0)
+	{
+		mmap_hash_destroy(pHash);
+	}
+	return result;
+}
+
+void mmap_hash_destroy(MmapHashArray *pHash)
+{
+	if (pHash->base != NULL)
+	{
+		munmap(pHash->base, pHash->header->file_size);
+		pHash->base = NULL;
+		pHash->header = NULL;
+		pHash->buckets = NULL;
+	}
+
+	if (pHash->fd >= 0)
+	{
+		close(pHash->fd);
+		pHash->fd = -1;
+	}
+}
+
+static MmapHashData *_mmap_chain_find_entry(MmapHashArray *pHash,
+		int64_t *pBucket, const void *key, const int key_len,
+		const unsigned int hash_code, MmapHashData **previous)
+{
+	MmapHashData *hash_data;
+
+	*previous = NULL;
+	hash_data = MMAP_HASH_PTR(pHash, *pBucket);
+	while (hash_data != NULL)
+	{
+		if (hash_data->hash_code == hash_code &&
+			key_len == hash_data->key_len &&
+			memcmp(key, hash_data->key, key_len) == 0)
+		{
+			return hash_data;
+		}
+
+		*previous = hash_data;
+		hash_data = MMAP_HASH_PTR(pHash, hash_data->next);
+	}
+
+	return NULL;
+}
+
+static void _mmap_hash_free_entry(MmapHashArray *pHash, int64_t *pBucket,
+		MmapHashData *previous, MmapHashData *hash_data)
+{
+	int64_t *free_head;
+
+	if (previous == NULL)
+	{
+		*pBucket = hash_data->next;
+	}
+	else
+	{
+		previous->next = hash_data->next;
+	}
+
+	pHash->header->item_count--;
+	pHash->header->bytes_used -= CALC_MMAP_NODE_BYTES(hash_data->key_len,
+			hash_data->malloc_value_size);
+
+	//the whole space after the header is reused as value buffer
+	hash_data->malloc_value_size += hash_data->key_len;
+	hash_data->key_len = 0;
+	hash_data->value_len = 0;
+	free_head = pHash->header->free_heads + MMAP_HASH_FREE_INDEX(
+			CALC_MMAP_NODE_BYTES(0, hash_data->malloc_value_size));
+	hash_data->next = *free_head;
+	*free_head = MMAP_HASH_OFFSET(pHash, hash_data);
+}
+
+static MmapHashData *_mmap_hash_alloc_entry(MmapHashArray *pHash,
+		const int key_len, const int value_len)
+{
+	MmapHashData *hash_data;
+	MmapHashData *previous;
+	int64_t *free_head;
+	int64_t *free_end;
+	int64_t bytes;
+
+	/* all blocks in the chains except the last one are large enough,
+	   the last chain for larger blocks need first fit search */
+	bytes = CALC_MMAP_NODE_BYTES(key_len, value_len);
+	free_end = pHash->header->free_heads + MMAP_HASH_FREE_CHAIN_COUNT;
+	for (free_head=pHash->header->free_heads + MMAP_HASH_FREE_INDEX(bytes);
+			free_head<free_end; free_head++)
+	{
+		previous = NULL;
+		hash_data = MMAP_HASH_PTR(pHash, *free_head);
+		while (hash_data != NULL)
+		{
+			if (hash_data->malloc_value_size >= key_len + value_len)
+			{
+				if (previous == NULL)
+				{
+					*free_head = hash_data->next;
+				}
+				else
+				{
+					previous->next = hash_data->next;
+				}
+
+				hash_data->malloc_value_size -= key_len;
+				return hash_data;
+			}
+
+			previous = hash_data;
+			hash_data = MMAP_HASH_PTR(pHash, hash_data->next);
+		}
+	}
+
+	if (pHash->header->alloc_offset + bytes > pHash->header->file_size)
+	{
+		return NULL;
+	}
+
+	hash_data = (MmapHashData *)(pHash->base + pHash->header->alloc_offset);
+	pHash->header->alloc_offset += bytes;
+	hash_data->malloc_value_size = bytes - sizeof(MmapHashData) - key_len;
+	return hash_data;
+}
+
+int mmap_hash_insert(MmapHashArray *pHash, const void *key,
+		const int key_len, const void *value, const int value_len)
+{
+	unsigned int hash_code;
+	int64_t *pBucket;
+	MmapHashData *hash_data;
+	MmapHashData *old_data;
+	MmapHashData *previous;
+	int result;
+
+	hash_code = pHash->hash_func(key, key_len);
+	pBucket = pHash->buckets + (hash_code % pHash->header->capacity);
+
+	MMAP_HASH_LOCK(pHash, result, -1 * result)
+	old_data = _mmap_chain_find_entry(pHash, pBucket, key, key_len,
+			hash_code, &previous);
+	if (old_data != NULL && old_data->malloc_value_size >= value_len)
+	{
+		old_data->value_len = value_len;
+		memcpy(MMAP_HASH_VALUE(old_data), value, value_len);
+		MMAP_HASH_UNLOCK(pHash)
+		return 0;
+	}
+
+	//alloc before free the old entry, the old one is kept when no space
+	hash_data = _mmap_hash_alloc_entry(pHash, key_len, value_len);
+	if (hash_data == NULL)
+	{
+		MMAP_HASH_UNLOCK(pHash)
+		return -ENOSPC;
+	}
+
+	if (old_data != NULL)
+	{
+		_mmap_hash_free_entry(pHash, pBucket, previous, old_data);
+		result = 0;
+	}
+	else
+	{
+		result = 1;
+	}
+
+	hash_data->key_len = key_len;
+	hash_data->value_len = value_len;
+	hash_data->hash_code = hash_code;
+	memcpy(hash_data->key, key, key_len);
+	memcpy(MMAP_HASH_VALUE(hash_data), value, value_len);
+
+	hash_data->next = *pBucket;
+	*pBucket = MMAP_HASH_OFFSET(pHash, hash_data);
+	pHash->header->item_count++;
+	pHash->header->bytes_used += CALC_MMAP_NODE_BYTES(key_len,
+			hash_data->malloc_value_size);
+	MMAP_HASH_UNLOCK(pHash)
+
+	return result;
+}
+
+MmapHashData *mmap_hash_find_ex(MmapHashArray *pHash, const void *key,
+		const int key_len)
+{
+	unsigned int hash_code;
+	int64_t *pBucket;
+	MmapHashData *hash_data;
+	MmapHashData *previous;
+	int result;
+
+	hash_code = pHash->hash_func(key, key_len);
+	pBucket = pHash->buckets + (hash_code % pHash->header->capacity);
+
+	MMAP_HASH_LOCK(pHash, result, NULL)
+	hash_data = _mmap_chain_find_entry(pHash, pBucket, key, key_len,
+			hash_code, &previous);
+	MMAP_HASH_UNLOCK(pHash)
+
+	return hash_data;
+}
+
+int mmap_hash_get(MmapHashArray *pHash, const void *key, const int key_len,
+		void *value, int *value_len)
+{
+	unsigned int hash_code;
+	int64_t *pBucket;
+	MmapHashData *hash_data;
+	MmapHashData *previous;
+	int result;
+
+	hash_code = pHash->hash_func(key, key_len);
+	pBucket = pHash->buckets + (hash_code % pHash->header->capacity);
+
+	MMAP_HASH_LOCK(pHash, result, result)
+	hash_data = _mmap_chain_find_entry(pHash, pBucket, key, key_len,
+			hash_code, &previous);
+	if (hash_data != NULL)
+	{
+		if (hash_data->value_len <= *value_len)
+		{
+			*value_len = hash_data->value_len;
+			memcpy(value, MMAP_HASH_VALUE(hash_data),
+					hash_data->value_len);
+			result = 0;
+		}
+		else
+		{
+			result = ENOSPC;
+		}
+	}
+	else
+	{
+		result = ENOENT;
+	}
+	MMAP_HASH_UNLOCK(pHash)
+
+	return result;
+}
+
+int mmap_hash_delete(MmapHashArray *pHash, const void *key,
+		const int key_len)
+{
+	unsigned int hash_code;
+	int64_t *pBucket;
+	MmapHashData *hash_data;
+	MmapHashData *previous;
+	int result;
+
+	hash_code = pHash->hash_func(key, key_len);
+	pBucket = pHash->buckets + (hash_code % pHash->header->capacity);
+
+	MMAP_HASH_LOCK(pHash, result, result)
+	hash_data = _mmap_chain_find_entry(pHash, pBucket, key, key_len,
+			hash_code, &previous);
+	if (hash_data != NULL)
+	{
+		_mmap_hash_free_entry(pHash, pBucket, previous, hash_data);
+		result = 0;
+	}
+	else
+	{
+		result = ENOENT;
+	}
+	MMAP_HASH_UNLOCK(pHash)
+
+	return result;
+}
+
+int mmap_hash_walk(MmapHashArray *pHash, MmapHashWalkFunc walkFunc,
+		void *args)
+{
+	int64_t *pBucket;
+	int64_t *bucket_end;
+	MmapHashData *hash_data;
+	int index;
+	int result;
+
+	index = 0;
+	result = 0;
+	MMAP_HASH_LOCK(pHash, result, result)
+	bucket_end = pHash->buckets + pHash->header->capacity;
+	for (pBucket=pHash->buckets; pBucket<bucket_end; pBucket++)
+	{
+		hash_data = MMAP_HASH_PTR(pHash, *pBucket);
+		while (hash_data != NULL)
+		{
+			if ((result=walkFunc(index, hash_data, args)) != 0)
+			{
+				break;
+			}
+
+			index++;
+			hash_data = MMAP_HASH_PTR(pHash, hash_data->next);
+		}
+
+		if (result != 0)
+		{
+			break;
+		}
+	}
+	MMAP_HASH_UNLOCK(pHash)
+
+	return result;
+}
+
+int mmap_hash_sync(MmapHashArray *pHash, const bool async)
+{
+	if (msync(pHash->base, pHash->header->file_size,
+				async ? MS_ASYNC : MS_SYNC) != 0)
+	{
+		return errno != 0 ? errno : EIO;
+	}
+
+	return 0;
+}
@@ -0,0 +1,199 @@
+/**
+* Copyright (C) 2008 Happy Fish / YuQing
+*
+* FastDFS may be copied only under the terms of the GNU General
+* Public License V3, which may be found in the FastDFS source kit.
+* Please visit the FastDFS Home Page http://www.csource.org/ for more detail.
+**/
+
+/**
+  hash table stored in a mmap-ed file (or a file under /dev/shm) which can be
+  shared by multi processes and reopened after restart without rebuilding.
+  the buckets and the entries use offsets instead of pointers, the layout
+  of the file:
+      MmapHashHeader + buckets (int64_t * capacity) + entries
+*/
+
+#ifndef _MMAP_HASH_H_
+#define _MMAP_HASH_H_
+
+#include <sys/types.h>
+#include <pthread.h>
+#include "common_define.h"
+#include "hash.h"
+
+#define MMAP_HASH_MAGIC          "FCMHASH"
+#define MMAP_HASH_MAGIC_SIZE     8
+#define MMAP_HASH_VERSION        2
+
+//free entry chains by block size (in 8 bytes), the last for larger blocks
+#define MMAP_HASH_FREE_CHAIN_COUNT  64
+
+#define MMAP_HASH_VALUE(hash_data) ((hash_data)->key + (hash_data)->key_len)
+
+#define MMAP_HASH_PTR(pHash, offset) \
+	((MmapHashData *)((offset) > 0 ? (pHash)->base + (offset) : NULL))
+
+typedef struct tagMmapHashData
+{
+	int key_len;
+	int value_len;
+	int malloc_value_size;
+	unsigned int hash_code;
+	int64_t next;  //offset of the next entry, 0 for the end of the chain
+	char key[0];   //the value follows the key
+} MmapHashData;
+
+typedef struct tagMmapHashHeader
+{
+	char magic[MMAP_HASH_MAGIC_SIZE];
+	int version;
+	int header_size;
+	unsigned int capacity;
+	int hash_check;   //hash code of MMAP_HASH_MAGIC for hash func check
+	int64_t file_size;
+	int64_t alloc_offset;  //the offset of the unallocated space
+	int64_t free_heads[MMAP_HASH_FREE_CHAIN_COUNT]; //free entry chains
+	int64_t bytes_used;
+	int item_count;
+	pthread_mutex_t lock;  //process shared and robust
+} MmapHashHeader;
+
+typedef struct tagMmapHashArray
+{
+	int fd;
+	bool need_lock;
+	HashFunc hash_func;
+	MmapHashHeader *header;
+	int64_t *buckets;
+	char *base;
+} MmapHashArray;
+
+/**
+ * mmap hash walk function
+ * parameters:
+ *         index: item index based 0
+ *         data: hash data, use MMAP_HASH_VALUE to get the value
+ *         args: passed by mmap_hash_walk function
+ * return 0 for success, != 0 for error
+*/
+typedef int (*MmapHashWalkFunc)(const int index, const MmapHashData *data,
+		void *args);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * mmap hash init function, attach the existing table when the header of
+ * the file is compatible, otherwise create a new table
+ * parameters:
+ *         pHash: the hash table
+ *         filename: the file to mmap, such as /dev/shm/xxx for shm
+ *         hash_func: hash function, must be the same among processes
+ *         capacity: the bucket count, ignored when attach
+ *         max_bytes: the file size, ignored when attach
+ *         need_lock: if need the process shared lock, the lock is
+ *                    recovered when the owner process crashed
+ * return 0 for success, != 0 for error
+*/
+int mmap_hash_init(MmapHashArray *pHash, const char *filename,
+		HashFunc hash_func, const unsigned int capacity,
+		const int64_t max_bytes, const bool need_lock);
+
+/**
+ * mmap hash destroy function, unmap the file only, the data is kept
+ * parameters:
+ *         pHash: the hash table
+ * return none
+*/
+void mmap_hash_destroy(MmapHashArray *pHash);
+
+/**
+ * mmap hash insert key
+ * parameters:
+ *         pHash: the hash table
+ *         key: the key to insert
+ *         key_len: length of th key
+ *         value: the value
+ *         value_len: length of the value
+ * return >= 0 for success, 0 for key already exist (update),
+ *        1 for new key (insert), < 0 for error
+*/
+int mmap_hash_insert(MmapHashArray *pHash, const void *key,
+		const int key_len, const void *value, const int value_len);
+
+/**
+ * mmap hash find key under the lock, the lock is released before return,
+ * so the caller should ensure the entry not be deleted or updated
+ * during access
+ * parameters:
+ *         pHash: the hash table
+ *         key: the key to find
+ *         key_len: length of th key
+ * return hash data, return NULL when the key not exist or lock fail
+*/
+MmapHashData *mmap_hash_find_ex(MmapHashArray *pHash, const void *key,
+		const int key_len);
+
+/**
+ * mmap hash get the value of the key (copy under lock)
+ * parameters:
+ *         pHash: the hash table
+ *         key: the key to find
+ *         key_len: length of th key
+ *         value: store the value
+ *         value_len: input for the max size of the value
+ *                    output for the length fo the value
+ * return 0 for success, != 0 fail (errno)
+*/
+int mmap_hash_get(MmapHashArray *pHash, const void *key, const int key_len,
+		void *value, int *value_len);
+
+/**
+ * mmap hash delete key
+ * parameters:
+ *         pHash: the hash table
+ *         key: the key to delete
+ *         key_len: length of th key
+ * return 0 for success, != 0 fail (errno)
+*/
+int mmap_hash_delete(MmapHashArray *pHash, const void *key,
+		const int key_len);
+
+/**
+ * mmap hash walk (iterator) under the process shared lock
+ * parameters:
+ *         pHash: the hash table
+ *         walkFunc: walk (interator) function
+ *         args: extra args which will be passed to walkFunc
+ * return 0 for success, != 0 fail (errno)
+*/
+int mmap_hash_walk(MmapHashArray *pHash, MmapHashWalkFunc walkFunc,
+		void *args);
+
+/**
+ * sync the mapped memory to the file
+ * parameters:
+ *         pHash: the hash table
+ *         async: if sync asynchronously
+ * return 0 for success, != 0 fail (errno)
+*/
+int mmap_hash_sync(MmapHashArray *pHash, const bool async);
+
+/**
+ * get hash item count
+ * parameters:
+ *         pHash: the hash table
+ * return item count
+*/
+static inline int mmap_hash_count(MmapHashArray *pHash)
+{
+	return pHash->header->item_count;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
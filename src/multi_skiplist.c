@@ -345,3 +345,204 @@ int multi_skiplist_find_all(MultiSkiplist *sl, void *data,
     }
 }
 
+
+//return the last node whose head data < the data, maybe the top
+static MultiSkiplistNode *multi_skiplist_get_last_lt(MultiSkiplist *sl,
+        void *data)
+{
+    int i;
+    MultiSkiplistNode *previous;
+
+    previous = sl->top;
+    for (i=sl->top_level_index; i>=0; i--) {
+        while (previous->links[i] != sl->tail && sl->compare_func(data,
+                    previous->links[i]->head->data) > 0)
+        {
+            previous = previous->links[i];
+        }
+    }
+
+    return previous;
+}
+
+void *multi_skiplist_find_ge(MultiSkiplist *sl, void *data)
+{
+    MultiSkiplistNode *node;
+
+    node = multi_skiplist_get_last_lt(sl, data)->links[0];
+    return (node != sl->tail) ? node->head->data : NULL;
+}
+
+void *multi_skiplist_find_le(MultiSkiplist *sl, void *data)
+{
+    int i;
+    MultiSkiplistNode *previous;
+
+    previous = sl->top;
+    for (i=sl->top_level_index; i>=0; i--) {
+        while (previous->links[i] != sl->tail && sl->compare_func(data,
+                    previous->links[i]->head->data) >= 0)
+        {
+            previous = previous->links[i];
+        }
+    }
+
+    return (previous != sl->top) ? previous->tail->data : NULL;
+}
+
+int multi_skiplist_find_range(MultiSkiplist *sl, void *start, void *end,
+        MultiSkiplistIterator *iterator)
+{
+    iterator->current.data = NULL;
+    if (sl->compare_func(start, end) >= 0) {
+        iterator->current.node = sl->tail;
+        iterator->tail = sl->tail;
+        return ENOENT;
+    }
+
+    iterator->current.node = multi_skiplist_get_last_lt(sl, start);
+    iterator->tail = multi_skiplist_get_last_lt(sl, end)->links[0];
+    return (iterator->current.node->links[0] != iterator->tail) ? 0 : ENOENT;
+}
+
+int multi_skiplist_delete_range(MultiSkiplist *sl, void *start, void *end,
+        int *delete_count)
+{
+    int i;
+    MultiSkiplistNode *firsts[SKIPLIST_MAX_LEVEL_COUNT];
+    MultiSkiplistNode *lasts[SKIPLIST_MAX_LEVEL_COUNT];
+    MultiSkiplistNode *previous;
+    MultiSkiplistNode *current;
+    MultiSkiplistNode *deleted;
+    MultiSkiplistNode *upper;
+    MultiSkiplistData *dataNode;
+    MultiSkiplistData *dataCurrent;
+
+    *delete_count = 0;
+    if (sl->compare_func(start, end) >= 0) {
+        return ENOENT;
+    }
+
+    //the range of every level is [firsts[i], lasts[i])
+    firsts[0] = lasts[0] = sl->tail;
+    previous = sl->top;
+    for (i=sl->top_level_index; i>=0; i--) {
+        while (previous->links[i] != sl->tail && sl->compare_func(start,
+                    previous->links[i]->head->data) > 0)
+        {
+            previous = previous->links[i];
+        }
+
+        current = previous->links[i];
+        firsts[i] = current;
+        while (current != sl->tail && sl->compare_func(end,
+                    current->head->data) > 0)
+        {
+            current = current->links[i];
+        }
+        lasts[i] = current;
+        previous->links[i] = current;
+    }
+
+    if (firsts[0] == lasts[0]) {
+        return ENOENT;
+    }
+
+    /* free the node by the level from bottom to top, a node belongs to
+       level i when it is not in the level i + 1 */
+    for (i=0; i<=sl->top_level_index; i++) {
+        upper = (i < sl->top_level_index) ? firsts[i + 1] : NULL;
+        current = firsts[i];
+        while (current != lasts[i]) {
+            deleted = current;
+            current = current->links[i];
+
+            if (i == 0) {
+                dataCurrent = deleted->head;
+                while (dataCurrent != NULL) {
+                    dataNode = dataCurrent;
+                    dataCurrent = dataCurrent->next;
+
+                    (*delete_count)++;
+                    multi_skiplist_free_data_node(sl, dataNode);
+                }
+            }
+
+            if (deleted == upper) {
+                upper = upper->links[i + 1];
+            }
+            else {
+                fast_mblock_free_object(sl->mblocks + i, deleted);
+            }
+        }
+    }
+
+    return 0;
+}
+
+int multi_skiplist_bulk_load(MultiSkiplist *sl, void **data_array,
+        const int count)
+{
+    int i;
+    int k;
+    int level_index;
+    MultiSkiplistNode *lasts[SKIPLIST_MAX_LEVEL_COUNT];
+    MultiSkiplistNode *node;
+    MultiSkiplistData *dataNode;
+
+    if (sl->top->links[0] != sl->tail) {
+        logError("file: "__FILE__", line: %d, "
+                "the skiplist is not empty", __LINE__);
+        return EEXIST;
+    }
+
+    for (i=1; i<count; i++) {
+        if (sl->compare_func(data_array[i - 1], data_array[i]) > 0) {
+            logError("file: "__FILE__", line: %d, "
+                    "the data array is not sorted, index: %d",
+                    __LINE__, i);
+            return EINVAL;
+        }
+    }
+
+    for (k=0; k<=sl->top_level_index; k++) {
+        lasts[k] = sl->top;
+    }
+
+    for (i=0; i<count; i++) {
+        dataNode = (MultiSkiplistData *)fast_mblock_alloc_object(
+                &sl->data_mblock);
+        if (dataNode == NULL) {
+            break;
+        }
+        dataNode->data = data_array[i];
+        dataNode->next = NULL;
+
+        if (lasts[0] != sl->top && sl->compare_func(data_array[i],
+                    lasts[0]->head->data) == 0)
+        {
+            lasts[0]->tail->next = dataNode;
+            lasts[0]->tail = dataNode;
+            continue;
+        }
+
+        level_index = multi_skiplist_get_level_index(sl);
+        node = (MultiSkiplistNode *)fast_mblock_alloc_object(
+                sl->mblocks + level_index);
+        if (node == NULL) {
+            fast_mblock_free_object(&sl->data_mblock, dataNode);
+            break;
+        }
+
+        node->head = node->tail = dataNode;
+        for (k=0; k<=level_index; k++) {
+            lasts[k]->links[k] = node;
+            lasts[k] = node;
+        }
+    }
+
+    for (k=0; k<=sl->top_level_index; k++) {
+        lasts[k]->links[k] = sl->tail;
+    }
+    return i == count ? 0 : ENOMEM;
+}
@@ -72,6 +72,31 @@ void *multi_skiplist_find(MultiSkiplist *sl, void *data);
 int multi_skiplist_find_all(MultiSkiplist *sl, void *data,
         MultiSkiplistIterator *iterator);
 
+/**
+ * build the skiplist from the sorted data in O(n) without searching
+ * parameters:
+ *         sl: the skiplist, must be empty
+ *         data_array: the data array in ascending order
+ *         count: the count of the data array
+ * return 0 for success, != 0 fail (errno)
+*/
+int multi_skiplist_bulk_load(MultiSkiplist *sl, void **data_array,
+        const int count);
+
+//return the first data >= the data, NULL for not found
+void *multi_skiplist_find_ge(MultiSkiplist *sl, void *data);
+
+//return the last data <= the data, NULL for not found
+void *multi_skiplist_find_le(MultiSkiplist *sl, void *data);
+
+//iterate the data in [start, end), return ENOENT for empty
+int multi_skiplist_find_range(MultiSkiplist *sl, void *start, void *end,
+        MultiSkiplistIterator *iterator);
+
+//delete the data in [start, end), return ENOENT when nothing deleted
+int multi_skiplist_delete_range(MultiSkiplist *sl, void *start, void *end,
+        int *delete_count);
+
 static inline void multi_skiplist_iterator(MultiSkiplist *sl,
         MultiSkiplistIterator *iterator)
 {
@@ -1895,6 +1895,143 @@ int load_allow_hosts(IniContext *pIniContext, \
 	return 0;
 }
 
+static int load_allow_any_to_trie(IPTrie *trie)
+{
+	int result;
+	struct in6_addr any;
+
+	memset(&any, 0, sizeof(any));
+	if ((result=ip_trie_insert(trie, AF_INET, &any, 0, NULL)) != 0)
+	{
+		return result;
+	}
+	return ip_trie_insert(trie, AF_INET6, &any, 0, NULL);
+}
+
+static int load_range_hosts_to_trie(IPTrie *trie, const char *value)
+{
+	char item_value[256];
+	char hostname[256];
+	char *pStart;
+	char *pEnd;
+	in_addr_t *addrs;
+	int alloc_count;
+	int count;
+	int nHeadLen;
+	int nValueLen;
+	int result;
+	int i;
+
+	pStart = strchr(value, '[');
+	pEnd = strchr(pStart, ']');
+	if (pEnd == NULL)
+	{
+		logError("file: "__FILE__", line: %d, " \
+			"invalid host name: %s, expect \"]\"", \
+			__LINE__, value);
+		return EINVAL;
+	}
+
+	nValueLen = strlen(value);
+	if (nValueLen >= (int)sizeof(item_value))
+	{
+		logError("file: "__FILE__", line: %d, " \
+			"hostname too long, exceeds %d bytes", \
+			__LINE__, (int)sizeof(item_value));
+		return EINVAL;
+	}
+	memcpy(item_value, value, nValueLen + 1);
+	nHeadLen = pStart - value;
+	memcpy(hostname, value, nHeadLen);
+
+	addrs = NULL;
+	alloc_count = 0;
+	count = 0;
+	result = parse_range_hosts(value, item_value + nHeadLen,
+			item_value + (pEnd - value), hostname, nHeadLen,
+			&addrs, &alloc_count, &count, 0);
+	for (i=0; i<count && result == 0; i++)
+	{
+		result = ip_trie_insert(trie, AF_INET, addrs + i, 32, NULL);
+	}
+
+	if (addrs != NULL)
+	{
+		free(addrs);
+	}
+	return result;
+}
+
+int load_allow_hosts_to_trie(IniContext *pIniContext, IPTrie *trie)
+{
+	int result;
+	int count;
+	IniItem *pItem;
+	IniItem *pItemStart;
+	IniItem *pItemEnd;
+	in_addr_t addr;
+
+	if ((pItemStart=iniGetValuesEx(NULL, "allow_hosts", \
+		pIniContext, &count)) == NULL)
+	{
+		return load_allow_any_to_trie(trie);
+	}
+
+	pItemEnd = pItemStart + count;
+	for (pItem=pItemStart; pItem<pItemEnd; pItem++)
+	{
+		if (strcmp(pItem->value, "*") == 0)
+		{
+			return load_allow_any_to_trie(trie);
+		}
+	}
+
+	for (pItem=pItemStart; pItem<pItemEnd; pItem++)
+	{
+		if (*(pItem->value) == '\0')
+		{
+			continue;
+		}
+
+		if (strchr(pItem->value, '[') != NULL)
+		{
+			result = load_range_hosts_to_trie(trie, pItem->value);
+		}
+		else if (strchr(pItem->value, '/') != NULL ||
+				strchr(pItem->value, ':') != NULL)
+		{
+			//CIDR or IPv6 addresses
+			result = ip_trie_insert_cidr(trie, pItem->value, NULL);
+		}
+		else
+		{
+			addr = getIpaddrByName(pItem->value, NULL, 0);
+			if (addr == INADDR_NONE)
+			{
+				logWarning("file: "__FILE__", line: %d, " \
+					"invalid host name: %s", \
+					__LINE__, pItem->value);
+				continue;
+			}
+			result = ip_trie_insert(trie, AF_INET, &addr, 32, NULL);
+		}
+
+		if (result != 0)
+		{
+			return result;
+		}
+	}
+
+	if (ip_trie_count(trie) == 0)
+	{
+		logWarning("file: "__FILE__", line: %d, " \
+			"allow ip count: 0", __LINE__);
+	}
+
+	logDebug("allow prefix count=%d", ip_trie_count(trie));
+	return 0;
+}
+
 int cmp_by_ip_addr_t(const void *p1, const void *p2)
 {
         return memcmp((in_addr_t *)p1, (in_addr_t *)p2, sizeof(in_addr_t));
@@ -16,6 +16,7 @@
 #include <sys/resource.h>
 #include "common_define.h"
 #include "ini_file_reader.h"
+#include "ip_trie.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -367,6 +368,16 @@ void set_log_level(char *pLogLevel);
 int load_allow_hosts(IniContext *pIniContext, \
 		in_addr_t **allow_ip_addrs, int *allow_ip_count);
 
+/** load allow hosts from config context to the radix trie for the longest
+ *  prefix match, the CIDR addresses (IPv4 and IPv6) are NOT expanded,
+ *  the trie matches any address when allow_hosts is not set or is *
+ *  parameters:
+ *  	pIniContext: the config context
+ *  	trie: the trie to store, should be inited
+ *  return: error no , 0 success, != 0 fail
+*/
+int load_allow_hosts_to_trie(IniContext *pIniContext, IPTrie *trie);
+
 /** get time item from config context
  *  parameters:
  *  	pIniContext: the config context
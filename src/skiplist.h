@@ -13,13 +13,18 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
 #include "common_define.h"
 #include "skiplist_common.h"
 #include "flat_skiplist.h"
 #include "multi_skiplist.h"
+#include "array_skiplist.h"
+#include "concurrent_skiplist.h"
 
 #define SKIPLIST_TYPE_FLAT    0
 #define SKIPLIST_TYPE_MULTI   1
+#define SKIPLIST_TYPE_ARRAY   2
+#define SKIPLIST_TYPE_CONCURRENT  3  //lock-free, thread safe
 
 typedef struct skiplist
 {
@@ -27,6 +32,8 @@ typedef struct skiplist
     union {
         FlatSkiplist flat;
         MultiSkiplist multi;
+        ArraySkiplist array;
+        ConcurrentSkiplist concurrent;
     } u;
 } Skiplist;
 
@@ -35,6 +42,8 @@ typedef struct skiplist_iterator {
     union {
         FlatSkiplistIterator flat;
         MultiSkiplistIterator multi;
+        ArraySkiplistIterator array;
+        ConcurrentSkiplistIterator concurrent;
     } u;
 } SkiplistIterator;
 
@@ -55,10 +64,21 @@ static inline int skiplist_init_ex(Skiplist *sl, const int level_count,
         return flat_skiplist_init_ex(&sl->u.flat, level_count,
                 compare_func, free_func, min_alloc_elements_once);
     }
-    else {
+    else if (type == SKIPLIST_TYPE_MULTI) {
         return multi_skiplist_init_ex(&sl->u.multi, level_count,
                 compare_func, free_func, min_alloc_elements_once);
     }
+    else if (type == SKIPLIST_TYPE_ARRAY) {
+        return array_skiplist_init_ex(&sl->u.array, level_count,
+                compare_func, free_func, min_alloc_elements_once);
+    }
+    else if (type == SKIPLIST_TYPE_CONCURRENT) {
+        return concurrent_skiplist_init_ex(&sl->u.concurrent, level_count,
+                compare_func, free_func, min_alloc_elements_once);
+    }
+    else {
+        return EINVAL;
+    }
 }
 
 static inline void skiplist_destroy(Skiplist *sl)
@@ -66,9 +86,15 @@ static inline void skiplist_destroy(Skiplist *sl)
     if (sl->type == SKIPLIST_TYPE_FLAT) {
         flat_skiplist_destroy(&sl->u.flat);
     }
-    else {
+    else if (sl->type == SKIPLIST_TYPE_MULTI) {
         multi_skiplist_destroy(&sl->u.multi);
     }
+    else if (sl->type == SKIPLIST_TYPE_ARRAY) {
+        array_skiplist_destroy(&sl->u.array);
+    }
+    else {
+        concurrent_skiplist_destroy(&sl->u.concurrent);
+    }
 }
 
 static inline int skiplist_insert(Skiplist *sl, void *data)
@@ -76,9 +102,15 @@ static inline int skiplist_insert(Skiplist *sl, void *data)
     if (sl->type == SKIPLIST_TYPE_FLAT) {
         return flat_skiplist_insert(&sl->u.flat, data);
     }
-    else {
+    else if (sl->type == SKIPLIST_TYPE_MULTI) {
         return multi_skiplist_insert(&sl->u.multi, data);
     }
+    else if (sl->type == SKIPLIST_TYPE_ARRAY) {
+        return array_skiplist_insert(&sl->u.array, data);
+    }
+    else {
+        return concurrent_skiplist_insert(&sl->u.concurrent, data);
+    }
 }
 
 static inline int skiplist_delete(Skiplist *sl, void *data)
@@ -86,9 +118,15 @@ static inline int skiplist_delete(Skiplist *sl, void *data)
     if (sl->type == SKIPLIST_TYPE_FLAT) {
         return flat_skiplist_delete(&sl->u.flat, data);
     }
-    else {
+    else if (sl->type == SKIPLIST_TYPE_MULTI) {
         return multi_skiplist_delete(&sl->u.multi, data);
     }
+    else if (sl->type == SKIPLIST_TYPE_ARRAY) {
+        return array_skiplist_delete(&sl->u.array, data);
+    }
+    else {
+        return concurrent_skiplist_delete(&sl->u.concurrent, data);
+    }
 }
 
 static inline int skiplist_delete_all(Skiplist *sl, void *data, int *delete_count)
@@ -96,9 +134,15 @@ static inline int skiplist_delete_all(Skiplist *sl, void *data, int *delete_coun
     if (sl->type == SKIPLIST_TYPE_FLAT) {
         return flat_skiplist_delete_all(&sl->u.flat, data, delete_count);
     }
-    else {
+    else if (sl->type == SKIPLIST_TYPE_MULTI) {
         return multi_skiplist_delete_all(&sl->u.multi, data, delete_count);
     }
+    else if (sl->type == SKIPLIST_TYPE_ARRAY) {
+        return array_skiplist_delete_all(&sl->u.array, data, delete_count);
+    }
+    else {
+        return concurrent_skiplist_delete_all(&sl->u.concurrent, data, delete_count);
+    }
 }
 
 static inline void *skiplist_find(Skiplist *sl, void *data)
@@ -106,9 +150,15 @@ static inline void *skiplist_find(Skiplist *sl, void *data)
     if (sl->type == SKIPLIST_TYPE_FLAT) {
         return flat_skiplist_find(&sl->u.flat, data);
     }
-    else {
+    else if (sl->type == SKIPLIST_TYPE_MULTI) {
         return multi_skiplist_find(&sl->u.multi, data);
     }
+    else if (sl->type == SKIPLIST_TYPE_ARRAY) {
+        return array_skiplist_find(&sl->u.array, data);
+    }
+    else {
+        return concurrent_skiplist_find(&sl->u.concurrent, data);
+    }
 }
 
 static inline int skiplist_find_all(Skiplist *sl, void *data, SkiplistIterator *iterator)
@@ -117,20 +167,35 @@ static inline int skiplist_find_all(Skiplist *sl, void *data, SkiplistIterator *
     if (sl->type == SKIPLIST_TYPE_FLAT) {
         return flat_skiplist_find_all(&sl->u.flat, data, &iterator->u.flat);
     }
-    else {
+    else if (sl->type == SKIPLIST_TYPE_MULTI) {
         return multi_skiplist_find_all(&sl->u.multi, data, &iterator->u.multi);
     }
+    else if (sl->type == SKIPLIST_TYPE_ARRAY) {
+        return array_skiplist_find_all(&sl->u.array, data, &iterator->u.array);
+    }
+    else {
+        return concurrent_skiplist_find_all(&sl->u.concurrent, data, &iterator->u.concurrent);
+    }
 }
 
-static inline void skiplist_iterator(Skiplist *sl, SkiplistIterator *iterator)
+//return 0 for success, ENOMEM for the concurrent skiplist
+static inline int skiplist_iterator(Skiplist *sl, SkiplistIterator *iterator)
 {
     iterator->type = sl->type;
     if (sl->type == SKIPLIST_TYPE_FLAT) {
-        return flat_skiplist_iterator(&sl->u.flat, &iterator->u.flat);
+        flat_skiplist_iterator(&sl->u.flat, &iterator->u.flat);
+    }
+    else if (sl->type == SKIPLIST_TYPE_MULTI) {
+        multi_skiplist_iterator(&sl->u.multi, &iterator->u.multi);
+    }
+    else if (sl->type == SKIPLIST_TYPE_ARRAY) {
+        array_skiplist_iterator(&sl->u.array, &iterator->u.array);
     }
     else {
-        return multi_skiplist_iterator(&sl->u.multi, &iterator->u.multi);
+        return concurrent_skiplist_iterator(&sl->u.concurrent,
+                &iterator->u.concurrent);
     }
+    return 0;
 }
 
 static inline void *skiplist_next(SkiplistIterator *iterator)
@@ -138,9 +203,154 @@ static inline void *skiplist_next(SkiplistIterator *iterator)
     if (iterator->type == SKIPLIST_TYPE_FLAT) {
         return flat_skiplist_next(&iterator->u.flat);
     }
-    else {
+    else if (iterator->type == SKIPLIST_TYPE_MULTI) {
         return multi_skiplist_next(&iterator->u.multi);
     }
+    else if (iterator->type == SKIPLIST_TYPE_ARRAY) {
+        return array_skiplist_next(&iterator->u.array);
+    }
+    else {
+        return concurrent_skiplist_next(&iterator->u.concurrent);
+    }
+}
+
+/**
+ * build the skiplist from the sorted data in O(n), only support the type
+ * SKIPLIST_TYPE_FLAT and SKIPLIST_TYPE_MULTI
+ * return 0 for success, EOPNOTSUPP for other types, != 0 fail (errno)
+*/
+static inline int skiplist_bulk_load(Skiplist *sl, void **data_array,
+        const int count)
+{
+    if (sl->type == SKIPLIST_TYPE_FLAT) {
+        return flat_skiplist_bulk_load(&sl->u.flat, data_array, count);
+    }
+    else if (sl->type == SKIPLIST_TYPE_MULTI) {
+        return multi_skiplist_bulk_load(&sl->u.multi, data_array, count);
+    }
+    else {
+        return EOPNOTSUPP;
+    }
+}
+
+static inline void *skiplist_find_ge(Skiplist *sl, void *data)
+{
+    if (sl->type == SKIPLIST_TYPE_FLAT) {
+        return flat_skiplist_find_ge(&sl->u.flat, data);
+    }
+    else if (sl->type == SKIPLIST_TYPE_MULTI) {
+        return multi_skiplist_find_ge(&sl->u.multi, data);
+    }
+    else if (sl->type == SKIPLIST_TYPE_ARRAY) {
+        return array_skiplist_find_ge(&sl->u.array, data);
+    }
+    else {
+        return concurrent_skiplist_find_ge(&sl->u.concurrent, data);
+    }
+}
+
+static inline void *skiplist_find_le(Skiplist *sl, void *data)
+{
+    if (sl->type == SKIPLIST_TYPE_FLAT) {
+        return flat_skiplist_find_le(&sl->u.flat, data);
+    }
+    else if (sl->type == SKIPLIST_TYPE_MULTI) {
+        return multi_skiplist_find_le(&sl->u.multi, data);
+    }
+    else if (sl->type == SKIPLIST_TYPE_ARRAY) {
+        return array_skiplist_find_le(&sl->u.array, data);
+    }
+    else {
+        return concurrent_skiplist_find_le(&sl->u.concurrent, data);
+    }
+}
+
+//iterate the data in [start, end) by skiplist_next
+static inline int skiplist_find_range(Skiplist *sl, void *start, void *end,
+        SkiplistIterator *iterator)
+{
+    iterator->type = sl->type;
+    if (sl->type == SKIPLIST_TYPE_FLAT) {
+        return flat_skiplist_find_range(&sl->u.flat, start, end,
+                &iterator->u.flat);
+    }
+    else if (sl->type == SKIPLIST_TYPE_MULTI) {
+        return multi_skiplist_find_range(&sl->u.multi, start, end,
+                &iterator->u.multi);
+    }
+    else if (sl->type == SKIPLIST_TYPE_ARRAY) {
+        return array_skiplist_find_range(&sl->u.array, start, end,
+                &iterator->u.array);
+    }
+    else {
+        return concurrent_skiplist_find_range(&sl->u.concurrent, start, end,
+                &iterator->u.concurrent);
+    }
+}
+
+//delete the data in [start, end)
+static inline int skiplist_delete_range(Skiplist *sl, void *start, void *end,
+        int *delete_count)
+{
+    if (sl->type == SKIPLIST_TYPE_FLAT) {
+        return flat_skiplist_delete_range(&sl->u.flat, start, end,
+                delete_count);
+    }
+    else if (sl->type == SKIPLIST_TYPE_MULTI) {
+        return multi_skiplist_delete_range(&sl->u.multi, start, end,
+                delete_count);
+    }
+    else if (sl->type == SKIPLIST_TYPE_ARRAY) {
+        return array_skiplist_delete_range(&sl->u.array, start, end,
+                delete_count);
+    }
+    else {
+        return concurrent_skiplist_delete_range(&sl->u.concurrent,
+                start, end, delete_count);
+    }
+}
+
+/**
+ * iterate from the last data to the first by skiplist_prev, only the types
+ * with the backward links support it: SKIPLIST_TYPE_FLAT, SKIPLIST_TYPE_ARRAY
+ * return 0 for success, EOPNOTSUPP for other types
+*/
+static inline int skiplist_reverse_iterator(Skiplist *sl,
+        SkiplistIterator *iterator)
+{
+    iterator->type = sl->type;
+    if (sl->type == SKIPLIST_TYPE_FLAT) {
+        flat_skiplist_reverse_iterator(&sl->u.flat, &iterator->u.flat);
+        return 0;
+    }
+    else if (sl->type == SKIPLIST_TYPE_ARRAY) {
+        array_skiplist_reverse_iterator(&sl->u.array, &iterator->u.array);
+        return 0;
+    }
+    else {
+        return EOPNOTSUPP;
+    }
+}
+
+static inline void *skiplist_prev(SkiplistIterator *iterator)
+{
+    if (iterator->type == SKIPLIST_TYPE_FLAT) {
+        return flat_skiplist_prev(&iterator->u.flat);
+    }
+    else if (iterator->type == SKIPLIST_TYPE_ARRAY) {
+        return array_skiplist_prev(&iterator->u.array);
+    }
+    else {
+        return NULL;
+    }
+}
+
+//call it when break the iteration before skiplist_next returns NULL
+static inline void skiplist_iterator_end(SkiplistIterator *iterator)
+{
+    if (iterator->type == SKIPLIST_TYPE_CONCURRENT) {
+        concurrent_skiplist_iterator_end(&iterator->u.concurrent);
+    }
 }
 
 #ifdef __cplusplus
@@ -16,6 +16,7 @@
 #include "common_define.h"
 
 #define SKIPLIST_DEFAULT_MIN_ALLOC_ELEMENTS_ONCE 128
+#define SKIPLIST_MAX_LEVEL_COUNT 20
 
 typedef int (*skiplist_compare_func)(const void *p1, const void *p2);
 typedef void (*skiplist_free_func)(void *ptr);
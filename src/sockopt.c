@@ -59,6 +59,19 @@
 #define USE_POLL
 #endif
 
+#if defined(OS_LINUX) && defined(SPLICE_F_MOVE) && defined(F_SETPIPE_SZ)
+#define USE_SPLICE
+#endif
+
+#ifdef MSG_DONTWAIT
+#define USE_OPTIMISTIC_IO
+#endif
+
+#if defined(OS_LINUX) && defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+#define USE_ZEROCOPY
+#include <linux/errqueue.h>
+#endif
+
 #ifdef OS_LINUX
 #ifndef TCP_KEEPIDLE
 #define TCP_KEEPIDLE	 4	/* Start keeplives after this period */
@@ -73,6 +86,10 @@
 #endif
 #endif
 
+bool g_tcprecvfile_use_splice = true;
+bool g_tcp_bulk_send_mode = false;
+bool g_tcp_optimistic_io = true;
+
 int tcpgets(int sock, char* s, const int size, const int timeout)
 {
 	int result;
@@ -122,6 +139,9 @@ int tcprecvdata_ex(int sock, void *data, const int size, \
 	int res;
 	int ret_code;
 	unsigned char* p;
+#ifdef USE_OPTIMISTIC_IO
+	bool try_first;
+#endif
 #ifdef USE_SELECT
 	fd_set read_set;
 	struct timeval t;
@@ -141,8 +161,40 @@ int tcprecvdata_ex(int sock, void *data, const int size, \
 	ret_code = 0;
 	p = (unsigned char*)data;
 	left_bytes = size;
+#ifdef USE_OPTIMISTIC_IO
+	try_first = g_tcp_optimistic_io;
+#endif
 	while (left_bytes > 0)
 	{
+#ifdef USE_OPTIMISTIC_IO
+		if (try_first)
+		{
+			read_bytes = recv(sock, p, left_bytes, MSG_DONTWAIT);
+			if (read_bytes > 0)
+			{
+				//wait the remain data by poll
+				try_first = false;
+				left_bytes -= read_bytes;
+				p += read_bytes;
+				continue;
+			}
+			if (read_bytes == 0)
+			{
+				ret_code = ENOTCONN;
+				break;
+			}
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			if (!(errno == EAGAIN || errno == EWOULDBLOCK))
+			{
+				ret_code = errno != 0 ? errno : EINTR;
+				break;
+			}
+			try_first = false;
+		}
+#endif
 
 #ifdef USE_SELECT
 		if (timeout <= 0)
@@ -213,6 +265,9 @@ int tcpsenddata(int sock, void* data, const int size, const int timeout)
 	int write_bytes;
 	int result;
 	unsigned char* p;
+#ifdef USE_OPTIMISTIC_IO
+	bool try_first;
+#endif
 #ifdef USE_SELECT
 	fd_set write_set;
 	struct timeval t;
@@ -230,8 +285,35 @@ int tcpsenddata(int sock, void* data, const int size, const int timeout)
 
 	p = (unsigned char*)data;
 	left_bytes = size;
+#ifdef USE_OPTIMISTIC_IO
+	try_first = g_tcp_optimistic_io;
+#endif
 	while (left_bytes > 0)
 	{
+#ifdef USE_OPTIMISTIC_IO
+		if (try_first)
+		{
+			write_bytes = send(sock, p, left_bytes, MSG_DONTWAIT);
+			if (write_bytes >= 0)
+			{
+				//the socket buffer is full, wait by poll
+				try_first = false;
+				left_bytes -= write_bytes;
+				p += write_bytes;
+				continue;
+			}
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			if (!(errno == EAGAIN || errno == EWOULDBLOCK))
+			{
+				return errno != 0 ? errno : EINTR;
+			}
+			try_first = false;
+		}
+#endif
+
 #ifdef USE_SELECT
 		if (timeout <= 0)
 		{
@@ -394,6 +476,15 @@ int tcpsenddata_nb(int sock, void* data, const int size, const int timeout)
 #else
 	struct pollfd pollfds;
 #endif
+#ifdef USE_ZEROCOPY
+	TCPZeroCopyContext zc_ctx;
+
+	if (g_tcp_bulk_send_mode && size >= TCP_BULK_SEND_MIN_BYTES && \
+		tcpzerocopy_init(&zc_ctx, sock, NULL, NULL) == 0)
+	{
+		return tcpsenddata_zc(&zc_ctx, data, size, timeout);
+	}
+#endif
 
 #ifdef USE_SELECT
 	FD_ZERO(&write_set);
@@ -458,6 +549,428 @@ int tcpsenddata_nb(int sock, void* data, const int size, const int timeout)
 	return 0;
 }
 
+/* wait the socket readable (POLLIN) or writable (POLLOUT),
+ * return 0 for ready, != 0 for error no */
+static int tcpwaitevent(int sock, const short events, const int timeout)
+{
+	int result;
+#ifdef USE_SELECT
+	fd_set fds;
+	struct timeval t;
+#else
+	struct pollfd pollfds;
+#endif
+
+	while (1)
+	{
+#ifdef USE_SELECT
+		FD_ZERO(&fds);
+		FD_SET(sock, &fds);
+		t.tv_usec = 0;
+		t.tv_sec = timeout;
+		if (events == POLLIN)
+		{
+			result = select(sock+1, &fds, NULL, NULL, \
+					timeout <= 0 ? NULL : &t);
+		}
+		else
+		{
+			result = select(sock+1, NULL, &fds, NULL, \
+					timeout <= 0 ? NULL : &t);
+		}
+#else
+		pollfds.fd = sock;
+		pollfds.events = events;
+		result = poll(&pollfds, 1, 1000 * timeout);
+		if (result > 0 && (pollfds.revents & POLLHUP) && \
+			!(pollfds.revents & events))
+		{
+			return ENOTCONN;
+		}
+#endif
+
+		if (result < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			return errno != 0 ? errno : EINTR;
+		}
+		else if (result == 0)
+		{
+			return ETIMEDOUT;
+		}
+
+		return 0;
+	}
+}
+
+static int tcpdosendv(int sock, struct iovec *iov, int iovcnt, \
+		const int timeout, const bool wait_first)
+{
+	ssize_t write_bytes;
+	int result;
+
+	if (wait_first && (result=tcpwaitevent(sock, POLLOUT, timeout)) != 0)
+	{
+		return result;
+	}
+
+	tcpadvanceiov(&iov, &iovcnt, 0);  //skip the empty vectors
+	while (iovcnt > 0)
+	{
+		write_bytes = writev(sock, iov, iovcnt < IOV_MAX ? \
+				iovcnt : IOV_MAX);
+		if (write_bytes < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			if (!(errno == EAGAIN || errno == EWOULDBLOCK))
+			{
+				return errno != 0 ? errno : EINTR;
+			}
+			write_bytes = 0;
+		}
+
+		tcpadvanceiov(&iov, &iovcnt, write_bytes);
+		if (iovcnt > 0 && (wait_first || write_bytes == 0))
+		{
+			if ((result=tcpwaitevent(sock, POLLOUT, timeout)) != 0)
+			{
+				return result;
+			}
+		}
+	}
+
+	return 0;
+}
+
+int tcpsendv(int sock, struct iovec *iov, int iovcnt, const int timeout)
+{
+	return tcpdosendv(sock, iov, iovcnt, timeout, true);
+}
+
+int tcpsendv_nb(int sock, struct iovec *iov, int iovcnt, const int timeout)
+{
+	return tcpdosendv(sock, iov, iovcnt, timeout, false);
+}
+
+static int tcpdorecvv(int sock, struct iovec *iov, int iovcnt, \
+		const int timeout, int *count, const bool wait_first)
+{
+	ssize_t read_bytes;
+	int total_bytes;
+	int result;
+
+	result = 0;
+	total_bytes = 0;
+	if (wait_first)
+	{
+		result = tcpwaitevent(sock, POLLIN, timeout);
+	}
+
+	tcpadvanceiov(&iov, &iovcnt, 0);  //skip the empty vectors
+	while (result == 0 && iovcnt > 0)
+	{
+		read_bytes = readv(sock, iov, iovcnt < IOV_MAX ? \
+				iovcnt : IOV_MAX);
+		if (read_bytes < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			if (!(errno == EAGAIN || errno == EWOULDBLOCK))
+			{
+				result = errno != 0 ? errno : EINTR;
+				break;
+			}
+			read_bytes = 0;
+		}
+		else if (read_bytes == 0)
+		{
+			result = ENOTCONN;
+			break;
+		}
+
+		total_bytes += read_bytes;
+		tcpadvanceiov(&iov, &iovcnt, read_bytes);
+		if (iovcnt > 0 && (wait_first || read_bytes == 0))
+		{
+			result = tcpwaitevent(sock, POLLIN, timeout);
+		}
+	}
+
+	if (count != NULL)
+	{
+		*count = total_bytes;
+	}
+	return result;
+}
+
+int tcprecvv(int sock, struct iovec *iov, int iovcnt, \
+		const int timeout, int *count)
+{
+	return tcpdorecvv(sock, iov, iovcnt, timeout, count, true);
+}
+
+int tcprecvv_nb(int sock, struct iovec *iov, int iovcnt, \
+		const int timeout, int *count)
+{
+	return tcpdorecvv(sock, iov, iovcnt, timeout, count, false);
+}
+
+int tcpsetcork(int sock, const bool on)
+{
+#if defined(OS_LINUX) && defined(TCP_CORK)
+	int cork;
+
+	cork = on ? 1 : 0;
+	if (setsockopt(sock, SOL_TCP, TCP_CORK, &cork, sizeof(cork)) < 0)
+	{
+		logError("file: "__FILE__", line: %d, " \
+			"setsockopt failed, errno: %d, error info: %s", \
+			__LINE__, errno, STRERROR(errno));
+		return errno != 0 ? errno : EINVAL;
+	}
+	return 0;
+#else
+	return EOPNOTSUPP;
+#endif
+}
+
+int tcpsetnotsentlowat(int sock, const int bytes)
+{
+#if defined(OS_LINUX) && defined(TCP_NOTSENT_LOWAT)
+	if (setsockopt(sock, SOL_TCP, TCP_NOTSENT_LOWAT, \
+		&bytes, sizeof(bytes)) < 0)
+	{
+		logError("file: "__FILE__", line: %d, " \
+			"setsockopt failed, errno: %d, error info: %s", \
+			__LINE__, errno, STRERROR(errno));
+		return errno != 0 ? errno : EINVAL;
+	}
+	return 0;
+#else
+	return EOPNOTSUPP;
+#endif
+}
+
+int tcpzerocopy_init(TCPZeroCopyContext *ctx, int sock, \
+		tcp_zerocopy_done_func done_callback, void *arg)
+{
+#ifdef USE_ZEROCOPY
+	int on;
+
+	on = 1;
+	if (setsockopt(sock, SOL_SOCKET, SO_ZEROCOPY, &on, sizeof(on)) < 0)
+	{
+		return EOPNOTSUPP;
+	}
+
+	ctx->sock = sock;
+	ctx->next_seq = 0;
+	ctx->done_count = 0;
+	ctx->done_callback = done_callback;
+	ctx->arg = arg;
+	return 0;
+#else
+	return EOPNOTSUPP;
+#endif
+}
+
+int tcpzerocopy_send(TCPZeroCopyContext *ctx, void *data, const int size, \
+		int *sent_bytes, uint32_t *seq, bool *copied)
+{
+#ifdef USE_ZEROCOPY
+	int bytes;
+
+	*sent_bytes = 0;
+	*copied = false;
+	while (1)
+	{
+		bytes = send(ctx->sock, data, size, MSG_ZEROCOPY | MSG_DONTWAIT);
+		if (bytes >= 0)
+		{
+			break;
+		}
+		if (errno == EINTR)
+		{
+			continue;
+		}
+		if (errno == EAGAIN || errno == EWOULDBLOCK)
+		{
+			return EAGAIN;
+		}
+		if (errno == ENOBUFS)  //exceeds the optmem limit, send by copy
+		{
+			bytes = send(ctx->sock, data, size, MSG_DONTWAIT);
+			if (bytes >= 0)
+			{
+				*sent_bytes = bytes;
+				*copied = true;
+				return 0;
+			}
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+			{
+				return EAGAIN;
+			}
+		}
+		return errno != 0 ? errno : EIO;
+	}
+
+	*sent_bytes = bytes;
+	*seq = ctx->next_seq++;
+	return 0;
+#else
+	return EOPNOTSUPP;
+#endif
+}
+
+int tcpzerocopy_reap(TCPZeroCopyContext *ctx)
+{
+#ifdef USE_ZEROCOPY
+	struct msghdr msg;
+	struct cmsghdr *cmsg;
+	struct sock_extended_err *serr;
+	char control[128];
+	int count;
+
+	count = 0;
+	while (1)
+	{
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+		if (recvmsg(ctx->sock, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+			{
+				break;
+			}
+			return errno != 0 ? -1 * errno : -1 * EIO;
+		}
+
+		for (cmsg=CMSG_FIRSTHDR(&msg); cmsg!=NULL; \
+				cmsg=CMSG_NXTHDR(&msg, cmsg))
+		{
+			if (!((cmsg->cmsg_level == SOL_IP && \
+				cmsg->cmsg_type == IP_RECVERR) || \
+				(cmsg->cmsg_level == SOL_IPV6 && \
+				 cmsg->cmsg_type == IPV6_RECVERR)))
+			{
+				continue;
+			}
+
+			serr = (struct sock_extended_err *)CMSG_DATA(cmsg);
+			if (serr->ee_errno != 0 || serr->ee_origin != \
+					SO_EE_ORIGIN_ZEROCOPY)
+			{
+				continue;
+			}
+
+			//the range from ee_info to ee_data
+			ctx->done_count += serr->ee_data - serr->ee_info + 1;
+			count += serr->ee_data - serr->ee_info + 1;
+			if (ctx->done_callback != NULL)
+			{
+				ctx->done_callback(ctx->arg, serr->ee_info, \
+					serr->ee_data, (serr->ee_code & \
+					SO_EE_CODE_ZEROCOPY_COPIED) != 0);
+			}
+		}
+	}
+
+	return count;
+#else
+	return -1 * EOPNOTSUPP;
+#endif
+}
+
+int tcpzerocopy_wait(TCPZeroCopyContext *ctx, const int timeout)
+{
+	struct pollfd pollfds;
+	int result;
+
+	pollfds.fd = ctx->sock;
+	pollfds.events = 0;  //the error queue is reported as POLLERR
+	while (!tcpzerocopy_all_done(ctx))
+	{
+		if ((result=tcpzerocopy_reap(ctx)) < 0)
+		{
+			return -1 * result;
+		}
+		if (tcpzerocopy_all_done(ctx))
+		{
+			break;
+		}
+
+		result = poll(&pollfds, 1, 1000 * timeout);
+		if (result < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			return errno != 0 ? errno : EINTR;
+		}
+		else if (result == 0)
+		{
+			return ETIMEDOUT;
+		}
+	}
+
+	return 0;
+}
+
+int tcpsenddata_zc(TCPZeroCopyContext *ctx, void *data, const int size, \
+		const int timeout)
+{
+	char *p;
+	int left_bytes;
+	int sent_bytes;
+	int result;
+	uint32_t seq;
+	bool copied;
+
+	p = (char *)data;
+	left_bytes = size;
+	while (left_bytes > 0)
+	{
+		result = tcpzerocopy_send(ctx, p, left_bytes, &sent_bytes,
+				&seq, &copied);
+		if (result == 0)
+		{
+			left_bytes -= sent_bytes;
+			p += sent_bytes;
+			continue;
+		}
+		if (result != EAGAIN)
+		{
+			return result;
+		}
+
+		//reap for the optmem and wait the socket writable
+		if ((result=tcpzerocopy_reap(ctx)) < 0)
+		{
+			return -1 * result;
+		}
+		if ((result=tcpwaitevent(ctx->sock, POLLOUT, timeout)) != 0)
+		{
+			return result;
+		}
+	}
+
+	return tcpzerocopy_wait(ctx, timeout);
+}
+
 int setsockaddrbyip(const char *ip, const short port, struct sockaddr_in *addr,
         struct sockaddr_in6 *addr6, void **output, int *size)
 {
@@ -918,11 +1431,10 @@ int socketServer(const char *bind_ipaddr, const int port, int *err_no)
 	return sock;
 }
 
-int tcprecvfile(int sock, const char *filename, const int64_t file_bytes, \
-		const int fsync_after_written_bytes, const int timeout, \
-		int64_t *true_file_bytes)
+static int tcprecvfile_by_copy(int sock, int write_fd, const char *filename, \
+		const int64_t file_bytes, const int fsync_after_written_bytes, \
+		const int timeout, int64_t *true_file_bytes)
 {
-	int write_fd;
 	char buff[FAST_WRITE_BUFF_SIZE];
 	int64_t remain_bytes;
 	int recv_bytes;
@@ -932,11 +1444,13 @@ int tcprecvfile(int sock, const char *filename, const int64_t file_bytes, \
 	int count;
 	tcprecvdata_exfunc recv_func;
 
-	*true_file_bytes = 0;
 	flags = fcntl(sock, F_GETFL, 0);
 	if (flags < 0)
 	{
-		return errno != 0 ? errno : EACCES;
+		result = errno != 0 ? errno : EACCES;
+		close(write_fd);
+		unlink(filename);
+		return result;
 	}
 
 	if (flags & O_NONBLOCK)
@@ -948,14 +1462,8 @@ int tcprecvfile(int sock, const char *filename, const int64_t file_bytes, \
 		recv_func = tcprecvdata_ex;
 	}
 
-	write_fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
-	if (write_fd < 0)
-	{
-		return errno != 0 ? errno : EACCES;
-	}
-
 	written_bytes = 0;
-	remain_bytes = file_bytes;
+	remain_bytes = file_bytes - *true_file_bytes;
 	while (remain_bytes > 0)
 	{
 		if (remain_bytes > sizeof(buff))
@@ -1071,6 +1579,225 @@ int tcprecvfile(int sock, const char *filename, const int64_t file_bytes, \
 	return 0;
 }
 
+#ifdef USE_SPLICE
+/* move the data in the pipe to the file by read and write,
+ * for the file which does not support splice */
+static int tcprecvfile_drain_pipe(int pipe_fd, int write_fd, int bytes)
+{
+	char buff[16 * 1024];
+	int read_bytes;
+
+	while (bytes > 0)
+	{
+		read_bytes = read(pipe_fd, buff, bytes < (int)sizeof(buff) ? \
+				bytes : (int)sizeof(buff));
+		if (read_bytes <= 0)
+		{
+			if (read_bytes < 0 && errno == EINTR)
+			{
+				continue;
+			}
+			return errno != 0 ? errno : EIO;
+		}
+
+		if (write(write_fd, buff, read_bytes) != read_bytes)
+		{
+			return errno != 0 ? errno : EIO;
+		}
+		bytes -= read_bytes;
+	}
+
+	return 0;
+}
+
+/* receive the file by splice: socket -> pipe -> file without the copy
+ * to the user space.
+ * return EOPNOTSUPP when the fd types do not support splice, the caller
+ * should receive the remain bytes (file_bytes - *true_file_bytes) by copy
+ */
+static int tcprecvfile_by_splice(int sock, int write_fd, \
+		const int64_t file_bytes, const int fsync_after_written_bytes, \
+		const int timeout, int64_t *true_file_bytes)
+{
+	int pipe_fds[2];
+	int pipe_size;
+	int64_t remain_bytes;
+	int written_bytes;
+	int recv_bytes;
+	int left_bytes;
+	int bytes;
+	int result;
+	struct pollfd pollfds;
+
+	if (pipe(pipe_fds) != 0)
+	{
+		return EOPNOTSUPP;
+	}
+
+	//the bigger pipe for less splice calls, ignore the failure
+	fcntl(pipe_fds[1], F_SETPIPE_SZ, FAST_WRITE_BUFF_SIZE);
+	pipe_size = fcntl(pipe_fds[1], F_GETPIPE_SZ);
+	if (pipe_size <= 0)
+	{
+		pipe_size = 64 * 1024;
+	}
+
+	pollfds.fd = sock;
+	pollfds.events = POLLIN;
+
+	result = 0;
+	written_bytes = 0;
+	remain_bytes = file_bytes;
+	while (remain_bytes > 0)
+	{
+		bytes = poll(&pollfds, 1, 1000 * timeout);
+		if (bytes < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			result = errno != 0 ? errno : EINTR;
+			break;
+		}
+		else if (bytes == 0)
+		{
+			result = ETIMEDOUT;
+			break;
+		}
+		if ((pollfds.revents & POLLHUP) && !(pollfds.revents & POLLIN))
+		{
+			result = ENOTCONN;
+			break;
+		}
+
+		recv_bytes = splice(sock, NULL, pipe_fds[1], NULL, \
+				remain_bytes < pipe_size ? remain_bytes : pipe_size, \
+				SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+		if (recv_bytes < 0)
+		{
+			if (errno == EINTR || errno == EAGAIN)
+			{
+				continue;
+			}
+			if ((errno == EINVAL || errno == ENOSYS) && \
+				*true_file_bytes == 0)
+			{
+				result = EOPNOTSUPP;
+			}
+			else
+			{
+				result = errno != 0 ? errno : EIO;
+			}
+			break;
+		}
+		if (recv_bytes == 0)
+		{
+			result = ENOTCONN;
+			break;
+		}
+
+		left_bytes = recv_bytes;
+		while (left_bytes > 0)
+		{
+			bytes = splice(pipe_fds[0], NULL, write_fd, NULL, \
+					left_bytes, SPLICE_F_MOVE);
+			if (bytes > 0)
+			{
+				left_bytes -= bytes;
+				continue;
+			}
+
+			if (bytes < 0 && errno == EINTR)
+			{
+				continue;
+			}
+			if (bytes < 0 && errno == EINVAL && *true_file_bytes == 0)
+			{
+				//the file does not support splice
+				if ((result=tcprecvfile_drain_pipe(pipe_fds[0], \
+					write_fd, left_bytes)) == 0)
+				{
+					result = EOPNOTSUPP;
+				}
+			}
+			else
+			{
+				result = errno != 0 ? errno : EIO;
+			}
+			break;
+		}
+
+		*true_file_bytes += recv_bytes - left_bytes;
+		if (result != 0)
+		{
+			if (result == EOPNOTSUPP)
+			{
+				*true_file_bytes += left_bytes;
+			}
+			break;
+		}
+
+		remain_bytes -= recv_bytes;
+		if (fsync_after_written_bytes > 0)
+		{
+			written_bytes += recv_bytes;
+			if (written_bytes >= fsync_after_written_bytes)
+			{
+				written_bytes = 0;
+				if (fsync(write_fd) != 0)
+				{
+					result = errno != 0 ? errno: EIO;
+					break;
+				}
+			}
+		}
+	}
+
+	close(pipe_fds[0]);
+	close(pipe_fds[1]);
+	return result;
+}
+#endif
+
+int tcprecvfile(int sock, const char *filename, const int64_t file_bytes, \
+		const int fsync_after_written_bytes, const int timeout, \
+		int64_t *true_file_bytes)
+{
+	int write_fd;
+#ifdef USE_SPLICE
+	int result;
+#endif
+
+	*true_file_bytes = 0;
+	write_fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (write_fd < 0)
+	{
+		return errno != 0 ? errno : EACCES;
+	}
+
+#ifdef USE_SPLICE
+	//the infinite file is terminated by the connection close, use copy
+	if (file_bytes != INFINITE_FILE_SIZE && g_tcprecvfile_use_splice)
+	{
+		result = tcprecvfile_by_splice(sock, write_fd, file_bytes, \
+				fsync_after_written_bytes, timeout, true_file_bytes);
+		if (result != EOPNOTSUPP)
+		{
+			close(write_fd);
+			if (result != 0)
+			{
+				unlink(filename);
+			}
+			return result;
+		}
+	}
+#endif
+
+	return tcprecvfile_by_copy(sock, write_fd, filename, file_bytes, \
+			fsync_after_written_bytes, timeout, true_file_bytes);
+}
+
 int tcprecvfile_ex(int sock, const char *filename, const int64_t file_bytes, \
 		const int fsync_after_written_bytes, \
 		unsigned int *hash_codes, const int timeout)
@@ -1229,6 +1956,9 @@ int tcpsendfile_ex(int sock, const char *filename, const int64_t file_offset, \
 	off_t offset;
 	int64_t remain_bytes;
    #endif
+   #ifdef OS_LINUX
+	bool cork;
+   #endif
 #else
 	int64_t remain_bytes;
 #endif
@@ -1274,6 +2004,10 @@ int tcpsendfile_ex(int sock, const char *filename, const int64_t file_offset, \
 
 #define FILE_1G_SIZE    (1 * 1024 * 1024 * 1024)
 
+	//the full frames only until the last part
+	cork = g_tcp_bulk_send_mode && file_bytes >= TCP_BULK_SEND_MIN_BYTES \
+		&& tcpsetcork(sock, true) == 0;
+
 	result = 0;
 	offset = file_offset;
 	remain_bytes = file_bytes;
@@ -1301,6 +2035,11 @@ int tcpsendfile_ex(int sock, const char *filename, const int64_t file_offset, \
 		remain_bytes -= send_bytes;
 	}
 
+	if (cork)
+	{
+		tcpsetcork(sock, false);
+	}
+
 #else
 #ifdef OS_FREEBSD
 	offset = file_offset;
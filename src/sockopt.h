@@ -13,10 +13,16 @@
 
 #include <net/if.h>
 #include <string.h>
+#include <limits.h>
+#include <sys/uio.h>
 #include "common_define.h"
 
 #define FAST_WRITE_BUFF_SIZE  256 * 1024
 
+#ifndef IOV_MAX
+#define IOV_MAX  1024  //the max io vectors of writev / readv
+#endif
+
 typedef struct fast_if_config {
     char name[IF_NAMESIZE];    //if name
     char mac[32];
@@ -29,10 +35,39 @@ typedef struct ip_addr_s {
     int socket_domain;
 } ip_addr_t;
 
+/* the min bytes to send by the bulk mode, the zero copy has the page pin
+ * and the notification cost, it is worth for the big buffer only */
+#define TCP_BULK_SEND_MIN_BYTES  (1024 * 1024)
+
+typedef void (*tcp_zerocopy_done_func)(void *arg, const uint32_t lo, \
+		const uint32_t hi, const bool copied);
+
+typedef struct tcp_zerocopy_context {
+	int sock;
+	uint32_t next_seq;    //the sequence of the next zero copy send
+	uint32_t done_count;  //the completed send count
+	tcp_zerocopy_done_func done_callback;  //lo to hi sequences completed
+	void *arg;
+} TCPZeroCopyContext;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/* tcprecvfile receives the file by splice (socket -> pipe -> file) on
+ * Linux, set to false to always copy by recv and write, default true */
+extern bool g_tcprecvfile_use_splice;
+
+/* the opt-in bulk send mode for the big buffer (TCP_BULK_SEND_MIN_BYTES):
+ * tcpsenddata_nb sends by MSG_ZEROCOPY, tcpsendfile_ex corks the socket,
+ * Linux only, default false */
+extern bool g_tcp_bulk_send_mode;
+
+/* tcprecvdata_ex and tcpsenddata (block mode) try recv / send without
+ * wait (MSG_DONTWAIT) first, and poll only when the data not ready,
+ * one syscall for the request / response on the fast path, default true */
+extern bool g_tcp_optimistic_io;
+
 typedef int (*getnamefunc)(int socket, struct sockaddr *address, \
 		socklen_t *address_len);
 
@@ -114,6 +149,158 @@ int tcpsenddata(int sock, void* data, const int size, const int timeout);
 */
 int tcpsenddata_nb(int sock, void* data, const int size, const int timeout);
 
+/** skip the sent or received bytes of the io vectors for resuming
+ *  parameters:
+ *          iov: the io vectors, point to the first unfinished vector after
+ *          iovcnt: the io vector count, the unfinished count after
+ *          bytes: the bytes to skip
+ *  return: none
+*/
+static inline void tcpadvanceiov(struct iovec **iov, int *iovcnt, \
+		size_t bytes)
+{
+	while (*iovcnt > 0 && bytes >= (*iov)->iov_len)
+	{
+		bytes -= (*iov)->iov_len;
+		(*iov)++;
+		(*iovcnt)--;
+	}
+
+	if (bytes > 0)
+	{
+		(*iov)->iov_base = (char *)(*iov)->iov_base + bytes;
+		(*iov)->iov_len -= bytes;
+	}
+}
+
+/** send the io vectors by writev (block mode), such as header, body and
+ *  trailer in one syscall, the partial write is resumed
+ *  parameters:
+ *          sock: the socket
+ *          iov: the io vectors, the array will be modified
+ *          iovcnt: the io vector count
+ *          timeout: write timeout
+ *  return: error no, 0 success, != 0 fail
+*/
+int tcpsendv(int sock, struct iovec *iov, int iovcnt, const int timeout);
+
+/** send the io vectors by writev (non-block mode)
+ *  parameters:
+ *          sock: the socket
+ *          iov: the io vectors, the array will be modified
+ *          iovcnt: the io vector count
+ *          timeout: write timeout
+ *  return: error no, 0 success, != 0 fail
+*/
+int tcpsendv_nb(int sock, struct iovec *iov, int iovcnt, const int timeout);
+
+/** recv data to the io vectors by readv (block mode)
+ *  parameters:
+ *          sock: the socket
+ *          iov: the io vectors, the array will be modified
+ *          iovcnt: the io vector count
+ *          timeout: read timeout
+ *          count: store the bytes recveived, can be NULL
+ *  return: error no, 0 success, != 0 fail
+*/
+int tcprecvv(int sock, struct iovec *iov, int iovcnt, \
+		const int timeout, int *count);
+
+/** recv data to the io vectors by readv (non-block mode)
+ *  parameters:
+ *          sock: the socket
+ *          iov: the io vectors, the array will be modified
+ *          iovcnt: the io vector count
+ *          timeout: read timeout
+ *          count: store the bytes recveived, can be NULL
+ *  return: error no, 0 success, != 0 fail
+*/
+int tcprecvv_nb(int sock, struct iovec *iov, int iovcnt, \
+		const int timeout, int *count);
+
+/** set socket TCP_CORK (Linux only) for the bulk send, the partial frames
+ *  are sent when cork off
+ *  parameters:
+ *          sock: the socket
+ *          on: cork on or off
+ *  return: error no, 0 success, != 0 fail
+*/
+int tcpsetcork(int sock, const bool on);
+
+/** set socket TCP_NOTSENT_LOWAT (Linux only), the socket is writable only
+ *  when the not sent bytes less than this, limits the memory in the socket
+ *  buffer for the bulk send of the non-block socket
+ *  parameters:
+ *          sock: the socket
+ *          bytes: the low water mark of the not sent bytes
+ *  return: error no, 0 success, != 0 fail
+*/
+int tcpsetnotsentlowat(int sock, const int bytes);
+
+/** init the zero copy send context and set SO_ZEROCOPY of the socket
+ *  (Linux 4.14+), the completions of MSG_ZEROCOPY send are notified by
+ *  the socket error queue, as IOEVENT_ERROR of ioevent
+ *  parameters:
+ *          ctx: the context to init
+ *          sock: the socket
+ *          done_callback: called for every completion, can be NULL
+ *          arg: the argument of the callback
+ *  return: error no, 0 success, EOPNOTSUPP for not supported
+*/
+int tcpzerocopy_init(TCPZeroCopyContext *ctx, int sock, \
+		tcp_zerocopy_done_func done_callback, void *arg);
+
+/** send by MSG_ZEROCOPY once without wait, the data must keep unchanged
+ *  until the completion of the sequence. the data is sent by copy when
+ *  the optmem limit exceeded (ENOBUFS), no sequence is consumed and no
+ *  completion will be notified for this send, the buffer can be reused
+ *  when return
+ *  parameters:
+ *          ctx: the zero copy context
+ *          data: the buffer to send
+ *          size: buffer size
+ *          sent_bytes: store the sent bytes
+ *          seq: store the sequence of this send, NOT set when copied
+ *          copied: store true for sent by copy, false for zero copy
+ *  return: error no, 0 success, EAGAIN for the socket buffer is full
+*/
+int tcpzerocopy_send(TCPZeroCopyContext *ctx, void *data, const int size, \
+		int *sent_bytes, uint32_t *seq, bool *copied);
+
+/** reap the completions from the socket error queue without wait and
+ *  call the done callback
+ *  parameters:
+ *          ctx: the zero copy context
+ *  return: the completed send count, < 0 for error (negative error no)
+*/
+int tcpzerocopy_reap(TCPZeroCopyContext *ctx);
+
+/** wait all the zero copy sends completed
+ *  parameters:
+ *          ctx: the zero copy context
+ *          timeout: wait timeout
+ *  return: error no, 0 success, != 0 fail
+*/
+int tcpzerocopy_wait(TCPZeroCopyContext *ctx, const int timeout);
+
+//if all the zero copy sends completed
+static inline bool tcpzerocopy_all_done(TCPZeroCopyContext *ctx)
+{
+	return ctx->done_count == ctx->next_seq;
+}
+
+/** send data by MSG_ZEROCOPY and wait the completions, so the buffer can
+ *  be reused when return
+ *  parameters:
+ *          ctx: the zero copy context
+ *          data: the buffer to send
+ *          size: buffer size
+ *          timeout: write timeout
+ *  return: error no, 0 success, != 0 fail
+*/
+int tcpsenddata_zc(TCPZeroCopyContext *ctx, void *data, const int size, \
+		const int timeout);
+
 /** connect to server by block mode
  *  parameters:
  *          sock: the socket
@@ -284,7 +471,8 @@ int socketServer(const char *bind_ipaddr, const int port, int *err_no);
 int tcpsendfile_ex(int sock, const char *filename, const int64_t file_offset, \
 	const int64_t file_bytes, const int timeout, int64_t *total_send_bytes);
 
-/** receive data to a file
+/** receive data to a file, zero copy by splice on Linux, fall back to
+ *  recv and write when the fd types do not support splice
  *  parameters:
  *          sock: the socket
  *          filename: the file to write
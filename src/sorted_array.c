@@ -0,0 +1,377 @@
+/**
+* Copyright (C) 2015 Happy Fish / YuQing
+*
+* libfastcommon may be copied only under the terms of the GNU General
+* Public License V3, which may be found in the FastDFS source kit.
+* Please visit the FastDFS Home Page http://www.csource.org/ for more detail.
+**/
+
+//sorted_array.c
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE4_2__)
+#include <nmmintrin.h>
+#endif
+#include "logger.h"
+#include "sorted_array.h"
+
+//the binary search stops at this window size, then scan the window
+#define SORTED_ARRAY_SCAN_SIZE  16
+
+//if the element is before the insert position of the target
+#define SORTED_ARRAY_BEFORE(compare, or_equal) \
+    ((or_equal) ? (compare) <= 0 : (compare) < 0)
+
+static int sorted_array_alloc(SortedArray *sa, const int capacity)
+{
+    void **data;
+    int64_t *keys;
+    int bytes;
+
+    bytes = sizeof(void *) * capacity;
+    data = (void **)realloc(sa->data, bytes);
+    if (data == NULL) {
+        logError("file: "__FILE__", line: %d, "
+                "malloc %d bytes fail, errno: %d, error info: %s",
+                __LINE__, bytes, errno, STRERROR(errno));
+        return errno != 0 ? errno : ENOMEM;
+    }
+    sa->data = data;
+
+    if (sa->key_func != NULL) {
+        bytes = sizeof(int64_t) * capacity;
+        keys = (int64_t *)realloc(sa->keys, bytes);
+        if (keys == NULL) {
+            logError("file: "__FILE__", line: %d, "
+                    "malloc %d bytes fail, errno: %d, error info: %s",
+                    __LINE__, bytes, errno, STRERROR(errno));
+            return errno != 0 ? errno : ENOMEM;
+        }
+        sa->keys = keys;
+    }
+
+    sa->capacity = capacity;
+    return 0;
+}
+
+int sorted_array_init_ex(SortedArray *sa, const int init_capacity,
+        skiplist_compare_func compare_func, skiplist_free_func free_func,
+        sorted_array_key_func key_func)
+{
+    int result;
+
+    if (compare_func == NULL && key_func == NULL) {
+        logError("file: "__FILE__", line: %d, "
+                "compare_func and key_func are both NULL", __LINE__);
+        return EINVAL;
+    }
+
+    sa->count = 0;
+    sa->gap_start = 0;
+    sa->data = NULL;
+    sa->keys = NULL;
+    sa->compare_func = compare_func;
+    sa->free_func = free_func;
+    sa->key_func = key_func;
+    if ((result=sorted_array_alloc(sa, init_capacity > 0 ? init_capacity :
+                    SORTED_ARRAY_DEFAULT_CAPACITY)) != 0)
+    {
+        sorted_array_destroy(sa);
+        return result;
+    }
+
+    return 0;
+}
+
+void sorted_array_destroy(SortedArray *sa)
+{
+    int i;
+
+    if (sa->free_func != NULL) {
+        for (i=0; i<sa->count; i++) {
+            sa->free_func(sorted_array_get(sa, i));
+        }
+    }
+
+    if (sa->data != NULL) {
+        free(sa->data);
+        sa->data = NULL;
+    }
+    if (sa->keys != NULL) {
+        free(sa->keys);
+        sa->keys = NULL;
+    }
+    sa->count = 0;
+    sa->capacity = 0;
+    sa->gap_start = 0;
+}
+
+//return the count of the keys before the target in the window
+static inline int sorted_array_scan_keys(const int64_t *keys, const int n,
+        const int64_t key, const bool or_equal)
+{
+    int count;
+    int i;
+
+    count = 0;
+    i = 0;
+#if defined(__AVX2__)
+    {
+        __m256i target;
+        __m256i values;
+        int mask;
+
+        target = _mm256_set1_epi64x(key);
+        for (; i + 4 <= n; i += 4) {
+            values = _mm256_loadu_si256((const __m256i *)(keys + i));
+            if (or_equal) {
+                mask = _mm256_movemask_pd(_mm256_castsi256_pd(
+                            _mm256_cmpgt_epi64(values, target)));
+                count += 4 - __builtin_popcount(mask);
+            } else {
+                mask = _mm256_movemask_pd(_mm256_castsi256_pd(
+                            _mm256_cmpgt_epi64(target, values)));
+                count += __builtin_popcount(mask);
+            }
+        }
+    }
+#elif defined(__SSE4_2__)
+    {
+        __m128i target;
+        __m128i values;
+        int mask;
+
+        target = _mm_set1_epi64x(key);
+        for (; i + 2 <= n; i += 2) {
+            values = _mm_loadu_si128((const __m128i *)(keys + i));
+            if (or_equal) {
+                mask = _mm_movemask_pd(_mm_castsi128_pd(
+                            _mm_cmpgt_epi64(values, target)));
+                count += 2 - __builtin_popcount(mask);
+            } else {
+                mask = _mm_movemask_pd(_mm_castsi128_pd(
+                            _mm_cmpgt_epi64(target, values)));
+                count += __builtin_popcount(mask);
+            }
+        }
+    }
+#endif
+
+    for (; i<n; i++) {
+        count += or_equal ? (keys[i] <= key) : (keys[i] < key);
+    }
+    return count;
+}
+
+static inline int sorted_array_search_keys(const int64_t *keys, int n,
+        const int64_t key, const bool or_equal)
+{
+    const int64_t *base;
+    int half;
+
+    base = keys;
+    while (n > SORTED_ARRAY_SCAN_SIZE) {
+        half = n / 2;
+        base = ((or_equal ? base[half] <= key : base[half] < key) ?
+                base + half : base);
+        n -= half;
+    }
+
+    return (base - keys) + sorted_array_scan_keys(base, n, key, or_equal);
+}
+
+static inline int sorted_array_search_data(SortedArray *sa, void **array,
+        int n, void *data, const bool or_equal)
+{
+    void **base;
+    int half;
+
+    if (n == 0) {
+        return 0;
+    }
+
+    base = array;
+    while (n > 1) {
+        half = n / 2;
+        base = SORTED_ARRAY_BEFORE(sa->compare_func(base[half], data),
+                or_equal) ? base + half : base;
+        n -= half;
+    }
+
+    return (base - array) + (SORTED_ARRAY_BEFORE(
+                sa->compare_func(*base, data), or_equal) ? 1 : 0);
+}
+
+/**
+ * the elements are [0, gap_start) and [gap_start + gap size, capacity),
+ * search the first part when the target is before its last element
+*/
+static int sorted_array_search(SortedArray *sa, void *data,
+        const int64_t key, const bool or_equal)
+{
+    int gap_size;
+    int tail_count;
+
+    gap_size = sa->capacity - sa->count;
+    tail_count = sa->count - sa->gap_start;
+    if (sa->key_func != NULL) {
+        if (sa->gap_start > 0 && !(or_equal ?
+                    sa->keys[sa->gap_start - 1] <= key :
+                    sa->keys[sa->gap_start - 1] < key))
+        {
+            return sorted_array_search_keys(sa->keys,
+                    sa->gap_start, key, or_equal);
+        }
+        return sa->gap_start + sorted_array_search_keys(sa->keys +
+                sa->gap_start + gap_size, tail_count, key, or_equal);
+    }
+
+    if (sa->gap_start > 0 && !SORTED_ARRAY_BEFORE(sa->compare_func(
+                    sa->data[sa->gap_start - 1], data), or_equal))
+    {
+        return sorted_array_search_data(sa, sa->data,
+                sa->gap_start, data, or_equal);
+    }
+    return sa->gap_start + sorted_array_search_data(sa, sa->data +
+            sa->gap_start + gap_size, tail_count, data, or_equal);
+}
+
+//move the gap to the index, only the elements between are moved
+static void sorted_array_move_gap(SortedArray *sa, const int index)
+{
+    int gap_size;
+    int start;
+    int dest;
+    int count;
+
+    gap_size = sa->capacity - sa->count;
+    if (gap_size == 0 || index == sa->gap_start) {
+        sa->gap_start = index;
+        return;
+    }
+
+    if (index < sa->gap_start) {
+        start = index;
+        dest = index + gap_size;
+        count = sa->gap_start - index;
+    } else {
+        start = sa->gap_start + gap_size;
+        dest = sa->gap_start;
+        count = index - sa->gap_start;
+    }
+
+    memmove(sa->data + dest, sa->data + start, sizeof(void *) * count);
+    if (sa->keys != NULL) {
+        memmove(sa->keys + dest, sa->keys + start, sizeof(int64_t) * count);
+    }
+    sa->gap_start = index;
+}
+
+int sorted_array_insert(SortedArray *sa, void *data)
+{
+    int64_t key;
+    int index;
+    int result;
+
+    if (sa->count == sa->capacity) {
+        //the gap is empty, append the new gap at the end
+        sa->gap_start = sa->count;
+        if ((result=sorted_array_alloc(sa, sa->capacity * 2)) != 0) {
+            return result;
+        }
+    }
+
+    key = (sa->key_func != NULL) ? sa->key_func(data) : 0;
+    index = sorted_array_search(sa, data, key, true);
+    sorted_array_move_gap(sa, index);
+    sa->data[sa->gap_start] = data;
+    if (sa->keys != NULL) {
+        sa->keys[sa->gap_start] = key;
+    }
+    sa->gap_start++;
+    sa->count++;
+    return 0;
+}
+
+int sorted_array_delete_by_index(SortedArray *sa, const int index)
+{
+    void *data;
+
+    if (index < 0 || index >= sa->count) {
+        return EINVAL;
+    }
+
+    data = sorted_array_get(sa, index);
+    sorted_array_move_gap(sa, index);
+    sa->count--;  //the element after the gap joins the gap
+    if (sa->free_func != NULL) {
+        sa->free_func(data);
+    }
+    return 0;
+}
+
+static inline int sorted_array_find_index(SortedArray *sa, void *data)
+{
+    int64_t key;
+    int index;
+    int physical;
+
+    key = (sa->key_func != NULL) ? sa->key_func(data) : 0;
+    index = sorted_array_search(sa, data, key, false);
+    if (index == sa->count) {
+        return -1;
+    }
+
+    physical = index < sa->gap_start ? index :
+        index + sa->capacity - sa->count;
+    if (sa->key_func != NULL) {
+        return sa->keys[physical] == key ? index : -1;
+    } else {
+        return sa->compare_func(sa->data[physical], data) == 0 ? index : -1;
+    }
+}
+
+int sorted_array_delete(SortedArray *sa, void *data)
+{
+    int index;
+
+    if ((index=sorted_array_find_index(sa, data)) < 0) {
+        return ENOENT;
+    }
+    return sorted_array_delete_by_index(sa, index);
+}
+
+void *sorted_array_find(SortedArray *sa, void *data)
+{
+    int index;
+
+    if ((index=sorted_array_find_index(sa, data)) < 0) {
+        return NULL;
+    }
+    return sorted_array_get(sa, index);
+}
+
+void *sorted_array_find_ge(SortedArray *sa, void *data)
+{
+    int index;
+
+    index = sorted_array_lower_bound(sa, data);
+    return index < sa->count ? sorted_array_get(sa, index) : NULL;
+}
+
+int sorted_array_lower_bound(SortedArray *sa, void *data)
+{
+    return sorted_array_search(sa, data, (sa->key_func != NULL) ?
+            sa->key_func(data) : 0, false);
+}
+
+int sorted_array_upper_bound(SortedArray *sa, void *data)
+{
+    return sorted_array_search(sa, data, (sa->key_func != NULL) ?
+            sa->key_func(data) : 0, true);
+}
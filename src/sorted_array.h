@@ -0,0 +1,105 @@
+/**
+* Copyright (C) 2015 Happy Fish / YuQing
+*
+* libfastcommon may be copied only under the terms of the GNU General
+* Public License V3, which may be found in the FastDFS source kit.
+* Please visit the FastDFS Home Page http://www.csource.org/ for more detail.
+**/
+
+//sorted_array.h, sorted contiguous array, support stable sort  :)
+/**
+  the data pointers are stored in one array for small or medium read-mostly
+  sets. the array keeps a gap (the free slots) at the last insert or delete
+  position, so the adjacent changes only move the elements between them.
+  the search is branchless binary search, the integer keys mode (init by
+  sorted_array_init_ex with key_func) searches the int64 key array and
+  scans the last window by SSE4.2 / AVX2 when the compiler enables them.
+*/
+#ifndef _SORTED_ARRAY_H
+#define _SORTED_ARRAY_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "common_define.h"
+#include "skiplist_common.h"
+
+#define SORTED_ARRAY_DEFAULT_CAPACITY  64
+
+typedef int64_t (*sorted_array_key_func)(const void *data);
+
+typedef struct sorted_array
+{
+    int capacity;
+    int count;
+    int gap_start;   //the gap is [gap_start, gap_start + capacity - count)
+    void **data;
+    int64_t *keys;   //the keys of the data for key_func, NULL for none
+    skiplist_compare_func compare_func;
+    skiplist_free_func free_func;
+    sorted_array_key_func key_func;
+} SortedArray;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define sorted_array_init(sa, init_capacity, compare_func, free_func) \
+    sorted_array_init_ex(sa, init_capacity, compare_func, free_func, NULL)
+
+/**
+ * init the sorted array
+ * parameters:
+ *         sa: the sorted array
+ *         init_capacity: the init capacity, <= 0 for default
+ *         compare_func: the compare function, can be NULL when key_func set
+ *         free_func: the function to free the data, can be NULL
+ *         key_func: the function to get the int64 key of the data, the data
+ *                   are ordered by the key and compare_func is not used,
+ *                   NULL for compare_func
+ * return 0 for success, != 0 fail (errno)
+*/
+int sorted_array_init_ex(SortedArray *sa, const int init_capacity,
+        skiplist_compare_func compare_func, skiplist_free_func free_func,
+        sorted_array_key_func key_func);
+
+void sorted_array_destroy(SortedArray *sa);
+
+//insert the data after the equal ones, return 0 for success, != 0 fail
+int sorted_array_insert(SortedArray *sa, void *data);
+
+//delete the first equal data, return 0 for success, ENOENT for not found
+int sorted_array_delete(SortedArray *sa, void *data);
+
+//delete the data by the index, return 0 for success, EINVAL for invalid
+int sorted_array_delete_by_index(SortedArray *sa, const int index);
+
+//return the first equal data, NULL for not found
+void *sorted_array_find(SortedArray *sa, void *data);
+
+//return the first data >= the data, NULL for not found
+void *sorted_array_find_ge(SortedArray *sa, void *data);
+
+//return the index of the first data >= the data, the count for none
+int sorted_array_lower_bound(SortedArray *sa, void *data);
+
+//return the index of the first data > the data, the count for none
+int sorted_array_upper_bound(SortedArray *sa, void *data);
+
+//get the data by the index based 0, the index must be valid
+static inline void *sorted_array_get(SortedArray *sa, const int index)
+{
+    return sa->data[index < sa->gap_start ? index :
+        index + sa->capacity - sa->count];
+}
+
+static inline int sorted_array_count(SortedArray *sa)
+{
+    return sa->count;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,282 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include "logger.h"
+#include "shared_func.h"
+#include "sched_thread.h"
+#include "sockopt.h"
+#include "ioevent_loop.h"
+#include "async_conn_pool.h"
+
+#define MAX_ACCEPT_COUNT 64
+#define CONNECT_TIMEOUT 2
+#define MAX_COUNT_PER_ENTRY 4
+#define MAX_IDLE_TIME 2
+#define HEALTH_CHECK_INTERVAL 1
+#define MIN_COUNT 2
+
+static int server_port;
+static int accept_socks[MAX_ACCEPT_COUNT];
+static int accept_count;
+static pthread_mutex_t accept_lock;
+
+static struct nio_thread_data thread_data;
+static AsyncConnPool pool;
+static AsyncConnEndpoint *endpoint;
+static volatile bool continue_flag;
+static bool (*loop_condition)();
+static time_t loop_deadline;
+
+typedef struct {
+    int count;
+    int err_no;
+    ConnectionInfo *conn;
+} CallbackResult;
+
+static void *accept_thread_func(void *arg)
+{
+    int listen_sock;
+    int sock;
+
+    listen_sock = (long)arg;
+    while ((sock=accept(listen_sock, NULL, NULL)) >= 0) {
+        pthread_mutex_lock(&accept_lock);
+        assert(accept_count < MAX_ACCEPT_COUNT);
+        accept_socks[accept_count++] = sock;
+        pthread_mutex_unlock(&accept_lock);
+    }
+    return NULL;
+}
+
+static void close_accepted_socks()
+{
+    int i;
+
+    pthread_mutex_lock(&accept_lock);
+    for (i=0; i<accept_count; i++) {
+        if (accept_socks[i] >= 0) {
+            close(accept_socks[i]);
+            accept_socks[i] = -1;
+        }
+    }
+    pthread_mutex_unlock(&accept_lock);
+}
+
+static void checkout_callback(ConnectionInfo *conn, const int err_no,
+        void *arg)
+{
+    CallbackResult *result;
+
+    result = (CallbackResult *)arg;
+    result->count++;
+    result->err_no = err_no;
+    result->conn = conn;
+    assert((conn != NULL) == (err_no == 0));
+}
+
+static void recv_notify_callback(int sock, short event, void *arg)
+{
+}
+
+static int thread_loop_callback(struct nio_thread_data *pThreadData)
+{
+    if (loop_condition() || g_current_time > loop_deadline) {
+        continue_flag = false;
+    }
+    return 0;
+}
+
+//run the event loop until the condition is true, return the condition
+static bool run_loop(bool (*condition)(), const int timeout)
+{
+    loop_condition = condition;
+    loop_deadline = g_current_time + timeout;
+    continue_flag = true;
+    assert(ioevent_loop(&thread_data, recv_notify_callback,
+                NULL, &continue_flag) == 0);
+    ioevent_detach(&thread_data.ev_puller, thread_data.pipe_fds[0]);
+    return condition();
+}
+
+static bool min_count_ready()
+{
+    return endpoint->free_count == MIN_COUNT;
+}
+
+static CallbackResult checkout_result;
+static bool checkout_done()
+{
+    return checkout_result.count > 0;
+}
+
+static bool idle_reaped()
+{
+    return endpoint->total_count == MIN_COUNT &&
+        endpoint->free_count == MIN_COUNT;
+}
+
+static int reconnect_accept_count;
+static bool health_checked()
+{
+    int count;
+
+    pthread_mutex_lock(&accept_lock);
+    count = accept_count;
+    pthread_mutex_unlock(&accept_lock);
+    return count >= reconnect_accept_count &&
+        endpoint->free_count == MIN_COUNT;
+}
+
+static void test_checkout(ConnectionInfo *server)
+{
+    ConnectionInfo *conns[MAX_COUNT_PER_ENTRY + 1];
+    ConnectionInfo *conn;
+    int64_t start_time;
+    int i;
+
+    //pre-warm without wait
+    start_time = get_current_time_ms();
+    assert(async_conn_pool_add_endpoint(&pool, server, MIN_COUNT) == 0);
+    assert(get_current_time_ms() - start_time < 100);
+    endpoint = pool.endpoints;
+    assert(endpoint->connecting_count == MIN_COUNT);
+    assert(run_loop(min_count_ready, 5));
+
+    //the free connections
+    for (i=0; i<MIN_COUNT; i++) {
+        assert(async_conn_pool_get_connection(&pool, server,
+                    checkout_callback, NULL, conns + i) == 0);
+        assert(conns[i] != NULL && conns[i]->sock >= 0);
+    }
+
+    //connect in the background
+    for (; i<MAX_COUNT_PER_ENTRY; i++) {
+        memset(&checkout_result, 0, sizeof(checkout_result));
+        assert(async_conn_pool_get_connection(&pool, server,
+                    checkout_callback, &checkout_result, &conn)
+                == EINPROGRESS);
+        assert(conn == NULL);
+        assert(run_loop(checkout_done, 5));
+        assert(checkout_result.err_no == 0);
+        conns[i] = checkout_result.conn;
+    }
+    assert(endpoint->total_count == MAX_COUNT_PER_ENTRY);
+
+    //the max count reached, wait for the release
+    memset(&checkout_result, 0, sizeof(checkout_result));
+    assert(async_conn_pool_get_connection(&pool, server,
+                checkout_callback, &checkout_result, &conn) == EINPROGRESS);
+    assert(endpoint->connecting_count == 0);
+    async_conn_pool_close_connection(&pool, conns[0]);
+    assert(checkout_result.count == 1 && checkout_result.conn == conns[0]);
+
+    //the waiter timeout
+    memset(&checkout_result, 0, sizeof(checkout_result));
+    assert(async_conn_pool_get_connection(&pool, server,
+                checkout_callback, &checkout_result, &conn) == EINPROGRESS);
+    assert(run_loop(checkout_done, CONNECT_TIMEOUT + 3));
+    assert(checkout_result.err_no == ETIMEDOUT);
+
+    //the force close, then the idle connections exceed min count are closed
+    async_conn_pool_close_connection_ex(&pool, conns[0], true);
+    for (i=1; i<MAX_COUNT_PER_ENTRY; i++) {
+        async_conn_pool_close_connection(&pool, conns[i]);
+    }
+    assert(endpoint->free_count == MAX_COUNT_PER_ENTRY - 1);
+    assert(run_loop(idle_reaped, MAX_IDLE_TIME + 5));
+    printf("checkout and idle reap OK\n");
+}
+
+static void test_health_check()
+{
+    pthread_mutex_lock(&accept_lock);
+    reconnect_accept_count = accept_count + MIN_COUNT;
+    pthread_mutex_unlock(&accept_lock);
+
+    //the server closes all the connections
+    close_accepted_socks();
+    assert(run_loop(health_checked, HEALTH_CHECK_INTERVAL + 5));
+    printf("health check and reconnect OK\n");
+}
+
+static void test_server_down()
+{
+    ConnectionInfo server;
+    ConnectionInfo *conn;
+    int result;
+
+    memset(&server, 0, sizeof(server));
+    server.sock = -1;
+    strcpy(server.ip_addr, "127.0.0.1");
+    server.port = server_port + 1;  //no listener
+
+    memset(&checkout_result, 0, sizeof(checkout_result));
+    result = async_conn_pool_get_connection(&pool, &server,
+            checkout_callback, &checkout_result, &conn);
+    if (result == EINPROGRESS) {
+        assert(run_loop(checkout_done, CONNECT_TIMEOUT + 3));
+        result = checkout_result.err_no;
+    }
+    assert(result == ECONNREFUSED);
+
+    //fail fast in the backoff
+    assert(async_conn_pool_get_connection(&pool, &server,
+                checkout_callback, &checkout_result, &conn) == ECONNREFUSED);
+    printf("server down OK\n");
+}
+
+int main(int argc, char *argv[])
+{
+    ScheduleArray schedule_array;
+    pthread_t schedule_tid;
+    pthread_t accept_tid;
+    ConnectionInfo server;
+    bool sched_flag;
+    int listen_sock;
+    int result;
+
+    log_init();
+    g_current_time = time(NULL);
+    sched_flag = true;
+    memset(&schedule_array, 0, sizeof(schedule_array));
+    assert(sched_start(&schedule_array, &schedule_tid,
+                64 * 1024, (bool * volatile)&sched_flag) == 0);
+
+    server_port = 20000 + getpid() % 10000;
+    listen_sock = socketServer("127.0.0.1", server_port, &result);
+    assert(listen_sock >= 0);
+    pthread_mutex_init(&accept_lock, NULL);
+    assert(pthread_create(&accept_tid, NULL, accept_thread_func,
+                (void *)(long)listen_sock) == 0);
+
+    memset(&thread_data, 0, sizeof(thread_data));
+    assert(ioevent_init(&thread_data.ev_puller, 256, 100, 0) == 0);
+    assert(fast_timer_init(&thread_data.timer, 60, g_current_time) == 0);
+    assert(pipe(thread_data.pipe_fds) == 0);
+    thread_data.thread_loop_callback = thread_loop_callback;
+
+    assert(async_conn_pool_init(&pool, &thread_data, CONNECT_TIMEOUT,
+                MAX_COUNT_PER_ENTRY, MAX_IDLE_TIME,
+                HEALTH_CHECK_INTERVAL) == 0);
+
+    memset(&server, 0, sizeof(server));
+    server.sock = -1;
+    strcpy(server.ip_addr, "127.0.0.1");
+    server.port = server_port;
+    test_checkout(&server);
+    test_health_check();
+    test_server_down();
+
+    async_conn_pool_destroy(&pool);
+    fast_timer_destroy(&thread_data.timer);
+    ioevent_destroy(&thread_data.ev_puller);
+    close_accepted_socks();
+    printf("pass OK\n");
+    return 0;
+}
@@ -0,0 +1,458 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include "logger.h"
+#include "shared_func.h"
+#include "sched_thread.h"
+#include "sockopt.h"
+#include "ioevent_loop.h"
+#include "async_http_client.h"
+
+#define CONNECT_TIMEOUT 2
+#define NETWORK_TIMEOUT 5
+#define MAX_COUNT_PER_ENTRY 4
+#define MAX_IDLE_TIME 3600
+#define PIPELINE_DEPTH 4
+#define PIPELINE_COUNT 10
+#define BIG_BODY_SIZE (1024 * 1024)
+
+static int server_port;
+static int accept_count;
+static int drop_count;  //the count of the connections to drop
+static pthread_mutex_t accept_lock;
+
+static struct nio_thread_data thread_data;
+static AsyncConnPool pool;
+static AsyncHttpClient client;
+static volatile bool continue_flag;
+static bool (*loop_condition)();
+static time_t loop_deadline;
+
+typedef struct {
+    int count;
+    int err_no;
+    int status;
+    int header_count;
+    FastBuffer body;
+} RequestResult;
+
+static RequestResult results[PIPELINE_COUNT];
+static int complete_count;
+static int expect_count;
+
+static int get_accept_count()
+{
+    int count;
+
+    pthread_mutex_lock(&accept_lock);
+    count = accept_count;
+    pthread_mutex_unlock(&accept_lock);
+    return count;
+}
+
+static int send_all(int sock, const char *data, const int length)
+{
+    return tcpsenddata_nb(sock, (void *)data, length, NETWORK_TIMEOUT);
+}
+
+static void send_response(int sock, const char *body, const int body_len)
+{
+    char header[128];
+    int len;
+
+    len = sprintf(header, "HTTP/1.1 200 OK\r\n"
+            "Content-Length: %d\r\n\r\n", body_len);
+    assert(send_all(sock, header, len) == 0);
+    if (body_len > 0) {
+        assert(send_all(sock, body, body_len) == 0);
+    }
+}
+
+//return false to close the connection
+static bool handle_request(int sock, const char *method, const char *path,
+        const char *body, const int body_len, const int index)
+{
+    static const char *chunked = "HTTP/1.1 200 OK\r\n"
+        "Transfer-Encoding: chunked\r\n\r\n"
+        "5;ext=1\r\nhello\r\n6\r\n world\r\n0\r\nX-Trailer: t\r\n\r\n";
+    static const char *bad_chunk = "HTTP/1.1 200 OK\r\n"
+        "Transfer-Encoding: chunked\r\n\r\n"
+        "0x5\r\nhello\r\n0\r\n\r\n";
+    static const char *closed = "HTTP/1.1 200 OK\r\n"
+        "Connection: close\r\n\r\nclosed body";
+    static const char *cont = "HTTP/1.1 100 Continue\r\n\r\n";
+    char *big;
+    int i;
+
+    if (strcmp(path, "/hello") == 0) {
+        if (strcmp(method, "HEAD") == 0) {
+            assert(send_all(sock, "HTTP/1.1 200 OK\r\n"
+                        "Content-Length: 5\r\n\r\n", 38) == 0);
+        } else {
+            send_response(sock, "hello", 5);
+        }
+    } else if (strncmp(path, "/seq/", 5) == 0) {
+        send_response(sock, path + 5, strlen(path + 5));
+    } else if (strcmp(path, "/chunked") == 0) {
+        assert(send_all(sock, chunked, strlen(chunked)) == 0);
+    } else if (strcmp(path, "/bad_chunk") == 0) {
+        assert(send_all(sock, bad_chunk, strlen(bad_chunk)) == 0);
+        return false;
+    } else if (strcmp(path, "/continue") == 0) {
+        assert(send_all(sock, cont, strlen(cont)) == 0);
+        send_response(sock, "continued", 9);
+    } else if (strcmp(path, "/close") == 0) {
+        assert(send_all(sock, closed, strlen(closed)) == 0);
+        return false;
+    } else if (strcmp(path, "/big") == 0) {
+        big = (char *)malloc(BIG_BODY_SIZE);
+        assert(big != NULL);
+        for (i=0; i<BIG_BODY_SIZE; i++) {
+            big[i] = 'a' + i % 26;
+        }
+        send_response(sock, big, BIG_BODY_SIZE);
+        free(big);
+    } else if (strcmp(path, "/echo") == 0) {
+        send_response(sock, body, body_len);
+    } else if (strcmp(path, "/drop") == 0) {
+        //close the kept-alive connection without the response
+        pthread_mutex_lock(&accept_lock);
+        if (index > 0 && drop_count > 0) {
+            drop_count--;
+            pthread_mutex_unlock(&accept_lock);
+            return false;
+        }
+        pthread_mutex_unlock(&accept_lock);
+        send_response(sock, "dropped", 7);
+    } else {
+        assert(send_all(sock, "HTTP/1.1 404 Not Found\r\n"
+                    "Content-Length: 0\r\n\r\n", 45) == 0);
+    }
+    return true;
+}
+
+static void *serve_thread_func(void *arg)
+{
+    char buff[64 * 1024];
+    char method[16];
+    char path[256];
+    char *header_end;
+    char *p;
+    int sock;
+    int length;
+    int bytes;
+    int header_len;
+    int body_len;
+    int index;
+
+    sock = (long)arg;
+    length = 0;
+    index = 0;
+    while (1) {
+        buff[length] = '\0';
+        header_end = strstr(buff, "\r\n\r\n");
+        if (header_end == NULL) {
+            bytes = recv(sock, buff + length, sizeof(buff) - 1 - length, 0);
+            if (bytes <= 0) {
+                break;
+            }
+            length += bytes;
+            continue;
+        }
+
+        header_len = (header_end + 4) - buff;
+        assert(sscanf(buff, "%15s %255s", method, path) == 2);
+        p = strstr(buff, "Content-Length: ");
+        body_len = (p != NULL && p < header_end) ? atoi(p + 16) : 0;
+        while (length < header_len + body_len) {
+            bytes = recv(sock, buff + length, sizeof(buff) - 1 - length, 0);
+            if (bytes <= 0) {
+                close(sock);
+                return NULL;
+            }
+            length += bytes;
+        }
+
+        if (!handle_request(sock, method, path, buff + header_len,
+                    body_len, index++))
+        {
+            break;
+        }
+        length -= header_len + body_len;
+        memmove(buff, buff + header_len + body_len, length);
+    }
+
+    close(sock);
+    return NULL;
+}
+
+static void *accept_thread_func(void *arg)
+{
+    pthread_t tid;
+    int listen_sock;
+    int sock;
+
+    listen_sock = (long)arg;
+    while ((sock=accept(listen_sock, NULL, NULL)) >= 0) {
+        pthread_mutex_lock(&accept_lock);
+        accept_count++;
+        pthread_mutex_unlock(&accept_lock);
+        assert(pthread_create(&tid, NULL, serve_thread_func,
+                    (void *)(long)sock) == 0);
+        pthread_detach(tid);
+    }
+    return NULL;
+}
+
+static int on_headers(AsyncHttpRequest *request,
+        const AsyncHttpResponse *response)
+{
+    RequestResult *result;
+
+    result = (RequestResult *)request->arg;
+    result->status = response->status;
+    result->header_count = response->header_count;
+    return 0;
+}
+
+static int on_body(AsyncHttpRequest *request, const char *data,
+        const int length)
+{
+    RequestResult *result;
+
+    result = (RequestResult *)request->arg;
+    return fast_buffer_append_buff(&result->body, data, length);
+}
+
+static void on_complete(AsyncHttpRequest *request, const int err_no)
+{
+    RequestResult *result;
+
+    result = (RequestResult *)request->arg;
+    result->count++;
+    result->err_no = err_no;
+    complete_count++;
+}
+
+static AsyncHttpCallbacks callbacks = {on_headers, on_body, on_complete};
+
+static void recv_notify_callback(int sock, short event, void *arg)
+{
+}
+
+static int thread_loop_callback(struct nio_thread_data *pThreadData)
+{
+    if (loop_condition() || g_current_time > loop_deadline) {
+        continue_flag = false;
+    }
+    return 0;
+}
+
+//run the event loop until the condition is true, return the condition
+static bool run_loop(bool (*condition)(), const int timeout)
+{
+    loop_condition = condition;
+    loop_deadline = g_current_time + timeout;
+    continue_flag = true;
+    assert(ioevent_loop(&thread_data, recv_notify_callback,
+                NULL, &continue_flag) == 0);
+    ioevent_detach(&thread_data.ev_puller, thread_data.pipe_fds[0]);
+    return condition();
+}
+
+static bool all_completed()
+{
+    return complete_count >= expect_count;
+}
+
+static void reset_results()
+{
+    int i;
+
+    for (i=0; i<PIPELINE_COUNT; i++) {
+        results[i].count = 0;
+        results[i].err_no = -1;
+        results[i].status = 0;
+        results[i].body.length = 0;
+    }
+    complete_count = 0;
+    expect_count = 0;
+}
+
+static RequestResult *do_request(const char *method, const char *path,
+        const char *body, const int body_len)
+{
+    char url[256];
+
+    reset_results();
+    sprintf(url, "http://127.0.0.1:%d%s", server_port, path);
+    assert(async_http_client_request(&client, method, url, NULL,
+                body, body_len, &callbacks, results) == 0);
+    expect_count = 1;
+    assert(run_loop(all_completed, NETWORK_TIMEOUT + 3));
+    assert(results[0].count == 1);
+    return results;
+}
+
+static void assert_body(const RequestResult *result, const char *body)
+{
+    assert(result->err_no == 0 && result->status == 200);
+    assert(result->body.length == (int)strlen(body));
+    assert(memcmp(result->body.data, body, result->body.length) == 0);
+}
+
+static void test_basic()
+{
+    RequestResult *result;
+    int count;
+    int i;
+
+    count = get_accept_count();
+    result = do_request("GET", "/hello", NULL, 0);
+    assert_body(result, "hello");
+    assert(result->header_count == 1);
+
+    //keep-alive
+    result = do_request("GET", "/hello", NULL, 0);
+    assert_body(result, "hello");
+    result = do_request("HEAD", "/hello", NULL, 0);
+    assert_body(result, "");
+    result = do_request("GET", "/chunked", NULL, 0);
+    assert_body(result, "hello world");
+    result = do_request("GET", "/continue", NULL, 0);
+    assert_body(result, "continued");
+    result = do_request("POST", "/echo", "posted data", 11);
+    assert_body(result, "posted data");
+    result = do_request("GET", "/not_exist", NULL, 0);
+    assert(result->err_no == 0 && result->status == 404);
+    assert(get_accept_count() == count + 1);
+
+    result = do_request("GET", "/big", NULL, 0);
+    assert(result->err_no == 0 && result->status == 200);
+    assert(result->body.length == BIG_BODY_SIZE);
+    for (i=0; i<BIG_BODY_SIZE; i++) {
+        assert(result->body.data[i] == 'a' + i % 26);
+    }
+
+    //closed by the server after the response
+    result = do_request("GET", "/close", NULL, 0);
+    assert_body(result, "closed body");
+    result = do_request("GET", "/hello", NULL, 0);
+    assert_body(result, "hello");
+    assert(get_accept_count() == count + 2);
+    printf("basic and keep-alive OK\n");
+}
+
+static void test_pipeline()
+{
+    char url[256];
+    char body[16];
+    int count;
+    int i;
+
+    count = get_accept_count();
+    reset_results();
+    for (i=0; i<PIPELINE_COUNT; i++) {
+        sprintf(url, "http://127.0.0.1:%d/seq/%d", server_port, i);
+        assert(async_http_client_get(&client, url,
+                    &callbacks, results + i) == 0);
+    }
+    expect_count = PIPELINE_COUNT;
+    assert(run_loop(all_completed, NETWORK_TIMEOUT + 3));
+
+    for (i=0; i<PIPELINE_COUNT; i++) {
+        assert(results[i].count == 1);
+        sprintf(body, "%d", i);
+        assert_body(results + i, body);
+    }
+
+    //the requests beyond the depth wait for the new connections
+    assert(get_accept_count() - count <= MAX_COUNT_PER_ENTRY - 1);
+    printf("pipeline OK, new connections: %d\n", get_accept_count() - count);
+}
+
+static void test_retry()
+{
+    RequestResult *result;
+
+    //the kept-alive connections served requests
+    pthread_mutex_lock(&accept_lock);
+    drop_count = 1;
+    pthread_mutex_unlock(&accept_lock);
+    result = do_request("GET", "/drop", NULL, 0);
+    assert_body(result, "dropped");  //GET is retried
+    assert(drop_count == 0);
+
+    pthread_mutex_lock(&accept_lock);
+    drop_count = 1;
+    pthread_mutex_unlock(&accept_lock);
+    result = do_request("POST", "/drop", "x", 1);  //NOT idempotent
+    assert(result->err_no == ENOTCONN);
+
+    assert(async_http_client_get(&client, "ftp://127.0.0.1/",
+                &callbacks, results) == EINVAL);
+    //the prefix 0x is NOT allowed by the chunk size
+    result = do_request("GET", "/bad_chunk", NULL, 0);
+    assert(result->err_no == EPROTO);
+    printf("retry OK\n");
+}
+
+int main(int argc, char *argv[])
+{
+    ScheduleArray schedule_array;
+    pthread_t schedule_tid;
+    pthread_t accept_tid;
+    bool sched_flag;
+    int listen_sock;
+    int result;
+    int i;
+
+    log_init();
+    g_current_time = time(NULL);
+    sched_flag = true;
+    memset(&schedule_array, 0, sizeof(schedule_array));
+    assert(sched_start(&schedule_array, &schedule_tid,
+                64 * 1024, (bool * volatile)&sched_flag) == 0);
+
+    server_port = 20000 + getpid() % 10000;
+    listen_sock = socketServer("127.0.0.1", server_port, &result);
+    assert(listen_sock >= 0);
+    pthread_mutex_init(&accept_lock, NULL);
+    assert(pthread_create(&accept_tid, NULL, accept_thread_func,
+                (void *)(long)listen_sock) == 0);
+
+    memset(&thread_data, 0, sizeof(thread_data));
+    assert(ioevent_init(&thread_data.ev_puller, 256, 100, 0) == 0);
+    assert(fast_timer_init(&thread_data.timer, 60, g_current_time) == 0);
+    assert(pipe(thread_data.pipe_fds) == 0);
+    thread_data.thread_loop_callback = thread_loop_callback;
+
+    assert(async_conn_pool_init(&pool, &thread_data, CONNECT_TIMEOUT,
+                MAX_COUNT_PER_ENTRY, MAX_IDLE_TIME, 0) == 0);
+    assert(async_http_client_init(&client, &pool, NETWORK_TIMEOUT,
+                PIPELINE_DEPTH) == 0);
+    for (i=0; i<PIPELINE_COUNT; i++) {
+        assert(fast_buffer_init(&results[i].body) == 0);
+    }
+
+    test_basic();
+    test_pipeline();
+    test_retry();
+
+    async_http_client_destroy(&client);
+    async_conn_pool_destroy(&pool);
+    fast_timer_destroy(&thread_data.timer);
+    ioevent_destroy(&thread_data.ev_puller);
+    for (i=0; i<PIPELINE_COUNT; i++) {
+        fast_buffer_destroy(&results[i].body);
+    }
+    close(listen_sock);
+    printf("pass OK\n");
+    return 0;
+}
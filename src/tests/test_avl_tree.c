@@ -0,0 +1,177 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+#include <inttypes.h>
+#include "logger.h"
+#include "shared_func.h"
+#include "avl_tree.h"
+
+#define COUNT 1000000
+
+static int *numbers;
+
+static int compare_func(void *p1, void *p2)
+{
+    return *((int *)p1) - *((int *)p2);
+}
+
+static int check_order(void *data, void *args)
+{
+    int *last;
+
+    last = (int *)args;
+    assert(*((int *)data) == *last + 1);
+    *last = *((int *)data);
+    return 0;
+}
+
+static void check_tree(AVLTreeInfo *tree)
+{
+    int i;
+    int last;
+    void *value;
+    AVLTreeIterator iterator;
+
+    for (i=0; i<COUNT; i++) {
+        value = avl_tree_find(tree, numbers + i);
+        assert(value != NULL && *((int *)value) == numbers[i]);
+    }
+
+    last = 0;
+    avl_tree_walk(tree, check_order, &last);
+    assert(last == COUNT);
+    assert(avl_tree_count(tree) == COUNT);
+
+    for (i=0; i<COUNT; i++) {
+        value = avl_tree_select(tree, i);
+        assert(value != NULL && *((int *)value) == i + 1);
+        assert(avl_tree_rank(tree, numbers + i) == numbers[i] - 1);
+    }
+    assert(avl_tree_select(tree, -1) == NULL);
+    assert(avl_tree_select(tree, COUNT) == NULL);
+
+    avl_tree_iterator(tree, &iterator);
+    for (i=0; i<COUNT; i++) {
+        value = avl_tree_next(&iterator);
+        assert(value != NULL && *((int *)value) == i + 1);
+    }
+    assert(avl_tree_next(&iterator) == NULL);
+
+    avl_tree_reverse_iterator(tree, &iterator);
+    for (i=COUNT; i>0; i--) {
+        value = avl_tree_prev(&iterator);
+        assert(value != NULL && *((int *)value) == i);
+    }
+    assert(avl_tree_prev(&iterator) == NULL);
+
+    //seek then move forward and backward
+    last = COUNT / 2;
+    assert(avl_tree_seek(tree, &iterator, &last) == 0);
+    assert(*((int *)avl_tree_next(&iterator)) == last);
+    assert(*((int *)avl_tree_next(&iterator)) == last + 1);
+    assert(*((int *)avl_tree_prev(&iterator)) == last + 2);
+    assert(*((int *)avl_tree_prev(&iterator)) == last + 1);
+    last = COUNT + 1;
+    assert(avl_tree_seek(tree, &iterator, &last) == ENOENT);
+    assert(avl_tree_next(&iterator) == NULL);
+}
+
+int main(int argc, char *argv[])
+{
+    int i;
+    int index1;
+    int index2;
+    int tmp;
+    int result;
+    int64_t start_time;
+    void **sorted;
+    AVLTreeInfo tree;
+
+    log_init();
+    numbers = (int *)malloc(sizeof(int) * COUNT);
+    sorted = (void **)malloc(sizeof(void *) * COUNT);
+    for (i=0; i<COUNT; i++) {
+        numbers[i] = i + 1;
+    }
+    srand(time(NULL));
+    for (i=0; i<COUNT; i++) {
+        index1 = (COUNT - 1) * (int64_t)rand() / (int64_t)RAND_MAX;
+        index2 = (COUNT - 1) * (int64_t)rand() / (int64_t)RAND_MAX;
+        tmp = numbers[index1];
+        numbers[index1] = numbers[index2];
+        numbers[index2] = tmp;
+    }
+    for (i=0; i<COUNT; i++) {
+        sorted[numbers[i] - 1] = numbers + i;
+    }
+
+    avl_tree_init(&tree, NULL, compare_func);
+    start_time = get_current_time_ms();
+    for (i=0; i<COUNT; i++) {
+        assert(avl_tree_insert(&tree, numbers + i) == 1);
+    }
+    printf("random insert time used: %"PRId64" ms, depth: %d\n",
+            get_current_time_ms() - start_time, avl_tree_depth(&tree));
+    check_tree(&tree);
+    for (i=0; i<COUNT; i++) {
+        assert(avl_tree_delete(&tree, numbers + i) == 1);
+        if (i % (COUNT / 10) == 0) {
+            assert(avl_tree_count(&tree) == COUNT - i - 1);
+        }
+    }
+    assert(avl_tree_count(&tree) == 0);
+    avl_tree_destroy(&tree);
+
+    avl_tree_init(&tree, NULL, compare_func);
+    start_time = get_current_time_ms();
+    for (i=0; i<COUNT; i++) {
+        assert(avl_tree_insert(&tree, sorted[i]) == 1);
+    }
+    printf("sorted insert time used: %"PRId64" ms, depth: %d\n",
+            get_current_time_ms() - start_time, avl_tree_depth(&tree));
+    check_tree(&tree);
+    avl_tree_destroy(&tree);
+
+    avl_tree_init(&tree, NULL, compare_func);
+    start_time = get_current_time_ms();
+    if ((result=avl_tree_bulk_load(&tree, sorted, COUNT)) != 0) {
+        return result;
+    }
+    printf("bulk load time used: %"PRId64" ms, depth: %d\n",
+            get_current_time_ms() - start_time, avl_tree_depth(&tree));
+    check_tree(&tree);
+    assert(avl_tree_bulk_load(&tree, sorted, COUNT) == EEXIST);
+
+    //the balance factors must be right for the later changes
+    for (i=0; i<COUNT; i+=2) {
+        assert(avl_tree_delete(&tree, sorted[i]) == 1);
+        assert(avl_tree_delete(&tree, sorted[i]) == 0);
+    }
+    assert(avl_tree_count(&tree) == COUNT / 2);
+    for (i=0; i<COUNT; i+=2) {
+        assert(avl_tree_find_ge(&tree, sorted[i]) == sorted[i + 1]);
+    }
+    //the odd numbers deleted, the rank of 2 * k is k - 1
+    for (i=1; i<COUNT; i+=2) {
+        assert(avl_tree_rank(&tree, sorted[i]) == i / 2);
+        assert(avl_tree_rank(&tree, sorted[i - 1]) == i / 2);
+        assert(*((int *)avl_tree_select(&tree, i / 2)) == i + 1);
+    }
+    for (i=0; i<COUNT; i+=2) {
+        assert(avl_tree_insert(&tree, sorted[i]) == 1);
+    }
+    check_tree(&tree);
+    avl_tree_destroy(&tree);
+
+    avl_tree_init(&tree, NULL, compare_func);
+    sorted[1] = sorted[0];
+    assert(avl_tree_bulk_load(&tree, sorted, COUNT) == EINVAL);
+    avl_tree_destroy(&tree);
+
+    free(sorted);
+    free(numbers);
+    printf("pass OK\n");
+    return 0;
+}
@@ -0,0 +1,238 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+#include <inttypes.h>
+#include "logger.h"
+#include "shared_func.h"
+#include "avl_tree.h"
+#include "flat_skiplist.h"
+#include "bplus_tree.h"
+
+#define COUNT 1000000
+#define LEVEL_COUNT 16
+
+static int *numbers;
+static int *copies;
+
+//the stale keys refer to the freed data break the search
+static void free_copy_func(void *ptr)
+{
+    if ((int *)ptr >= copies && (int *)ptr < copies + COUNT) {
+        *((int *)ptr) = -1;
+    }
+}
+
+static int compare_func(const void *p1, const void *p2)
+{
+    return *((int *)p1) - *((int *)p2);
+}
+
+static int avl_compare_func(void *p1, void *p2)
+{
+    return *((int *)p1) - *((int *)p2);
+}
+
+static int check_order(void *data, void *args)
+{
+    int *last;
+
+    last = (int *)args;
+    assert(*((int *)data) == *last + 1);
+    *last = *((int *)data);
+    return 0;
+}
+
+static void check_tree(BPlusTreeInfo *tree)
+{
+    int i;
+    int last;
+    int value;
+    void *data;
+    BPlusTreeIterator iterator;
+
+    for (i=0; i<COUNT; i++) {
+        data = bplus_tree_find(tree, numbers + i);
+        assert(data != NULL && *((int *)data) == numbers[i]);
+    }
+
+    last = 0;
+    bplus_tree_walk(tree, check_order, &last);
+    assert(last == COUNT);
+    assert(bplus_tree_count(tree) == COUNT);
+
+    value = COUNT / 2;
+    last = COUNT / 2 + 100;
+    assert(bplus_tree_find_range(tree, &value, &last, &iterator) == 0);
+    i = 0;
+    while ((data=bplus_tree_next(&iterator)) != NULL) {
+        assert(*((int *)data) == value + i);
+        i++;
+    }
+    assert(i == 100);
+    assert(bplus_tree_find_range(tree, &value, &value, &iterator) == ENOENT);
+}
+
+static int64_t bench_avl_tree(void)
+{
+    int i;
+    int64_t start_time;
+    AVLTreeInfo tree;
+
+    avl_tree_init(&tree, NULL, avl_compare_func);
+    start_time = get_current_time_ms();
+    for (i=0; i<COUNT; i++) {
+        avl_tree_insert(&tree, numbers + i);
+    }
+    for (i=0; i<COUNT; i++) {
+        assert(avl_tree_find(&tree, numbers + i) != NULL);
+    }
+    for (i=0; i<COUNT; i++) {
+        avl_tree_delete(&tree, numbers + i);
+    }
+    avl_tree_destroy(&tree);
+    return get_current_time_ms() - start_time;
+}
+
+static int64_t bench_flat_skiplist(void)
+{
+    int i;
+    int64_t start_time;
+    FlatSkiplist sl;
+
+    flat_skiplist_init(&sl, LEVEL_COUNT, compare_func, NULL);
+    start_time = get_current_time_ms();
+    for (i=0; i<COUNT; i++) {
+        flat_skiplist_insert(&sl, numbers + i);
+    }
+    for (i=0; i<COUNT; i++) {
+        assert(flat_skiplist_find(&sl, numbers + i) != NULL);
+    }
+    for (i=0; i<COUNT; i++) {
+        flat_skiplist_delete(&sl, numbers + i);
+    }
+    flat_skiplist_destroy(&sl);
+    return get_current_time_ms() - start_time;
+}
+
+static int64_t bench_bplus_tree(void)
+{
+    int i;
+    int64_t start_time;
+    BPlusTreeInfo tree;
+
+    bplus_tree_init(&tree, NULL, avl_compare_func);
+    start_time = get_current_time_ms();
+    for (i=0; i<COUNT; i++) {
+        bplus_tree_insert(&tree, numbers + i);
+    }
+    for (i=0; i<COUNT; i++) {
+        assert(bplus_tree_find(&tree, numbers + i) != NULL);
+    }
+    for (i=0; i<COUNT; i++) {
+        bplus_tree_delete(&tree, numbers + i);
+    }
+    bplus_tree_destroy(&tree);
+    return get_current_time_ms() - start_time;
+}
+
+int main(int argc, char *argv[])
+{
+    int i;
+    int index1;
+    int index2;
+    int tmp;
+    int value;
+    int64_t start_time;
+    void **sorted;
+    BPlusTreeInfo tree;
+
+    log_init();
+    numbers = (int *)malloc(sizeof(int) * COUNT);
+    copies = (int *)malloc(sizeof(int) * COUNT);
+    sorted = (void **)malloc(sizeof(void *) * COUNT);
+    for (i=0; i<COUNT; i++) {
+        numbers[i] = i + 1;
+    }
+    srand(time(NULL));
+    for (i=0; i<COUNT; i++) {
+        index1 = (COUNT - 1) * (int64_t)rand() / (int64_t)RAND_MAX;
+        index2 = (COUNT - 1) * (int64_t)rand() / (int64_t)RAND_MAX;
+        tmp = numbers[index1];
+        numbers[index1] = numbers[index2];
+        numbers[index2] = tmp;
+    }
+    for (i=0; i<COUNT; i++) {
+        sorted[numbers[i] - 1] = numbers + i;
+    }
+
+    bplus_tree_init(&tree, free_copy_func, avl_compare_func);
+    start_time = get_current_time_ms();
+    for (i=0; i<COUNT; i++) {
+        assert(bplus_tree_insert(&tree, numbers + i) == 1);
+    }
+    printf("random insert time used: %"PRId64" ms, depth: %d\n",
+            get_current_time_ms() - start_time, bplus_tree_depth(&tree));
+    check_tree(&tree);
+
+    for (i=0; i<COUNT; i++) {
+        copies[i] = numbers[i];
+        assert(bplus_tree_insert(&tree, copies + i) == 0);
+        assert(bplus_tree_replace(&tree, copies + i) == 0);
+        assert(bplus_tree_find(&tree, numbers + i) == copies + i);
+    }
+    check_tree(&tree);
+
+    //delete the odd numbers, the keys of the internal nodes are replaced
+    for (i=0; i<COUNT; i+=2) {
+        assert(bplus_tree_delete(&tree, sorted[i]) == 1);
+        assert(bplus_tree_delete(&tree, sorted[i]) == 0);
+    }
+    assert(bplus_tree_count(&tree) == COUNT / 2);
+    for (i=0; i<COUNT; i+=2) {
+        assert(bplus_tree_find(&tree, sorted[i]) == NULL);
+        assert(*((int *)bplus_tree_find_ge(&tree, sorted[i])) == i + 2);
+    }
+    value = COUNT + 1;
+    assert(bplus_tree_find_ge(&tree, &value) == NULL);
+    for (i=0; i<COUNT; i+=2) {
+        assert(bplus_tree_insert(&tree, sorted[i]) == 1);
+    }
+    check_tree(&tree);
+
+    //the replaced copies are freed
+    for (i=1; i<COUNT; i+=2) {
+        assert(bplus_tree_replace(&tree, sorted[i]) == 0);
+    }
+    check_tree(&tree);
+
+    for (i=0; i<COUNT; i++) {
+        assert(bplus_tree_delete(&tree, numbers + i) == 1);
+    }
+    assert(bplus_tree_count(&tree) == 0);
+    assert(bplus_tree_depth(&tree) == 0);
+    assert(tree.head == NULL && tree.tail == NULL);
+    bplus_tree_destroy(&tree);
+
+    bplus_tree_init(&tree, NULL, avl_compare_func);
+    start_time = get_current_time_ms();
+    for (i=0; i<COUNT; i++) {
+        assert(bplus_tree_insert(&tree, sorted[i]) == 1);
+    }
+    printf("sorted insert time used: %"PRId64" ms, depth: %d\n",
+            get_current_time_ms() - start_time, bplus_tree_depth(&tree));
+    check_tree(&tree);
+    bplus_tree_destroy(&tree);
+
+    printf("insert + find + delete %d random numbers, time used:\n", COUNT);
+    printf("    avl_tree: %"PRId64" ms\n", bench_avl_tree());
+    printf("    flat_skiplist: %"PRId64" ms\n", bench_flat_skiplist());
+    printf("    bplus_tree: %"PRId64" ms\n", bench_bplus_tree());
+
+    free(sorted);
+    free(copies);
+    free(numbers);
+    printf("pass OK\n");
+    return 0;
+}
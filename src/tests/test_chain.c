@@ -0,0 +1,121 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+#include <inttypes.h>
+#include "logger.h"
+#include "shared_func.h"
+#include "fast_mblock.h"
+#include "chain.h"
+
+#define COUNT 1000000
+
+typedef struct {
+    int id;
+    ChainLink link;
+} Connection;
+
+static int compare_func(void *p1, void *p2)
+{
+    return (long)p1 - (long)p2;
+}
+
+static void test_intrusive()
+{
+    int i;
+    Connection *conns;
+    ChainLink head;
+    ChainLink *link;
+    ChainLink *tmp;
+    int64_t start_time;
+
+    conns = (Connection *)malloc(sizeof(Connection) * COUNT);
+    chain_link_init(&head);
+    assert(chain_link_empty(&head));
+    assert(chain_link_first(&head) == NULL);
+
+    start_time = get_current_time_ms();
+    for (i=0; i<COUNT; i++) {
+        conns[i].id = i;
+        chain_link_add_tail(&head, &conns[i].link);
+    }
+    assert(CHAIN_LINK_ENTRY(chain_link_first(&head),
+                Connection, link)->id == 0);
+    assert(CHAIN_LINK_ENTRY(chain_link_last(&head),
+                Connection, link)->id == COUNT - 1);
+
+    //remove the odd ones in O(1)
+    for (i=1; i<COUNT; i+=2) {
+        chain_link_remove(&conns[i].link);
+    }
+    i = 0;
+    CHAIN_LINK_FOR_EACH(link, &head) {
+        assert(CHAIN_LINK_ENTRY(link, Connection, link)->id == i);
+        i += 2;
+    }
+    assert(i == COUNT);
+
+    CHAIN_LINK_FOR_EACH_SAFE(link, tmp, &head) {
+        chain_link_remove(link);
+    }
+    assert(chain_link_empty(&head));
+
+    chain_link_add_head(&head, &conns[0].link);
+    chain_link_add_head(&head, &conns[1].link);
+    assert(chain_link_pop_head(&head) == &conns[1].link);
+    assert(chain_link_pop_head(&head) == &conns[0].link);
+    assert(chain_link_pop_head(&head) == NULL);
+    printf("intrusive list time used: %"PRId64" ms\n",
+            get_current_time_ms() - start_time);
+    free(conns);
+}
+
+static int64_t test_chain(struct fast_mblock_man *node_allocator)
+{
+    long i;
+    ChainList list;
+    int64_t start_time;
+
+    start_time = get_current_time_ms();
+    chain_init_ex(&list, CHAIN_TYPE_APPEND, NULL, compare_func,
+            node_allocator);
+    for (i=0; i<COUNT; i++) {
+        assert(appendNode(&list, (void *)i) == 0);
+    }
+    assert(deleteOne(&list, (void *)0L) == 1);
+    assert(chain_count(&list) == COUNT - 1);
+    for (i=1; i<COUNT; i++) {
+        assert((long)chain_pop_head(&list) == i);
+    }
+    assert(chain_pop_head(&list) == NULL);
+
+    for (i=0; i<COUNT; i++) {
+        assert(insertNodePrior(&list, (void *)i) == 0);
+    }
+    chain_destroy(&list);
+    return get_current_time_ms() - start_time;
+}
+
+int main(int argc, char *argv[])
+{
+    int result;
+    struct fast_mblock_man node_allocator;
+
+    log_init();
+    test_intrusive();
+
+    printf("chain with malloc time used: %"PRId64" ms\n",
+            test_chain(NULL));
+    if ((result=chain_node_allocator_init(&node_allocator,
+                    0, false)) != 0) {
+        return result;
+    }
+    printf("chain with node pool time used: %"PRId64" ms\n",
+            test_chain(&node_allocator));
+    assert(node_allocator.info.element_used_count == 0);
+    fast_mblock_destroy(&node_allocator);
+
+    printf("pass OK\n");
+    return 0;
+}
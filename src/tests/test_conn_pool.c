@@ -0,0 +1,283 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include "logger.h"
+#include "shared_func.h"
+#include "sockopt.h"
+#include "connection_pool.h"
+
+#define THREAD_COUNT 4
+#define LOOP_COUNT 1000000
+#define CONNECT_TIMEOUT 5
+#define MAX_IDLE_TIME 3600
+#define THREAD_CACHE_SIZE 4
+
+static ConnectionPool cp;
+static ConnectionInfo server;
+
+static void *accept_thread_func(void *arg)
+{
+    int listen_sock;
+
+    listen_sock = (long)arg;
+    while (accept(listen_sock, NULL, NULL) >= 0) {
+        //keep the connection opened
+    }
+    return NULL;
+}
+
+static void *checkout_thread_func(void *arg)
+{
+    ConnectionPoolKey key;
+    ConnectionInfo *conn;
+    int result;
+    int i;
+
+    assert(conn_pool_make_key(&server, &key) == 0);
+    for (i=0; i<LOOP_COUNT; i++) {
+        if (arg != NULL) {
+            conn = conn_pool_get_connection_by_key(&cp,
+                    &server, &key, &result);
+        } else {
+            conn = conn_pool_get_connection(&cp, &server, &result);
+        }
+        assert(conn != NULL && result == 0);
+        assert(conn_pool_close_connection(&cp, conn) == 0);
+    }
+    return NULL;
+}
+
+static ConnectionPoolStat *find_stat(ConnectionPoolStat *stats,
+        const int count, const ConnectionInfo *conn)
+{
+    int i;
+
+    for (i=0; i<count; i++) {
+        if (stats[i].port == conn->port &&
+                strcmp(stats[i].ip_addr, conn->ip_addr) == 0)
+        {
+            return stats + i;
+        }
+    }
+    return NULL;
+}
+
+static void test_stat(const ConnectionInfo *other)
+{
+    ConnectionPoolStat stats[2];
+    ConnectionPoolStat *stat;
+    int64_t latency_count;
+    int count;
+    int i;
+
+    assert(conn_pool_stat(&cp, stats, 1, &count) == EOVERFLOW);
+    assert(conn_pool_stat(&cp, stats, 2, &count) == 0);
+    assert(count == 2);
+
+    stat = find_stat(stats, count, &server);
+    assert(stat != NULL);
+    assert(stat->total_count == 1 && stat->free_count == 1);
+    assert(stat->stats.connect_count == 2);
+    assert(stat->stats.connect_fail_count == 0);
+    assert(stat->stats.checkout_count == 3);
+    assert(stat->stats.reuse_count == 1);
+    assert(stat->stats.max_checkout_wait_us > 0);
+    latency_count = 0;
+    for (i=0; i<CONN_POOL_LATENCY_BUCKET_COUNT; i++) {
+        latency_count += stat->stats.connect_latency[i];
+    }
+    assert(latency_count == 2);
+
+    stat = find_stat(stats, count, other);
+    assert(stat != NULL);
+    assert(stat->total_count == 0);
+    assert(stat->stats.connect_count == 0);
+    assert(stat->stats.connect_fail_count == 1);
+
+    assert(conn_pool_stat_print(&cp) == 0);
+}
+
+static void *hold_thread_func(void *arg)
+{
+    ConnectionInfo *conns[2];
+    int result;
+    int i;
+
+    //hold the max count then push back to the thread cache
+    for (i=0; i<2; i++) {
+        conns[i] = conn_pool_get_connection(&cp, &server, &result);
+        assert(conns[i] != NULL);
+    }
+    for (i=0; i<2; i++) {
+        assert(conn_pool_close_connection(&cp, conns[i]) == 0);
+    }
+    assert(conn_pool_get_connection_count(&cp) == 2);
+    return NULL;
+}
+
+static void *limit_thread_func(void *arg)
+{
+    ConnectionInfo *conn;
+    int result;
+
+    conn = conn_pool_get_connection(&cp, &server, &result);
+    if (arg != NULL) {
+        assert(conn != NULL);
+        assert(conn_pool_close_connection(&cp, conn) == 0);
+    } else {
+        assert(conn == NULL && result == ENOSPC);
+    }
+    return NULL;
+}
+
+static void test_thread_cache()
+{
+    ConnectionPoolStat stat;
+    pthread_t tid;
+    int count;
+    pthread_t hold_tid;
+
+    assert(conn_pool_init(&cp, CONNECT_TIMEOUT, 2, MAX_IDLE_TIME) == 0);
+    assert(conn_pool_enable_thread_cache(&cp, THREAD_CACHE_SIZE) == 0);
+
+    /* the global max count: all the connections are in the cache of
+     * the hold thread */
+    assert(pthread_create(&hold_tid, NULL, hold_thread_func, NULL) == 0);
+    pthread_join(hold_tid, NULL);
+
+    //the cache is pushed back to the pool when the hold thread exits
+    assert(pthread_create(&tid, NULL, limit_thread_func, (void *)1) == 0);
+    pthread_join(tid, NULL);
+    conn_pool_destroy(&cp);
+
+    assert(conn_pool_init(&cp, CONNECT_TIMEOUT, 2, MAX_IDLE_TIME) == 0);
+    assert(conn_pool_enable_thread_cache(&cp, THREAD_CACHE_SIZE) == 0);
+    hold_thread_func(NULL);  //the cache of the main thread
+    assert(pthread_create(&tid, NULL, limit_thread_func, NULL) == 0);
+    pthread_join(tid, NULL);
+    hold_thread_func(NULL);  //reuse from the cache
+    assert(conn_pool_stat(&cp, &stat, 1, &count) == 0);
+    assert(count == 1 && stat.total_count == 2 && stat.free_count == 2);
+    assert(stat.stats.connect_count == 2 && stat.stats.reuse_count == 2);
+    assert(stat.stats.checkout_count == 4);
+    conn_pool_destroy(&cp);
+}
+
+static void test_checkout(const bool by_key)
+{
+    pthread_t tids[THREAD_COUNT];
+    int64_t start_time;
+    int64_t time_used;
+    int i;
+
+    start_time = get_current_time_ms();
+    for (i=0; i<THREAD_COUNT; i++) {
+        assert(pthread_create(tids + i, NULL, checkout_thread_func,
+                    by_key ? (void *)1 : NULL) == 0);
+    }
+    for (i=0; i<THREAD_COUNT; i++) {
+        pthread_join(tids[i], NULL);
+    }
+    time_used = get_current_time_ms() - start_time;
+    printf("checkout %s%s, threads: %d, loop count: %d, time used: "
+            "%"PRId64" ms, avg: %.1f ns\n", by_key ? "by key" : "by conn",
+            cp.thread_cache_size > 0 ? " with thread cache" : "",
+            THREAD_COUNT, LOOP_COUNT, time_used, (double)time_used *
+            1000 * 1000 / ((int64_t)THREAD_COUNT * LOOP_COUNT));
+}
+
+static void test_key()
+{
+    ConnectionPoolKey key1;
+    ConnectionPoolKey key2;
+    ConnectionInfo conn;
+
+    memset(&conn, 0, sizeof(conn));
+    strcpy(conn.ip_addr, "192.168.0.1");
+    conn.port = 23000;
+    assert(conn_pool_make_key(&conn, &key1) == 0);
+    strcpy(conn.ip_addr, "::ffff:192.168.0.1");
+    assert(conn_pool_make_key(&conn, &key2) == 0);
+    assert(memcmp(&key1, &key2, CONN_POOL_KEY_BYTES) != 0);
+    strcpy(conn.ip_addr, "192.168.0.1");
+    conn.port = 23001;
+    assert(conn_pool_make_key(&conn, &key2) == 0);
+    assert(memcmp(&key1, &key2, CONN_POOL_KEY_BYTES) != 0);
+    conn.port = 23000;
+    assert(conn_pool_make_key(&conn, &key2) == 0);
+    assert(memcmp(&key1, &key2, sizeof(key1)) == 0);
+
+    strcpy(conn.ip_addr, "not.an.ip");
+    assert(conn_pool_make_key(&conn, &key2) == EINVAL);
+}
+
+int main(int argc, char *argv[])
+{
+    pthread_t accept_tid;
+    ConnectionInfo other;
+    ConnectionInfo *conns[3];
+    int listen_sock;
+    int result;
+
+    log_init();
+    test_key();
+
+    memset(&server, 0, sizeof(server));
+    server.sock = -1;
+    strcpy(server.ip_addr, "127.0.0.1");
+    server.port = 20000 + getpid() % 10000;
+    listen_sock = socketServer(server.ip_addr, server.port, &result);
+    assert(listen_sock >= 0);
+    assert(pthread_create(&accept_tid, NULL, accept_thread_func,
+                (void *)(long)listen_sock) == 0);
+
+    assert(conn_pool_init(&cp, CONNECT_TIMEOUT, 2, MAX_IDLE_TIME) == 0);
+
+    //the max count per entry
+    conns[0] = conn_pool_get_connection(&cp, &server, &result);
+    assert(conns[0] != NULL);
+    conns[1] = conn_pool_get_connection(&cp, &server, &result);
+    assert(conns[1] != NULL && conns[1]->sock != conns[0]->sock);
+    conns[2] = conn_pool_get_connection(&cp, &server, &result);
+    assert(conns[2] == NULL && result == ENOSPC);
+    assert(conn_pool_close_connection(&cp, conns[0]) == 0);
+    assert(conn_pool_get_connection_count(&cp) == 1);
+    conns[2] = conn_pool_get_connection(&cp, &server, &result);
+    assert(conns[2] == conns[0]);  //reuse
+    assert(conn_pool_close_connection_ex(&cp, conns[1], true) == 0);
+    assert(conn_pool_close_connection(&cp, conns[2]) == 0);
+    assert(conn_pool_get_connection_count(&cp) == 1);
+
+    //the server not exist
+    other = server;
+    other.port = server.port + 1;
+    assert(conn_pool_get_connection(&cp, &other, &result) == NULL);
+    assert(result == ECONNREFUSED);
+    test_stat(&other);
+
+    conn_pool_destroy(&cp);
+
+    //no limit for the benchmark
+    assert(conn_pool_init(&cp, CONNECT_TIMEOUT, 0, MAX_IDLE_TIME) == 0);
+    test_checkout(false);
+    test_checkout(true);
+    assert(conn_pool_get_connection_count(&cp) <= THREAD_COUNT);
+    conn_pool_destroy(&cp);
+
+    test_thread_cache();
+    assert(conn_pool_init(&cp, CONNECT_TIMEOUT, 0, MAX_IDLE_TIME) == 0);
+    assert(conn_pool_enable_thread_cache(&cp, THREAD_CACHE_SIZE) == 0);
+    test_checkout(false);
+    test_checkout(true);
+    conn_pool_destroy(&cp);
+    close(listen_sock);
+    printf("pass OK\n");
+    return 0;
+}
@@ -0,0 +1,138 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+#include <inttypes.h>
+#include "logger.h"
+#include "shared_func.h"
+#include "hash.h"
+
+#define DEFAULT_COUNT  (4 * 1024 * 1024)  //larger than LLC
+#define BATCH_SIZE     64
+#define KEY_SIZE       16
+
+static int count = DEFAULT_COUNT;
+static char *keys;
+static int *key_lens;
+static int *indexes;
+
+static void gen_keys()
+{
+    int i;
+    int index1;
+    int index2;
+    int tmp;
+
+    keys = (char *)malloc(KEY_SIZE * (int64_t)count);
+    key_lens = (int *)malloc(sizeof(int) * count);
+    indexes = (int *)malloc(sizeof(int) * count);
+    for (i=0; i<count; i++) {
+        key_lens[i] = sprintf(keys + KEY_SIZE * (int64_t)i, "key-%d", i);
+        indexes[i] = i;
+    }
+
+    //random access order
+    for (i=0; i<count; i++) {
+        index1 = (count - 1) * (int64_t)rand() / (int64_t)RAND_MAX;
+        index2 = (count - 1) * (int64_t)rand() / (int64_t)RAND_MAX;
+        tmp = indexes[index1];
+        indexes[index1] = indexes[index2];
+        indexes[index2] = tmp;
+    }
+}
+
+static void test_find_loop(HashArray *hash)
+{
+    int i;
+    int found;
+    int64_t start_time;
+    void *value;
+
+    found = 0;
+    start_time = get_current_time_us();
+    for (i=0; i<count; i++) {
+        value = hash_find(hash, keys + KEY_SIZE * (int64_t)indexes[i],
+                key_lens[indexes[i]]);
+        if (value != NULL) {
+            found++;
+        }
+    }
+    assert(found == count);
+    printf("hash_find loop time used: %"PRId64" ms\n",
+            (get_current_time_us() - start_time) / 1000);
+}
+
+static void test_find_batch(HashArray *hash)
+{
+    int i;
+    int k;
+    int n;
+    int found;
+    int64_t start_time;
+    const void *batch_keys[BATCH_SIZE];
+    int batch_key_lens[BATCH_SIZE];
+    void *values[BATCH_SIZE];
+
+    found = 0;
+    start_time = get_current_time_us();
+    for (i=0; i<count; i+=BATCH_SIZE) {
+        n = count - i < BATCH_SIZE ? count - i : BATCH_SIZE;
+        for (k=0; k<n; k++) {
+            batch_keys[k] = keys + KEY_SIZE * (int64_t)indexes[i + k];
+            batch_key_lens[k] = key_lens[indexes[i + k]];
+        }
+        found += hash_find_batch(hash, batch_keys, batch_key_lens,
+                n, values);
+        for (k=0; k<n; k++) {
+            assert(values[k] == (void *)(batch_keys[k]));
+        }
+    }
+    assert(found == count);
+    printf("hash_find_batch time used: %"PRId64" ms\n",
+            (get_current_time_us() - start_time) / 1000);
+}
+
+int main(int argc, char *argv[])
+{
+    int i;
+    int result;
+    void *values[2];
+    const void *miss_keys[2];
+    int miss_key_lens[2];
+    HashArray hash;
+
+    log_init();
+    if (argc > 1) {
+        count = atoi(argv[1]);
+    }
+    srand(time(NULL));
+    gen_keys();
+
+    if ((result=hash_init(&hash, simple_hash, count, 0.75)) != 0) {
+        return result;
+    }
+    for (i=0; i<count; i++) {
+        //the value is the key pointer for check
+        if (hash_insert(&hash, keys + KEY_SIZE * (int64_t)i, key_lens[i],
+                    keys + KEY_SIZE * (int64_t)i) < 0)
+        {
+            return ENOMEM;
+        }
+    }
+    printf("item count: %d\n", hash_count(&hash));
+
+    test_find_loop(&hash);
+    test_find_batch(&hash);
+
+    miss_keys[0] = "not-exist";
+    miss_key_lens[0] = strlen("not-exist");
+    miss_keys[1] = keys;
+    miss_key_lens[1] = key_lens[0];
+    assert(hash_find_batch(&hash, miss_keys, miss_key_lens, 2, values) == 1);
+    assert(values[0] == NULL && values[1] == keys);
+
+    hash_destroy(&hash);
+    printf("pass OK\n");
+    return 0;
+}
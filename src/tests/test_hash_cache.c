@@ -0,0 +1,257 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <assert.h>
+#include <inttypes.h>
+#include "logger.h"
+#include "shared_func.h"
+#include "hash_cache.h"
+
+#define CAPACITY    100
+#define SLOT_COUNT  4
+#define VALUE_LEN   16
+
+static int64_t base_bytes;   //the buckets of the empty cache
+static int64_t entry_bytes;  //one entry with the key "key-n"
+
+static int make_key(char *key, const int n)
+{
+    return sprintf(key, "key-%d", n);
+}
+
+static int cache_set(HashCache *cache, const int n, const int ttl)
+{
+    char key[32];
+    char value[VALUE_LEN];
+    int key_len;
+
+    key_len = make_key(key, n);
+    memset(value, 'a' + n % 26, VALUE_LEN);
+    return hash_cache_set(cache, key, key_len, value, VALUE_LEN, ttl);
+}
+
+static int cache_get(HashCache *cache, const int n)
+{
+    char key[32];
+    char value[VALUE_LEN];
+    int key_len;
+    int value_len;
+    int result;
+
+    key_len = make_key(key, n);
+    value_len = sizeof(value);
+    if ((result=hash_cache_get(cache, key, key_len,
+                    value, &value_len)) == 0) {
+        assert(value_len == VALUE_LEN);
+        assert(value[0] == 'a' + n % 26 && value[VALUE_LEN - 1] == value[0]);
+    }
+    return result;
+}
+
+static void calc_entry_bytes()
+{
+    HashCache cache;
+    HashCacheStat stat;
+
+    assert(hash_cache_init_ex(&cache, simple_hash, CAPACITY,
+                1024 * 1024, 1, HASH_CACHE_POLICY_LRU) == 0);
+    hash_cache_stat(&cache, &stat);
+    base_bytes = stat.bytes_used;
+    assert(cache_set(&cache, 0, 0) == 0);
+    hash_cache_stat(&cache, &stat);
+    entry_bytes = stat.bytes_used - base_bytes;
+    assert(entry_bytes > VALUE_LEN);
+    hash_cache_destroy(&cache);
+}
+
+//the cache holds SLOT_COUNT entries exactly
+static void init_bounded_cache(HashCache *cache, const int policy)
+{
+    assert(hash_cache_init_ex(cache, simple_hash, CAPACITY,
+                base_bytes + SLOT_COUNT * entry_bytes, 1, policy) == 0);
+}
+
+static void check_bound(HashCache *cache)
+{
+    HashCacheStat stat;
+
+    hash_cache_stat(cache, &stat);
+    assert(stat.item_count == SLOT_COUNT);
+    assert(stat.bytes_used == base_bytes + SLOT_COUNT * entry_bytes);
+}
+
+static void test_lru()
+{
+    HashCache cache;
+    HashCacheStat stat;
+    int i;
+
+    init_bounded_cache(&cache, HASH_CACHE_POLICY_LRU);
+    for (i=0; i<SLOT_COUNT; i++) {
+        assert(cache_set(&cache, i, 0) == 0);
+    }
+    check_bound(&cache);
+
+    //key-0 becomes the most recently used, key-1 is the tail
+    assert(cache_get(&cache, 0) == 0);
+    assert(cache_set(&cache, 4, 0) == 0);
+    check_bound(&cache);
+    assert(cache_get(&cache, 1) == ENOENT);
+
+    assert(cache_set(&cache, 5, 0) == 0);
+    check_bound(&cache);
+    assert(cache_get(&cache, 2) == ENOENT);
+    assert(cache_get(&cache, 0) == 0);
+    assert(cache_get(&cache, 3) == 0);
+    assert(cache_get(&cache, 4) == 0);
+    assert(cache_get(&cache, 5) == 0);
+
+    hash_cache_stat(&cache, &stat);
+    assert(stat.evictions == 2);
+    assert(stat.hits == 5);
+    assert(stat.misses == 2);
+    assert(stat.expirations == 0);
+    hash_cache_destroy(&cache);
+}
+
+static void test_clock()
+{
+    HashCache cache;
+    HashCacheStat stat;
+    int i;
+
+    init_bounded_cache(&cache, HASH_CACHE_POLICY_CLOCK);
+    for (i=0; i<SLOT_COUNT; i++) {
+        assert(cache_set(&cache, i, 0) == 0);
+    }
+
+    //key-0 is referenced, so gets the second chance and key-1 is evicted
+    assert(cache_get(&cache, 0) == 0);
+    assert(cache_set(&cache, 4, 0) == 0);
+    check_bound(&cache);
+    assert(cache_get(&cache, 1) == ENOENT);
+
+    //the hand goes on from key-2
+    assert(cache_set(&cache, 5, 0) == 0);
+    check_bound(&cache);
+    assert(cache_get(&cache, 2) == ENOENT);
+    assert(cache_get(&cache, 0) == 0);
+    assert(cache_get(&cache, 3) == 0);
+    assert(cache_get(&cache, 4) == 0);
+    assert(cache_get(&cache, 5) == 0);
+
+    hash_cache_stat(&cache, &stat);
+    assert(stat.evictions == 2);
+    assert(stat.hits == 5);
+    assert(stat.misses == 2);
+    hash_cache_destroy(&cache);
+}
+
+static void test_overwrite()
+{
+    HashCache cache;
+    HashCacheStat stat;
+    char key[32];
+    char value[2 * VALUE_LEN];
+    char *big_value;
+    int big_len;
+    int key_len;
+    int value_len;
+    int i;
+
+    init_bounded_cache(&cache, HASH_CACHE_POLICY_LRU);
+    for (i=0; i<SLOT_COUNT; i++) {
+        assert(cache_set(&cache, i, 0) == 0);
+    }
+
+    //overwrite by the same size, nothing evicted
+    for (i=0; i<SLOT_COUNT; i++) {
+        assert(cache_set(&cache, i, 0) == 0);
+    }
+    check_bound(&cache);
+    hash_cache_stat(&cache, &stat);
+    assert(stat.evictions == 0);
+
+    //the larger value evicts the tail only
+    memset(value, 'z', sizeof(value));
+    assert(hash_cache_set(&cache, "key-3", 5, value, sizeof(value), 0) == 0);
+    hash_cache_stat(&cache, &stat);
+    assert(stat.evictions == 1);
+    assert(stat.item_count == SLOT_COUNT - 1);
+    assert(stat.bytes_used <= base_bytes + SLOT_COUNT * entry_bytes);
+    assert(cache_get(&cache, 0) == ENOENT);
+
+    value_len = sizeof(value);
+    assert(hash_cache_get(&cache, "key-3", 5, value, &value_len) == 0);
+    assert(value_len == sizeof(value) && value[0] == 'z');
+
+    //the value larger than the max bytes
+    big_len = base_bytes + SLOT_COUNT * entry_bytes;
+    big_value = (char *)malloc(big_len);
+    assert(big_value != NULL);
+    memset(big_value, 'b', big_len);
+    assert(hash_cache_set(&cache, "key-9", 5, big_value,
+                big_len, 0) == ENOSPC);
+    free(big_value);
+
+    for (i=1; i<SLOT_COUNT; i++) {
+        key_len = make_key(key, i);
+        assert(hash_cache_delete(&cache, key, key_len) == 0);
+    }
+    assert(hash_cache_delete(&cache, "key-0", 5) == ENOENT);
+    hash_cache_stat(&cache, &stat);
+    assert(stat.item_count == 0);
+    assert(stat.bytes_used == base_bytes);
+    hash_cache_destroy(&cache);
+}
+
+static void test_ttl()
+{
+    HashCache cache;
+    HashCacheStat stat;
+
+    init_bounded_cache(&cache, HASH_CACHE_POLICY_LRU);
+    assert(cache_set(&cache, 0, 1) == 0);
+    assert(cache_set(&cache, 1, 0) == 0);
+    assert(cache_get(&cache, 0) == 0);
+
+    sleep(2);
+    assert(cache_get(&cache, 0) == ENOENT);
+    assert(cache_get(&cache, 1) == 0);
+
+    hash_cache_stat(&cache, &stat);
+    assert(stat.item_count == 1);
+    assert(stat.bytes_used == base_bytes + entry_bytes);
+    assert(stat.expirations == 1);
+    assert(stat.evictions == 0);
+    assert(stat.hits == 2);
+    assert(stat.misses == 1);
+    hash_cache_destroy(&cache);
+}
+
+int main(int argc, char *argv[])
+{
+    HashCache cache;
+
+    log_init();
+    assert(hash_cache_init_ex(&cache, simple_hash, CAPACITY,
+                0, 1, HASH_CACHE_POLICY_LRU) == EINVAL);
+    assert(hash_cache_init_ex(&cache, simple_hash, CAPACITY,
+                1024, 1, HASH_CACHE_POLICY_CLOCK + 1) == EINVAL);
+
+    //the capacity is too large for the HashArray, the shards are destroyed
+    assert(hash_cache_init_ex(&cache, simple_hash, 0xFFFFFFFF,
+                1024, 1, HASH_CACHE_POLICY_LRU) == EINVAL);
+    assert(cache.shards == NULL);
+
+    calc_entry_bytes();
+    test_lru();
+    test_clock();
+    test_overwrite();
+    test_ttl();
+
+    printf("pass OK\n");
+    return 0;
+}
@@ -0,0 +1,168 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include "logger.h"
+#include "shared_func.h"
+#include "hash_filter.h"
+
+#define COUNT 1000000
+#define THREAD_COUNT 4
+#define FALSE_POSITIVE_RATE 0.01
+
+static BloomFilter bloom;
+
+static int make_key(char *key, const int n)
+{
+    return sprintf(key, "key-%d", n);
+}
+
+static void *add_thread_func(void *arg)
+{
+    int start;
+    int i;
+    int key_len;
+    char key[32];
+
+    start = (long)arg;
+    for (i=start; i<COUNT; i+=THREAD_COUNT) {
+        key_len = make_key(key, i);
+        bloom_filter_add(&bloom, key, key_len);
+    }
+    return NULL;
+}
+
+static void test_bloom_filter()
+{
+    int i;
+    int key_len;
+    int false_positive;
+    int64_t size;
+    int64_t start_time;
+    char key[32];
+    char *buff;
+    const char *filename = "/tmp/test_bloom_filter.dat";
+    pthread_t tids[THREAD_COUNT];
+    BloomFilter loaded;
+
+    assert(bloom_filter_init(&bloom, COUNT, FALSE_POSITIVE_RATE, true) == 0);
+    start_time = get_current_time_ms();
+    for (i=0; i<THREAD_COUNT; i++) {
+        assert(pthread_create(tids + i, NULL, add_thread_func,
+                    (void *)(long)i) == 0);
+    }
+    for (i=0; i<THREAD_COUNT; i++) {
+        pthread_join(tids[i], NULL);
+    }
+    printf("bloom filter add by %d threads, time used: %"PRId64" ms\n",
+            THREAD_COUNT, get_current_time_ms() - start_time);
+
+    start_time = get_current_time_ms();
+    for (i=0; i<COUNT; i++) {
+        key_len = make_key(key, i);
+        assert(bloom_filter_contains(&bloom, key, key_len));
+    }
+    false_positive = 0;
+    for (i=COUNT; i<2 * COUNT; i++) {
+        key_len = make_key(key, i);
+        false_positive += bloom_filter_contains(&bloom, key, key_len);
+    }
+    printf("bloom filter bytes: %"PRId64", hash count: %d, "
+            "false positive rate: %.4f, time used: %"PRId64" ms\n",
+            bloom.block_count * 64, bloom.hash_count,
+            (double)false_positive / COUNT,
+            get_current_time_ms() - start_time);
+    assert(false_positive < 2 * FALSE_POSITIVE_RATE * COUNT);
+
+    size = bloom_filter_serialize_size(&bloom);
+    buff = (char *)malloc(size);
+    assert(bloom_filter_serialize(&bloom, buff, size - 1) == ENOSPC);
+    assert(bloom_filter_serialize(&bloom, buff, size) == 0);
+    assert(bloom_filter_deserialize(&loaded, buff, size - 1, false) == EINVAL);
+    assert(bloom_filter_deserialize(&loaded, buff, size, false) == 0);
+    assert(loaded.block_count == bloom.block_count);
+    assert(memcmp(loaded.bits, bloom.bits, size -
+                BLOOM_FILTER_HEADER_SIZE) == 0);
+    bloom_filter_destroy(&loaded);
+    free(buff);
+
+    assert(bloom_filter_save(&bloom, filename) == 0);
+    assert(bloom_filter_load(&loaded, filename, false) == 0);
+    unlink(filename);
+    for (i=0; i<COUNT; i++) {
+        key_len = make_key(key, i);
+        assert(bloom_filter_contains(&loaded, key, key_len));
+    }
+    bloom_filter_destroy(&loaded);
+
+    bloom_filter_clear(&bloom);
+    key_len = make_key(key, 0);
+    assert(!bloom_filter_contains(&bloom, key, key_len));
+    bloom_filter_destroy(&bloom);
+}
+
+static void test_cuckoo_filter()
+{
+    int i;
+    int key_len;
+    int false_positive;
+    int64_t start_time;
+    char key[32];
+    CuckooFilter cuckoo;
+
+    assert(cuckoo_filter_init(&cuckoo, COUNT) == 0);
+    start_time = get_current_time_ms();
+    for (i=0; i<COUNT; i++) {
+        key_len = make_key(key, i);
+        assert(cuckoo_filter_add(&cuckoo, key, key_len) == 0);
+    }
+    for (i=0; i<COUNT; i++) {
+        key_len = make_key(key, i);
+        assert(cuckoo_filter_contains(&cuckoo, key, key_len));
+    }
+    assert(cuckoo_filter_count(&cuckoo) == COUNT);
+
+    //delete the odd keys
+    for (i=1; i<COUNT; i+=2) {
+        key_len = make_key(key, i);
+        assert(cuckoo_filter_delete(&cuckoo, key, key_len) == 0);
+    }
+    assert(cuckoo_filter_count(&cuckoo) == COUNT / 2);
+    false_positive = 0;
+    for (i=0; i<COUNT; i++) {
+        key_len = make_key(key, i);
+        if (i % 2 == 0) {
+            assert(cuckoo_filter_contains(&cuckoo, key, key_len));
+        } else {
+            false_positive += cuckoo_filter_contains(&cuckoo, key, key_len);
+        }
+    }
+    printf("cuckoo filter bytes: %"PRId64", false positive rate: %.4f, "
+            "time used: %"PRId64" ms\n", (cuckoo.bucket_mask + 1) *
+            CUCKOO_FILTER_BUCKET_SLOTS * 2, (double)false_positive /
+            (COUNT / 2), get_current_time_ms() - start_time);
+    assert(false_positive < FALSE_POSITIVE_RATE * COUNT / 2);
+
+    //fill the filter until full
+    i = COUNT;
+    do {
+        key_len = make_key(key, i++);
+    } while (cuckoo_filter_add(&cuckoo, key, key_len) == 0);
+    assert(cuckoo_filter_count(&cuckoo) > (cuckoo.bucket_mask + 1) *
+            CUCKOO_FILTER_BUCKET_SLOTS * 0.9);
+    key_len = make_key(key, 0);
+    assert(cuckoo_filter_delete(&cuckoo, key, key_len) == 0);
+    cuckoo_filter_destroy(&cuckoo);
+}
+
+int main(int argc, char *argv[])
+{
+    log_init();
+    test_bloom_filter();
+    test_cuckoo_filter();
+    printf("pass OK\n");
+    return 0;
+}
@@ -0,0 +1,247 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+#include <inttypes.h>
+#include "logger.h"
+#include "shared_func.h"
+#include "hash_sketch.h"
+
+#define COUNT 1000000
+#define HEAVY_COUNT 10
+#define HEAVY_TIMES 10000
+#define TOP_K 16
+
+static int make_key(char *key, const int n)
+{
+    return sprintf(key, "key-%d", n);
+}
+
+static void test_hll()
+{
+    int i;
+    int key_len;
+    int size;
+    int64_t count;
+    int64_t start_time;
+    double error;
+    char key[32];
+    char *buff;
+    HyperLogLog hll;
+    HyperLogLog half;
+    HyperLogLog loaded;
+
+    assert(hll_init(&hll, HLL_MAX_PRECISION + 1) == EINVAL);
+    assert(hll_init(&hll, HLL_DEFAULT_PRECISION) == 0);
+    assert(hll_count(&hll) == 0);
+
+    //small range by the linear counting
+    for (i=0; i<100; i++) {
+        key_len = make_key(key, i);
+        hll_add(&hll, key, key_len);
+        hll_add(&hll, key, key_len);
+    }
+    count = hll_count(&hll);
+    assert(count >= 98 && count <= 102);
+
+    start_time = get_current_time_ms();
+    for (i=0; i<COUNT; i++) {
+        key_len = make_key(key, i);
+        hll_add(&hll, key, key_len);
+    }
+    count = hll_count(&hll);
+    error = (double)(count - COUNT) / COUNT;
+    printf("hll count: %"PRId64", error: %.4f, time used: %"PRId64" ms\n",
+            count, error, get_current_time_ms() - start_time);
+    assert(error > -0.03 && error < 0.03);
+
+    //merge two halves
+    hll_clear(&hll);
+    assert(hll_init(&half, HLL_DEFAULT_PRECISION) == 0);
+    for (i=0; i<COUNT; i++) {
+        key_len = make_key(key, i);
+        hll_add(i < COUNT / 2 ? &hll : &half, key, key_len);
+    }
+    assert(hll_merge(&hll, &half) == 0);
+    error = (double)(hll_count(&hll) - COUNT) / COUNT;
+    assert(error > -0.03 && error < 0.03);
+    hll_destroy(&half);
+
+    assert(hll_init(&half, HLL_DEFAULT_PRECISION - 1) == 0);
+    assert(hll_merge(&hll, &half) == EINVAL);
+    hll_destroy(&half);
+
+    size = hll_serialize_size(&hll);
+    buff = (char *)malloc(size);
+    assert(hll_serialize(&hll, buff, size - 1) == ENOSPC);
+    assert(hll_serialize(&hll, buff, size) == 0);
+    assert(hll_deserialize(&loaded, buff, size - 1) == EINVAL);
+    assert(hll_deserialize(&loaded, buff, size) == 0);
+    assert(loaded.precision == hll.precision);
+    assert(hll_count(&loaded) == hll_count(&hll));
+    hll_destroy(&loaded);
+    free(buff);
+
+    hll_destroy(&hll);
+}
+
+static void add_keys(CountMinSketch *sketch, const int start, const int step)
+{
+    int i;
+    int k;
+    int key_len;
+    char key[32];
+
+    for (i=start; i<COUNT; i+=step) {
+        key_len = make_key(key, i);
+        count_min_add(sketch, key, key_len, 1);
+    }
+    for (k=0; k<HEAVY_COUNT; k++) {
+        key_len = make_key(key, k);
+        for (i=start; i<HEAVY_TIMES; i+=step) {
+            count_min_add(sketch, key, key_len, 1);
+        }
+    }
+}
+
+static void check_top_k(CountMinSketch *sketch)
+{
+    CountMinEntry entries[TOP_K];
+    bool found[HEAVY_COUNT];
+    int count;
+    int i;
+    int n;
+
+    count = count_min_top_k(sketch, entries, TOP_K);
+    assert(count == TOP_K);
+    for (i=1; i<count; i++) {
+        assert(entries[i - 1].count >= entries[i].count);
+    }
+
+    memset(found, 0, sizeof(found));
+    for (i=0; i<HEAVY_COUNT; i++) {
+        entries[i].key[entries[i].key_len] = '\0';
+        assert(sscanf(entries[i].key, "key-%d", &n) == 1);
+        assert(n < HEAVY_COUNT && !found[n]);
+        found[n] = true;
+        assert(entries[i].count >= HEAVY_TIMES + 1);
+    }
+}
+
+static void test_count_min()
+{
+    int i;
+    int key_len;
+    int64_t estimate;
+    int64_t max_error;
+    int64_t start_time;
+    char key[32];
+    CountMinSketch sketch;
+    CountMinSketch half;
+
+    assert(count_min_init(&sketch, 0, 4, TOP_K) == EINVAL);
+    assert(count_min_init(&sketch, 1 << 16, 4, TOP_K) == 0);
+
+    start_time = get_current_time_ms();
+    add_keys(&sketch, 0, 1);
+    printf("count min add, time used: %"PRId64" ms\n",
+            get_current_time_ms() - start_time);
+    assert(sketch.total == COUNT + HEAVY_COUNT * HEAVY_TIMES);
+
+    //never under estimate, over estimate by total * e / width mostly
+    max_error = 3 * sketch.total / sketch.width;
+    for (i=0; i<COUNT; i+=97) {
+        key_len = make_key(key, i);
+        estimate = count_min_estimate(&sketch, key, key_len);
+        if (i < HEAVY_COUNT) {
+            assert(estimate >= HEAVY_TIMES + 1);
+            assert(estimate <= HEAVY_TIMES + 1 + max_error);
+        } else {
+            assert(estimate >= 1 && estimate <= 1 + max_error);
+        }
+    }
+    check_top_k(&sketch);
+
+    //merge the sketches of the odd and even keys
+    count_min_clear(&sketch);
+    assert(count_min_top_k(&sketch, NULL, 0) == 0);
+    assert(count_min_init(&half, 1 << 16, 4, TOP_K) == 0);
+    add_keys(&sketch, 0, 2);
+    add_keys(&half, 1, 2);
+    assert(count_min_merge(&sketch, &half) == 0);
+    assert(sketch.total == COUNT + HEAVY_COUNT * HEAVY_TIMES);
+    check_top_k(&sketch);
+    count_min_destroy(&half);
+
+    assert(count_min_init(&half, 1 << 15, 4, TOP_K) == 0);
+    assert(count_min_merge(&sketch, &half) == EINVAL);
+    count_min_destroy(&half);
+
+    count_min_destroy(&sketch);
+}
+
+//merge the sketch of the other node by the serialized buffer
+static void test_count_min_serialize()
+{
+    int i;
+    int size;
+    char *buff;
+    CountMinSketch sketch;
+    CountMinSketch remote;
+    CountMinSketch loaded;
+
+    assert(count_min_init(&sketch, 1 << 16, 4, TOP_K) == 0);
+    assert(count_min_init(&remote, 1 << 16, 4, TOP_K) == 0);
+    add_keys(&sketch, 0, 2);
+    add_keys(&remote, 1, 2);
+
+    size = count_min_serialize_size(&remote);
+    assert(remote.top_k.count > 0);
+    assert(size == COUNT_MIN_HEADER_SIZE + 8 * remote.width * remote.depth
+            + COUNT_MIN_ENTRY_SIZE * remote.top_k.count);
+    buff = (char *)malloc(size);
+    assert(buff != NULL);
+    assert(count_min_serialize(&remote, buff, size - 1) == ENOSPC);
+    assert(count_min_serialize(&remote, buff, size) == 0);
+    assert(count_min_deserialize(&loaded, buff, size - 1) == EINVAL);
+    assert(count_min_deserialize(&loaded, buff, size) == 0);
+
+    //round trip
+    assert(loaded.width == remote.width && loaded.depth == remote.depth);
+    assert(loaded.total == remote.total);
+    assert(memcmp(loaded.counters, remote.counters, sizeof(int64_t) *
+                remote.width * remote.depth) == 0);
+    assert(loaded.top_k.capacity == remote.top_k.capacity);
+    assert(loaded.top_k.count == remote.top_k.count);
+    for (i=0; i<remote.top_k.count; i++) {
+        assert(loaded.top_k.entries[i].hash_code ==
+                remote.top_k.entries[i].hash_code);
+        assert(loaded.top_k.entries[i].count ==
+                remote.top_k.entries[i].count);
+        assert(loaded.top_k.entries[i].key_len ==
+                remote.top_k.entries[i].key_len);
+        assert(memcmp(loaded.top_k.entries[i].key,
+                    remote.top_k.entries[i].key,
+                    remote.top_k.entries[i].key_len) == 0);
+    }
+    free(buff);
+
+    assert(count_min_merge(&sketch, &loaded) == 0);
+    assert(sketch.total == COUNT + HEAVY_COUNT * HEAVY_TIMES);
+    check_top_k(&sketch);
+
+    count_min_destroy(&loaded);
+    count_min_destroy(&remote);
+    count_min_destroy(&sketch);
+}
+
+int main(int argc, char *argv[])
+{
+    log_init();
+    test_hll();
+    test_count_min();
+    test_count_min_serialize();
+    printf("pass OK\n");
+    return 0;
+}
@@ -0,0 +1,278 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <inttypes.h>
+#include "logger.h"
+#include "shared_func.h"
+#include "http_parser.h"
+
+#define LOOP_COUNT 1000000
+
+static const char *request_str =
+    "GET /wp-content/uploads/2010/03/hello-kitty-darth-vader-pink.jpg HTTP/1.1\r\n"
+    "Host: www.kittyhell.com\r\n"
+    "User-Agent: Mozilla/5.0 (Macintosh; U; Intel Mac OS X 10_6_3; ja-JP-mac; "
+    "rv:1.9.2.3) Gecko/20100401 Firefox/3.6.3 Pathtraq/0.9\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+    "Accept-Language: ja,en-us;q=0.7,en;q=0.3\r\n"
+    "Accept-Encoding: gzip,deflate\r\n"
+    "Accept-Charset: Shift_JIS,utf-8;q=0.7,*;q=0.7\r\n"
+    "Keep-Alive: 115\r\n"
+    "Connection: keep-alive\r\n"
+    "Cookie: wp_ozh_wsa_visits=2; wp_ozh_wsa_visit_lasttime=xxxxxxxxxx; "
+    "__utma=xxxxxxxxx.xxxxxxxxxx.xxxxxxxxxx.xxxxxxxxxx.xxxxxxxxxx.x; "
+    "__utmz=xxxxxxxxx.xxxxxxxxxx.x.x.utmccn=(referral)|utmcsr=reader.livedoor.com"
+    "|utmcct=/reader/|utmcmd=referral\r\n"
+    "\r\n";
+
+static bool slice_equals(const char *buff, const HttpSlice *slice,
+        const char *str)
+{
+    return slice->length == (int)strlen(str) && memcmp(buff +
+            slice->offset, str, slice->length) == 0;
+}
+
+static void check_request(const char *buff, HttpParser *parser)
+{
+    HttpSlice value;
+
+    assert(slice_equals(buff, &parser->method, "GET"));
+    assert(slice_equals(buff, &parser->path, "/wp-content/uploads/2010/03/"
+                "hello-kitty-darth-vader-pink.jpg"));
+    assert(parser->minor_version == 1);
+    assert(parser->header_count == 9);
+    assert(slice_equals(buff, &parser->headers[0].name, "Host"));
+    assert(slice_equals(buff, &parser->headers[0].value,
+                "www.kittyhell.com"));
+    assert(http_parser_find_header(parser, buff, "keep-alive", &value) == 0);
+    assert(slice_equals(buff, &value, "115"));
+    assert(http_parser_find_header(parser, buff, "X-None", &value) == ENOENT);
+    assert(parser->keep_alive);
+    assert(http_parser_is_done(parser));
+}
+
+//feed the data byte by byte as the partial reads
+static void test_partial()
+{
+    HttpParser parser;
+    int length;
+    int result;
+
+    http_parser_init(&parser, HTTP_PARSER_TYPE_REQUEST, 0);
+    for (length=1; ; length++) {
+        result = http_parser_parse_headers(&parser, request_str, length);
+        if (result != EAGAIN) {
+            break;
+        }
+    }
+    assert(result == 0 && length == (int)strlen(request_str));
+    assert(parser.offset == (int)strlen(request_str));
+    check_request(request_str, &parser);
+    printf("partial request OK\n");
+}
+
+static void test_pipeline()
+{
+    char buff[256];
+    HttpParser parser;
+    HttpSlice slice;
+    int length;
+
+    //the leading empty lines, LF only line end and the POST body
+    length = sprintf(buff, "\r\nGET /a?x=1 HTTP/1.0\nHost:  h  \n\n"
+            "POST /b HTTP/1.1\r\nContent-Length: 5\r\n\r\nhello"
+            "GET /c HTTP/1.1\r\n\r\n");
+    http_parser_init(&parser, HTTP_PARSER_TYPE_REQUEST, 0);
+    assert(http_parser_parse_headers(&parser, buff, length) == 0);
+    assert(slice_equals(buff, &parser.path, "/a?x=1"));
+    assert(slice_equals(buff, &parser.headers[0].value, "h"));
+    assert(parser.minor_version == 0 && !parser.keep_alive);
+    assert(http_parser_parse_body(&parser, buff, length, &slice) == ENOENT);
+
+    http_parser_reset(&parser);
+    assert(http_parser_parse_headers(&parser, buff, length) == 0);
+    assert(slice_equals(buff, &parser.method, "POST"));
+    assert(parser.content_length == 5 && parser.keep_alive);
+    assert(http_parser_parse_body(&parser, buff, length - 21, &slice) == 0);
+    assert(slice_equals(buff, &slice, "hel"));
+    assert(http_parser_parse_body(&parser, buff, length - 21,
+                &slice) == EAGAIN);
+    assert(http_parser_parse_body(&parser, buff, length, &slice) == 0);
+    assert(slice_equals(buff, &slice, "lo"));
+    assert(http_parser_parse_body(&parser, buff, length, &slice) == ENOENT);
+
+    //drop the parsed data from the buffer front
+    length -= parser.offset;
+    memmove(buff, buff + parser.offset, length);
+    http_parser_shift(&parser, parser.offset);
+    http_parser_reset(&parser);
+    assert(parser.offset == 0);
+    assert(http_parser_parse_headers(&parser, buff, length) == 0);
+    assert(slice_equals(buff, &parser.path, "/c"));
+    assert(parser.header_count == 0 && parser.offset == length);
+    printf("pipeline OK\n");
+}
+
+static void test_chunked()
+{
+    const char *response = "HTTP/1.1 200 OK\r\n"
+        "Transfer-Encoding: gzip, chunked\r\n\r\n"
+        "5;ext=1\r\nhello\r\nB\r\n world, abc\r\n0\r\nX-Trailer: t\r\n\r\n"
+        "HTTP/1.1 204 No Content\r\n\r\n";
+    HttpParser parser;
+    HttpSlice slice;
+    char body[64];
+    int body_len;
+    int length;
+    int total;
+    int result;
+
+    //all the split points
+    total = strlen(response);
+    for (length=1; length<=total; length++) {
+        http_parser_init(&parser, HTTP_PARSER_TYPE_RESPONSE, 0);
+        body_len = 0;
+        result = http_parser_parse_headers(&parser, response, length);
+        if (result == EAGAIN) {
+            result = http_parser_parse_headers(&parser, response, total);
+        } else {
+            while ((result=http_parser_parse_body(&parser, response,
+                            length, &slice)) == 0)
+            {
+                memcpy(body + body_len, response + slice.offset,
+                        slice.length);
+                body_len += slice.length;
+            }
+            assert(result == EAGAIN || result == ENOENT);
+        }
+        assert(parser.status == 200 && parser.chunked);
+        assert(slice_equals(response, &parser.reason, "OK"));
+
+        while ((result=http_parser_parse_body(&parser, response,
+                        total, &slice)) == 0)
+        {
+            memcpy(body + body_len, response + slice.offset, slice.length);
+            body_len += slice.length;
+        }
+        assert(result == ENOENT);
+        assert(body_len == 16 && memcmp(body, "hello world, abc", 16) == 0);
+
+        http_parser_reset(&parser);
+        assert(http_parser_parse_headers(&parser, response, total) == 0);
+        assert(parser.status == 204 && http_parser_is_done(&parser));
+        assert(parser.offset == total);
+    }
+    printf("chunked OK\n");
+}
+
+static int parse_one(const int type, const char *str)
+{
+    HttpParser parser;
+
+    http_parser_init(&parser, type, 256);
+    return http_parser_parse_headers(&parser, str, strlen(str));
+}
+
+static void test_invalid()
+{
+    char buff[512];
+    HttpParser parser;
+    HttpSlice slice;
+    int length;
+    int i;
+
+    assert(parse_one(HTTP_PARSER_TYPE_REQUEST, "GET / HTTP/1.1\r\n") == EAGAIN);
+    assert(parse_one(HTTP_PARSER_TYPE_REQUEST,
+                "G@T / HTTP/1.1\r\n\r\n") == EPROTO);
+    assert(parse_one(HTTP_PARSER_TYPE_REQUEST,
+                "GET /a b HTTP/1.1\r\n\r\n") == EPROTO);
+    assert(parse_one(HTTP_PARSER_TYPE_REQUEST,
+                "GET / HTTP/2.0\r\n\r\n") == EPROTO);
+    assert(parse_one(HTTP_PARSER_TYPE_REQUEST,
+                "GET / HTTP/1.1\r\nA: b\r\n folded\r\n\r\n") == EPROTO);
+    assert(parse_one(HTTP_PARSER_TYPE_REQUEST,
+                "GET / HTTP/1.1\r\nA b\r\n\r\n") == EPROTO);
+    assert(parse_one(HTTP_PARSER_TYPE_REQUEST,
+                "GET / HTTP/1.1\r\nA: b\rc\r\n\r\n") == EPROTO);
+    assert(parse_one(HTTP_PARSER_TYPE_REQUEST, "POST / HTTP/1.1\r\n"
+                "Content-Length: 5\r\nContent-Length: 6\r\n\r\n") == EPROTO);
+    assert(parse_one(HTTP_PARSER_TYPE_REQUEST, "POST / HTTP/1.1\r\n"
+                "Content-Length: -1\r\n\r\n") == EPROTO);
+    assert(parse_one(HTTP_PARSER_TYPE_RESPONSE,
+                "HTTP/1.1 20 OK\r\n\r\n") == EPROTO);
+    assert(parse_one(HTTP_PARSER_TYPE_RESPONSE, "HTTP/1.1 200\r\n\r\n") == 0);
+
+    //the max header size
+    length = sprintf(buff, "GET / HTTP/1.1\r\nA: ");
+    memset(buff + length, 'a', 300);
+    buff[length + 300] = '\0';
+    assert(parse_one(HTTP_PARSER_TYPE_REQUEST, buff) == EOVERFLOW);
+    strcpy(buff + length + 300, "\r\n\r\n");
+    assert(parse_one(HTTP_PARSER_TYPE_REQUEST, buff) == EOVERFLOW);
+
+    //the max header count
+    length = sprintf(buff, "GET / HTTP/1.1\r\n");
+    for (i=0; i<=HTTP_PARSER_MAX_HEADER_COUNT; i++) {
+        length += sprintf(buff + length, "A:\n");
+    }
+    sprintf(buff + length, "\n");
+    http_parser_init(&parser, HTTP_PARSER_TYPE_REQUEST, 0);
+    assert(http_parser_parse_headers(&parser, buff,
+                strlen(buff)) == EOVERFLOW);
+
+    //the invalid chunk size
+    length = sprintf(buff, "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked"
+            "\r\n\r\nxyz\r\n");
+    http_parser_init(&parser, HTTP_PARSER_TYPE_RESPONSE, 0);
+    assert(http_parser_parse_headers(&parser, buff, length) == 0);
+    assert(http_parser_parse_body(&parser, buff, length, &slice) == EPROTO);
+
+    //the body until the connection closed
+    length = sprintf(buff, "HTTP/1.1 200 OK\r\n\r\nabc");
+    http_parser_init(&parser, HTTP_PARSER_TYPE_RESPONSE, 0);
+    assert(http_parser_parse_headers(&parser, buff, length) == 0);
+    assert(parser.state == HTTP_PARSER_STATE_BODY_EOF && !parser.keep_alive);
+    assert(http_parser_parse_body(&parser, buff, length, &slice) == 0);
+    assert(slice_equals(buff, &slice, "abc"));
+    assert(http_parser_parse_body(&parser, buff, length, &slice) == EAGAIN);
+    printf("invalid OK\n");
+}
+
+static void benchmark()
+{
+    HttpParser parser;
+    int64_t start_time;
+    int64_t time_used;
+    int length;
+    int i;
+
+    length = strlen(request_str);
+    start_time = get_current_time_ms();
+    for (i=0; i<LOOP_COUNT; i++) {
+        http_parser_init(&parser, HTTP_PARSER_TYPE_REQUEST, 0);
+        if (http_parser_parse_headers(&parser, request_str, length) != 0) {
+            assert(0);
+        }
+    }
+    time_used = get_current_time_ms() - start_time;
+    check_request(request_str, &parser);
+    printf("parse request %d bytes, loop count: %d, time used: %"PRId64
+            " ms, avg: %.1f ns, %.1f MB/s\n", length, LOOP_COUNT, time_used,
+            (double)time_used * 1000 * 1000 / LOOP_COUNT,
+            time_used > 0 ? (double)length * LOOP_COUNT /
+            (1024 * 1024) * 1000 / time_used : 0.0);
+}
+
+int main(int argc, char *argv[])
+{
+    log_init();
+    test_partial();
+    test_pipeline();
+    test_chunked();
+    test_invalid();
+    benchmark();
+    printf("pass OK\n");
+    return 0;
+}
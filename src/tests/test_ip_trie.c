@@ -0,0 +1,216 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+#include <inttypes.h>
+#include <arpa/inet.h>
+#include "logger.h"
+#include "shared_func.h"
+#include "ini_file_reader.h"
+#include "ip_trie.h"
+
+#define PREFIX_COUNT 10000
+#define LOOKUP_COUNT 1000000
+
+typedef struct {
+    uint32_t network;  //host order
+    int prefix_len;
+} Prefix;
+
+static Prefix prefixes[PREFIX_COUNT];
+
+static inline uint32_t prefix_mask(const int prefix_len)
+{
+    return prefix_len == 0 ? 0 : (uint32_t)(0xFFFFFFFF << (32 - prefix_len));
+}
+
+static int lookup_ipv4(IPTrie *trie, const char *ip)
+{
+    struct in_addr addr;
+    IPTrieNode *node;
+
+    assert(inet_pton(AF_INET, ip, &addr) == 1);
+    node = ip_trie_lookup(trie, AF_INET, &addr);
+    return node != NULL ? (int)(long)node->data : -1;
+}
+
+static int lookup_ipv6(IPTrie *trie, const char *ip)
+{
+    struct sockaddr_in6 addr;
+    IPTrieNode *node;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin6_family = AF_INET6;
+    assert(inet_pton(AF_INET6, ip, &addr.sin6_addr) == 1);
+    node = ip_trie_lookup_sockaddr(trie, (struct sockaddr *)&addr);
+    return node != NULL ? (int)(long)node->data : -1;
+}
+
+static void test_longest_prefix()
+{
+    IPTrie trie;
+
+    ip_trie_init(&trie);
+    assert(ip_trie_insert_cidr(&trie, "10.0.0.0/8", (void *)8) == 0);
+    assert(ip_trie_insert_cidr(&trie, "10.1.0.0/16", (void *)16) == 0);
+    assert(ip_trie_insert_cidr(&trie, "10.1.2.0/24", (void *)24) == 0);
+    assert(ip_trie_insert_cidr(&trie, "10.1.2.3", (void *)32) == 0);
+    assert(ip_trie_insert_cidr(&trie, "10.1.128.0/17", (void *)17) == 0);
+    assert(ip_trie_insert_cidr(&trie, "2001:db8::/32", (void *)32) == 0);
+    assert(ip_trie_insert_cidr(&trie, "2001:db8:1::/48", (void *)48) == 0);
+    assert(ip_trie_insert_cidr(&trie, "::1", (void *)128) == 0);
+    assert(ip_trie_count(&trie) == 8);
+
+    assert(ip_trie_insert_cidr(&trie, "10.0.0.0/33", NULL) == EINVAL);
+    assert(ip_trie_insert_cidr(&trie, "10.0.0/8", NULL) == EINVAL);
+    assert(ip_trie_insert_cidr(&trie, "10.0.0.0/", NULL) == EINVAL);
+
+    assert(lookup_ipv4(&trie, "10.1.2.3") == 32);
+    assert(lookup_ipv4(&trie, "10.1.2.4") == 24);
+    assert(lookup_ipv4(&trie, "10.1.3.4") == 16);
+    assert(lookup_ipv4(&trie, "10.1.200.4") == 17);
+    assert(lookup_ipv4(&trie, "10.2.3.4") == 8);
+    assert(lookup_ipv4(&trie, "11.1.2.3") == -1);
+    assert(lookup_ipv4(&trie, "0.0.0.0") == -1);
+
+    assert(lookup_ipv6(&trie, "2001:db8:1::5") == 48);
+    assert(lookup_ipv6(&trie, "2001:db8:2::5") == 32);
+    assert(lookup_ipv6(&trie, "2001:db9::5") == -1);
+    assert(lookup_ipv6(&trie, "::1") == 128);
+    assert(lookup_ipv6(&trie, "::2") == -1);
+    assert(lookup_ipv6(&trie, "::ffff:10.1.2.9") == 24);
+
+    //replace the data
+    assert(ip_trie_insert_cidr(&trie, "10.1.0.0/16", (void *)160) == 0);
+    assert(ip_trie_count(&trie) == 8);
+    assert(lookup_ipv4(&trie, "10.1.3.4") == 160);
+
+    assert(ip_trie_insert_cidr(&trie, "0.0.0.0/0", (void *)0) == 0);
+    assert(lookup_ipv4(&trie, "11.1.2.3") == 0);
+    ip_trie_destroy(&trie);
+    assert(ip_trie_count(&trie) == 0);
+}
+
+static int brute_force_lookup(const uint32_t ip)
+{
+    int i;
+    int best;
+
+    best = -1;
+    for (i=0; i<PREFIX_COUNT; i++) {
+        if ((ip & prefix_mask(prefixes[i].prefix_len)) ==
+                prefixes[i].network && (best < 0 ||
+                    prefixes[i].prefix_len > prefixes[best].prefix_len))
+        {
+            best = i;
+        }
+    }
+    return best;
+}
+
+static void test_random()
+{
+    IPTrie trie;
+    IPTrieNode *node;
+    uint32_t ip;
+    in_addr_t addr;
+    int64_t start_time;
+    int found;
+    int i;
+    int k;
+
+    ip_trie_init(&trie);
+    for (i=0; i<PREFIX_COUNT; i++) {
+        //keep the prefixes of the same network bits unique
+        do {
+            prefixes[i].prefix_len = 8 + rand() % 25;
+            prefixes[i].network = ((uint32_t)rand() << 8 | (rand() & 0xFF))
+                & prefix_mask(prefixes[i].prefix_len) & 0x0FFFFFFF;
+            for (k=0; k<i; k++) {
+                if (prefixes[k].network == prefixes[i].network &&
+                        prefixes[k].prefix_len == prefixes[i].prefix_len)
+                {
+                    break;
+                }
+            }
+        } while (k < i);
+
+        addr = htonl(prefixes[i].network);
+        assert(ip_trie_insert(&trie, AF_INET, &addr,
+                    prefixes[i].prefix_len, (void *)(long)i) == 0);
+    }
+    assert(ip_trie_count(&trie) == PREFIX_COUNT);
+
+    for (i=0; i<10000; i++) {
+        if (i % 2 == 0) {
+            k = rand() % PREFIX_COUNT;
+            ip = prefixes[k].network | ((uint32_t)rand() &
+                    ~prefix_mask(prefixes[k].prefix_len));
+        } else {
+            ip = ((uint32_t)rand() << 8 | (rand() & 0xFF)) & 0x0FFFFFFF;
+        }
+        addr = htonl(ip);
+        node = ip_trie_lookup(&trie, AF_INET, &addr);
+        k = brute_force_lookup(ip);
+        assert((node == NULL && k < 0) || (node != NULL && k >= 0 &&
+                    prefixes[(long)node->data].prefix_len ==
+                    prefixes[k].prefix_len));
+    }
+
+    found = 0;
+    start_time = get_current_time_ms();
+    for (i=0; i<LOOKUP_COUNT; i++) {
+        addr = htonl(prefixes[i % PREFIX_COUNT].network | (i & 0xFF));
+        found += ip_trie_contains(&trie, AF_INET, &addr);
+    }
+    printf("ip trie prefix count: %d, lookup count: %d, found: %d, "
+            "time used: %"PRId64" ms\n", PREFIX_COUNT, LOOKUP_COUNT,
+            found, get_current_time_ms() - start_time);
+    assert(found == LOOKUP_COUNT);
+    ip_trie_destroy(&trie);
+}
+
+static void test_load_allow_hosts()
+{
+    char content[256];
+    IniContext context;
+    IPTrie trie;
+
+    strcpy(content, "allow_hosts = 192.168.0.0/16\n"
+            "allow_hosts = 10.0.0.[1-3]\n"
+            "allow_hosts = fe80::/10\n"
+            "allow_hosts = 127.0.0.1\n");
+    assert(iniLoadFromBuffer(content, &context) == 0);
+    ip_trie_init(&trie);
+    assert(load_allow_hosts_to_trie(&context, &trie) == 0);
+    assert(ip_trie_count(&trie) == 6);
+    assert(lookup_ipv4(&trie, "192.168.100.1") == 0);
+    assert(lookup_ipv4(&trie, "10.0.0.3") == 0);
+    assert(lookup_ipv4(&trie, "10.0.0.4") == -1);
+    assert(lookup_ipv4(&trie, "127.0.0.1") == 0);
+    assert(lookup_ipv6(&trie, "fe80::1") == 0);
+    assert(lookup_ipv6(&trie, "fec0::1") == -1);
+    ip_trie_destroy(&trie);
+    iniFreeContext(&context);
+
+    strcpy(content, "allow_hosts = 10.0.0.1\nallow_hosts = *\n");
+    assert(iniLoadFromBuffer(content, &context) == 0);
+    ip_trie_init(&trie);
+    assert(load_allow_hosts_to_trie(&context, &trie) == 0);
+    assert(lookup_ipv4(&trie, "8.8.8.8") == 0);
+    assert(lookup_ipv6(&trie, "2001::1") == 0);
+    ip_trie_destroy(&trie);
+    iniFreeContext(&context);
+}
+
+int main(int argc, char *argv[])
+{
+    log_init();
+    srand(time(NULL));
+    test_longest_prefix();
+    test_random();
+    test_load_allow_hosts();
+    printf("pass OK\n");
+    return 0;
+}
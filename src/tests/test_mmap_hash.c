@@ -0,0 +1,235 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+#include <errno.h>
+#include <unistd.h>
+#include <inttypes.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "logger.h"
+#include "shared_func.h"
+#include "mmap_hash.h"
+
+#define COUNT 100000
+#define HASH_FILENAME "/tmp/test_mmap_hash.dat"
+
+static int walk_count = 0;
+
+static int walk_func(const int index, const MmapHashData *data, void *args)
+{
+    walk_count++;
+    return 0;
+}
+
+static int test_insert(MmapHashArray *hash)
+{
+    int i;
+    int key_len;
+    int value_len;
+    int result;
+    char key[32];
+    char value[64];
+
+    for (i=0; i<COUNT; i++) {
+        key_len = sprintf(key, "key-%d", i);
+        value_len = sprintf(value, "value-%d", i);
+        result = mmap_hash_insert(hash, key, key_len, value, value_len);
+        if (result < 0) {
+            return -1 * result;
+        }
+        assert(result == 1);
+    }
+
+    //update with longer value to reuse the free chain
+    for (i=0; i<COUNT; i+=2) {
+        key_len = sprintf(key, "key-%d", i);
+        value_len = sprintf(value, "value-%d-updated-with-longer-value", i);
+        result = mmap_hash_insert(hash, key, key_len, value, value_len);
+        assert(result == 0);
+    }
+    assert(mmap_hash_count(hash) == COUNT);
+    return 0;
+}
+
+static void test_find(MmapHashArray *hash)
+{
+    int i;
+    int key_len;
+    int value_len;
+    char key[32];
+    char value[64];
+    char expect[64];
+
+    for (i=0; i<COUNT; i++) {
+        key_len = sprintf(key, "key-%d", i);
+        if (i % 2 == 0) {
+            sprintf(expect, "value-%d-updated-with-longer-value", i);
+        } else {
+            sprintf(expect, "value-%d", i);
+        }
+        value_len = sizeof(value) - 1;
+        assert(mmap_hash_get(hash, key, key_len, value, &value_len) == 0);
+        value[value_len] = '\0';
+        assert(strcmp(value, expect) == 0);
+    }
+
+    walk_count = 0;
+    mmap_hash_walk(hash, walk_func, NULL);
+    assert(walk_count == mmap_hash_count(hash));
+}
+
+//the existing key is kept when no space for the larger value
+static void test_no_space()
+{
+    MmapHashArray hash;
+    char key[32];
+    char value[256];
+    int key_len;
+    int value_len;
+    int result;
+    int i;
+
+    unlink(HASH_FILENAME);
+    assert(mmap_hash_init(&hash, HASH_FILENAME, simple_hash,
+                64, 64 * 1024, true) == 0);
+    for (i=0; ; i++) {
+        key_len = sprintf(key, "key-%d", i);
+        result = mmap_hash_insert(&hash, key, key_len, "v", 1);
+        if (result < 0) {
+            break;
+        }
+        assert(result == 1);
+    }
+    assert(result == -ENOSPC && i > 0);
+
+    memset(value, 'x', sizeof(value));
+    assert(mmap_hash_insert(&hash, "key-0", 5, value,
+                sizeof(value)) == -ENOSPC);
+    assert(mmap_hash_count(&hash) == i);
+    value_len = sizeof(value);
+    assert(mmap_hash_get(&hash, "key-0", 5, value, &value_len) == 0);
+    assert(value_len == 1 && value[0] == 'v');
+    mmap_hash_destroy(&hash);
+    unlink(HASH_FILENAME);
+}
+
+//the child exits with the lock held, the lock should be recovered
+static void test_owner_dead()
+{
+    MmapHashArray hash;
+    char value[32];
+    int value_len;
+    pid_t pid;
+    int status;
+
+    unlink(HASH_FILENAME);
+    assert(mmap_hash_init(&hash, HASH_FILENAME, simple_hash,
+                64, 64 * 1024, true) == 0);
+    pid = fork();
+    assert(pid >= 0);
+    if (pid == 0) {
+        pthread_mutex_lock(&hash.header->lock);
+        _exit(0);
+    }
+    waitpid(pid, &status, 0);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    assert(mmap_hash_insert(&hash, "key", 3, "value", 5) == 1);
+    assert(mmap_hash_insert(&hash, "key", 3, "value", 5) == 0);
+    assert(mmap_hash_count(&hash) == 1);
+
+    //unlock without consistent, the lock becomes not recoverable
+    pid = fork();
+    assert(pid >= 0);
+    if (pid == 0) {
+        pthread_mutex_lock(&hash.header->lock);
+        _exit(0);
+    }
+    waitpid(pid, &status, 0);
+    assert(pthread_mutex_lock(&hash.header->lock) == EOWNERDEAD);
+    pthread_mutex_unlock(&hash.header->lock);
+
+    value_len = sizeof(value);
+    assert(mmap_hash_insert(&hash, "key", 3, "value", 5) ==
+            -ENOTRECOVERABLE);
+    assert(mmap_hash_get(&hash, "key", 3, value, &value_len) ==
+            ENOTRECOVERABLE);
+    assert(mmap_hash_delete(&hash, "key", 3) == ENOTRECOVERABLE);
+    assert(mmap_hash_find_ex(&hash, "key", 3) == NULL);
+    assert(mmap_hash_walk(&hash, walk_func, NULL) == ENOTRECOVERABLE);
+    mmap_hash_destroy(&hash);
+    unlink(HASH_FILENAME);
+}
+
+int main(int argc, char *argv[])
+{
+    int result;
+    int status;
+    int64_t start_time;
+    pid_t pid;
+    MmapHashArray hash;
+
+    log_init();
+    unlink(HASH_FILENAME);
+
+    start_time = get_current_time_ms();
+    if ((result=mmap_hash_init(&hash, HASH_FILENAME, simple_hash,
+                    COUNT, 32 * 1024 * 1024, true)) != 0)
+    {
+        return result;
+    }
+    if ((result=test_insert(&hash)) != 0) {
+        return result;
+    }
+    printf("insert time used: %"PRId64" ms\n",
+            get_current_time_ms() - start_time);
+
+    fflush(stdout);
+    pid = fork();
+    if (pid == 0) {
+        //child: attach the table created by the parent
+        MmapHashArray child_hash;
+        if (mmap_hash_init(&child_hash, HASH_FILENAME, simple_hash,
+                    0, 0, true) != 0)
+        {
+            exit(1);
+        }
+        test_find(&child_hash);
+        assert(mmap_hash_delete(&child_hash, "key-1", 5) == 0);
+        mmap_hash_destroy(&child_hash);
+        exit(0);
+    }
+    assert(pid > 0);
+    waitpid(pid, &status, 0);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    assert(mmap_hash_find_ex(&hash, "key-1", 5) == NULL);
+    assert(mmap_hash_count(&hash) == COUNT - 1);
+    mmap_hash_destroy(&hash);
+
+    //reopen after "restart"
+    start_time = get_current_time_ms();
+    if ((result=mmap_hash_init(&hash, HASH_FILENAME, simple_hash,
+                    0, 0, true)) != 0)
+    {
+        return result;
+    }
+    printf("reopen time used: %"PRId64" ms, item count: %d\n",
+            get_current_time_ms() - start_time, mmap_hash_count(&hash));
+    assert(mmap_hash_count(&hash) == COUNT - 1);
+    assert(mmap_hash_insert(&hash, "key-1", 5, "value-1", 7) == 1);
+    test_find(&hash);
+    mmap_hash_destroy(&hash);
+
+    //the hash function must match when reattach
+    assert(mmap_hash_init(&hash, HASH_FILENAME, Time33Hash,
+                0, 0, true) == EINVAL);
+
+    test_no_space();
+    test_owner_dead();
+    unlink(HASH_FILENAME);
+    printf("pass OK\n");
+    return 0;
+}
@@ -0,0 +1,129 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include "logger.h"
+#include "shared_func.h"
+#include "sockopt.h"
+
+#define REQUEST_SIZE 64
+#define RESPONSE_SIZE 256
+#define LOOP_COUNT 100000
+#define NETWORK_TIMEOUT 5
+
+static int server_port;
+
+//the echo server: recv the request then send the response
+static void *server_thread_func(void *arg)
+{
+    char request[REQUEST_SIZE];
+    char response[RESPONSE_SIZE];
+    int listen_sock;
+    int sock;
+    int i;
+
+    listen_sock = (long)arg;
+    sock = accept(listen_sock, NULL, NULL);
+    assert(sock >= 0);
+    tcpsetnodelay(sock, NETWORK_TIMEOUT);
+    for (i=0; i<LOOP_COUNT; i++) {
+        assert(tcprecvdata(sock, request, REQUEST_SIZE,
+                    NETWORK_TIMEOUT) == 0);
+        memset(response, request[0], RESPONSE_SIZE);
+        assert(tcpsenddata(sock, response, RESPONSE_SIZE,
+                    NETWORK_TIMEOUT) == 0);
+    }
+    close(sock);
+    return NULL;
+}
+
+static void test_pingpong(const int listen_sock, const bool optimistic)
+{
+    char request[REQUEST_SIZE];
+    char response[RESPONSE_SIZE];
+    pthread_t tid;
+    int64_t start_time;
+    int64_t time_used;
+    int sock;
+    int count;
+    int i;
+
+    g_tcp_optimistic_io = optimistic;
+    assert(pthread_create(&tid, NULL, server_thread_func,
+                (void *)(long)listen_sock) == 0);
+    sock = socket(AF_INET, SOCK_STREAM, 0);
+    assert(sock >= 0);
+    assert(connectserverbyip(sock, "127.0.0.1", server_port) == 0);
+    tcpsetnodelay(sock, NETWORK_TIMEOUT);
+
+    start_time = get_current_time_ms();
+    for (i=0; i<LOOP_COUNT; i++) {
+        memset(request, 'a' + i % 26, REQUEST_SIZE);
+        assert(tcpsenddata(sock, request, REQUEST_SIZE,
+                    NETWORK_TIMEOUT) == 0);
+        assert(tcprecvdata(sock, response, RESPONSE_SIZE,
+                    NETWORK_TIMEOUT) == 0);
+        assert(response[0] == request[0] &&
+                response[RESPONSE_SIZE - 1] == request[0]);
+    }
+    time_used = get_current_time_ms() - start_time;
+    pthread_join(tid, NULL);
+    printf("%s request/response count: %d, time used: %"PRId64" ms, "
+            "avg latency: %.2f us\n", optimistic ? "optimistic" : "poll first",
+            LOOP_COUNT, time_used,
+            (double)time_used * 1000 / LOOP_COUNT);
+
+    //the peer closed
+    assert(tcprecvdata_ex(sock, response, RESPONSE_SIZE,
+                NETWORK_TIMEOUT, &count) == ENOTCONN);
+    assert(count == 0);
+    close(sock);
+}
+
+static void test_timeout(const int listen_sock)
+{
+    char buff[16];
+    int64_t start_time;
+    int sock;
+    int server;
+    int count;
+
+    sock = socket(AF_INET, SOCK_STREAM, 0);
+    assert(sock >= 0);
+    assert(connectserverbyip(sock, "127.0.0.1", server_port) == 0);
+    server = accept(listen_sock, NULL, NULL);
+    assert(server >= 0);
+
+    //the partial data then timeout
+    assert(tcpsenddata(server, "abc", 3, NETWORK_TIMEOUT) == 0);
+    start_time = get_current_time_ms();
+    assert(tcprecvdata_ex(sock, buff, sizeof(buff), 1, &count) == ETIMEDOUT);
+    assert(count == 3);
+    assert(get_current_time_ms() - start_time >= 900);
+    close(server);
+    close(sock);
+}
+
+int main(int argc, char *argv[])
+{
+    int listen_sock;
+    int result;
+
+    log_init();
+    server_port = 20000 + getpid() % 10000;
+    listen_sock = socketServer("127.0.0.1", server_port, &result);
+    assert(listen_sock >= 0);
+
+    test_pingpong(listen_sock, false);
+    test_pingpong(listen_sock, true);
+    test_timeout(listen_sock);
+
+    close(listen_sock);
+    printf("pass OK\n");
+    return 0;
+}
@@ -0,0 +1,158 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include "logger.h"
+#include "shared_func.h"
+#include "sockopt.h"
+
+#define FILE_SIZE (256 * 1024 * 1024)
+#define SEND_BUFF_SIZE (256 * 1024)
+#define RECV_FILENAME "/tmp/test_recvfile.dat"
+#define NETWORK_TIMEOUT 5
+
+static int server_port;
+
+typedef struct {
+    int64_t bytes;     //the bytes to send
+    int sleep_seconds; //sleep before close
+} SendArgs;
+
+static inline char pattern_char(const int64_t offset)
+{
+    return (char)(offset * 131 + offset / 4096);
+}
+
+static void *send_thread_func(void *arg)
+{
+    SendArgs *args;
+    char *buff;
+    int64_t offset;
+    int bytes;
+    int sock;
+    int i;
+
+    args = (SendArgs *)arg;
+    buff = (char *)malloc(SEND_BUFF_SIZE);
+    assert(buff != NULL);
+    sock = socket(AF_INET, SOCK_STREAM, 0);
+    assert(sock >= 0);
+    assert(connectserverbyip(sock, "127.0.0.1", server_port) == 0);
+
+    offset = 0;
+    while (offset < args->bytes) {
+        bytes = args->bytes - offset < SEND_BUFF_SIZE ?
+            args->bytes - offset : SEND_BUFF_SIZE;
+        for (i=0; i<bytes; i++) {
+            buff[i] = pattern_char(offset + i);
+        }
+        assert(tcpsenddata(sock, buff, bytes, NETWORK_TIMEOUT) == 0);
+        offset += bytes;
+    }
+
+    if (args->sleep_seconds > 0) {
+        sleep(args->sleep_seconds);
+    }
+    close(sock);
+    free(buff);
+    return NULL;
+}
+
+static int recv_file(const int listen_sock, SendArgs *args,
+        const int64_t file_bytes, const int timeout, int64_t *true_bytes)
+{
+    pthread_t tid;
+    int sock;
+    int result;
+
+    assert(pthread_create(&tid, NULL, send_thread_func, args) == 0);
+    sock = accept(listen_sock, NULL, NULL);
+    assert(sock >= 0);
+    result = tcprecvfile(sock, RECV_FILENAME, file_bytes,
+            64 * 1024 * 1024, timeout, true_bytes);
+    close(sock);
+    pthread_join(tid, NULL);
+    return result;
+}
+
+static void check_file(const int64_t file_bytes)
+{
+    char *buff;
+    FILE *fp;
+    int64_t offset;
+    int bytes;
+    int i;
+
+    buff = (char *)malloc(SEND_BUFF_SIZE);
+    assert(buff != NULL);
+    fp = fopen(RECV_FILENAME, "rb");
+    assert(fp != NULL);
+    offset = 0;
+    while ((bytes=fread(buff, 1, SEND_BUFF_SIZE, fp)) > 0) {
+        for (i=0; i<bytes; i++) {
+            assert(buff[i] == pattern_char(offset + i));
+        }
+        offset += bytes;
+    }
+    assert(offset == file_bytes);
+    fclose(fp);
+    free(buff);
+}
+
+static void test_recvfile(const int listen_sock, const bool use_splice)
+{
+    SendArgs args;
+    int64_t true_bytes;
+    int64_t start_time;
+    int64_t time_used;
+
+    g_tcprecvfile_use_splice = use_splice;
+    args.bytes = FILE_SIZE;
+    args.sleep_seconds = 0;
+    start_time = get_current_time_ms();
+    assert(recv_file(listen_sock, &args, FILE_SIZE, NETWORK_TIMEOUT,
+                &true_bytes) == 0);
+    time_used = get_current_time_ms() - start_time;
+    assert(true_bytes == FILE_SIZE);
+    printf("recv file by %s, bytes: %d, time used: %"PRId64" ms, "
+            "throughput: %.2f MB/s\n", use_splice ? "splice" : "copy",
+            FILE_SIZE, time_used, time_used > 0 ? (double)FILE_SIZE /
+            (1024 * 1024) * 1000 / time_used : 0.00);
+    check_file(FILE_SIZE);
+
+    //the peer closes the connection before the file end
+    args.bytes = 1024 * 1024;
+    assert(recv_file(listen_sock, &args, 2 * args.bytes, NETWORK_TIMEOUT,
+                &true_bytes) == ENOTCONN);
+    assert(true_bytes == args.bytes);
+    assert(access(RECV_FILENAME, F_OK) != 0);
+
+    //the recv timeout
+    args.sleep_seconds = 2;
+    assert(recv_file(listen_sock, &args, 2 * args.bytes, 1,
+                &true_bytes) == ETIMEDOUT);
+    assert(access(RECV_FILENAME, F_OK) != 0);
+}
+
+int main(int argc, char *argv[])
+{
+    int listen_sock;
+    int result;
+
+    log_init();
+    server_port = 20000 + getpid() % 10000;
+    listen_sock = socketServer("127.0.0.1", server_port, &result);
+    assert(listen_sock >= 0);
+
+    test_recvfile(listen_sock, false);
+    test_recvfile(listen_sock, true);
+
+    close(listen_sock);
+    printf("pass OK\n");
+    return 0;
+}
@@ -0,0 +1,186 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include "logger.h"
+#include "shared_func.h"
+#include "sockopt.h"
+#include "fast_task_queue.h"
+
+#define HEADER_SIZE 16
+#define BODY_SIZE (4 * 1024 * 1024)
+#define TRAILER_SIZE 8
+#define TOTAL_SIZE (HEADER_SIZE + BODY_SIZE + TRAILER_SIZE)
+#define NETWORK_TIMEOUT 5
+
+static char header[HEADER_SIZE];
+static char trailer[TRAILER_SIZE];
+static char *body;
+
+static int socks[2];
+
+static void init_iovs(struct iovec *iovs)
+{
+    iovs[0].iov_base = header;
+    iovs[0].iov_len = HEADER_SIZE;
+    iovs[1].iov_base = NULL;   //the empty vector
+    iovs[1].iov_len = 0;
+    iovs[2].iov_base = body;
+    iovs[2].iov_len = BODY_SIZE;
+    iovs[3].iov_base = trailer;
+    iovs[3].iov_len = TRAILER_SIZE;
+}
+
+static void *sendv_thread_func(void *arg)
+{
+    struct iovec iovs[4];
+
+    init_iovs(iovs);
+    if (arg != NULL) {
+        assert(tcpsendv_nb(socks[0], iovs, 4, NETWORK_TIMEOUT) == 0);
+    } else {
+        assert(tcpsendv(socks[0], iovs, 4, NETWORK_TIMEOUT) == 0);
+    }
+    return NULL;
+}
+
+static void *task_send_thread_func(void *arg)
+{
+    struct fast_task_info task;
+    struct iovec iovs[4];
+    int result;
+    int calls;
+
+    memset(&task, 0, sizeof(task));
+    task.event.fd = socks[0];
+    init_iovs(iovs);
+    task_set_iovs(&task, iovs, 4);
+
+    calls = 0;
+    while ((result=task_send_iovs(&task)) == EAGAIN) {
+        calls++;
+        usleep(1000);  //wait the write event
+    }
+    assert(result == 0);
+    assert(task.iov_count == 0 && task.iovs == NULL);
+    printf("task_send_iovs, the EAGAIN count: %d\n", calls);
+    return NULL;
+}
+
+static void check_received(char *buff)
+{
+    assert(memcmp(buff, header, HEADER_SIZE) == 0);
+    assert(memcmp(buff + HEADER_SIZE, body, BODY_SIZE) == 0);
+    assert(memcmp(buff + HEADER_SIZE + BODY_SIZE, trailer,
+                TRAILER_SIZE) == 0);
+}
+
+static void test_send_recv(void *(*send_func)(void *), void *arg,
+        const bool recv_nb)
+{
+    pthread_t tid;
+    struct iovec iovs[3];
+    char *buff;
+    int count;
+
+    buff = (char *)malloc(TOTAL_SIZE);
+    assert(buff != NULL);
+    memset(buff, 0, TOTAL_SIZE);
+    assert(pthread_create(&tid, NULL, send_func, arg) == 0);
+
+    //the different split from the sender
+    iovs[0].iov_base = buff;
+    iovs[0].iov_len = 1000;
+    iovs[1].iov_base = buff + 1000;
+    iovs[1].iov_len = BODY_SIZE - 1000;
+    iovs[2].iov_base = buff + BODY_SIZE;
+    iovs[2].iov_len = TOTAL_SIZE - BODY_SIZE;
+    if (recv_nb) {
+        assert(tcprecvv_nb(socks[1], iovs, 3, NETWORK_TIMEOUT, &count) == 0);
+    } else {
+        assert(tcprecvv(socks[1], iovs, 3, NETWORK_TIMEOUT, &count) == 0);
+    }
+    assert(count == TOTAL_SIZE);
+    pthread_join(tid, NULL);
+    check_received(buff);
+    free(buff);
+}
+
+static void test_advance()
+{
+    char buff[32];
+    struct iovec iovs[3];
+    struct iovec *iov;
+    int iovcnt;
+
+    iovs[0].iov_base = buff;
+    iovs[0].iov_len = 4;
+    iovs[1].iov_base = buff + 4;
+    iovs[1].iov_len = 8;
+    iovs[2].iov_base = buff + 12;
+    iovs[2].iov_len = 4;
+
+    iov = iovs;
+    iovcnt = 3;
+    tcpadvanceiov(&iov, &iovcnt, 6);
+    assert(iov == iovs + 1 && iovcnt == 2);
+    assert(iov->iov_base == buff + 6 && iov->iov_len == 6);
+    tcpadvanceiov(&iov, &iovcnt, 6);
+    assert(iov == iovs + 2 && iovcnt == 1 && iov->iov_len == 4);
+    tcpadvanceiov(&iov, &iovcnt, 4);
+    assert(iovcnt == 0);
+}
+
+int main(int argc, char *argv[])
+{
+    struct iovec iov;
+    char buff[16];
+    int sndbuf;
+    int count;
+    int i;
+
+    log_init();
+    body = (char *)malloc(BODY_SIZE);
+    assert(body != NULL);
+    for (i=0; i<BODY_SIZE; i++) {
+        body[i] = (char)(i * 7 + i / 255);
+    }
+    memset(header, 'H', HEADER_SIZE);
+    memset(trailer, 'T', TRAILER_SIZE);
+
+    test_advance();
+
+    //the small send buffer for the partial writes
+    assert(socketpair(AF_UNIX, SOCK_STREAM, 0, socks) == 0);
+    sndbuf = 16 * 1024;
+    setsockopt(socks[0], SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+
+    test_send_recv(sendv_thread_func, NULL, false);
+    assert(tcpsetnonblockopt(socks[0]) == 0);
+    assert(tcpsetnonblockopt(socks[1]) == 0);
+    test_send_recv(sendv_thread_func, (void *)1, true);
+    test_send_recv(task_send_thread_func, NULL, true);
+
+    //the recv timeout
+    iov.iov_base = buff;
+    iov.iov_len = sizeof(buff);
+    assert(tcprecvv_nb(socks[1], &iov, 1, 1, &count) == ETIMEDOUT);
+    assert(count == 0);
+
+    //the peer closed
+    close(socks[0]);
+    iov.iov_base = buff;
+    iov.iov_len = sizeof(buff);
+    assert(tcprecvv_nb(socks[1], &iov, 1, 1, &count) == ENOTCONN);
+    close(socks[1]);
+
+    free(body);
+    printf("pass OK\n");
+    return 0;
+}
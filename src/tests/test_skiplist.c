@@ -6,6 +6,7 @@
 #include <assert.h>
 #include <inttypes.h>
 #include <sys/time.h>
+#include <pthread.h>
 #include "skiplist.h"
 #include "logger.h"
 #include "shared_func.h"
@@ -215,6 +216,384 @@ static int test_stable_sort()
     return 0;
 }
 
+static int test_range()
+{
+#define RANGE_KEYS 1000
+    int i;
+    int result;
+    int key;
+    int last;
+    int start;
+    int end;
+    int delete_count;
+    int values[2 * RANGE_KEYS];
+    Skiplist sl;
+    SkiplistIterator iterator;
+    void *value;
+
+    instance_count = 0;
+    result = skiplist_init_ex(&sl, 12, compare_func,
+            free_test_func, 128, skiplist_type);
+    if (result != 0) {
+        return result;
+    }
+
+    //even keys 0, 2, 4 ... every key twice
+    for (i=0; i<2 * RANGE_KEYS; i++) {
+        values[i] = 2 * (i % RANGE_KEYS);
+        if ((result=skiplist_insert(&sl, values + i)) != 0) {
+            return result;
+        }
+        instance_count++;
+    }
+
+    key = 11;
+    assert(*((int *)skiplist_find_ge(&sl, &key)) == 12);
+    assert(*((int *)skiplist_find_le(&sl, &key)) == 10);
+    key = 12;
+    assert(*((int *)skiplist_find_ge(&sl, &key)) == 12);
+    assert(*((int *)skiplist_find_le(&sl, &key)) == 12);
+    key = -1;
+    assert(skiplist_find_le(&sl, &key) == NULL);
+    key = 2 * RANGE_KEYS;
+    assert(skiplist_find_ge(&sl, &key) == NULL);
+
+    start = 101;
+    end = 201;
+    assert(skiplist_find_range(&sl, &start, &end, &iterator) == 0);
+    i = 0;
+    last = start;
+    while ((value=skiplist_next(&iterator)) != NULL) {
+        assert(*((int *)value) >= last && *((int *)value) < end);
+        last = *((int *)value);
+        i++;
+    }
+    assert(i == 100);
+    assert(skiplist_find_range(&sl, &end, &start, &iterator) == ENOENT);
+    assert(skiplist_next(&iterator) == NULL);
+
+    if (skiplist_reverse_iterator(&sl, &iterator) == 0) {
+        i = 0;
+        last = 2 * RANGE_KEYS;
+        while ((value=skiplist_prev(&iterator)) != NULL) {
+            assert(*((int *)value) <= last);
+            last = *((int *)value);
+            i++;
+        }
+        assert(i == 2 * RANGE_KEYS);
+    }
+
+    assert(skiplist_delete_range(&sl, &start, &end, &delete_count) == 0);
+    assert(delete_count == 100);
+    assert(instance_count == 2 * RANGE_KEYS - 100);
+    key = 150;
+    assert(skiplist_find(&sl, &key) == NULL);
+    assert(*((int *)skiplist_find_ge(&sl, &key)) == 202);
+    assert(*((int *)skiplist_find_le(&sl, &key)) == 100);
+
+    start = 0;
+    end = 2 * RANGE_KEYS;
+    assert(skiplist_find_range(&sl, &start, &end, &iterator) == 0);
+    i = 0;
+    while (skiplist_next(&iterator) != NULL) {
+        i++;
+    }
+    assert(i == 2 * RANGE_KEYS - 100);
+
+    assert(skiplist_delete_range(&sl, &start, &end, &delete_count) == 0);
+    assert(delete_count == 2 * RANGE_KEYS - 100);
+    assert(instance_count == 0);
+
+    skiplist_destroy(&sl);
+    printf("range test OK\n");
+    return 0;
+}
+
+static int test_bulk_load()
+{
+    int i;
+    int result;
+    int64_t start_time;
+    void **sorted;
+    void *value;
+
+    sorted = (void **)malloc(sizeof(void *) * COUNT);
+    for (i=0; i<COUNT; i++) {
+        sorted[numbers[i] - 1] = numbers + i;
+    }
+
+    instance_count = 0;
+    result = skiplist_init_ex(&sl, LEVEL_COUNT, compare_func,
+            free_test_func, MIN_ALLOC_ONCE, skiplist_type);
+    if (result != 0) {
+        return result;
+    }
+
+    start_time = get_current_time_ms();
+    result = skiplist_bulk_load(&sl, sorted, COUNT);
+    if (result == EOPNOTSUPP) {
+        skiplist_destroy(&sl);
+        free(sorted);
+        return 0;
+    }
+    assert(result == 0);
+    instance_count = COUNT;
+    printf("bulk load time used: %"PRId64" ms\n",
+            get_current_time_ms() - start_time);
+
+    start_time = get_current_time_ms();
+    for (i=0; i<COUNT; i++) {
+        value = skiplist_find(&sl, numbers + i);
+        assert(value != NULL && *((int *)value) == numbers[i]);
+    }
+    printf("find after bulk load time used: %"PRId64" ms\n",
+            get_current_time_ms() - start_time);
+
+    i = 0;
+    skiplist_iterator(&sl, &iterator);
+    while ((value=skiplist_next(&iterator)) != NULL) {
+        i++;
+        assert(i == *((int *)value));
+    }
+    assert(i == COUNT);
+
+    assert(skiplist_bulk_load(&sl, sorted, COUNT) == EEXIST);
+    for (i=0; i<COUNT; i+=2) {
+        assert(skiplist_delete(&sl, sorted[i]) == 0);
+    }
+    for (i=0; i<COUNT; i+=2) {
+        assert(skiplist_insert(&sl, sorted[i]) == 0);
+        instance_count++;
+    }
+    i = 0;
+    skiplist_iterator(&sl, &iterator);
+    while ((value=skiplist_next(&iterator)) != NULL) {
+        i++;
+        assert(i == *((int *)value));
+    }
+    assert(i == COUNT);
+
+    skiplist_destroy(&sl);
+    assert(instance_count == 0);
+    free(sorted);
+    return 0;
+}
+
+#define DUP_KEY_COUNT   200
+#define DUP_TIMES       8
+#define DUP_DELETE_TIMES 4
+#define DUP_INSERT_BASE 1000
+#define DUP_INSERT_COUNT 800
+#define DUP_ROUNDS      50
+
+//walk the list in order, return the node count, count the key also
+static int check_duplicate_walk(const int key, int *key_count)
+{
+    int count;
+    int last;
+    void *value;
+
+    count = 0;
+    last = 0;
+    *key_count = 0;
+    assert(skiplist_iterator(&sl, &iterator) == 0);
+    while ((value=skiplist_next(&iterator)) != NULL) {
+        assert(*((int *)value) >= last);
+        last = *((int *)value);
+        if (last == key) {
+            (*key_count)++;
+        }
+        count++;
+    }
+    return count;
+}
+
+//delete the equal keys then insert the others, the nodes must be unlinked
+static int test_duplicate_delete()
+{
+    int keys[DUP_KEY_COUNT + DUP_INSERT_COUNT];
+    int round;
+    int count;
+    int key_count;
+    int i;
+    int k;
+    int result;
+
+    for (i=0; i<DUP_KEY_COUNT; i++) {
+        keys[i] = i + 1;
+    }
+    for (i=0; i<DUP_INSERT_COUNT; i++) {
+        keys[DUP_KEY_COUNT + i] = DUP_INSERT_BASE + i;
+    }
+
+    for (round=0; round<DUP_ROUNDS; round++) {
+        instance_count = 0;
+        if ((result=skiplist_init_ex(&sl, LEVEL_COUNT, compare_func,
+                        free_test_func, MIN_ALLOC_ONCE, skiplist_type)) != 0)
+        {
+            return result;
+        }
+
+        for (k=0; k<DUP_TIMES; k++) {
+            for (i=0; i<DUP_KEY_COUNT; i++) {
+                assert(skiplist_insert(&sl, keys + i) == 0);
+                instance_count++;
+            }
+        }
+        for (k=0; k<DUP_DELETE_TIMES; k++) {
+            for (i=0; i<DUP_KEY_COUNT; i+=2) {
+                assert(skiplist_delete(&sl, keys + i) == 0);
+            }
+        }
+
+        //the deleted nodes must be unlinked from the walk
+        count = check_duplicate_walk(keys[0], &key_count);
+        assert(count == DUP_KEY_COUNT * DUP_TIMES - (DUP_KEY_COUNT / 2) *
+                DUP_DELETE_TIMES);
+        assert(key_count == DUP_TIMES - DUP_DELETE_TIMES);
+
+        for (i=0; i<DUP_INSERT_COUNT; i++) {
+            assert(skiplist_insert(&sl, keys + DUP_KEY_COUNT + i) == 0);
+            instance_count++;
+        }
+
+        count = check_duplicate_walk(keys[1], &key_count);
+        assert(count == DUP_KEY_COUNT * DUP_TIMES - (DUP_KEY_COUNT / 2) *
+                DUP_DELETE_TIMES + DUP_INSERT_COUNT);
+        assert(key_count == DUP_TIMES);
+
+        skiplist_destroy(&sl);
+        assert(instance_count == 0);
+    }
+
+    printf("duplicate delete and reinsert OK\n");
+    return 0;
+}
+
+#define THREAD_COUNT 4
+
+static volatile int instance_total = 0;
+
+static void free_concurrent_func(void *ptr)
+{
+    __sync_sub_and_fetch(&instance_total, 1);
+}
+
+static void *insert_thread_func(void *arg)
+{
+    int i;
+    int start;
+
+    start = (long)arg * (COUNT / THREAD_COUNT);
+    for (i=start; i<start + COUNT / THREAD_COUNT; i++) {
+        assert(skiplist_insert(&sl, numbers + i) == 0);
+        __sync_add_and_fetch(&instance_total, 1);
+    }
+    return NULL;
+}
+
+static void *delete_thread_func(void *arg)
+{
+    int i;
+    int start;
+
+    start = (long)arg * (COUNT / THREAD_COUNT);
+    for (i=start; i<start + COUNT / THREAD_COUNT; i++) {
+        assert(skiplist_delete(&sl, numbers + i) == 0);
+    }
+    return NULL;
+}
+
+static void *find_thread_func(void *arg)
+{
+    int i;
+    int count;
+    int last;
+    void *value;
+    SkiplistIterator it;
+
+    for (i=0; i<COUNT; i++) {
+        value = skiplist_find(&sl, numbers + i);
+        assert(value == NULL || *((int *)value) == numbers[i]);
+    }
+
+    count = 0;
+    last = 0;
+    skiplist_iterator(&sl, &it);
+    while ((value=skiplist_next(&it)) != NULL) {
+        assert(*((int *)value) > last);
+        last = *((int *)value);
+        count++;
+    }
+    printf("reader thread iterate count: %d\n", count);
+    return NULL;
+}
+
+static int run_threads(void *(*func)(void *), const bool with_reader)
+{
+    long i;
+    int result;
+    pthread_t tids[THREAD_COUNT + 1];
+
+    for (i=0; i<THREAD_COUNT; i++) {
+        if ((result=pthread_create(tids + i, NULL, func, (void *)i)) != 0) {
+            return result;
+        }
+    }
+    if (with_reader && (result=pthread_create(tids + THREAD_COUNT,
+                    NULL, find_thread_func, NULL)) != 0)
+    {
+        return result;
+    }
+
+    for (i=0; i<THREAD_COUNT + (with_reader ? 1 : 0); i++) {
+        pthread_join(tids[i], NULL);
+    }
+    return 0;
+}
+
+static int test_concurrent()
+{
+    int i;
+    int result;
+    int64_t start_time;
+    void *value;
+
+    result = skiplist_init_ex(&sl, LEVEL_COUNT, compare_func,
+            free_concurrent_func, MIN_ALLOC_ONCE, skiplist_type);
+    if (result != 0) {
+        return result;
+    }
+
+    start_time = get_current_time_ms();
+    if ((result=run_threads(insert_thread_func, true)) != 0) {
+        return result;
+    }
+    printf("concurrent insert time used: %"PRId64" ms\n",
+            get_current_time_ms() - start_time);
+    assert(sl.u.concurrent.element_count == COUNT);
+
+    i = 0;
+    skiplist_iterator(&sl, &iterator);
+    while ((value=skiplist_next(&iterator)) != NULL) {
+        i++;
+        assert(i == *((int *)value));
+    }
+    assert(i == COUNT);
+
+    start_time = get_current_time_ms();
+    if ((result=run_threads(delete_thread_func, true)) != 0) {
+        return result;
+    }
+    printf("concurrent delete time used: %"PRId64" ms\n",
+            get_current_time_ms() - start_time);
+    assert(sl.u.concurrent.element_count == 0);
+
+    skiplist_destroy(&sl);
+    assert(instance_total == 0);
+    return 0;
+}
+
 int main(int argc, char *argv[])
 {
     int i;
@@ -230,9 +609,21 @@ int main(int argc, char *argv[])
         if (strcasecmp(argv[1], "multi") == 0 || strcmp(argv[1], "1") == 0) {
             skiplist_type = SKIPLIST_TYPE_MULTI;
         }
+        else if (strcasecmp(argv[1], "array") == 0 ||
+                strcmp(argv[1], "2") == 0)
+        {
+            skiplist_type = SKIPLIST_TYPE_ARRAY;
+        }
+        else if (strcasecmp(argv[1], "concurrent") == 0 ||
+                strcmp(argv[1], "3") == 0)
+        {
+            skiplist_type = SKIPLIST_TYPE_CONCURRENT;
+        }
     }
     printf("skiplist type: %s\n",
-            skiplist_type == SKIPLIST_TYPE_FLAT ? "flat" : "multi");
+            skiplist_type == SKIPLIST_TYPE_FLAT ? "flat" :
+            (skiplist_type == SKIPLIST_TYPE_MULTI ? "multi" :
+            (skiplist_type == SKIPLIST_TYPE_ARRAY ? "array" : "concurrent")));
 
     numbers = (int *)malloc(sizeof(int) * COUNT);
     srand(time(NULL));
@@ -252,6 +643,8 @@ int main(int argc, char *argv[])
     }
 
     fast_mblock_manager_init();
+    assert(skiplist_init_ex(&sl, LEVEL_COUNT, compare_func, free_test_func,
+                MIN_ALLOC_ONCE, SKIPLIST_TYPE_CONCURRENT + 1) == EINVAL);
     result = skiplist_init_ex(&sl, LEVEL_COUNT, compare_func,
             free_test_func, MIN_ALLOC_ONCE, skiplist_type);
     if (result != 0) {
@@ -274,6 +667,13 @@ int main(int argc, char *argv[])
     assert(instance_count == 0);
 
     test_stable_sort();
+    test_range();
+    test_bulk_load();
+    test_duplicate_delete();
+
+    if (skiplist_type == SKIPLIST_TYPE_CONCURRENT) {
+        test_concurrent();
+    }
 
     printf("pass OK\n");
     return 0;
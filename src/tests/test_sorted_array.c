@@ -0,0 +1,273 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+#include <inttypes.h>
+#include "logger.h"
+#include "shared_func.h"
+#include "avl_tree.h"
+#include "flat_skiplist.h"
+#include "bplus_tree.h"
+#include "sorted_array.h"
+
+#define COUNT 100000
+#define FIND_LOOP 10
+#define LEVEL_COUNT 16
+
+static int *numbers;
+
+static int compare_func(const void *p1, const void *p2)
+{
+    return *((int *)p1) - *((int *)p2);
+}
+
+static int avl_compare_func(void *p1, void *p2)
+{
+    return *((int *)p1) - *((int *)p2);
+}
+
+static int64_t key_func(const void *data)
+{
+    return *((int *)data);
+}
+
+static void check_array(SortedArray *sa)
+{
+    int i;
+    int value;
+
+    assert(sorted_array_count(sa) == COUNT);
+    for (i=0; i<COUNT; i++) {
+        assert(*((int *)sorted_array_get(sa, i)) == i + 1);
+        assert(*((int *)sorted_array_find(sa, numbers + i)) == numbers[i]);
+    }
+
+    value = 0;
+    assert(sorted_array_find(sa, &value) == NULL);
+    assert(sorted_array_lower_bound(sa, &value) == 0);
+    assert(*((int *)sorted_array_find_ge(sa, &value)) == 1);
+    value = COUNT + 1;
+    assert(sorted_array_find_ge(sa, &value) == NULL);
+    assert(sorted_array_upper_bound(sa, &value) == COUNT);
+}
+
+static void test_sorted_array(sorted_array_key_func key_func)
+{
+    int i;
+    int result;
+    int value;
+    int dups[3];
+    SortedArray sa;
+
+    if ((result=sorted_array_init_ex(&sa, 0, compare_func,
+                    NULL, key_func)) != 0)
+    {
+        exit(result);
+    }
+    for (i=0; i<COUNT; i++) {
+        assert(sorted_array_insert(&sa, numbers + i) == 0);
+    }
+    check_array(&sa);
+
+    //delete the odd numbers
+    for (i=1; i<=COUNT; i+=2) {
+        assert(sorted_array_delete(&sa, &i) == 0);
+        assert(sorted_array_delete(&sa, &i) == ENOENT);
+    }
+    assert(sorted_array_count(&sa) == COUNT / 2);
+    for (i=1; i<=COUNT; i+=2) {
+        assert(sorted_array_lower_bound(&sa, &i) == i / 2);
+        assert(*((int *)sorted_array_find_ge(&sa, &i)) == i + 1);
+    }
+    for (i=0; i<COUNT; i++) {
+        if (numbers[i] % 2 == 1) {
+            assert(sorted_array_insert(&sa, numbers + i) == 0);
+        }
+    }
+    check_array(&sa);
+
+    //stable sort, the equal data are inserted after the existing ones
+    value = COUNT / 2;
+    for (i=0; i<3; i++) {
+        dups[i] = value;
+        assert(sorted_array_insert(&sa, dups + i) == 0);
+    }
+    assert(sorted_array_upper_bound(&sa, &value) == value + 3);
+    assert(sorted_array_lower_bound(&sa, &value) == value - 1);
+    for (i=0; i<3; i++) {
+        assert(sorted_array_get(&sa, value + i) == dups + i);
+    }
+    for (i=0; i<3; i++) {
+        assert(sorted_array_delete_by_index(&sa, value) == 0);
+    }
+    assert(sorted_array_delete_by_index(&sa, COUNT) == EINVAL);
+    check_array(&sa);
+    sorted_array_destroy(&sa);
+}
+
+static void print_result(const char *caption, const int64_t insert_time,
+        const int64_t find_time, const int64_t bytes)
+{
+    printf("%16s  insert: %4"PRId64" ms, find: %4"PRId64" ms, "
+            "memory: %8"PRId64" bytes, %5.1f bytes / element\n",
+            caption, insert_time, find_time, bytes, (double)bytes / COUNT);
+}
+
+static void bench_sorted_array(const char *caption,
+        sorted_array_key_func key_func)
+{
+    int i;
+    int k;
+    int64_t start_time;
+    int64_t insert_time;
+    int64_t bytes;
+    SortedArray sa;
+
+    sorted_array_init_ex(&sa, 0, compare_func, NULL, key_func);
+    start_time = get_current_time_ms();
+    for (i=0; i<COUNT; i++) {
+        sorted_array_insert(&sa, numbers + i);
+    }
+    insert_time = get_current_time_ms() - start_time;
+
+    start_time = get_current_time_ms();
+    for (k=0; k<FIND_LOOP; k++) {
+        for (i=0; i<COUNT; i++) {
+            assert(sorted_array_find(&sa, numbers + i) != NULL);
+        }
+    }
+    bytes = (int64_t)sa.capacity * (sizeof(void *) +
+            (sa.keys != NULL ? sizeof(int64_t) : 0));
+    print_result(caption, insert_time, get_current_time_ms() -
+            start_time, bytes);
+    sorted_array_destroy(&sa);
+}
+
+static void bench_avl_tree()
+{
+    int i;
+    int k;
+    int64_t start_time;
+    int64_t insert_time;
+    AVLTreeInfo tree;
+
+    avl_tree_init(&tree, NULL, avl_compare_func);
+    start_time = get_current_time_ms();
+    for (i=0; i<COUNT; i++) {
+        avl_tree_insert(&tree, numbers + i);
+    }
+    insert_time = get_current_time_ms() - start_time;
+
+    start_time = get_current_time_ms();
+    for (k=0; k<FIND_LOOP; k++) {
+        for (i=0; i<COUNT; i++) {
+            assert(avl_tree_find(&tree, numbers + i) != NULL);
+        }
+    }
+    //malloc overhead excluded
+    print_result("avl_tree", insert_time, get_current_time_ms() -
+            start_time, (int64_t)COUNT * sizeof(AVLTreeNode));
+    avl_tree_destroy(&tree);
+}
+
+static void bench_flat_skiplist()
+{
+    int i;
+    int k;
+    int64_t start_time;
+    int64_t insert_time;
+    int64_t bytes;
+    FlatSkiplist sl;
+
+    flat_skiplist_init(&sl, LEVEL_COUNT, compare_func, NULL);
+    start_time = get_current_time_ms();
+    for (i=0; i<COUNT; i++) {
+        flat_skiplist_insert(&sl, numbers + i);
+    }
+    insert_time = get_current_time_ms() - start_time;
+
+    start_time = get_current_time_ms();
+    for (k=0; k<FIND_LOOP; k++) {
+        for (i=0; i<COUNT; i++) {
+            assert(flat_skiplist_find(&sl, numbers + i) != NULL);
+        }
+    }
+
+    bytes = 0;
+    for (i=0; i<sl.level_count; i++) {
+        bytes += (int64_t)sl.mblocks[i].info.element_used_count *
+            sl.mblocks[i].info.element_size;
+    }
+    print_result("flat_skiplist", insert_time, get_current_time_ms() -
+            start_time, bytes);
+    flat_skiplist_destroy(&sl);
+}
+
+static void bench_bplus_tree()
+{
+    int i;
+    int k;
+    int64_t start_time;
+    int64_t insert_time;
+    int64_t bytes;
+    BPlusTreeInfo tree;
+
+    bplus_tree_init(&tree, NULL, avl_compare_func);
+    start_time = get_current_time_ms();
+    for (i=0; i<COUNT; i++) {
+        bplus_tree_insert(&tree, numbers + i);
+    }
+    insert_time = get_current_time_ms() - start_time;
+
+    start_time = get_current_time_ms();
+    for (k=0; k<FIND_LOOP; k++) {
+        for (i=0; i<COUNT; i++) {
+            assert(bplus_tree_find(&tree, numbers + i) != NULL);
+        }
+    }
+
+    bytes = (int64_t)tree.leaf_allocator.info.element_used_count *
+        tree.leaf_allocator.info.element_size +
+        (int64_t)tree.internal_allocator.info.element_used_count *
+        tree.internal_allocator.info.element_size;
+    print_result("bplus_tree", insert_time, get_current_time_ms() -
+            start_time, bytes);
+    bplus_tree_destroy(&tree);
+}
+
+int main(int argc, char *argv[])
+{
+    int i;
+    int index1;
+    int index2;
+    int tmp;
+
+    log_init();
+    numbers = (int *)malloc(sizeof(int) * COUNT);
+    for (i=0; i<COUNT; i++) {
+        numbers[i] = i + 1;
+    }
+    srand(time(NULL));
+    for (i=0; i<COUNT; i++) {
+        index1 = (COUNT - 1) * (int64_t)rand() / (int64_t)RAND_MAX;
+        index2 = (COUNT - 1) * (int64_t)rand() / (int64_t)RAND_MAX;
+        tmp = numbers[index1];
+        numbers[index1] = numbers[index2];
+        numbers[index2] = tmp;
+    }
+
+    test_sorted_array(NULL);
+    test_sorted_array(key_func);
+
+    printf("%d random numbers, find %d times:\n", COUNT, COUNT * FIND_LOOP);
+    bench_sorted_array("sorted_array", NULL);
+    bench_sorted_array("sorted_array key", key_func);
+    bench_bplus_tree();
+    bench_avl_tree();
+    bench_flat_skiplist();
+
+    free(numbers);
+    printf("pass OK\n");
+    return 0;
+}
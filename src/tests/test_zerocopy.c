@@ -0,0 +1,183 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include "logger.h"
+#include "shared_func.h"
+#include "sockopt.h"
+#include "ioevent_loop.h"
+
+#define DATA_SIZE (8 * 1024 * 1024)
+#define LOOP_COUNT 16
+#define NETWORK_TIMEOUT 5
+
+static int server_port;
+static char *send_buff;
+
+typedef struct {
+    int completions;
+    int copied;
+} DoneStats;
+
+static void done_callback(void *arg, const uint32_t lo,
+        const uint32_t hi, const bool copied)
+{
+    DoneStats *stats;
+
+    stats = (DoneStats *)arg;
+    stats->completions += hi - lo + 1;
+    if (copied) {
+        stats->copied += hi - lo + 1;
+    }
+}
+
+static void *recv_thread_func(void *arg)
+{
+    char *buff;
+    int sock;
+    int i;
+
+    sock = (long)arg;
+    buff = (char *)malloc(DATA_SIZE);
+    assert(buff != NULL);
+    for (i=0; i<LOOP_COUNT; i++) {
+        assert(tcprecvdata(sock, buff, DATA_SIZE, NETWORK_TIMEOUT) == 0);
+        assert(memcmp(buff, send_buff, DATA_SIZE) == 0);
+    }
+    free(buff);
+    return NULL;
+}
+
+static void connect_pair(const int listen_sock, int *client, int *server)
+{
+    *client = socket(AF_INET, SOCK_STREAM, 0);
+    assert(*client >= 0);
+    assert(connectserverbyip(*client, "127.0.0.1", server_port) == 0);
+    *server = accept(listen_sock, NULL, NULL);
+    assert(*server >= 0);
+    assert(tcpsetnonblockopt(*client) == 0);
+}
+
+static void test_send(const int listen_sock, const bool bulk_mode)
+{
+    pthread_t tid;
+    int64_t start_time;
+    int client;
+    int server;
+    int i;
+
+    connect_pair(listen_sock, &client, &server);
+    assert(pthread_create(&tid, NULL, recv_thread_func,
+                (void *)(long)server) == 0);
+
+    g_tcp_bulk_send_mode = bulk_mode;
+    start_time = get_current_time_ms();
+    for (i=0; i<LOOP_COUNT; i++) {
+        assert(tcpsenddata_nb(client, send_buff, DATA_SIZE,
+                    NETWORK_TIMEOUT) == 0);
+    }
+    pthread_join(tid, NULL);
+    g_tcp_bulk_send_mode = false;
+    printf("tcpsenddata_nb %s bulk mode, time used: %"PRId64" ms\n",
+            bulk_mode ? "with" : "without",
+            get_current_time_ms() - start_time);
+    close(client);
+    close(server);
+}
+
+static void test_async(const int listen_sock)
+{
+    TCPZeroCopyContext ctx;
+    DoneStats stats;
+    pthread_t tid;
+    int client;
+    int server;
+    int sent_bytes;
+    int offset;
+    int event;
+    int result;
+    int i;
+    int fallback_sends;
+    uint32_t seq;
+    bool copied;
+
+    connect_pair(listen_sock, &client, &server);
+    memset(&stats, 0, sizeof(stats));
+    fallback_sends = 0;
+    if (tcpzerocopy_init(&ctx, client, done_callback, &stats) != 0) {
+        printf("MSG_ZEROCOPY not supported, skip\n");
+        close(client);
+        close(server);
+        return;
+    }
+
+    assert(pthread_create(&tid, NULL, recv_thread_func,
+                (void *)(long)server) == 0);
+    for (i=0; i<LOOP_COUNT; i++) {
+        offset = 0;
+        while (offset < DATA_SIZE) {
+            result = tcpzerocopy_send(&ctx, send_buff + offset,
+                    DATA_SIZE - offset, &sent_bytes, &seq, &copied);
+            if (result == EAGAIN) {
+                //the completions come as the error event
+                event = ioevent_reap_zerocopy(&ctx, IOEVENT_ERROR);
+                assert(event == IOEVENT_ERROR || event == 0);
+                usleep(100);
+                continue;
+            }
+            assert(result == 0);
+            if (copied) {
+                fallback_sends++;
+            } else {
+                assert(seq == ctx.next_seq - 1);
+            }
+            offset += sent_bytes;
+        }
+
+        //the buffer must be unchanged until all completed
+        assert(tcpzerocopy_wait(&ctx, NETWORK_TIMEOUT) == 0);
+    }
+    pthread_join(tid, NULL);
+
+    assert(tcpzerocopy_all_done(&ctx));
+    assert(stats.completions == (int)ctx.done_count);
+    assert(ctx.done_count == ctx.next_seq);
+    printf("zero copy sends: %u, completions: %d, copied: %d, "
+            "fallback sends: %d\n", ctx.next_seq, stats.completions,
+            stats.copied, fallback_sends);
+    assert(ioevent_reap_zerocopy(&ctx, IOEVENT_READ) == IOEVENT_READ);
+    close(client);
+    close(server);
+}
+
+int main(int argc, char *argv[])
+{
+    int listen_sock;
+    int result;
+    int i;
+
+    log_init();
+    send_buff = (char *)malloc(DATA_SIZE);
+    assert(send_buff != NULL);
+    for (i=0; i<DATA_SIZE; i++) {
+        send_buff[i] = (char)(i * 13 + i / 1024);
+    }
+
+    server_port = 20000 + getpid() % 10000;
+    listen_sock = socketServer("127.0.0.1", server_port, &result);
+    assert(listen_sock >= 0);
+
+    test_async(listen_sock);
+    test_send(listen_sock, false);
+    test_send(listen_sock, true);
+
+    close(listen_sock);
+    free(send_buff);
+    printf("pass OK\n");
+    return 0;
+}